@@ -0,0 +1,228 @@
+/*
+	,---.         .              ,-_/
+	|  -' ,-. ,-. |- ,-. . ,-.   '  | ,-. ,-. . ,
+	|   . ,-| | | |  ,-| | | |      | ,-| |   |/
+	`---' `-^ |-' `' `-^ ' ' '      | `-^ `-' |\
+	          |                  /  |         ' `
+	          '                  `--'
+	          captain jack audio device
+	         github.com/qix-/captainjack
+
+	        copyright (c) 2016 josh junon
+	        released under the MIT license
+*/
+
+/*
+	what the daemon's mix buses cost the process callback: 64
+	clients each sent into one of six submixes (and every
+	fourth into a recorder too), the submixes into a master,
+	and the master into the recorder. the sends are handed
+	over shuffled, so the schedule has to sort them out.
+
+	half_silent_ns is the same graph with every other client
+	silent, which the daemon hands over as NULL buffers.
+	mix_ns and scalar_ns are the per-sample cost of one send,
+	with the mixing kernel and with a plain loop. schedule_us
+	is what a rebuild costs the control thread.
+
+	exits with a failure if a bus doesn't hold what it should.
+*/
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../src/bus.h"
+#include "../src/dsp.h"
+#include "bench.h"
+
+#define kBench_Clients    64
+#define kBench_Submixes   6
+#define kBench_Master     (kBench_Clients + kBench_Submixes)
+#define kBench_Recorder   (kBench_Master + 1)
+#define kBench_Nodes      (kBench_Recorder + 1)
+#define kBench_Rate       48000
+#define kBench_Periods    20000
+#define kBench_Builds     1000
+#define kBench_MaxFrames  1024
+
+static float                   gSamples[kBench_Nodes][kBus_Channels][kBench_MaxFrames];
+static float                  *gBuffers[kBench_Nodes * kBus_Channels];
+static bool                    gIsBus[kBench_Nodes];
+static CaptainJack_BusSend     gSends[kBench_Clients * 2 + kBench_Submixes + 1];
+static size_t                  gSendCount = 0;
+static CaptainJack_BusSchedule gSchedule;
+
+static float Level(int client) {
+	return (float) (client + 1) / 1000.0f;
+}
+
+static void Send(unsigned int from, unsigned int to, float gain) {
+	gSends[gSendCount].from = (uint16_t) from;
+	gSends[gSendCount].to = (uint16_t) to;
+	gSends[gSendCount].gain = gain;
+	gSendCount++;
+}
+
+static void BuildGraph(void) {
+	for (int c = 0; c < kBench_Clients; c++) {
+		Send((unsigned int) c, kBench_Clients + c % kBench_Submixes, 0.5f);
+		if (c % 4 == 0) {
+			Send((unsigned int) c, kBench_Recorder, 0.25f);
+		}
+	}
+
+	for (int s = 0; s < kBench_Submixes; s++) {
+		gIsBus[kBench_Clients + s] = true;
+		Send(kBench_Clients + s, kBench_Master, 0.8f);
+	}
+
+	gIsBus[kBench_Master] = true;
+	gIsBus[kBench_Recorder] = true;
+	Send(kBench_Master, kBench_Recorder, 0.5f);
+
+	// downstream sends first, so nothing about the order given is any help
+	srand(1);
+	for (size_t i = gSendCount - 1; i > 0; i--) {
+		size_t j = (size_t) rand() % (i + 1);
+		CaptainJack_BusSend swap = gSends[i];
+		gSends[i] = gSends[j];
+		gSends[j] = swap;
+	}
+}
+
+static void SetSources(bool halfSilent) {
+	for (int node = 0; node < kBench_Nodes; node++) {
+		for (int channel = 0; channel < kBus_Channels; channel++) {
+			bool silent = node < kBench_Clients && halfSilent && node % 2 == 1;
+			gBuffers[node * kBus_Channels + channel] = silent ? NULL : gSamples[node][channel];
+
+			if (node < kBench_Clients) {
+				for (int i = 0; i < kBench_MaxFrames; i++) {
+					gSamples[node][channel][i] = Level(node);
+				}
+			}
+		}
+	}
+}
+
+static bool Check(void) {
+	float submixes[kBench_Submixes] = { 0 };
+	float recorder = 0.0f;
+
+	for (int c = 0; c < kBench_Clients; c++) {
+		submixes[c % kBench_Submixes] += 0.5f * Level(c);
+		recorder += c % 4 == 0 ? 0.25f * Level(c) : 0.0f;
+	}
+
+	float master = 0.0f;
+	for (int s = 0; s < kBench_Submixes; s++) {
+		master += 0.8f * submixes[s];
+	}
+	recorder += 0.5f * master;
+
+	CaptainJack_RunBuses(&gSchedule, gBuffers, kBench_MaxFrames);
+
+	bool correct = true;
+	for (int channel = 0; channel < kBus_Channels; channel++) {
+		for (int s = 0; s < kBench_Submixes; s++) {
+			correct = correct && fabsf(gSamples[kBench_Clients + s][channel][kBench_MaxFrames - 1] - submixes[s]) < 1e-5f;
+		}
+		correct = correct && fabsf(gSamples[kBench_Master][channel][0] - master) < 1e-5f;
+		correct = correct && fabsf(gSamples[kBench_Recorder][channel][kBench_MaxFrames / 2] - recorder) < 1e-5f;
+	}
+
+	return correct;
+}
+
+static double Time(unsigned int frames) {
+	uint64_t total = 0;
+
+	for (int period = 0; period < kBench_Periods; period++) {
+		uint64_t start = Bench_Now();
+		CaptainJack_RunBuses(&gSchedule, gBuffers, frames);
+		total += Bench_Now() - start;
+		Bench_Consume(gSamples);
+	}
+
+	return (double) total / kBench_Periods;
+}
+
+static void Scalar(float *out, const float *in, size_t count, float gain) {
+	for (size_t i = 0; i < count; i++) {
+		out[i] += in[i] * gain;
+	}
+}
+
+static double TimeSend(bool scalar) {
+	uint64_t total = 0;
+
+	for (int period = 0; period < kBench_Periods; period++) {
+		uint64_t start = Bench_Now();
+		if (scalar) {
+			Scalar(gSamples[kBench_Master][0], gSamples[0][0], 256, 0.5f);
+		} else {
+			CaptainJack_MixInto(gSamples[kBench_Master][0], gSamples[0][0], 256, 0.5f);
+		}
+		total += Bench_Now() - start;
+		Bench_Consume(gSamples);
+	}
+
+	return (double) total / kBench_Periods / 256.0;
+}
+
+static double TimeSchedule(void) {
+	uint64_t start = Bench_Now();
+	for (int build = 0; build < kBench_Builds; build++) {
+		CaptainJack_ScheduleBuses(&gSchedule, gIsBus, kBench_Nodes, gSends, gSendCount);
+		Bench_Consume(&gSchedule);
+	}
+
+	return (double) (Bench_Now() - start) / kBench_Builds / 1000.0;
+}
+
+int main(void) {
+	static const unsigned int periods[] = { 64, 128, 256, 512, 1024 };
+
+	BuildGraph();
+	if (!CaptainJack_ScheduleBuses(&gSchedule, gIsBus, kBench_Nodes, gSends, gSendCount)) {
+		fprintf(stderr, "bench-bus: could not schedule the graph\n");
+		return EXIT_FAILURE;
+	}
+
+	SetSources(false);
+	bool correct = Check();
+
+	printf("{\"benchmark\":\"bus\",\"clients\":%d,\"buses\":%u,\"sends\":%u,\"correct\":%s,\"schedule_us\":%.2f,\"mix_ns\":%.3f,\"scalar_ns\":%.3f,\"rate\":%d,\"periods\":[",
+		kBench_Clients,
+		gSchedule.busCount,
+		gSchedule.sendCount,
+		correct ? "true" : "false",
+		TimeSchedule(),
+		TimeSend(false),
+		TimeSend(true),
+		kBench_Rate);
+
+	for (size_t p = 0; p < sizeof(periods) / sizeof(periods[0]); p++) {
+		unsigned int frames = periods[p];
+		double budget = 1e9 * frames / kBench_Rate;
+
+		SetSources(false);
+		double all = Time(frames);
+		SetSources(true);
+		double halfSilent = Time(frames);
+
+		printf("%s{\"frames\":%u,\"period_us\":%.1f,\"mean_ns\":%.1f,\"half_silent_ns\":%.1f,\"mean_percent\":%.3f}",
+			p ? "," : "",
+			frames,
+			budget / 1000.0,
+			all,
+			halfSilent,
+			100.0 * all / budget);
+	}
+
+	printf("]}\n");
+	return correct ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,170 @@
+/*
+	,---.         .              ,-_/
+	|  -' ,-. ,-. |- ,-. . ,-.   '  | ,-. ,-. . ,
+	|   . ,-| | | |  ,-| | | |      | ,-| |   |/
+	`---' `-^ |-' `' `-^ ' ' '      | `-^ `-' |\
+	          |                  /  |         ' `
+	          '                  `--'
+	          captain jack audio device
+	         github.com/qix-/captainjack
+
+	        copyright (c) 2016 josh junon
+	        released under the MIT license
+*/
+
+/*
+	reader contention on the device configuration: 8 threads
+	reading it as fast as they can while one thread keeps
+	changing the sample rate, first with everything behind a mutex
+	(what the device used to do) and then through a config
+	cell.
+
+	every 64th read is timed on its own for the percentiles;
+	reads_per_sec counts all of them.
+*/
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../src/config.h"
+#include "bench.h"
+
+#define kBench_Readers  8
+#define kBench_Duration 300000000ull
+#define kBench_Samples  65536
+
+typedef struct {
+	const char *name;
+	double      readsPerSec;
+	double      writesPerSec;
+	uint64_t    p50;
+	uint64_t    p99;
+	uint64_t    p999;
+	uint64_t    worst;
+} Result;
+
+typedef struct {
+	uint64_t reads;
+	size_t   count;
+	uint64_t samples[kBench_Samples];
+} Reader;
+
+static pthread_mutex_t        gLock   = PTHREAD_MUTEX_INITIALIZER;
+static CaptainJack_Config     gLocked = { .sampleRate = 44100.0 };
+static CaptainJack_ConfigCell gCell   = CAPTAIN_JACK_CONFIG_CELL({ .sampleRate = 44100.0 });
+
+static bool     gUseCell;
+static uint32_t gRunning;
+static Reader   gReaders[kBench_Readers];
+
+static void Read(CaptainJack_Config *config) {
+	if (gUseCell) {
+		CaptainJack_ReadConfig(&gCell, config);
+	} else {
+		pthread_mutex_lock(&gLock);
+		*config = gLocked;
+		pthread_mutex_unlock(&gLock);
+	}
+}
+
+static void Write(double rate) {
+	if (gUseCell) {
+		CaptainJack_BeginConfig(&gCell)->sampleRate = rate;
+		CaptainJack_CommitConfig(&gCell);
+	} else {
+		pthread_mutex_lock(&gLock);
+		gLocked.sampleRate = rate;
+		pthread_mutex_unlock(&gLock);
+	}
+}
+
+static void * ReadLoop(void *arg) {
+	Reader *reader = arg;
+	CaptainJack_Config config;
+
+	while (!__atomic_load_n(&gRunning, __ATOMIC_ACQUIRE)) {
+		sched_yield();
+	}
+
+	while (__atomic_load_n(&gRunning, __ATOMIC_RELAXED) == 1) {
+		if ((reader->reads & 63) == 0 && reader->count < kBench_Samples) {
+			uint64_t start = Bench_Now();
+			Read(&config);
+			reader->samples[reader->count++] = Bench_Now() - start;
+		} else {
+			Read(&config);
+		}
+
+		Bench_Consume(&config);
+		reader->reads++;
+	}
+
+	return NULL;
+}
+
+static Result Run(const char *name, bool useCell) {
+	gUseCell = useCell;
+	gRunning = 0;
+
+	pthread_t threads[kBench_Readers];
+	for (int i = 0; i < kBench_Readers; i++) {
+		gReaders[i].reads = 0;
+		gReaders[i].count = 0;
+		pthread_create(&threads[i], NULL, &ReadLoop, &gReaders[i]);
+	}
+
+	__atomic_store_n(&gRunning, 1, __ATOMIC_RELEASE);
+
+	uint64_t writes = 0;
+	uint64_t start = Bench_Now();
+	uint64_t elapsed;
+	while ((elapsed = Bench_Now() - start) < kBench_Duration) {
+		Write((writes & 1) ? 48000.0 : 44100.0);
+		writes++;
+	}
+
+	__atomic_store_n(&gRunning, 2, __ATOMIC_RELEASE);
+
+	static uint64_t samples[kBench_Readers * kBench_Samples];
+	size_t count = 0;
+	uint64_t reads = 0;
+	for (int i = 0; i < kBench_Readers; i++) {
+		pthread_join(threads[i], NULL);
+		for (size_t j = 0; j < gReaders[i].count; j++) {
+			samples[count++] = gReaders[i].samples[j];
+		}
+		reads += gReaders[i].reads;
+	}
+
+	double seconds = (double) elapsed / 1e9;
+	Result result = {
+		.name = name,
+		.readsPerSec = (double) reads / seconds,
+		.writesPerSec = (double) writes / seconds,
+		.p50 = Bench_Percentile(samples, count, 50.0),
+		.p99 = Bench_Percentile(samples, count, 99.0),
+		.p999 = Bench_Percentile(samples, count, 99.9),
+		.worst = count > 0 ? samples[count - 1] : 0
+	};
+	return result;
+}
+
+int main(void) {
+	Result results[] = {
+		Run("mutex", false),
+		Run("cell", true)
+	};
+
+	printf("{\"benchmark\":\"config\",\"readers\":%d", kBench_Readers);
+	for (size_t i = 0; i < sizeof(results) / sizeof(results[0]); i++) {
+		printf(",\"%s\":{\"reads_per_sec\":%.0f,\"writes_per_sec\":%.0f,\"read_p50_ns\":%llu,\"read_p99_ns\":%llu,\"read_p999_ns\":%llu,\"read_worst_ns\":%llu}",
+			results[i].name, results[i].readsPerSec, results[i].writesPerSec,
+			(unsigned long long) results[i].p50, (unsigned long long) results[i].p99,
+			(unsigned long long) results[i].p999, (unsigned long long) results[i].worst);
+	}
+	printf("}\n");
+
+	return EXIT_SUCCESS;
+}
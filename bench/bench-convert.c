@@ -0,0 +1,163 @@
+/*
+	,---.         .              ,-_/
+	|  -' ,-. ,-. |- ,-. . ,-.   '  | ,-. ,-. . ,
+	|   . ,-| | | |  ,-| | | |      | ,-| |   |/
+	`---' `-^ |-' `' `-^ ' ' '      | `-^ `-' |\
+	          |                  /  |         ' `
+	          '                  `--'
+	          captain jack audio device
+	         github.com/qix-/captainjack
+
+	        copyright (c) 2016 josh junon
+	        released under the MIT license
+*/
+
+/*
+	times the sample format conversions per sample, each way,
+	with and without dither, next to a plain scalar loop doing
+	the float to integer direction for comparison.
+
+	max_error_lsb is the worst round trip error (float to
+	integer and back) in units of the integer format's least
+	significant bit: at most 0.5 undithered, 1.5 dithered.
+*/
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../src/convert.h"
+#include "bench.h"
+
+#define kBench_Samples  4096
+#define kBench_Batches  7
+#define kBench_Reps     200
+
+static float   gInput[kBench_Samples];
+static float   gOutput[kBench_Samples];
+static uint8_t gPacked[kBench_Samples * 4];
+
+static const struct {
+	const char              *name;
+	CaptainJack_SampleFormat format;
+} kFormats[] = {
+	{ "int16", kSampleFormat_Int16 },
+	{ "int24", kSampleFormat_Int24 },
+	{ "int32", kSampleFormat_Int32 }
+};
+
+typedef enum {
+	kKernel_From,
+	kKernel_FromDither,
+	kKernel_To,
+	kKernel_Scalar
+} Kernel;
+
+static void Scalar(CaptainJack_SampleFormat format) {
+	float scale = (float) (1u << (CaptainJack_SampleBits(format) - 1));
+	float top = format == kSampleFormat_Int32 ? 2147483520.0f : scale - 1.0f;
+
+	for (size_t i = 0; i < kBench_Samples; i++) {
+		float x = gInput[i] * scale;
+		x = x > top ? top : (x < -scale ? -scale : x);
+		int32_t value = (int32_t) lrintf(x);
+
+		switch (format) {
+		case kSampleFormat_Int16: {
+			int16_t sample = (int16_t) value;
+			memcpy(&gPacked[i * 2], &sample, 2);
+			break;
+		}
+
+		case kSampleFormat_Int24:
+			memcpy(&gPacked[i * 3], &value, 3);
+			break;
+
+		default:
+			memcpy(&gPacked[i * 4], &value, 4);
+			break;
+		}
+	}
+}
+
+static double Time(Kernel kernel, CaptainJack_SampleFormat format, CaptainJack_Dither *dither) {
+	double fastest = 0.0;
+
+	for (int batch = 0; batch < kBench_Batches; batch++) {
+		uint64_t start = Bench_Now();
+		for (int rep = 0; rep < kBench_Reps; rep++) {
+			switch (kernel) {
+			case kKernel_From:
+				CaptainJack_FromFloat(gInput, gPacked, kBench_Samples, format, NULL);
+				break;
+
+			case kKernel_FromDither:
+				CaptainJack_FromFloat(gInput, gPacked, kBench_Samples, format, dither);
+				break;
+
+			case kKernel_To:
+				CaptainJack_ToFloat(gPacked, gOutput, kBench_Samples, format);
+				break;
+
+			case kKernel_Scalar:
+				Scalar(format);
+				break;
+			}
+			Bench_Consume(gPacked);
+			Bench_Consume(gOutput);
+		}
+
+		double elapsed = (double) (Bench_Now() - start) / ((double) kBench_Reps * kBench_Samples);
+		if (batch == 0 || elapsed < fastest) {
+			fastest = elapsed;
+		}
+	}
+
+	return fastest;
+}
+
+static double RoundTripError(CaptainJack_SampleFormat format, CaptainJack_Dither *dither) {
+	float lsb = 1.0f / (float) (1u << (CaptainJack_SampleBits(format) - 1));
+
+	CaptainJack_FromFloat(gInput, gPacked, kBench_Samples, format, dither);
+	CaptainJack_ToFloat(gPacked, gOutput, kBench_Samples, format);
+
+	double worst = 0.0;
+	for (size_t i = 0; i < kBench_Samples; i++) {
+		double error = fabs((double) gOutput[i] - (double) gInput[i]) / lsb;
+		worst = error > worst ? error : worst;
+	}
+
+	return worst;
+}
+
+int main(void) {
+	// a loud sine with a little headroom, so nothing clips
+	for (size_t i = 0; i < kBench_Samples; i++) {
+		gInput[i] = 0.9f * sinf((float) i * 0.0123f);
+	}
+
+	CaptainJack_Dither dither;
+	CaptainJack_SeedDither(&dither, 1);
+
+	printf("{\"benchmark\":\"convert\",\"samples\":%d,\"formats\":[", kBench_Samples);
+
+	for (size_t f = 0; f < sizeof(kFormats) / sizeof(kFormats[0]); f++) {
+		CaptainJack_SampleFormat format = kFormats[f].format;
+
+		printf("%s{\"format\":\"%s\",\"bytes_per_frame\":%u,\"from_ns\":%.3f,\"from_dither_ns\":%.3f,\"to_ns\":%.3f,\"scalar_from_ns\":%.3f,\"max_error_lsb\":%.3f,\"max_error_dither_lsb\":%.3f}",
+			f ? "," : "",
+			kFormats[f].name,
+			2 * CaptainJack_SampleBytes(format),
+			Time(kKernel_From, format, NULL),
+			Time(kKernel_FromDither, format, &dither),
+			Time(kKernel_To, format, NULL),
+			Time(kKernel_Scalar, format, NULL),
+			RoundTripError(format, NULL),
+			RoundTripError(format, &dither));
+	}
+
+	printf("]}\n");
+	return EXIT_SUCCESS;
+}
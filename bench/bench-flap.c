@@ -0,0 +1,308 @@
+/*
+	,---.         .              ,-_/
+	|  -' ,-. ,-. |- ,-. . ,-.   '  | ,-. ,-. . ,
+	|   . ,-| | | |  ,-| | | |      | ,-| |   |/
+	`---' `-^ |-' `' `-^ ' ' '      | `-^ `-' |\
+	          |                  /  |         ' `
+	          '                  `--'
+	          captain jack audio device
+	         github.com/qix-/captainjack
+
+	        copyright (c) 2016 josh junon
+	        released under the MIT license
+*/
+
+
+/*
+	an app that starts and stops IO around every sound it
+	makes, played to the real xmit subsystem with a forked
+	stand-in daemon counting what arrives.
+
+	"blips" stops for less than the device's coalescing
+	window between sounds, so all but the first StartIO and
+	the last StopIO should cancel out; "pauses" stops for
+	longer, so every one of them should go through. either
+	way the daemon has to end up knowing every client has
+	stopped.
+
+	"restarts" restarts the daemon while a StopIO is held and
+	starts the client again inside the window once it's back.
+	the snapshot the new daemon gets already says the client
+	stopped, so the StartIO has to reach it as well.
+*/
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "../src/xmit.h"
+#include "bench.h"
+
+#define kBench_Clients          8
+#define kBench_WindowMs         20
+#define kBench_Restarts         20
+#define kBench_RestartWindowMs  200
+
+typedef struct {
+	bool     connected;
+	bool     done;
+	uint64_t readies;
+	uint64_t clients;
+	uint64_t enables;
+	uint64_t disables;
+	bool     io[kBench_Clients + 1];
+} Shared;
+
+static Shared *gShared = NULL;
+
+static void OnReady(void) {
+	__atomic_add_fetch(&gShared->readies, 1, __ATOMIC_RELEASE);
+}
+
+static void OnNewClient(unsigned int cid, pid_t pid) {
+	__atomic_add_fetch(&gShared->clients, 1, __ATOMIC_RELEASE);
+}
+
+static void OnDCClient(unsigned int cid, pid_t pid) {
+}
+
+static void OnEnableIO(unsigned int cid) {
+	gShared->io[cid] = true;
+	gShared->enables++;
+}
+
+static void OnDisableIO(unsigned int cid) {
+	gShared->io[cid] = false;
+	gShared->disables++;
+}
+
+static void OnSilence(unsigned int cid, bool silent) {
+}
+
+static void OnSnapshot(const CaptainJack_XmitClient *clients, unsigned int count) {
+	__atomic_store_n(&gShared->connected, true, __ATOMIC_RELEASE);
+}
+
+static CaptainJack_Xmitter gReceiver = {
+	&OnReady,
+	&OnNewClient,
+	&OnDCClient,
+	&OnEnableIO,
+	&OnDisableIO,
+	&OnSilence,
+	&OnSnapshot,
+};
+
+static void Receive(void) {
+	CaptainJack_RegisterXmitterClient(&gReceiver);
+
+	while (!__atomic_load_n(&gShared->done, __ATOMIC_ACQUIRE)) {
+		if (!CaptainJack_TickXmitter()) {
+			usleep(1000);
+		}
+	}
+
+	_exit(EXIT_SUCCESS);
+}
+
+// everything sent before this has arrived once it returns
+static void Barrier(CaptainJack_Xmitter *device) {
+	uint64_t target = __atomic_load_n(&gShared->readies, __ATOMIC_ACQUIRE) + 1;
+	device->do_device_ready();
+	while (__atomic_load_n(&gShared->readies, __ATOMIC_ACQUIRE) < target) {
+		usleep(100);
+	}
+}
+
+static bool Flap(CaptainJack_Xmitter *device, const char *name, int flaps, unsigned int onMicros, unsigned int offMicros, bool first) {
+	gShared->enables = 0;
+	gShared->disables = 0;
+
+	uint64_t start = Bench_Now();
+	for (int flap = 0; flap < flaps; flap++) {
+		for (unsigned int cid = 1; cid <= kBench_Clients; cid++) {
+			device->do_client_enable_io(cid);
+		}
+		usleep(onMicros);
+
+		for (unsigned int cid = 1; cid <= kBench_Clients; cid++) {
+			device->do_client_disable_io(cid);
+		}
+		usleep(offMicros);
+	}
+	double wall = (double) (Bench_Now() - start) / 1e6;
+
+	// the last stops are held for the window too
+	usleep(3 * kBench_WindowMs * 1000);
+	Barrier(device);
+
+	bool stopped = true;
+	for (unsigned int cid = 1; cid <= kBench_Clients; cid++) {
+		stopped = stopped && !gShared->io[cid];
+	}
+
+	uint64_t calls = 2ull * flaps * kBench_Clients;
+	uint64_t sent = gShared->enables + gShared->disables;
+	bool paired = gShared->enables == gShared->disables && gShared->enables >= kBench_Clients;
+
+	printf("%s{\"pattern\":\"%s\",\"flaps\":%d,\"on_ms\":%.1f,\"off_ms\":%.1f,\"calls\":%llu,\"sent\":%llu,\"coalesced\":%llu,\"coalesced_percent\":%.1f,\"wall_ms\":%.1f,\"stopped\":%s}",
+		first ? "" : ",",
+		name,
+		flaps,
+		onMicros / 1000.0,
+		offMicros / 1000.0,
+		(unsigned long long) calls,
+		(unsigned long long) sent,
+		(unsigned long long) (calls - sent),
+		100.0 * (double) (calls - sent) / (double) calls,
+		wall,
+		stopped ? "true" : "false");
+
+	return stopped && paired && sent <= calls;
+}
+
+typedef struct {
+	bool synced;
+	bool io;
+} Daemon;
+
+static void OnDaemonReady(void *context) {
+}
+
+static void OnDaemonPIDCID(void *context, unsigned int cid, pid_t pid) {
+}
+
+static void OnDaemonEnableIO(void *context, unsigned int cid) {
+	((Daemon *) context)->io = true;
+}
+
+static void OnDaemonDisableIO(void *context, unsigned int cid) {
+	((Daemon *) context)->io = false;
+}
+
+static void OnDaemonSilence(void *context, unsigned int cid, bool silent) {
+}
+
+static void OnDaemonSnapshot(void *context, const CaptainJack_XmitClient *clients, unsigned int count) {
+	Daemon *daemon = context;
+	daemon->synced = true;
+	daemon->io = count > 0 && clients[0].io;
+}
+
+static const CaptainJack_XmitHandlers kDaemonHandlers = {
+	&OnDaemonReady,
+	&OnDaemonPIDCID,
+	&OnDaemonPIDCID,
+	&OnDaemonEnableIO,
+	&OnDaemonDisableIO,
+	&OnDaemonSilence,
+	&OnDaemonSnapshot,
+};
+
+// ticks until `done` is set or `micros` have gone by
+static void TickUntil(CaptainJack_XmitConnection *connection, const bool *done, unsigned int micros) {
+	uint64_t deadline = Bench_Now() + micros * 1000ull;
+	while (!*done && Bench_Now() < deadline) {
+		if (!CaptainJack_TickXmitConnection(connection)) {
+			usleep(1000);
+		} else {
+			usleep(100);
+		}
+	}
+}
+
+static CaptainJack_XmitConnection * StartDaemon(Daemon *daemon, const CaptainJack_XmitOptions *options) {
+	memset(daemon, 0, sizeof(*daemon));
+	CaptainJack_XmitConnection *connection = CaptainJack_OpenXmitConnection(&kDaemonHandlers, daemon, options);
+	TickUntil(connection, &daemon->synced, 5000000);
+	return connection;
+}
+
+/*
+	a server and daemons of its own on the next port over, so
+	the forked daemon above never sees any of it
+*/
+static unsigned int Restarts(void) {
+	CaptainJack_XmitOptions options;
+	CaptainJack_InitXmitOptions(&options);
+	options.port = kXmit_Port + 1;
+	options.coalesceMillis = kBench_RestartWindowMs;
+
+	CaptainJack_XmitServer *server = CaptainJack_StartXmitServer(&options);
+	if (server == NULL) {
+		return kBench_Restarts;
+	}
+	CaptainJack_XmitClientConnect(server, 1, 1001);
+
+	Daemon daemon;
+	CaptainJack_XmitConnection *connection = StartDaemon(&daemon, &options);
+	unsigned int wrong = 0;
+
+	for (int round = 0; round < kBench_Restarts; round++) {
+		CaptainJack_XmitClientEnableIO(server, 1);
+		TickUntil(connection, &daemon.io, 1000000);
+
+		// held for the window, and the daemon goes away while it is
+		CaptainJack_XmitClientDisableIO(server, 1);
+		usleep(1000);
+		CaptainJack_CloseXmitConnection(connection);
+		connection = StartDaemon(&daemon, &options);
+
+		CaptainJack_XmitClientEnableIO(server, 1);
+		TickUntil(connection, &daemon.io, 2 * kBench_RestartWindowMs * 1000);
+		wrong += !daemon.io;
+	}
+
+	CaptainJack_CloseXmitConnection(connection);
+	CaptainJack_StopXmitServer(server);
+	return wrong;
+}
+
+int main(void) {
+	char window[16];
+	snprintf(window, sizeof(window), "%d", kBench_WindowMs);
+	setenv("CAPTAIN_JACK_IO_COALESCE_MS", window, 1);
+
+	gShared = mmap(NULL, sizeof(*gShared), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (gShared == MAP_FAILED) {
+		perror("bench-flap: could not map shared memory");
+		return EXIT_FAILURE;
+	}
+
+	pid_t child = fork();
+	if (child < 0) {
+		perror("bench-flap: could not fork");
+		return EXIT_FAILURE;
+	} else if (child == 0) {
+		Receive();
+	}
+
+	CaptainJack_Xmitter *device = CaptainJack_GetXmitterServer();
+	while (!__atomic_load_n(&gShared->connected, __ATOMIC_ACQUIRE)) {
+		usleep(1000);
+	}
+
+	for (unsigned int cid = 1; cid <= kBench_Clients; cid++) {
+		device->do_client_connect(cid, (pid_t) (1000 + cid));
+	}
+	Barrier(device);
+
+	printf("{\"benchmark\":\"flap\",\"clients\":%d,\"window_ms\":%d,\"patterns\":[", kBench_Clients, kBench_WindowMs);
+
+	bool correct = Flap(device, "blips", 100, 2000, 5000, true);
+	correct = Flap(device, "pauses", 10, 2000, 4 * kBench_WindowMs * 1000, false) && correct;
+
+	unsigned int wrong = Restarts();
+	correct = correct && wrong == 0;
+
+	printf("],\"restarts\":{\"rounds\":%d,\"window_ms\":%d,\"wrong\":%u},\"correct\":%s}\n", kBench_Restarts, kBench_RestartWindowMs, wrong, correct ? "true" : "false");
+
+	__atomic_store_n(&gShared->done, true, __ATOMIC_RELEASE);
+	waitpid(child, NULL, 0);
+
+	return correct ? EXIT_SUCCESS : EXIT_FAILURE;
+}
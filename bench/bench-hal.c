@@ -0,0 +1,297 @@
+/*
+	,---.         .              ,-_/
+	|  -' ,-. ,-. |- ,-. . ,-.   '  | ,-. ,-. . ,
+	|   . ,-| | | |  ,-| | | |      | ,-| |   |/
+	`---' `-^ |-' `' `-^ ' ' '      | `-^ `-' |\
+	          |                  /  |         ' `
+	          '                  `--'
+	          captain jack audio device
+	         github.com/qix-/captainjack
+
+	        copyright (c) 2016 josh junon
+	        released under the MIT license
+*/
+
+/*
+	plays coreaudiod to the real device, built against the
+	stand-in headers in sim/.
+
+	it loads the driver through CaptainJack_Create(), brings
+	it up like the HAL does, and runs IO cycles on a fixed
+	period: a zero time stamp, then begin/do/end for reading
+	and converting input, for processing the client's output
+	and for converting and writing the mix. every callback
+	is timed into a log2 histogram.
+
+	the device talks to a daemon as soon as it's initialized,
+	so a forked child stands in for that by ticking the
+	xmitter with a client that does nothing.
+*/
+
+#include <errno.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <CoreAudio/AudioServerPlugIn.h>
+
+#include "../src/xmit.h"
+#include "bench.h"
+
+#define kBench_Cycles       1000
+#define kBench_FrameSize    128
+#define kBench_Channels     2
+#define kBench_Buckets      32
+#define kBench_Operations   5
+
+// object IDs from captain-jack-device.c
+#define kBench_Device       3
+#define kBench_InputStream  4
+#define kBench_OutputStream 8
+#define kBench_Client       1
+
+typedef enum {
+	kCallback_GetZeroTimeStamp = 0,
+	kCallback_BeginIOOperation,
+	kCallback_DoIOOperation,
+	kCallback_EndIOOperation,
+	kCallback_Cycle,
+	kCallback_Count
+} Callback;
+
+typedef struct {
+	const char *name;
+	uint64_t    buckets[kBench_Buckets];
+	uint64_t    total;
+	uint64_t    worst;
+	size_t      count;
+	uint64_t   *samples;
+} Timing;
+
+void *CaptainJack_Create(CFAllocatorRef inAllocator, CFUUIDRef inRequestedTypeUUID);
+
+static AudioServerPlugInDriverRef gDriver = NULL;
+static unsigned int               gPropertiesChanged = 0;
+
+static Timing gTimings[kCallback_Count] = {
+	{ .name = "GetZeroTimeStamp" },
+	{ .name = "BeginIOOperation" },
+	{ .name = "DoIOOperation" },
+	{ .name = "EndIOOperation" },
+	{ .name = "cycle" },
+};
+
+static OSStatus Host_PropertiesChanged(AudioServerPlugInHostRef inHost, AudioObjectID inObjectID, UInt32 inNumberAddresses, const AudioObjectPropertyAddress *inAddresses) {
+	__atomic_add_fetch(&gPropertiesChanged, inNumberAddresses, __ATOMIC_RELAXED);
+	return 0;
+}
+
+static OSStatus Host_CopyFromStorage(AudioServerPlugInHostRef inHost, CFStringRef inKey, CFPropertyListRef *outData) {
+	*outData = NULL;
+	return 0;
+}
+
+static OSStatus Host_WriteToStorage(AudioServerPlugInHostRef inHost, CFStringRef inKey, CFPropertyListRef inData) {
+	return 0;
+}
+
+static OSStatus Host_DeleteFromStorage(AudioServerPlugInHostRef inHost, CFStringRef inKey) {
+	return 0;
+}
+
+static OSStatus Host_RequestDeviceConfigurationChange(AudioServerPlugInHostRef inHost, AudioObjectID inDeviceObjectID, UInt64 inChangeAction, void *inChangeInfo) {
+	return (*gDriver)->PerformDeviceConfigurationChange(gDriver, inDeviceObjectID, inChangeAction, inChangeInfo);
+}
+
+static const AudioServerPlugInHostInterface gHost = {
+	&Host_PropertiesChanged,
+	&Host_CopyFromStorage,
+	&Host_WriteToStorage,
+	&Host_DeleteFromStorage,
+	&Host_RequestDeviceConfigurationChange,
+};
+
+static void Daemon_Ready(void) {
+}
+
+static void Daemon_PIDCID(unsigned int cid, pid_t pid) {
+}
+
+static void Daemon_CID(unsigned int cid) {
+}
+
+static void Daemon_Silence(unsigned int cid, bool silent) {
+}
+
+static void Daemon_Snapshot(const CaptainJack_XmitClient *clients, unsigned int count) {
+}
+
+static CaptainJack_Xmitter gDaemon = {
+	&Daemon_Ready,
+	&Daemon_PIDCID,
+	&Daemon_PIDCID,
+	&Daemon_CID,
+	&Daemon_CID,
+	&Daemon_Silence,
+	&Daemon_Snapshot,
+};
+
+static void RunDaemon(void) {
+	CaptainJack_RegisterXmitterClient(&gDaemon);
+
+	for (;;) {
+		if (!CaptainJack_TickXmitter()) {
+			usleep(1000);
+		} else {
+			usleep(100);
+		}
+	}
+}
+
+static void Record(Callback callback, uint64_t elapsed) {
+	Timing *timing = &gTimings[callback];
+
+	int bucket = elapsed == 0 ? 0 : 64 - __builtin_clzll(elapsed);
+	timing->buckets[bucket < kBench_Buckets ? bucket : kBench_Buckets - 1]++;
+	timing->total += elapsed;
+	if (elapsed > timing->worst) {
+		timing->worst = elapsed;
+	}
+	timing->samples[timing->count++] = elapsed;
+}
+
+static void Check(OSStatus status, const char *what) {
+	if (status != 0) {
+		fprintf(stderr, "bench-hal: %s failed: %d\n", what, (int) status);
+		exit(EXIT_FAILURE);
+	}
+}
+
+static void RunOperation(UInt32 operation, AudioObjectID stream, const AudioServerPlugInIOCycleInfo *cycle, float *buffer) {
+	uint64_t start = Bench_Now();
+	Check((*gDriver)->BeginIOOperation(gDriver, kBench_Device, kBench_Client, operation, kBench_FrameSize, cycle), "BeginIOOperation");
+	uint64_t began = Bench_Now();
+	Check((*gDriver)->DoIOOperation(gDriver, kBench_Device, stream, kBench_Client, operation, kBench_FrameSize, cycle, buffer, NULL), "DoIOOperation");
+	uint64_t done = Bench_Now();
+	Check((*gDriver)->EndIOOperation(gDriver, kBench_Device, kBench_Client, operation, kBench_FrameSize, cycle), "EndIOOperation");
+	uint64_t ended = Bench_Now();
+
+	Record(kCallback_BeginIOOperation, began - start);
+	Record(kCallback_DoIOOperation, done - began);
+	Record(kCallback_EndIOOperation, ended - done);
+}
+
+int main(void) {
+	static float buffer[kBench_FrameSize * kBench_Channels];
+
+	for (int i = 0; i < kCallback_Count; i++) {
+		gTimings[i].samples = calloc(kBench_Cycles * kBench_Operations, sizeof(uint64_t));
+		if (gTimings[i].samples == NULL) {
+			perror("bench-hal: could not allocate samples");
+			return EXIT_FAILURE;
+		}
+	}
+
+	pid_t daemon = fork();
+	if (daemon < 0) {
+		perror("bench-hal: could not fork");
+		return EXIT_FAILURE;
+	} else if (daemon == 0) {
+		RunDaemon();
+	}
+
+	gDriver = CaptainJack_Create(NULL, kAudioServerPlugInTypeUUID);
+	if (gDriver == NULL) {
+		fprintf(stderr, "bench-hal: the driver didn't recognize the plug-in type\n");
+		return EXIT_FAILURE;
+	}
+
+	AudioServerPlugInClientInfo client = { kBench_Client, getpid(), true, NULL };
+
+	Check((*gDriver)->Initialize(gDriver, &gHost), "Initialize");
+	Check((*gDriver)->AddDeviceClient(gDriver, kBench_Device, &client), "AddDeviceClient");
+	Check((*gDriver)->StartIO(gDriver, kBench_Device, kBench_Client), "StartIO");
+
+	Float64 sampleRate = 0.0;
+	UInt32 size = sizeof(sampleRate);
+	AudioObjectPropertyAddress rateAddress = { kAudioDevicePropertyNominalSampleRate, kAudioObjectPropertyScopeGlobal, kAudioObjectPropertyElementMaster };
+	Check((*gDriver)->GetPropertyData(gDriver, kBench_Device, getpid(), &rateAddress, 0, NULL, size, &size, &sampleRate), "GetPropertyData");
+
+	uint64_t period = (uint64_t) (1e9 * kBench_FrameSize / sampleRate);
+	uint64_t deadline = Bench_Now();
+	uint64_t late = 0;
+	AudioServerPlugInIOCycleInfo cycle = { 0 };
+	cycle.mNominalIOBufferFrameSize = kBench_FrameSize;
+
+	for (int i = 0; i < kBench_Cycles; i++) {
+		deadline += period;
+		uint64_t now = Bench_Now();
+		if (now < deadline) {
+			struct timespec wait = { 0, (long) (deadline - now) };
+			while (nanosleep(&wait, &wait) != 0 && errno == EINTR);
+		} else {
+			late++;
+		}
+
+		uint64_t start = Bench_Now();
+
+		Float64 sampleTime;
+		UInt64 hostTime;
+		UInt64 seed;
+		Check((*gDriver)->GetZeroTimeStamp(gDriver, kBench_Device, kBench_Client, &sampleTime, &hostTime, &seed), "GetZeroTimeStamp");
+		Record(kCallback_GetZeroTimeStamp, Bench_Now() - start);
+
+		cycle.mIOCycleCounter = (UInt64) i;
+		cycle.mCurrentTime.mHostTime = start;
+
+		RunOperation(kAudioServerPlugInIOOperationReadInput, kBench_InputStream, &cycle, buffer);
+		RunOperation(kAudioServerPlugInIOOperationConvertInput, kBench_InputStream, &cycle, buffer);
+		RunOperation(kAudioServerPlugInIOOperationProcessOutput, kBench_OutputStream, &cycle, buffer);
+		RunOperation(kAudioServerPlugInIOOperationConvertMix, kBench_OutputStream, &cycle, buffer);
+		RunOperation(kAudioServerPlugInIOOperationWriteMix, kBench_OutputStream, &cycle, buffer);
+
+		Record(kCallback_Cycle, Bench_Now() - start);
+	}
+
+	Check((*gDriver)->StopIO(gDriver, kBench_Device, kBench_Client), "StopIO");
+	Check((*gDriver)->RemoveDeviceClient(gDriver, kBench_Device, &client), "RemoveDeviceClient");
+
+	kill(daemon, SIGTERM);
+	waitpid(daemon, NULL, 0);
+
+	printf("{\"benchmark\":\"hal\",\"cycles\":%d,\"frames\":%d,\"rate\":%.0f,\"period_us\":%.1f,\"late_cycles\":%llu,\"callbacks\":[",
+		kBench_Cycles,
+		kBench_FrameSize,
+		sampleRate,
+		period / 1000.0,
+		(unsigned long long) late);
+
+	for (int i = 0; i < kCallback_Count; i++) {
+		Timing *timing = &gTimings[i];
+		printf("%s{\"name\":\"%s\",\"calls\":%zu,\"mean_ns\":%.1f,\"p50_ns\":%llu,\"p99_ns\":%llu,\"p999_ns\":%llu,\"worst_ns\":%llu,\"histogram\":{",
+			i ? "," : "",
+			timing->name,
+			timing->count,
+			(double) timing->total / timing->count,
+			(unsigned long long) Bench_Percentile(timing->samples, timing->count, 50.0),
+			(unsigned long long) Bench_Percentile(timing->samples, timing->count, 99.0),
+			(unsigned long long) Bench_Percentile(timing->samples, timing->count, 99.9),
+			(unsigned long long) timing->worst);
+
+		// keyed by the bucket's upper bound in ns; empty buckets are left out
+		bool first = true;
+		for (int b = 0; b < kBench_Buckets; b++) {
+			if (timing->buckets[b] != 0) {
+				printf("%s\"%llu\":%llu", first ? "" : ",", 1ull << b, (unsigned long long) timing->buckets[b]);
+				first = false;
+			}
+		}
+		printf("}}");
+	}
+
+	printf("]}\n");
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,160 @@
+/*
+	,---.         .              ,-_/
+	|  -' ,-. ,-. |- ,-. . ,-.   '  | ,-. ,-. . ,
+	|   . ,-| | | |  ,-| | | |      | ,-| |   |/
+	`---' `-^ |-' `' `-^ ' ' '      | `-^ `-' |\
+	          |                  /  |         ' `
+	          '                  `--'
+	          captain jack audio device
+	         github.com/qix-/captainjack
+
+	        copyright (c) 2016 josh junon
+	        released under the MIT license
+*/
+
+/*
+	hammers the two ways the control thread hands things to
+	the JACK process thread, one thread on each side.
+
+	the triple buffer carries blocks that are filled with
+	their sequence number throughout: the reader checks it
+	never sees a block that's half one and half another, or
+	one older than the last. the command queue carries
+	numbered commands, which have to come out whole, all of
+	them, in order.
+
+	`make tsan` builds and runs this under ThreadSanitizer,
+	which has to stay quiet. errors make it exit with a
+	failure either way.
+*/
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../src/spsc.h"
+#include "../src/triple.h"
+#include "bench.h"
+
+#define kBench_Blocks    1000000
+#define kBench_Commands  2000000
+#define kBench_Words     64
+#define kBench_Capacity  256
+
+typedef struct {
+	uint64_t words[kBench_Words];
+} Block;
+
+typedef struct {
+	uint64_t seq;
+	uint64_t check;
+} Command;
+
+static Block                    gBlocks[3];
+static CaptainJack_TripleBuffer gTriple;
+static Command                  gItems[kBench_Capacity];
+static CaptainJack_SPSCQueue    gQueue;
+static uint64_t                 gWriterDone = 0;
+
+static void * Writer(void *arg) {
+	for (uint64_t seq = 1; seq <= kBench_Blocks; seq++) {
+		Block *block = CaptainJack_TripleBufferBack(&gTriple);
+		for (int i = 0; i < kBench_Words; i++) {
+			block->words[i] = seq;
+		}
+		CaptainJack_PublishTripleBuffer(&gTriple);
+	}
+
+	__atomic_store_n(&gWriterDone, 1, __ATOMIC_RELEASE);
+	return NULL;
+}
+
+static void * Producer(void *arg) {
+	for (uint64_t seq = 1; seq <= kBench_Commands; seq++) {
+		Command command = { seq, ~seq };
+		while (!CaptainJack_PushSPSC(&gQueue, &command)) {
+			sched_yield();
+		}
+	}
+
+	return NULL;
+}
+
+int main(void) {
+	CaptainJack_InitTripleBuffer(&gTriple, &gBlocks[0], &gBlocks[1], &gBlocks[2]);
+	CaptainJack_InitSPSCQueue(&gQueue, gItems, kBench_Capacity, sizeof(gItems[0]));
+
+	pthread_t thread;
+	uint64_t torn = 0;
+	uint64_t backwards = 0;
+	uint64_t reads = 0;
+	uint64_t fresh = 0;
+	uint64_t last = 0;
+
+	uint64_t start = Bench_Now();
+	pthread_create(&thread, NULL, &Writer, NULL);
+
+	for (bool done = false; !done;) {
+		// checked before reading, so the read after the writer's finished sees its last block
+		done = __atomic_load_n(&gWriterDone, __ATOMIC_ACQUIRE) != 0;
+
+		bool updated;
+		const Block *block = CaptainJack_ReadTripleBuffer(&gTriple, &updated);
+		reads++;
+		fresh += updated;
+
+		uint64_t seq = block->words[0];
+		for (int i = 1; i < kBench_Words; i++) {
+			torn += block->words[i] != seq;
+		}
+		backwards += seq < last;
+		last = seq;
+	}
+
+	pthread_join(thread, NULL);
+	double tripleSeconds = (double) (Bench_Now() - start) / 1e9;
+	bool tripleLast = last == kBench_Blocks;
+
+	uint64_t broken = 0;
+	uint64_t missing = 0;
+	uint64_t expected = 1;
+
+	start = Bench_Now();
+	pthread_create(&thread, NULL, &Producer, NULL);
+
+	while (expected <= kBench_Commands) {
+		Command command;
+		if (!CaptainJack_PopSPSC(&gQueue, &command)) {
+			sched_yield();
+			continue;
+		}
+
+		broken += command.check != ~command.seq;
+		missing += command.seq != expected;
+		expected = command.seq + 1;
+	}
+
+	pthread_join(thread, NULL);
+	double queueSeconds = (double) (Bench_Now() - start) / 1e9;
+
+	bool correct = torn == 0 && backwards == 0 && tripleLast && broken == 0 && missing == 0;
+
+	printf("{\"benchmark\":\"handoff\",\"triple\":{\"blocks\":%d,\"block_bytes\":%zu,\"reads\":%llu,\"fresh_reads\":%llu,\"torn\":%llu,\"backwards\":%llu,\"saw_last\":%s,\"blocks_per_sec\":%.0f},\"queue\":{\"commands\":%d,\"capacity\":%d,\"broken\":%llu,\"out_of_order\":%llu,\"commands_per_sec\":%.0f},\"correct\":%s}\n",
+		kBench_Blocks,
+		sizeof(Block),
+		(unsigned long long) reads,
+		(unsigned long long) fresh,
+		(unsigned long long) torn,
+		(unsigned long long) backwards,
+		tripleLast ? "true" : "false",
+		kBench_Blocks / tripleSeconds,
+		kBench_Commands,
+		kBench_Capacity,
+		(unsigned long long) broken,
+		(unsigned long long) missing,
+		kBench_Commands / queueSeconds,
+		correct ? "true" : "false");
+
+	return correct ? EXIT_SUCCESS : EXIT_FAILURE;
+}
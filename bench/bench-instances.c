@@ -0,0 +1,290 @@
+/*
+	,---.         .              ,-_/
+	|  -' ,-. ,-. |- ,-. . ,-.   '  | ,-. ,-. . ,
+	|   . ,-| | | |  ,-| | | |      | ,-| |   |/
+	`---' `-^ |-' `' `-^ ' ' '      | `-^ `-' |\
+	          |                  /  |         ' `
+	          '                  `--'
+	          captain jack audio device
+	         github.com/qix-/captainjack
+
+	        copyright (c) 2016 josh junon
+	        released under the MIT license
+*/
+
+
+/*
+	runs several xmit instances side by side in one process:
+	each is a server and a connection of its own, talking over
+	a unix socket of its own (through the transport hooks) and
+	stamping messages with the benchmark's clock (through the
+	clock hook). every instance has a sender thread, its server's
+	xmit thread and a receiver thread ticking its connection.
+
+	instances share nothing but the stats, so the work scales
+	linearly: cpu_ns_per_msg (the whole process's CPU time per
+	message) stays flat however many there are, and msgs_per_sec
+	grows with them until the machine runs out of cores to give
+	them (three each, when they're all busy). scaling is
+	msgs_per_sec over what one instance managed on its own.
+
+	every message carries its instance in the client ID and its
+	place in the stream in the rest, so one turning up anywhere
+	else, or out of order, is counted as wrong.
+*/
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../src/xmit.h"
+#include "bench.h"
+
+#define kBench_Messages   10000
+#define kBench_InFlight   256
+#define kBench_Burst      32
+#define kBench_MaxCount   16
+#define kBench_Shift      20
+#define kBench_Deadline   30000000000ull
+
+typedef struct {
+	unsigned int                index;
+	struct sockaddr_un          addr;
+	CaptainJack_XmitServer     *server;
+	CaptainJack_XmitConnection *connection;
+	pthread_t                   sender;
+	pthread_t                   receiver;
+	bool                        synced;
+	bool                        go;
+	uint64_t                    received;
+	uint64_t                    wrong;
+	uint64_t                    finished;
+	uint64_t                    deadline;
+} Instance;
+
+static Instance gInstances[kBench_MaxCount];
+
+static int Listen(void *context) {
+	Instance *instance = context;
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0) {
+		return -1;
+	}
+
+	unlink(instance->addr.sun_path);
+	if (bind(fd, (const struct sockaddr *) &instance->addr, sizeof(instance->addr)) != 0 || listen(fd, 2) != 0) {
+		close(fd);
+		return -1;
+	}
+
+	return fd;
+}
+
+static int Connect(void *context) {
+	Instance *instance = context;
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0) {
+		return -1;
+	}
+
+	if (connect(fd, (const struct sockaddr *) &instance->addr, sizeof(instance->addr)) != 0) {
+		close(fd);
+		return -1;
+	}
+
+	return fd;
+}
+
+static uint64_t Now(void *context) {
+	return Bench_Now();
+}
+
+static void OnReady(void *context) {
+}
+
+static void OnPIDCID(void *context, unsigned int cid, pid_t pid) {
+	__atomic_add_fetch(&((Instance *) context)->wrong, 1, __ATOMIC_RELAXED);
+}
+
+static void OnCID(void *context, unsigned int cid) {
+	Instance *instance = context;
+	uint64_t index = instance->received;
+
+	if (cid != ((instance->index << kBench_Shift) | (unsigned int) index)) {
+		__atomic_add_fetch(&instance->wrong, 1, __ATOMIC_RELAXED);
+	}
+
+	__atomic_store_n(&instance->received, index + 1, __ATOMIC_RELEASE);
+}
+
+static void OnSilence(void *context, unsigned int cid, bool silent) {
+	__atomic_add_fetch(&((Instance *) context)->wrong, 1, __ATOMIC_RELAXED);
+}
+
+static void OnSnapshot(void *context, const CaptainJack_XmitClient *clients, unsigned int count) {
+	__atomic_store_n(&((Instance *) context)->synced, true, __ATOMIC_RELEASE);
+}
+
+static const CaptainJack_XmitHandlers kHandlers = {
+	&OnReady,
+	&OnPIDCID,
+	&OnPIDCID,
+	&OnCID,
+	&OnCID,
+	&OnSilence,
+	&OnSnapshot,
+};
+
+static void * Receive(void *arg) {
+	Instance *instance = arg;
+
+	while (__atomic_load_n(&instance->received, __ATOMIC_ACQUIRE) < kBench_Messages && Bench_Now() < instance->deadline) {
+		uint64_t before = instance->received;
+		CaptainJack_TickXmitConnection(instance->connection);
+
+		// sleep rather than yield so the other threads sharing our core get to run
+		if (instance->received == before) {
+			usleep(10);
+		}
+	}
+
+	instance->finished = Bench_Now();
+	return NULL;
+}
+
+static void * Send(void *arg) {
+	Instance *instance = arg;
+
+	while (!__atomic_load_n(&instance->go, __ATOMIC_ACQUIRE)) {
+		usleep(10);
+	}
+
+	for (unsigned int sent = 0; sent < kBench_Messages;) {
+		// stays well inside the server's window, so nothing is ever dropped
+		while (sent - __atomic_load_n(&instance->received, __ATOMIC_ACQUIRE) >= kBench_InFlight) {
+			if (Bench_Now() >= instance->deadline) {
+				return NULL;
+			}
+			usleep(10);
+		}
+
+		for (unsigned int i = 0; i < kBench_Burst && sent < kBench_Messages; i++, sent++) {
+			CaptainJack_XmitClientEnableIO(instance->server, (instance->index << kBench_Shift) | sent);
+		}
+	}
+
+	return NULL;
+}
+
+static double ProcessTime(void) {
+	struct timespec now;
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &now);
+	return (double) now.tv_sec * 1e9 + (double) now.tv_nsec;
+}
+
+static bool Run(unsigned int count, double *rate, double *cpu) {
+	CaptainJack_XmitOptions options;
+	CaptainJack_InitXmitOptions(&options);
+	options.hooks.listen = &Listen;
+	options.hooks.connect = &Connect;
+	options.hooks.now = &Now;
+
+	// this is about the instances; bench-flap is the one about holding back StopIO
+	options.coalesceMillis = 0;
+
+	*rate = 0.0;
+	*cpu = 0.0;
+
+	uint64_t deadline = Bench_Now() + kBench_Deadline;
+	for (unsigned int i = 0; i < count; i++) {
+		Instance *instance = &gInstances[i];
+		memset(instance, 0, sizeof(*instance));
+		instance->index = i;
+		instance->deadline = deadline;
+		instance->addr.sun_family = AF_UNIX;
+		snprintf(instance->addr.sun_path, sizeof(instance->addr.sun_path), "/tmp/cj-bench-%d-%u.sock", (int) getpid(), i);
+
+		options.hooks.context = instance;
+		instance->server = CaptainJack_StartXmitServer(&options);
+		instance->connection = CaptainJack_OpenXmitConnection(&kHandlers, instance, &options);
+		if (instance->server == NULL || instance->connection == NULL) {
+			fprintf(stderr, "bench-instances: could not start instance %u\n", i);
+			return false;
+		}
+
+		pthread_create(&instance->receiver, NULL, &Receive, instance);
+		pthread_create(&instance->sender, NULL, &Send, instance);
+	}
+
+	// everyone connected, and past the snapshot that starts every connection
+	for (unsigned int i = 0; i < count; i++) {
+		while (!__atomic_load_n(&gInstances[i].synced, __ATOMIC_ACQUIRE) && Bench_Now() < deadline) {
+			usleep(100);
+		}
+	}
+
+	uint64_t start = Bench_Now();
+	double cpuStart = ProcessTime();
+	for (unsigned int i = 0; i < count; i++) {
+		__atomic_store_n(&gInstances[i].go, true, __ATOMIC_RELEASE);
+	}
+
+	uint64_t end = start;
+	bool correct = true;
+	for (unsigned int i = 0; i < count; i++) {
+		Instance *instance = &gInstances[i];
+		pthread_join(instance->sender, NULL);
+		pthread_join(instance->receiver, NULL);
+
+		end = instance->finished > end ? instance->finished : end;
+		correct = correct && instance->received == kBench_Messages && instance->wrong == 0;
+	}
+
+	*cpu = (ProcessTime() - cpuStart) / ((double) count * kBench_Messages);
+	*rate = 1e9 * count * kBench_Messages / (double) (end - start);
+
+	for (unsigned int i = 0; i < count; i++) {
+		CaptainJack_CloseXmitConnection(gInstances[i].connection);
+		CaptainJack_StopXmitServer(gInstances[i].server);
+		unlink(gInstances[i].addr.sun_path);
+	}
+
+	return correct;
+}
+
+int main(void) {
+	static const unsigned int counts[] = { 1, 2, 4, 8, 16 };
+
+	printf("{\"benchmark\":\"instances\",\"messages\":%d,\"cpus\":%ld,\"results\":[", kBench_Messages, sysconf(_SC_NPROCESSORS_ONLN));
+
+	bool correct = true;
+	double single = 0.0;
+	for (size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); c++) {
+		double rate;
+		double cpu;
+		bool ok = Run(counts[c], &rate, &cpu);
+		correct = correct && ok;
+
+		if (c == 0) {
+			single = rate;
+		}
+
+		printf("%s{\"instances\":%u,\"msgs_per_sec\":%.0f,\"per_instance_msgs_per_sec\":%.0f,\"scaling\":%.2f,\"cpu_ns_per_msg\":%.0f,\"correct\":%s}",
+			c ? "," : "",
+			counts[c],
+			rate,
+			rate / counts[c],
+			rate / single,
+			cpu,
+			ok ? "true" : "false");
+	}
+
+	printf("]}\n");
+	return correct ? EXIT_SUCCESS : EXIT_FAILURE;
+}
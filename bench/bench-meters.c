@@ -0,0 +1,117 @@
+/*
+	,---.         .              ,-_/
+	|  -' ,-. ,-. |- ,-. . ,-.   '  | ,-. ,-. . ,
+	|   . ,-| | | |  ,-| | | |      | ,-| |   |/
+	`---' `-^ |-' `' `-^ ' ' '      | `-^ `-' |\
+	          |                  /  |         ' `
+	          '                  `--'
+	          captain jack audio device
+	         github.com/qix-/captainjack
+
+	        copyright (c) 2016 josh junon
+	        released under the MIT license
+*/
+
+/*
+	times the per-period metering work the daemon's process
+	callback does (measure both channels of every client,
+	fold into the accumulators, publish through the triple
+	buffer) for 64 clients and reports it as a share of the
+	period at 48kHz.
+*/
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../src/dsp.h"
+#include "../src/triple.h"
+#include "bench.h"
+
+#define kBench_Clients    64
+#define kBench_Channels   2
+#define kBench_Rate       48000
+#define kBench_Periods    20000
+
+typedef struct {
+	float    peak[kBench_Channels];
+	double   squares[kBench_Channels];
+	uint64_t frames;
+} Level;
+
+typedef struct {
+	Level clients[kBench_Clients];
+} Frame;
+
+static float  gSamples[kBench_Clients][kBench_Channels][1024];
+static Level  gLevels[kBench_Clients];
+static Frame  gFrames[3];
+
+int main(void) {
+	static const unsigned int periods[] = { 64, 128, 256, 512, 1024 };
+
+	srand(1);
+	for (int c = 0; c < kBench_Clients; c++) {
+		for (int ch = 0; ch < kBench_Channels; ch++) {
+			for (int i = 0; i < 1024; i++) {
+				gSamples[c][ch][i] = (float) rand() / RAND_MAX * 2.0f - 1.0f;
+			}
+		}
+	}
+
+	CaptainJack_TripleBuffer buffer;
+	CaptainJack_InitTripleBuffer(&buffer, &gFrames[0], &gFrames[1], &gFrames[2]);
+
+	printf("{\"benchmark\":\"meters\",\"clients\":%d,\"rate\":%d,\"periods\":[", kBench_Clients, kBench_Rate);
+
+	for (size_t p = 0; p < sizeof(periods) / sizeof(periods[0]); p++) {
+		unsigned int frames = periods[p];
+		uint64_t worst = 0;
+		uint64_t total = 0;
+
+		for (int period = 0; period < kBench_Periods; period++) {
+			uint64_t start = Bench_Now();
+
+			Frame *frame = CaptainJack_TripleBufferBack(&buffer);
+			for (int c = 0; c < kBench_Clients; c++) {
+				Level *level = &gLevels[c];
+				for (int ch = 0; ch < kBench_Channels; ch++) {
+					float peak;
+					float squares;
+					CaptainJack_Measure(gSamples[c][ch], frames, &peak, &squares);
+					if (peak > level->peak[ch]) {
+						level->peak[ch] = peak;
+					}
+					level->squares[ch] += squares;
+				}
+				level->frames += frames;
+				frame->clients[c] = *level;
+			}
+			CaptainJack_PublishTripleBuffer(&buffer);
+
+			uint64_t elapsed = Bench_Now() - start;
+			total += elapsed;
+			if (elapsed > worst) {
+				worst = elapsed;
+			}
+
+			if (period % 64 == 0) {
+				Bench_Consume(CaptainJack_ReadTripleBuffer(&buffer, NULL));
+			}
+		}
+
+		double budget = 1e9 * frames / kBench_Rate;
+		double mean = (double) total / kBench_Periods;
+		printf("%s{\"frames\":%u,\"period_us\":%.1f,\"mean_ns\":%.1f,\"worst_ns\":%llu,\"mean_percent\":%.3f}",
+			p ? "," : "",
+			frames,
+			budget / 1000.0,
+			mean,
+			(unsigned long long) worst,
+			100.0 * mean / budget);
+	}
+
+	printf("]}\n");
+	return EXIT_SUCCESS;
+}
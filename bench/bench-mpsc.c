@@ -0,0 +1,191 @@
+/*
+	,---.         .              ,-_/
+	|  -' ,-. ,-. |- ,-. . ,-.   '  | ,-. ,-. . ,
+	|   . ,-| | | |  ,-| | | |      | ,-| |   |/
+	`---' `-^ |-' `' `-^ ' ' '      | `-^ `-' |\
+	          |                  /  |         ' `
+	          '                  `--'
+	          captain jack audio device
+	         github.com/qix-/captainjack
+
+	        copyright (c) 2016 josh junon
+	        released under the MIT license
+*/
+
+
+/*
+	16 threads queueing events for one consumer at once, the
+	way the HAL's callbacks queue them for the device's xmit
+	thread: once through the lock-free queue (`src/mpsc.h`)
+	and once through the same ring behind a mutex, the way
+	sends were serialized before.
+
+	every event carries its producer and a per-producer
+	sequence number; the consumer checks they all arrive,
+	whole and in order for each producer. push_*_ns is the
+	time a producer spent in one push, waiting included;
+	full_waits counts pushes that found the queue full.
+*/
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../src/mpsc.h"
+#include "bench.h"
+
+#define kBench_Producers 16
+#define kBench_Events    100000
+#define kBench_Capacity  1024
+#define kBench_Total     ((uint64_t) kBench_Producers * kBench_Events)
+
+typedef struct {
+	uint32_t producer;
+	uint32_t seq;
+	uint64_t check;
+} Event;
+
+typedef struct {
+	pthread_mutex_t lock;
+	uint32_t        head;
+	uint32_t        tail;
+	Event           items[kBench_Capacity];
+} LockedQueue;
+
+typedef struct {
+	bool     locked;
+	uint32_t producer;
+	uint64_t fullWaits;
+} Producer;
+
+static CaptainJack_MPSCQueue gQueue;
+static char                  gCells[kMPSC_Bytes(kBench_Capacity, sizeof(Event))] __attribute__((aligned(64)));
+static LockedQueue           gLocked = { PTHREAD_MUTEX_INITIALIZER, 0, 0, { { 0, 0, 0 } } };
+static uint64_t              gPushes[kBench_Producers][kBench_Events];
+static uint32_t              gGo = 0;
+
+static bool PushLocked(const Event *event) {
+	pthread_mutex_lock(&gLocked.lock);
+	bool pushed = gLocked.tail - gLocked.head < kBench_Capacity;
+	if (pushed) {
+		gLocked.items[gLocked.tail++ % kBench_Capacity] = *event;
+	}
+	pthread_mutex_unlock(&gLocked.lock);
+	return pushed;
+}
+
+static bool PopLocked(Event *event) {
+	pthread_mutex_lock(&gLocked.lock);
+	bool popped = gLocked.head != gLocked.tail;
+	if (popped) {
+		*event = gLocked.items[gLocked.head++ % kBench_Capacity];
+	}
+	pthread_mutex_unlock(&gLocked.lock);
+	return popped;
+}
+
+static void * Produce(void *arg) {
+	Producer *producer = arg;
+
+	while (!__atomic_load_n(&gGo, __ATOMIC_ACQUIRE)) {
+		sched_yield();
+	}
+
+	for (uint32_t seq = 0; seq < kBench_Events; seq++) {
+		Event event = { producer->producer, seq, ~((uint64_t) producer->producer << 32 | seq) };
+
+		uint64_t start = Bench_Now();
+		while (!(producer->locked ? PushLocked(&event) : CaptainJack_PushMPSC(&gQueue, &event))) {
+			producer->fullWaits++;
+			sched_yield();
+		}
+		gPushes[producer->producer][seq] = Bench_Now() - start;
+	}
+
+	return NULL;
+}
+
+static bool Run(bool locked, const char *name, bool first) {
+	static uint32_t expected[kBench_Producers];
+	pthread_t threads[kBench_Producers];
+	Producer producers[kBench_Producers];
+
+	CaptainJack_InitMPSCQueue(&gQueue, gCells, kBench_Capacity, sizeof(Event));
+	__atomic_store_n(&gGo, 0, __ATOMIC_RELAXED);
+
+	for (uint32_t p = 0; p < kBench_Producers; p++) {
+		expected[p] = 0;
+		producers[p] = (Producer) { locked, p, 0 };
+		pthread_create(&threads[p], NULL, &Produce, &producers[p]);
+	}
+
+	uint64_t broken = 0;
+	uint64_t outOfOrder = 0;
+	uint64_t received = 0;
+
+	uint64_t start = Bench_Now();
+	__atomic_store_n(&gGo, 1, __ATOMIC_RELEASE);
+
+	while (received < kBench_Total) {
+		Event event;
+		if (!(locked ? PopLocked(&event) : CaptainJack_PopMPSC(&gQueue, &event))) {
+			sched_yield();
+			continue;
+		}
+
+		received++;
+		if (event.producer >= kBench_Producers || event.check != ~((uint64_t) event.producer << 32 | event.seq)) {
+			broken++;
+			continue;
+		}
+
+		outOfOrder += event.seq != expected[event.producer];
+		expected[event.producer] = event.seq + 1;
+	}
+
+	double seconds = (double) (Bench_Now() - start) / 1e9;
+
+	uint64_t fullWaits = 0;
+	for (uint32_t p = 0; p < kBench_Producers; p++) {
+		pthread_join(threads[p], NULL);
+		fullWaits += producers[p].fullWaits;
+	}
+
+	// nothing left over, either
+	Event extra;
+	uint64_t leftover = 0;
+	while (locked ? PopLocked(&extra) : CaptainJack_PopMPSC(&gQueue, &extra)) {
+		leftover++;
+	}
+
+	uint64_t *pushes = &gPushes[0][0];
+	printf("%s\"%s\":{\"events_per_sec\":%.0f,\"push_p50_ns\":%llu,\"push_p99_ns\":%llu,\"push_p999_ns\":%llu,\"full_waits\":%llu,\"broken\":%llu,\"out_of_order\":%llu,\"leftover\":%llu}",
+		first ? "" : ",",
+		name,
+		kBench_Total / seconds,
+		(unsigned long long) Bench_Percentile(pushes, kBench_Total, 50.0),
+		(unsigned long long) Bench_Percentile(pushes, kBench_Total, 99.0),
+		(unsigned long long) Bench_Percentile(pushes, kBench_Total, 99.9),
+		(unsigned long long) fullWaits,
+		(unsigned long long) broken,
+		(unsigned long long) outOfOrder,
+		(unsigned long long) leftover);
+
+	return broken == 0 && outOfOrder == 0 && leftover == 0;
+}
+
+int main(void) {
+	printf("{\"benchmark\":\"mpsc\",\"producers\":%d,\"events_per_producer\":%d,\"capacity\":%d,\"cell_bytes\":%zu,",
+		kBench_Producers,
+		kBench_Events,
+		kBench_Capacity,
+		kMPSC_Stride(sizeof(Event)));
+
+	bool correct = Run(false, "lock_free", true);
+	correct = Run(true, "mutex", false) && correct;
+
+	printf(",\"correct\":%s}\n", correct ? "true" : "false");
+	return correct ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,190 @@
+/*
+	,---.         .              ,-_/
+	|  -' ,-. ,-. |- ,-. . ,-.   '  | ,-. ,-. . ,
+	|   . ,-| | | |  ,-| | | |      | ,-| |   |/
+	`---' `-^ |-' `' `-^ ' ' '      | `-^ `-' |\
+	          |                  /  |         ' `
+	          '                  `--'
+	          captain jack audio device
+	         github.com/qix-/captainjack
+
+	        copyright (c) 2016 josh junon
+	        released under the MIT license
+*/
+
+/*
+	how the mix buses scale across threads: 256 clients each
+	sent into two of 24 submixes, the submixes into 6 groups,
+	the groups into a master and the master and every eighth
+	client into a recorder. 32 buses, so 64 tasks a period,
+	though only the submixes can all run at once.
+
+	each thread count gets its own pool, and every period is
+	checked against what one thread makes of it. the JACK
+	thread's share is always there, so 1 is no pool at all.
+
+	fallback_ns is a 16 frame period through a 4 thread pool,
+	which is too little work to hand out and stays on the
+	calling thread; single_ns is the same without a pool.
+
+	on a machine with fewer cores than threads the extra
+	threads only get in each other's way; `cpus` is how many
+	there were.
+*/
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../src/bus.h"
+#include "bench.h"
+
+#define kBench_Clients    256
+#define kBench_Submixes   24
+#define kBench_Groups     6
+#define kBench_Master     (kBench_Clients + kBench_Submixes + kBench_Groups)
+#define kBench_Recorder   (kBench_Master + 1)
+#define kBench_Nodes      (kBench_Recorder + 1)
+#define kBench_Frames     1024
+#define kBench_Small      16
+#define kBench_Rate       48000
+#define kBench_Periods    500
+#define kBench_MaxThreads 16
+
+static float                   gSamples[kBench_Nodes][kBus_Channels][kBench_Frames];
+static float                   gExpected[kBench_Nodes][kBus_Channels][kBench_Frames];
+static float                  *gBuffers[kBench_Nodes * kBus_Channels];
+static bool                    gIsBus[kBench_Nodes];
+static CaptainJack_BusSend     gSends[kBus_MaxSends];
+static size_t                  gSendCount = 0;
+static CaptainJack_BusSchedule gSchedule;
+
+static void Send(unsigned int from, unsigned int to, float gain) {
+	gSends[gSendCount].from = (uint16_t) from;
+	gSends[gSendCount].to = (uint16_t) to;
+	gSends[gSendCount].gain = gain;
+	gSendCount++;
+}
+
+static void BuildGraph(void) {
+	for (unsigned int c = 0; c < kBench_Clients; c++) {
+		Send(c, kBench_Clients + c % kBench_Submixes, 0.5f);
+		Send(c, kBench_Clients + (c * 7 + 3) % kBench_Submixes, 0.3f);
+		if (c % 8 == 0) {
+			Send(c, kBench_Recorder, 0.25f);
+		}
+	}
+
+	for (unsigned int s = 0; s < kBench_Submixes; s++) {
+		gIsBus[kBench_Clients + s] = true;
+		Send(kBench_Clients + s, kBench_Clients + kBench_Submixes + s % kBench_Groups, 0.7f);
+	}
+
+	for (unsigned int g = 0; g < kBench_Groups; g++) {
+		gIsBus[kBench_Clients + kBench_Submixes + g] = true;
+		Send(kBench_Clients + kBench_Submixes + g, kBench_Master, 0.8f);
+	}
+
+	gIsBus[kBench_Master] = true;
+	gIsBus[kBench_Recorder] = true;
+	Send(kBench_Master, kBench_Recorder, 0.5f);
+}
+
+static bool Matches(void) {
+	for (int node = kBench_Clients; node < kBench_Nodes; node++) {
+		for (int channel = 0; channel < kBus_Channels; channel++) {
+			if (memcmp(gSamples[node][channel], gExpected[node][channel], sizeof(gExpected[node][channel])) != 0) {
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+static double Time(CaptainJack_BusPool *pool, unsigned int frames, bool *correct) {
+	static uint64_t samples[kBench_Periods];
+
+	for (int period = 0; period < kBench_Periods; period++) {
+		uint64_t start = Bench_Now();
+		CaptainJack_RunBusesParallel(pool, &gSchedule, gBuffers, frames);
+		samples[period] = Bench_Now() - start;
+
+		if (correct != NULL && !Matches()) {
+			*correct = false;
+		}
+	}
+
+	uint64_t total = 0;
+	for (int period = 0; period < kBench_Periods; period++) {
+		total += samples[period];
+	}
+
+	return (double) total / kBench_Periods;
+}
+
+int main(void) {
+	BuildGraph();
+	if (!CaptainJack_ScheduleBuses(&gSchedule, gIsBus, kBench_Nodes, gSends, gSendCount)) {
+		fprintf(stderr, "bench-parallel: could not schedule the graph\n");
+		return EXIT_FAILURE;
+	}
+
+	for (int node = 0; node < kBench_Nodes; node++) {
+		for (int channel = 0; channel < kBus_Channels; channel++) {
+			gBuffers[node * kBus_Channels + channel] = gSamples[node][channel];
+			for (int i = 0; node < kBench_Clients && i < kBench_Frames; i++) {
+				gSamples[node][channel][i] = sinf((float) (i + node * 31 + channel * 7) * 0.01f) * 0.1f;
+			}
+		}
+	}
+
+	// every thread count has to add things up in exactly the same order as this
+	CaptainJack_RunBuses(&gSchedule, gBuffers, kBench_Frames);
+	memcpy(gExpected, gSamples, sizeof(gSamples));
+
+	bool correct = true;
+	double single = 0.0;
+
+	printf("{\"benchmark\":\"parallel\",\"cpus\":%ld,\"clients\":%d,\"buses\":%u,\"sends\":%u,\"frames\":%d,\"period_us\":%.1f,\"threads\":[",
+		sysconf(_SC_NPROCESSORS_ONLN),
+		kBench_Clients,
+		gSchedule.busCount,
+		gSchedule.sendCount,
+		kBench_Frames,
+		1e6 * kBench_Frames / kBench_Rate);
+
+	for (unsigned int threads = 1; threads <= kBench_MaxThreads; threads++) {
+		CaptainJack_BusPool *pool = threads > 1 ? CaptainJack_StartBusPool(threads, 0) : NULL;
+		if (threads > 1 && pool == NULL) {
+			fprintf(stderr, "bench-parallel: could not start %u threads\n", threads);
+			return EXIT_FAILURE;
+		}
+
+		Time(pool, kBench_Frames, NULL);
+		double mean = Time(pool, kBench_Frames, &correct);
+		single = threads == 1 ? mean : single;
+
+		printf("%s{\"threads\":%u,\"mean_us\":%.1f,\"speedup\":%.2f}",
+			threads > 1 ? "," : "",
+			threads,
+			mean / 1000.0,
+			single / mean);
+
+		CaptainJack_StopBusPool(pool);
+	}
+
+	CaptainJack_BusPool *pool = CaptainJack_StartBusPool(4, 0);
+	double fallback = Time(pool, kBench_Small, NULL);
+	CaptainJack_StopBusPool(pool);
+
+	printf("],\"correct\":%s,\"fallback_ns\":%.1f,\"single_ns\":%.1f}\n",
+		correct ? "true" : "false",
+		fallback,
+		Time(NULL, kBench_Small, NULL));
+
+	return correct ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,131 @@
+/*
+	,---.         .              ,-_/
+	|  -' ,-. ,-. |- ,-. . ,-.   '  | ,-. ,-. . ,
+	|   . ,-| | | |  ,-| | | |      | ,-| |   |/
+	`---' `-^ |-' `' `-^ ' ' '      | `-^ `-' |\
+	          |                  /  |         ' `
+	          '                  `--'
+	          captain jack audio device
+	         github.com/qix-/captainjack
+
+	        copyright (c) 2016 josh junon
+	        released under the MIT license
+*/
+
+
+/*
+	first-sound latency: how long a client that starts
+	playing waits for its ports, with no spares (every pair
+	registered there and then) and with a pool of them kept
+	topped up in the background.
+
+	there's no JACK server here, so registering a port is a
+	stand-in that takes kBench_RegisterMicros, about what a
+	round trip to jackd and the graph reorder after it come
+	to on a quiet machine. what matters is how much of that
+	is left on the path to the first sound.
+
+	"steady" has a client start every 10ms or so; "bursts"
+	has eight start at once, more than the pool holds, so
+	the ones after it's empty wait as long as they would
+	have without it.
+*/
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "../src/portpool.h"
+#include "bench.h"
+
+#define kBench_RegisterMicros 1000
+#define kBench_Starts         128
+#define kBench_Spares         4
+#define kBench_Burst          8
+
+static uint64_t gMade  = 0;
+static uint64_t gFreed = 0;
+
+static bool MakePair(void *context, unsigned int index, void *pair[2]) {
+	for (int i = 0; i < 2; i++) {
+		usleep(kBench_RegisterMicros);
+		pair[i] = (void *) (uintptr_t) (2 * index + i + 1);
+	}
+
+	__atomic_add_fetch(&gMade, 1, __ATOMIC_RELAXED);
+	return true;
+}
+
+static void FreePair(void *context, void *pair[2]) {
+	__atomic_add_fetch(&gFreed, 1, __ATOMIC_RELAXED);
+}
+
+// what the daemon does on do_client_enable_io, up to the point the client can be heard
+static uint64_t Start(CaptainJack_PortPool *pool) {
+	uint64_t start = Bench_Now();
+	void *pair[2];
+
+	if (!CaptainJack_TakePortPair(pool, pair)) {
+		MakePair(NULL, 0, pair);
+	}
+
+	Bench_Consume(pair);
+	return Bench_Now() - start;
+}
+
+static void Run(const char *name, unsigned int spares, unsigned int burst, bool first) {
+	static uint64_t latencies[kBench_Starts];
+
+	CaptainJack_PortPool *pool = spares > 0 ? CaptainJack_StartPortPool(spares, &MakePair, &FreePair, NULL) : NULL;
+
+	// the daemon's pool fills while it connects to JACK and loads its rules
+	usleep(spares * 2 * kBench_RegisterMicros * 2);
+
+	for (int i = 0; i < kBench_Starts; i++) {
+		latencies[i] = Start(pool);
+
+		if ((i + 1) % burst == 0) {
+			usleep(burst * 10000 + (unsigned int) (rand() % 5000));
+		}
+	}
+
+	CaptainJack_PortPoolStats stats;
+	CaptainJack_GetPortPoolStats(pool, &stats);
+	CaptainJack_StopPortPool(pool);
+
+	uint64_t total = 0;
+	for (int i = 0; i < kBench_Starts; i++) {
+		total += latencies[i];
+	}
+
+	printf("%s{\"pattern\":\"%s\",\"spares\":%u,\"burst\":%u,\"mean_us\":%.1f,\"p50_us\":%.1f,\"p99_us\":%.1f,\"worst_us\":%.1f,\"taken\":%llu,\"empty\":%llu}",
+		first ? "" : ",",
+		name,
+		spares,
+		burst,
+		(double) total / kBench_Starts / 1000.0,
+		Bench_Percentile(latencies, kBench_Starts, 50.0) / 1000.0,
+		Bench_Percentile(latencies, kBench_Starts, 99.0) / 1000.0,
+		Bench_Percentile(latencies, kBench_Starts, 100.0) / 1000.0,
+		(unsigned long long) stats.taken,
+		(unsigned long long) stats.empty);
+}
+
+int main(void) {
+	srand(1);
+
+	printf("{\"benchmark\":\"portpool\",\"register_us\":%d,\"starts\":%d,\"results\":[", 2 * kBench_RegisterMicros, kBench_Starts);
+
+	Run("steady", 0, 1, true);
+	Run("steady", kBench_Spares, 1, false);
+	Run("bursts", 0, kBench_Burst, false);
+	Run("bursts", kBench_Spares, kBench_Burst, false);
+
+	// everything the pools made was either handed out or freed when they stopped
+	uint64_t made = __atomic_load_n(&gMade, __ATOMIC_RELAXED);
+	printf("],\"pairs_made\":%llu,\"pairs_freed\":%llu}\n", (unsigned long long) made, (unsigned long long) gFreed);
+
+	return EXIT_SUCCESS;
+}
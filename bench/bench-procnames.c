@@ -0,0 +1,185 @@
+/*
+	,---.         .              ,-_/
+	|  -' ,-. ,-. |- ,-. . ,-.   '  | ,-. ,-. . ,
+	|   . ,-| | | |  ,-| | | |      | ,-| |   |/
+	`---' `-^ |-' `' `-^ ' ' '      | `-^ `-' |\
+	          |                  /  |         ' `
+	          '                  `--'
+	          captain jack audio device
+	         github.com/qix-/captainjack
+
+	        copyright (c) 2016 josh junon
+	        released under the MIT license
+*/
+
+
+/*
+	replays a storm of client connects through the daemon's
+	process name cache, with made up processes standing in
+	for the kernel. each connect resolves the name the way
+	on_new_client does. now and then a process exits and its
+	PID goes to a new process, or a process exec()s into
+	something else, and the cache has to notice either way.
+
+	"hot" is a few apps reconnecting over and over, and fits
+	in the cache. "storm" is four times as many processes as
+	the cache holds, with a few of them far busier than the
+	rest, so there are evictions as well.
+
+	resolve_ns is the cache's own cost per connect, without
+	the query; kernel_resolve_ns is a real resolve of this
+	process for comparison, which is what a connect costs.
+	lookup_ns is the cached lookup the disconnect path uses.
+	any name that doesn't match what the process is called at
+	that moment is counted as stale.
+*/
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../src/proc-names.h"
+#include "bench.h"
+
+#define kBench_Connects   1000000
+#define kBench_MaxProcs   1024
+#define kBench_FirstPID   100
+#define kBench_Kernel     20000
+
+typedef struct {
+	uint64_t generation;
+	char     name[24];
+} Process;
+
+static Process  gProcs[kBench_MaxProcs];
+static uint32_t gRandom         = 2463534242u;
+static uint64_t gNextGeneration = 1;
+static unsigned gNextName       = 0;
+
+static uint32_t Random(void) {
+	// xorshift32
+	gRandom ^= gRandom << 13;
+	gRandom ^= gRandom >> 17;
+	gRandom ^= gRandom << 5;
+	return gRandom;
+}
+
+static double Uniform(void) {
+	return (double) Random() / 4294967296.0;
+}
+
+static bool Query(pid_t pid, char *name, size_t size, uint64_t *generation) {
+	unsigned int index = (unsigned int) pid - kBench_FirstPID;
+	if (index >= kBench_MaxProcs) {
+		return false;
+	}
+
+	snprintf(name, size, "%s", gProcs[index].name);
+	*generation = gProcs[index].generation;
+	return true;
+}
+
+static void Spawn(Process *process) {
+	process->generation = gNextGeneration++;
+	snprintf(process->name, sizeof(process->name), "app-%u", gNextName++);
+}
+
+static void Exec(Process *process) {
+	// same process, so the same start time; only the name changes
+	snprintf(process->name, sizeof(process->name), "exec-%u", gNextName++);
+}
+
+static double Rate(unsigned long count, unsigned long of) {
+	return of != 0 ? (double) count / (double) of : 0.0;
+}
+
+static bool Storm(const char *name, unsigned int procs, double skew, double reuse, double exec, bool first) {
+	for (unsigned int i = 0; i < procs; i++) {
+		Spawn(&gProcs[i]);
+	}
+
+	CaptainJack_ProcNameStats before;
+	CaptainJack_ProcNameStats after;
+	CaptainJack_GetProcNameStats(&before);
+
+	unsigned long stale = 0;
+	unsigned long changes = 0;
+	uint64_t resolve = 0;
+	uint64_t lookup = 0;
+	unsigned long found = 0;
+
+	for (int connect = 0; connect < kBench_Connects; connect++) {
+		// a skewed pick: a handful of processes connect far more often than the rest
+		unsigned int index = (unsigned int) (procs * pow(Uniform(), skew));
+		pid_t pid = (pid_t) (kBench_FirstPID + index);
+
+		double event = Uniform();
+		if (event < reuse) {
+			Spawn(&gProcs[index]);
+			changes++;
+		} else if (event < reuse + exec) {
+			Exec(&gProcs[index]);
+			changes++;
+		}
+
+		uint64_t start = Bench_Now();
+		const char *resolved = CaptainJack_ResolveProcName(pid);
+		resolve += Bench_Now() - start;
+		stale += resolved == NULL || strcmp(resolved, gProcs[index].name) != 0;
+
+		// and its disconnect, or anything else that wants the name later
+		unsigned int other = (unsigned int) (procs * pow(Uniform(), skew));
+		start = Bench_Now();
+		const char *cached = CaptainJack_LookupProcName((pid_t) (kBench_FirstPID + other));
+		lookup += Bench_Now() - start;
+		found += cached != NULL;
+	}
+
+	CaptainJack_GetProcNameStats(&after);
+	unsigned long lookups = after.lookups - before.lookups;
+
+	printf("%s{\"pattern\":\"%s\",\"processes\":%u,\"connects\":%lu,\"pid_changes\":%lu,\"hit_rate\":%.4f,\"miss_rate\":%.4f,\"reuse_rate\":%.4f,\"eviction_rate\":%.4f,\"stale\":%lu,\"resolve_ns\":%.1f,\"lookup_ns\":%.1f,\"lookup_found_rate\":%.4f}",
+		first ? "" : ",",
+		name,
+		procs,
+		lookups,
+		changes,
+		Rate(after.hits - before.hits, lookups),
+		Rate(after.misses - before.misses, lookups),
+		Rate(after.reused - before.reused, lookups),
+		Rate(after.evictions - before.evictions, lookups),
+		stale,
+		(double) resolve / kBench_Connects,
+		(double) lookup / kBench_Connects,
+		Rate(found, kBench_Connects));
+
+	return stale == 0;
+}
+
+static double KernelResolve(void) {
+	CaptainJack_SetProcQuery(NULL);
+
+	pid_t self = getpid();
+	uint64_t start = Bench_Now();
+	for (int i = 0; i < kBench_Kernel; i++) {
+		Bench_Consume(CaptainJack_ResolveProcName(self));
+	}
+
+	return (double) (Bench_Now() - start) / kBench_Kernel;
+}
+
+int main(void) {
+	CaptainJack_SetProcQuery(&Query);
+
+	printf("{\"benchmark\":\"procnames\",\"patterns\":[");
+
+	bool correct = Storm("hot", 64, 2.0, 0.001, 0.001, true);
+	correct = Storm("storm", kBench_MaxProcs, 3.0, 0.01, 0.005, false) && correct;
+
+	printf("],\"kernel_resolve_ns\":%.1f,\"correct\":%s}\n", KernelResolve(), correct ? "true" : "false");
+
+	return correct ? EXIT_SUCCESS : EXIT_FAILURE;
+}
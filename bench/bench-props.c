@@ -0,0 +1,356 @@
+/*
+	,---.         .              ,-_/
+	|  -' ,-. ,-. |- ,-. . ,-.   '  | ,-. ,-. . ,
+	|   . ,-| | | |  ,-| | | |      | ,-| |   |/
+	`---' `-^ |-' `' `-^ ' ' '      | `-^ `-' |\
+	          |                  /  |         ' `
+	          '                  `--'
+	          captain jack audio device
+	         github.com/qix-/captainjack
+
+	        copyright (c) 2016 josh junon
+	        released under the MIT license
+*/
+
+/*
+	a storm of property queries against the device, the way
+	the HAL and System Preferences hammer it while they walk
+	the object model.
+
+	the trace is either synthesized (every object, selector
+	and scope the device says it has) or read from a file
+	given as the first argument, one query per line:
+
+		3 'uid ' 'glob' 0
+
+	every query is a HasProperty, GetPropertyDataSize and
+	GetPropertyData, and runs with the property cache off and
+	then on.
+*/
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <CoreAudio/AudioServerPlugIn.h>
+
+#include "bench.h"
+
+#define kBench_Queries  512
+#define kBench_Reps     400
+#define kBench_Batches  5
+#define kBench_DataSize 1024
+
+typedef struct {
+	AudioObjectID              object;
+	AudioObjectPropertyAddress address;
+	double                     has_ns[2];
+	double                     size_ns[2];
+	double                     data_ns[2];
+} Query;
+
+void *CaptainJack_Create(CFAllocatorRef inAllocator, CFUUIDRef inRequestedTypeUUID);
+
+static AudioServerPlugInDriverRef gDriver = NULL;
+static pid_t                      gPID = 0;
+static Query                      gQueries[kBench_Queries];
+static size_t                     gQueryCount = 0;
+
+static const AudioObjectPropertySelector kBench_Selectors[] = {
+	kAudioObjectPropertyBaseClass,
+	kAudioObjectPropertyClass,
+	kAudioObjectPropertyOwner,
+	kAudioObjectPropertyName,
+	kAudioObjectPropertyModelName,
+	kAudioObjectPropertyManufacturer,
+	kAudioObjectPropertyOwnedObjects,
+	kAudioObjectPropertyIdentify,
+	kAudioObjectPropertySerialNumber,
+	kAudioObjectPropertyFirmwareVersion,
+	kAudioObjectPropertyControlList,
+	kAudioPlugInPropertyBoxList,
+	kAudioPlugInPropertyDeviceList,
+	kAudioPlugInPropertyResourceBundle,
+	kAudioBoxPropertyBoxUID,
+	kAudioBoxPropertyTransportType,
+	kAudioBoxPropertyHasAudio,
+	kAudioBoxPropertyHasVideo,
+	kAudioBoxPropertyHasMIDI,
+	kAudioBoxPropertyIsProtected,
+	kAudioBoxPropertyAcquired,
+	kAudioBoxPropertyAcquisitionFailed,
+	kAudioBoxPropertyDeviceList,
+	kAudioDevicePropertyDeviceUID,
+	kAudioDevicePropertyModelUID,
+	kAudioDevicePropertyRelatedDevices,
+	kAudioDevicePropertyClockDomain,
+	kAudioDevicePropertyDeviceIsAlive,
+	kAudioDevicePropertyDeviceIsRunning,
+	kAudioDevicePropertyDeviceCanBeDefaultDevice,
+	kAudioDevicePropertyDeviceCanBeDefaultSystemDevice,
+	kAudioDevicePropertyLatency,
+	kAudioDevicePropertyStreams,
+	kAudioDevicePropertySafetyOffset,
+	kAudioDevicePropertyNominalSampleRate,
+	kAudioDevicePropertyAvailableNominalSampleRates,
+	kAudioDevicePropertyIsHidden,
+	kAudioDevicePropertyPreferredChannelsForStereo,
+	kAudioDevicePropertyPreferredChannelLayout,
+	kAudioDevicePropertyZeroTimeStampPeriod,
+	kAudioStreamPropertyIsActive,
+	kAudioStreamPropertyDirection,
+	kAudioStreamPropertyTerminalType,
+	kAudioStreamPropertyStartingChannel,
+	kAudioStreamPropertyVirtualFormat,
+	kAudioStreamPropertyPhysicalFormat,
+	kAudioStreamPropertyAvailableVirtualFormats,
+	kAudioStreamPropertyAvailablePhysicalFormats,
+	kAudioControlPropertyScope,
+	kAudioControlPropertyElement,
+	kAudioLevelControlPropertyScalarValue,
+	kAudioLevelControlPropertyDecibelValue,
+	kAudioLevelControlPropertyDecibelRange,
+	kAudioBooleanControlPropertyValue,
+	kAudioSelectorControlPropertyCurrentItem,
+	kAudioSelectorControlPropertyAvailableItems,
+};
+
+static const AudioObjectPropertyScope kBench_Scopes[] = {
+	kAudioObjectPropertyScopeGlobal,
+	kAudioObjectPropertyScopeInput,
+	kAudioObjectPropertyScopeOutput,
+};
+
+// object IDs from captain-jack-device.c
+static const char * ObjectName(AudioObjectID object) {
+	switch (object) {
+	case 1: return "plugin";
+	case 2: return "box";
+	case 3: return "device";
+	case 4:
+	case 8: return "stream";
+	default: return "control";
+	}
+}
+
+static void FourCC(UInt32 code, char out[5]) {
+	out[0] = (char) (code >> 24);
+	out[1] = (char) (code >> 16);
+	out[2] = (char) (code >> 8);
+	out[3] = (char) code;
+	out[4] = 0;
+}
+
+static UInt32 ParseFourCC(const char *text) {
+	return ((UInt32) (unsigned char) text[0] << 24)
+		| ((UInt32) (unsigned char) text[1] << 16)
+		| ((UInt32) (unsigned char) text[2] << 8)
+		| (UInt32) (unsigned char) text[3];
+}
+
+static bool RunQuery(const Query *query, void *data) {
+	UInt32 size = 0;
+
+	if (!(*gDriver)->HasProperty(gDriver, query->object, gPID, &query->address)) {
+		return false;
+	}
+
+	if ((*gDriver)->GetPropertyDataSize(gDriver, query->object, gPID, &query->address, 0, NULL, &size) != 0) {
+		return false;
+	}
+
+	return (*gDriver)->GetPropertyData(gDriver, query->object, gPID, &query->address, 0, NULL, size, &size, data) == 0;
+}
+
+static void AddQuery(AudioObjectID object, AudioObjectPropertySelector selector, AudioObjectPropertyScope scope, AudioObjectPropertyElement element) {
+	static char data[kBench_DataSize];
+
+	if (gQueryCount == kBench_Queries) {
+		return;
+	}
+
+	Query *query = &gQueries[gQueryCount];
+	memset(query, 0, sizeof(*query));
+	query->object = object;
+	query->address.mSelector = selector;
+	query->address.mScope = scope;
+	query->address.mElement = element;
+
+	// queries the device can't answer without a qualifier (or at all) are left out
+	if (RunQuery(query, data)) {
+		gQueryCount++;
+	}
+}
+
+static void SynthesizeTrace(void) {
+	for (AudioObjectID object = 1; object <= 11; object++) {
+		for (size_t s = 0; s < sizeof(kBench_Selectors) / sizeof(kBench_Selectors[0]); s++) {
+			for (size_t c = 0; c < sizeof(kBench_Scopes) / sizeof(kBench_Scopes[0]); c++) {
+				AddQuery(object, kBench_Selectors[s], kBench_Scopes[c], kAudioObjectPropertyElementMaster);
+			}
+		}
+	}
+}
+
+static bool ReadTrace(const char *path) {
+	FILE *file = fopen(path, "r");
+	if (file == NULL) {
+		perror("bench-props: could not open the trace");
+		return false;
+	}
+
+	char line[256];
+	while (fgets(line, sizeof(line), file) != NULL) {
+		unsigned int object;
+		unsigned int element;
+		char selector[5] = { 0 };
+		char scope[5] = { 0 };
+
+		if (sscanf(line, "%u '%4c' '%4c' %u", &object, selector, scope, &element) == 4) {
+			AddQuery(object, ParseFourCC(selector), ParseFourCC(scope), element);
+		}
+	}
+
+	fclose(file);
+	return true;
+}
+
+/*
+	times a call kBench_Reps times in a row, kBench_Batches
+	times over, and keeps the quickest batch so a preempted
+	batch doesn't skew a query that takes a few dozen ns
+*/
+#define Bench_Time(result, call) do { \
+		double fastest = 0.0; \
+		for (int b = 0; b < kBench_Batches; b++) { \
+			uint64_t start = Bench_Now(); \
+			for (int r = 0; r < kBench_Reps; r++) { \
+				call; \
+			} \
+			double elapsed = (double) (Bench_Now() - start) / kBench_Reps; \
+			if (b == 0 || elapsed < fastest) { \
+				fastest = elapsed; \
+			} \
+		} \
+		(result) = fastest; \
+	} while (0)
+
+static void Measure(int mode) {
+	static char data[kBench_DataSize];
+
+	for (size_t q = 0; q < gQueryCount; q++) {
+		Query *query = &gQueries[q];
+		UInt32 size = 0;
+		UInt32 used = 0;
+
+		// the first time through fills the cache (when it's on)
+		RunQuery(query, data);
+		(*gDriver)->GetPropertyDataSize(gDriver, query->object, gPID, &query->address, 0, NULL, &size);
+
+		Bench_Time(query->has_ns[mode], Bench_Consume(&(Boolean) { (*gDriver)->HasProperty(gDriver, query->object, gPID, &query->address) }));
+		Bench_Time(query->size_ns[mode], (*gDriver)->GetPropertyDataSize(gDriver, query->object, gPID, &query->address, 0, NULL, &used); Bench_Consume(&used));
+		Bench_Time(query->data_ns[mode], (*gDriver)->GetPropertyData(gDriver, query->object, gPID, &query->address, 0, NULL, size, &used, data); Bench_Consume(data));
+	}
+}
+
+static void Replay(void) {
+	static char data[kBench_DataSize];
+
+	for (size_t q = 0; q < gQueryCount; q++) {
+		RunQuery(&gQueries[q], data);
+	}
+}
+
+static double Storm(void) {
+	double best;
+	Bench_Time(best, Replay());
+	return best / gQueryCount;
+}
+
+static void PrintByObject(int mode) {
+	static const char *objects[] = { "plugin", "box", "device", "stream", "control" };
+
+	printf("\"by_object\":{");
+	for (size_t o = 0; o < sizeof(objects) / sizeof(objects[0]); o++) {
+		double total = 0.0;
+		size_t count = 0;
+
+		for (size_t q = 0; q < gQueryCount; q++) {
+			if (strcmp(ObjectName(gQueries[q].object), objects[o]) == 0) {
+				total += gQueries[q].has_ns[mode] + gQueries[q].size_ns[mode] + gQueries[q].data_ns[mode];
+				count++;
+			}
+		}
+
+		printf("%s\"%s\":%.1f", o ? "," : "", objects[o], count ? total / count : 0.0);
+	}
+	printf("}");
+}
+
+int main(int argc, char **argv) {
+	double storm_ns[2];
+
+	gPID = getpid();
+
+	setenv("CAPTAIN_JACK_PROPERTY_CACHE", "0", 1);
+	gDriver = CaptainJack_Create(NULL, kAudioServerPlugInTypeUUID);
+	if (gDriver == NULL) {
+		fprintf(stderr, "bench-props: the driver didn't recognize the plug-in type\n");
+		return EXIT_FAILURE;
+	}
+
+	if (argc > 1) {
+		if (!ReadTrace(argv[1])) {
+			return EXIT_FAILURE;
+		}
+	} else {
+		SynthesizeTrace();
+	}
+
+	if (gQueryCount == 0) {
+		fprintf(stderr, "bench-props: the trace has no queries the device can answer\n");
+		return EXIT_FAILURE;
+	}
+
+	for (int mode = 0; mode < 2; mode++) {
+		// creating the driver again picks up the setting
+		setenv("CAPTAIN_JACK_PROPERTY_CACHE", mode ? "1" : "0", 1);
+		CaptainJack_Create(NULL, kAudioServerPlugInTypeUUID);
+
+		Measure(mode);
+		storm_ns[mode] = Storm();
+	}
+
+	printf("{\"benchmark\":\"props\",\"trace\":\"%s\",\"queries\":%zu,\"reps\":%d", argc > 1 ? "file" : "synthetic", gQueryCount, kBench_Reps * kBench_Batches);
+
+	for (int mode = 0; mode < 2; mode++) {
+		printf(",\"%s\":{\"storm_ns_per_query\":%.1f,\"queries_per_sec\":%.0f,", mode ? "cached" : "uncached", storm_ns[mode], 1e9 / storm_ns[mode]);
+		PrintByObject(mode);
+		printf("}");
+	}
+
+	// get_ns is the GetPropertyDataSize + GetPropertyData pair, uncached then cached
+	printf(",\"by_selector\":[");
+	for (size_t q = 0; q < gQueryCount; q++) {
+		const Query *query = &gQueries[q];
+		char selector[5];
+		char scope[5];
+		FourCC(query->address.mSelector, selector);
+		FourCC(query->address.mScope, scope);
+
+		printf("%s{\"object\":\"%s\",\"id\":%u,\"selector\":\"%s\",\"scope\":\"%s\",\"has_ns\":%.1f,\"get_ns\":[%.1f,%.1f]}",
+			q ? "," : "",
+			ObjectName(query->object),
+			(unsigned int) query->object,
+			selector,
+			scope,
+			query->has_ns[0],
+			query->size_ns[0] + query->data_ns[0],
+			query->size_ns[1] + query->data_ns[1]);
+	}
+	printf("]}\n");
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,216 @@
+/*
+	,---.         .              ,-_/
+	|  -' ,-. ,-. |- ,-. . ,-.   '  | ,-. ,-. . ,
+	|   . ,-| | | |  ,-| | | |      | ,-| |   |/
+	`---' `-^ |-' `' `-^ ' ' '      | `-^ `-' |\
+	          |                  /  |         ' `
+	          '                  `--'
+	          captain jack audio device
+	         github.com/qix-/captainjack
+
+	        copyright (c) 2016 josh junon
+	        released under the MIT license
+*/
+
+
+/*
+	cycle times over the transport region: every cycle, a
+	period of audio goes into each of 256 clients' rings
+	and comes back out, the way the device and the daemon
+	pass it. each layout gets fresh regions, so it pays
+	for whatever it left until later.
+
+	cold is a plain mapping with each ring's indices at its
+	start, next to the samples (what a ring would be
+	without the header). the rest keep the indices in the
+	header and fault the region in up front, then also
+	lock it, then also ask for huge pages (which may not
+	be on offer; huge says whether they were).
+
+	cycle times are the thread's CPU time (faults included),
+	so another process getting the core in the middle of a
+	cycle doesn't count against whichever layout it was.
+	minor_faults is page faults taken during the cycles;
+	they're what cold's p999 is made of.
+*/
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+
+#include "../src/transport.h"
+#include "bench.h"
+
+#define kBench_Clients     kTransport_MaxRings
+#define kBench_RingFrames  8192
+#define kBench_Period      128
+#define kBench_Channels    2
+#define kBench_RingBytes   (kBench_RingFrames * kBench_Channels * sizeof(float))
+#define kBench_Wraps       64
+#define kBench_Rounds      2
+#define kBench_Cycles      (kBench_Wraps * kBench_RingFrames / kBench_Period)
+
+static const struct {
+	const char  *name;
+	unsigned int flags;
+	bool         split;
+} kLayouts[] = {
+	{ "cold", 0, false },
+	{ "prefaulted", kTransportFlag_Prefault, true },
+	{ "locked", kTransportFlag_Prefault | kTransportFlag_Lock, true },
+	{ "huge", kTransportFlag_All, true }
+};
+
+typedef struct {
+	uint32_t *write;
+	uint32_t *read;
+	float    *samples;
+	uint32_t  frames;
+} Ring;
+
+static Ring   gRings[kBench_Clients];
+static float  gPeriod[kBench_Period * kBench_Channels];
+static float  gOut[kBench_Period * kBench_Channels];
+
+static bool Setup(CaptainJack_Transport *transport, bool split) {
+	for (unsigned int i = 0; i < kBench_Clients; i++) {
+		char *ring = (char *) transport->rings + i * kBench_RingBytes;
+		Ring *r = &gRings[i];
+
+		if (split) {
+			CaptainJack_PublishRing(transport, i, i + 1, ring, kBench_RingBytes);
+			r->write = &transport->header->indices[i].write;
+			r->read = &transport->header->indices[i].read;
+			r->samples = (float *) ((char *) transport->header + transport->header->entries[i].offset);
+			r->frames = kBench_RingFrames;
+
+			if ((char *) r->samples != ring || ((uintptr_t) r->samples & 4095) != 0) {
+				return false;
+			}
+		} else {
+			// a frame's worth of room for the indices, in the first line with the samples
+			r->write = (uint32_t *) ring;
+			r->read = (uint32_t *) ring + 1;
+			r->samples = (float *) ring + kBench_Channels;
+			r->frames = kBench_RingFrames - 1;
+		}
+	}
+
+	return true;
+}
+
+// `frames` in or out of a ring from `index` on, in (at most) two pieces where it wraps
+static void Copy(Ring *r, uint32_t index, float *buffer, uint32_t frames, bool in) {
+	uint32_t at = index % r->frames;
+	uint32_t first = frames < r->frames - at ? frames : r->frames - at;
+	size_t frameBytes = kBench_Channels * sizeof(float);
+
+	if (in) {
+		memcpy(&r->samples[at * kBench_Channels], buffer, first * frameBytes);
+		memcpy(r->samples, &buffer[first * kBench_Channels], (frames - first) * frameBytes);
+	} else {
+		memcpy(buffer, &r->samples[at * kBench_Channels], first * frameBytes);
+		memcpy(&buffer[first * kBench_Channels], r->samples, (frames - first) * frameBytes);
+	}
+}
+
+// one period, through every ring; false if anything came out different
+static bool Cycle(uint32_t cycle) {
+	bool same = true;
+
+	for (unsigned int i = 0; i < kBench_Clients; i++) {
+		Ring *r = &gRings[i];
+
+		// the device's side
+		uint32_t write = __atomic_load_n(r->write, __ATOMIC_RELAXED);
+		gPeriod[0] = (float) (cycle + i);
+		Copy(r, write, gPeriod, kBench_Period, true);
+		__atomic_store_n(r->write, write + kBench_Period, __ATOMIC_RELEASE);
+
+		// the daemon's
+		uint32_t read = __atomic_load_n(r->read, __ATOMIC_RELAXED);
+		uint32_t available = __atomic_load_n(r->write, __ATOMIC_ACQUIRE) - read;
+		Copy(r, read, gOut, available, false);
+		__atomic_store_n(r->read, read + available, __ATOMIC_RELEASE);
+
+		same = same && available == kBench_Period && gOut[0] == (float) (cycle + i);
+	}
+
+	Bench_Consume(gOut);
+	return same;
+}
+
+static long MinorFaults(void) {
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	return usage.ru_minflt;
+}
+
+int main(void) {
+	static uint64_t cycles[kBench_Rounds * kBench_Cycles];
+
+	bool correct = offsetof(CaptainJack_RingIndices, read) - offsetof(CaptainJack_RingIndices, write) >= 64
+		&& sizeof(CaptainJack_RingIndices) % 64 == 0
+		&& offsetof(CaptainJack_TransportHeader, indices) % 64 == 0;
+
+	for (unsigned int f = 0; f < kBench_Period * kBench_Channels; f++) {
+		gPeriod[f] = (float) f / (kBench_Period * kBench_Channels);
+	}
+
+	printf("{\"benchmark\":\"region\",\"clients\":%d,\"ring_bytes\":%zu,\"period\":%d,\"cycles\":%d,\"layouts\":[",
+		kBench_Clients,
+		kBench_RingBytes,
+		kBench_Period,
+		kBench_Rounds * kBench_Cycles);
+
+	for (size_t l = 0; l < sizeof(kLayouts) / sizeof(kLayouts[0]); l++) {
+		bool huge = true;
+		bool locked = true;
+		long faults = 0;
+		uint64_t setup = 0;
+
+		for (int round = 0; round < kBench_Rounds; round++) {
+			CaptainJack_Transport transport;
+
+			uint64_t start = Bench_Now();
+			if (!CaptainJack_MapTransport(&transport, NULL, kBench_Clients * kBench_RingBytes, kLayouts[l].flags)) {
+				fprintf(stderr, "bench-region: could not map a region\n");
+				return EXIT_FAILURE;
+			}
+			setup += Bench_Now() - start;
+
+			huge = huge && transport.huge;
+			locked = locked && transport.locked;
+			correct = correct && transport.header->magic == kTransport_Magic && Setup(&transport, kLayouts[l].split);
+
+			long before = MinorFaults();
+			for (uint32_t cycle = 0; cycle < kBench_Cycles; cycle++) {
+				start = Bench_ThreadTime();
+				correct = Cycle(cycle) && correct;
+				cycles[round * kBench_Cycles + cycle] = Bench_ThreadTime() - start;
+			}
+			faults += MinorFaults() - before;
+
+			CaptainJack_UnmapTransport(&transport);
+		}
+
+		size_t count = kBench_Rounds * kBench_Cycles;
+		printf("%s{\"layout\":\"%s\",\"huge\":%s,\"locked\":%s,\"setup_ms\":%.2f,\"minor_faults\":%ld,\"cycle_p50_us\":%.1f,\"cycle_p99_us\":%.1f,\"cycle_p999_us\":%.1f,\"cycle_worst_us\":%.1f}",
+			l ? "," : "",
+			kLayouts[l].name,
+			huge ? "true" : "false",
+			locked ? "true" : "false",
+			setup / 1e6 / kBench_Rounds,
+			faults,
+			Bench_Percentile(cycles, count, 50.0) / 1000.0,
+			Bench_Percentile(cycles, count, 99.0) / 1000.0,
+			Bench_Percentile(cycles, count, 99.9) / 1000.0,
+			Bench_Percentile(cycles, count, 100.0) / 1000.0);
+	}
+
+	printf("],\"correct\":%s}\n", correct ? "true" : "false");
+	return correct ? EXIT_SUCCESS : EXIT_FAILURE;
+}
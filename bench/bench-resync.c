@@ -0,0 +1,150 @@
+/*
+	,---.         .              ,-_/
+	|  -' ,-. ,-. |- ,-. . ,-.   '  | ,-. ,-. . ,
+	|   . ,-| | | |  ,-| | | |      | ,-| |   |/
+	`---' `-^ |-' `' `-^ ' ' '      | `-^ `-' |\
+	          |                  /  |         ' `
+	          '                  `--'
+	          captain jack audio device
+	         github.com/qix-/captainjack
+
+	        copyright (c) 2016 josh junon
+	        released under the MIT license
+*/
+
+/*
+	how long a freshly (re)started daemon takes to know
+	everything again. the parent plays the device with 50
+	clients doing IO; each round forks a daemon that connects,
+	waits for the snapshot and dies, and the device changes a
+	client while nobody is listening. every snapshot has to
+	reflect that change.
+
+	resync_us is from the fork to the snapshot arriving, so it
+	includes starting the process.
+*/
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "../src/xmit.h"
+#include "bench.h"
+
+#define kBench_Clients  50
+#define kBench_Rounds   50
+
+typedef struct {
+	unsigned int added;
+	unsigned int removed;
+	uint64_t     arrived;
+	bool         correct;
+} Shared;
+
+static Shared *gShared = NULL;
+
+static void OnReady(void) {
+}
+
+static void OnPIDCID(unsigned int cid, pid_t pid) {
+}
+
+static void OnCID(unsigned int cid) {
+}
+
+static void OnSilence(unsigned int cid, bool silent) {
+}
+
+static void OnSnapshot(const CaptainJack_XmitClient *clients, unsigned int count) {
+	bool added = gShared->added == 0;
+	bool removed = true;
+	unsigned int io = 0;
+	for (unsigned int i = 0; i < count; i++) {
+		added = added || clients[i].cid == gShared->added;
+		removed = removed && clients[i].cid != gShared->removed;
+		io += clients[i].io;
+	}
+
+	gShared->correct = count == kBench_Clients && io == kBench_Clients && added && removed;
+	__atomic_store_n(&gShared->arrived, Bench_Now(), __ATOMIC_RELEASE);
+}
+
+static CaptainJack_Xmitter gReceiver = {
+	&OnReady,
+	&OnPIDCID,
+	&OnPIDCID,
+	&OnCID,
+	&OnCID,
+	&OnSilence,
+	&OnSnapshot,
+};
+
+static void Daemon(void) {
+	CaptainJack_RegisterXmitterClient(&gReceiver);
+
+	while (!__atomic_load_n(&gShared->arrived, __ATOMIC_ACQUIRE)) {
+		CaptainJack_TickXmitter();
+		usleep(100);
+	}
+
+	// a crash, as far as the device can tell
+	_exit(EXIT_SUCCESS);
+}
+
+int main(void) {
+	static uint64_t resyncs[kBench_Rounds];
+
+	gShared = mmap(NULL, sizeof(*gShared), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (gShared == MAP_FAILED) {
+		perror("bench-resync: could not map shared memory");
+		return EXIT_FAILURE;
+	}
+
+	// nobody's listening yet, so all of this only lands in the device's table
+	CaptainJack_Xmitter *device = CaptainJack_GetXmitterServer();
+	for (unsigned int cid = 1; cid <= kBench_Clients; cid++) {
+		device->do_client_connect(cid, (pid_t) (1000 + cid));
+		device->do_client_enable_io(cid);
+	}
+
+	unsigned int wrong = 0;
+
+	for (int round = 0; round < kBench_Rounds; round++) {
+		gShared->arrived = 0;
+		gShared->correct = false;
+
+		uint64_t start = Bench_Now();
+		pid_t child = fork();
+		if (child < 0) {
+			perror("bench-resync: could not fork");
+			return EXIT_FAILURE;
+		} else if (child == 0) {
+			Daemon();
+		}
+
+		waitpid(child, NULL, 0);
+		resyncs[round] = __atomic_load_n(&gShared->arrived, __ATOMIC_ACQUIRE) - start;
+
+		wrong += !gShared->correct;
+
+		// replace the oldest client while the daemon is down
+		gShared->removed = (unsigned int) round + 1;
+		gShared->added = (unsigned int) round + 1 + kBench_Clients;
+		device->do_client_disconnect(gShared->removed, (pid_t) (1000 + gShared->removed));
+		device->do_client_connect(gShared->added, (pid_t) (1000 + gShared->added));
+		device->do_client_enable_io(gShared->added);
+	}
+
+	printf("{\"benchmark\":\"resync\",\"clients\":%d,\"rounds\":%d,\"wrong_snapshots\":%u,\"resync_p50_us\":%.1f,\"resync_p99_us\":%.1f,\"resync_worst_us\":%.1f}\n",
+		kBench_Clients,
+		kBench_Rounds,
+		wrong,
+		Bench_Percentile(resyncs, kBench_Rounds, 50.0) / 1000.0,
+		Bench_Percentile(resyncs, kBench_Rounds, 99.0) / 1000.0,
+		Bench_Percentile(resyncs, kBench_Rounds, 100.0) / 1000.0);
+
+	return wrong == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,131 @@
+/*
+	,---.         .              ,-_/
+	|  -' ,-. ,-. |- ,-. . ,-.   '  | ,-. ,-. . ,
+	|   . ,-| | | |  ,-| | | |      | ,-| |   |/
+	`---' `-^ |-' `' `-^ ' ' '      | `-^ `-' |\
+	          |                  /  |         ' `
+	          '                  `--'
+	          captain jack audio device
+	         github.com/qix-/captainjack
+
+	        copyright (c) 2016 josh junon
+	        released under the MIT license
+*/
+
+/*
+	compiles a 10,000 rule file and times matching a mix of
+	literal hits, glob hits and misses against it.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "../src/routes.h"
+#include "bench.h"
+
+#define kBench_Rules     10000
+#define kBench_Subjects  1024
+#define kBench_Rounds    200
+
+int main(void) {
+	char path[] = "/tmp/captain-jack-routes-XXXXXX";
+	int fd = mkstemp(path);
+	FILE *file = fd < 0 ? NULL : fdopen(fd, "w");
+	if (file == NULL) {
+		perror("bench-routes: could not create rules file");
+		return EXIT_FAILURE;
+	}
+
+	// mostly literal names, with prefix globs, bundle globs and a few leading-star globs
+	for (int i = 0; i < kBench_Rules; i++) {
+		switch (i % 10) {
+		case 0:
+			fprintf(file, "name  vendor%d-*           bus%d:in_1,bus%d:in_2 gain -3\n", i, i, i);
+			break;
+		case 1:
+			fprintf(file, "bundle com.vendor%d.*      bus%d:in_1,bus%d:in_2\n", i, i, i);
+			break;
+		case 2:
+			if (i % 1000 == 2) {
+				fprintf(file, "path  */helper%d          bus%d:in_1\n", i, i);
+				break;
+			}
+			// fall through
+		default:
+			fprintf(file, "name  \"App Number %d\"     bus%d:in_1,bus%d:in_2\n", i, i, i);
+		}
+	}
+	fclose(file);
+
+	uint64_t start = Bench_Now();
+	CaptainJack_Routes *routes = CaptainJack_LoadRoutes(path);
+	uint64_t compile = Bench_Now() - start;
+	unlink(path);
+
+	if (routes == NULL) {
+		fprintf(stderr, "bench-routes: could not compile rules\n");
+		return EXIT_FAILURE;
+	}
+
+	static char names[kBench_Subjects][64];
+	static char bundles[kBench_Subjects][64];
+	static char paths[kBench_Subjects][64];
+	CaptainJack_RouteSubject subjects[kBench_Subjects];
+
+	srand(1);
+	for (int i = 0; i < kBench_Subjects; i++) {
+		int rule = rand() % kBench_Rules;
+		switch (i % 4) {
+		case 0:
+			snprintf(names[i], sizeof(names[i]), "App Number %d", rule);
+			break;
+		case 1:
+			snprintf(names[i], sizeof(names[i]), "vendor%d-helper", rule - rule % 10);
+			break;
+		case 2:
+			snprintf(names[i], sizeof(names[i]), "Unknown App %d", rule);
+			break;
+		default:
+			snprintf(names[i], sizeof(names[i]), "app%d", rule);
+		}
+
+		snprintf(bundles[i], sizeof(bundles[i]), "com.vendor%d.app", rule - rule % 10 + 1);
+		snprintf(paths[i], sizeof(paths[i]), "/Applications/App%d.app/Contents/MacOS/App", rule);
+
+		subjects[i].keys[kRouteKey_Name] = names[i];
+		subjects[i].keys[kRouteKey_Path] = paths[i];
+		subjects[i].keys[kRouteKey_Bundle] = (i % 8 == 3) ? bundles[i] : NULL;
+	}
+
+	unsigned long matched = 0;
+	uint64_t best = UINT64_MAX;
+	uint64_t total = 0;
+
+	for (int round = 0; round < kBench_Rounds; round++) {
+		start = Bench_Now();
+		for (int i = 0; i < kBench_Subjects; i++) {
+			const CaptainJack_Route *route = CaptainJack_MatchRoute(routes, &subjects[i]);
+			Bench_Consume(route);
+			matched += route != NULL;
+		}
+		uint64_t elapsed = Bench_Now() - start;
+
+		total += elapsed;
+		if (elapsed < best) {
+			best = elapsed;
+		}
+	}
+
+	printf("{\"benchmark\":\"routes\",\"rules\":%d,\"compile_us\":%.1f,\"subjects\":%d,\"matched\":%lu,"
+		"\"match_ns_best\":%.1f,\"match_ns_mean\":%.1f}\n",
+		kBench_Rules,
+		compile / 1000.0,
+		kBench_Subjects,
+		matched / kBench_Rounds,
+		(double) best / kBench_Subjects,
+		(double) total / kBench_Rounds / kBench_Subjects);
+
+	CaptainJack_FreeRoutes(routes);
+	return EXIT_SUCCESS;
+}
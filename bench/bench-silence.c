@@ -0,0 +1,155 @@
+/*
+	,---.         .              ,-_/
+	|  -' ,-. ,-. |- ,-. . ,-.   '  | ,-. ,-. . ,
+	|   . ,-| | | |  ,-| | | |      | ,-| |   |/
+	`---' `-^ |-' `' `-^ ' ' '      | `-^ `-' |\
+	          |                  /  |         ' `
+	          '                  `--'
+	          captain jack audio device
+	         github.com/qix-/captainjack
+
+	        copyright (c) 2016 josh junon
+	        released under the MIT license
+*/
+
+/*
+	what 50 idle clients cost the daemon's process callback
+	per period, with every port buffer cleared and metered
+	each cycle (what it did before the device reported
+	silence) and with silent clients' buffers left alone
+	once they've been cleared.
+
+	detect_ns is the device's side of the bargain: running
+	the silence detector over one client's stereo buffer in
+	ProcessOutput, next to a full measure of the same buffer.
+*/
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../src/dsp.h"
+#include "bench.h"
+
+#define kBench_Clients    50
+#define kBench_Channels   2
+#define kBench_Rate       48000
+#define kBench_Periods    20000
+#define kBench_Threshold  (1.0f / 65536.0f)
+
+typedef struct {
+	float    peak[kBench_Channels];
+	double   squares[kBench_Channels];
+	uint64_t frames;
+} Level;
+
+typedef struct {
+	bool  silent;
+	void *zeroed[kBench_Channels];
+} Slot;
+
+static float  gBuffers[kBench_Clients][kBench_Channels][1024];
+static Level  gLevels[kBench_Clients];
+static Slot   gSlots[kBench_Clients];
+
+// the daemon's per-client loop; `skip` is whether it pays attention to `silent`
+static uint64_t Period(unsigned int frames, bool skip) {
+	uint64_t written = 0;
+
+	for (int c = 0; c < kBench_Clients; c++) {
+		Slot *slot = &gSlots[c];
+		Level *level = &gLevels[c];
+		bool silent = skip && __atomic_load_n(&slot->silent, __ATOMIC_RELAXED);
+
+		for (int ch = 0; ch < kBench_Channels; ch++) {
+			float *buffer = gBuffers[c][ch];
+
+			if (silent && buffer == slot->zeroed[ch]) {
+				continue;
+			}
+
+			memset(buffer, 0, frames * sizeof(*buffer));
+			slot->zeroed[ch] = silent ? buffer : NULL;
+			written++;
+
+			float peak;
+			float squares;
+			CaptainJack_Measure(buffer, frames, &peak, &squares);
+			if (peak > level->peak[ch]) {
+				level->peak[ch] = peak;
+			}
+			level->squares[ch] += squares;
+		}
+
+		level->frames += frames;
+	}
+
+	return written;
+}
+
+static double Time(unsigned int frames, bool skip) {
+	uint64_t total = 0;
+
+	for (int period = 0; period < kBench_Periods; period++) {
+		uint64_t start = Bench_Now();
+		Bench_Consume((void *) (uintptr_t) Period(frames, skip));
+		total += Bench_Now() - start;
+	}
+
+	Bench_Consume(gLevels);
+	return (double) total / kBench_Periods;
+}
+
+static double TimeDetect(unsigned int frames, bool measure) {
+	static float interleaved[2048];
+	uint64_t total = 0;
+	float peak;
+	float squares;
+
+	for (int period = 0; period < kBench_Periods; period++) {
+		uint64_t start = Bench_Now();
+		if (measure) {
+			CaptainJack_Measure(interleaved, frames * kBench_Channels, &peak, &squares);
+			Bench_Consume(&peak);
+		} else {
+			Bench_Consume((void *) (uintptr_t) CaptainJack_IsSilent(interleaved, frames * kBench_Channels, kBench_Threshold));
+		}
+		total += Bench_Now() - start;
+	}
+
+	return (double) total / kBench_Periods;
+}
+
+int main(void) {
+	static const unsigned int periods[] = { 64, 128, 256, 512, 1024 };
+
+	for (int c = 0; c < kBench_Clients; c++) {
+		gSlots[c].silent = true;
+	}
+
+	printf("{\"benchmark\":\"silence\",\"clients\":%d,\"rate\":%d,\"periods\":[", kBench_Clients, kBench_Rate);
+
+	for (size_t p = 0; p < sizeof(periods) / sizeof(periods[0]); p++) {
+		unsigned int frames = periods[p];
+		double budget = 1e9 * frames / kBench_Rate;
+
+		double always = Time(frames, false);
+		double skipping = Time(frames, true);
+
+		printf("%s{\"frames\":%u,\"period_us\":%.1f,\"always_ns\":%.1f,\"skipping_ns\":%.1f,\"always_percent\":%.3f,\"skipping_percent\":%.3f,\"saved_percent\":%.1f,\"detect_ns\":%.1f,\"measure_ns\":%.1f}",
+			p ? "," : "",
+			frames,
+			budget / 1000.0,
+			always,
+			skipping,
+			100.0 * always / budget,
+			100.0 * skipping / budget,
+			100.0 * (always - skipping) / always,
+			TimeDetect(frames, false),
+			TimeDetect(frames, true));
+	}
+
+	printf("]}\n");
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,194 @@
+/*
+	,---.         .              ,-_/
+	|  -' ,-. ,-. |- ,-. . ,-.   '  | ,-. ,-. . ,
+	|   . ,-| | | |  ,-| | | |      | ,-| |   |/
+	`---' `-^ |-' `' `-^ ' ' '      | `-^ `-' |\
+	          |                  /  |         ' `
+	          '                  `--'
+	          captain jack audio device
+	         github.com/qix-/captainjack
+
+	        copyright (c) 2016 josh junon
+	        released under the MIT license
+*/
+
+
+/*
+	256 clients connecting and disconnecting at random for a
+	long while, each getting a ring of one of three sizes out
+	of a 16 MiB region (the daemon's default) through the
+	slab allocator, and the same churn through posix_memalign()
+	for comparison.
+
+	every ring is stamped with its owner at both ends and
+	checked when it's given back, so two rings overlapping
+	shows up as broken. fragmented counts allocations that
+	failed even though the region had that many bytes free.
+*/
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include "../src/slab.h"
+#include "bench.h"
+
+#define kBench_Clients  256
+#define kBench_Steps    400000
+#define kBench_Region   (16u << 20)
+
+static const size_t kSizes[] = { 16384, 65536, 262144 };
+
+typedef struct {
+	uint64_t *ring;
+	size_t    bytes;
+} Ring;
+
+static Ring     gRings[kBench_Clients];
+static uint64_t gAllocs[kBench_Steps];
+static uint64_t gFrees[kBench_Steps];
+
+static size_t PickSize(void) {
+	int roll = rand() % 10;
+	return roll < 3 ? kSizes[0] : roll < 9 ? kSizes[1] : kSizes[2];
+}
+
+static void * SystemAlloc(size_t bytes) {
+	void *memory = NULL;
+	return posix_memalign(&memory, kSlab_PageBytes, bytes) == 0 ? memory : NULL;
+}
+
+static void Stamp(Ring *ring, unsigned int owner) {
+	size_t words = ring->bytes / sizeof(uint64_t);
+	ring->ring[0] = owner;
+	ring->ring[words - 1] = ~(uint64_t) owner;
+}
+
+static bool Check(const Ring *ring, unsigned int owner) {
+	size_t words = ring->bytes / sizeof(uint64_t);
+	return ring->ring[0] == owner && ring->ring[words - 1] == ~(uint64_t) owner;
+}
+
+int main(void) {
+	void *region = mmap(NULL, kBench_Region, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (region == MAP_FAILED) {
+		perror("bench-slab: could not map the region");
+		return EXIT_FAILURE;
+	}
+
+	static CaptainJack_Slab slab;
+	if (!CaptainJack_InitSlab(&slab, region, kBench_Region, kSizes, sizeof(kSizes) / sizeof(kSizes[0]))) {
+		fprintf(stderr, "bench-slab: could not set up the slab allocator\n");
+		return EXIT_FAILURE;
+	}
+
+	uint64_t broken = 0;
+	uint64_t misaligned = 0;
+	uint64_t fragmented = 0;
+	size_t allocs = 0;
+	size_t frees = 0;
+	double occupancy = 0.0;
+
+	for (int pass = 0; pass < 2; pass++) {
+		bool useSlab = pass == 0;
+		size_t count = 0;
+		srand(1);
+
+		for (int step = 0; step < kBench_Steps; step++) {
+			unsigned int owner = (unsigned int) rand() % kBench_Clients;
+			Ring *ring = &gRings[owner];
+
+			if (ring->ring == NULL) {
+				size_t bytes = PickSize();
+				uint64_t start = Bench_Now();
+				void *memory = useSlab ? CaptainJack_SlabAlloc(&slab, bytes) : SystemAlloc(bytes);
+				uint64_t elapsed = Bench_Now() - start;
+
+				if (memory == NULL) {
+					fragmented += useSlab && kBench_Region - slab.bytesUsed >= bytes;
+					continue;
+				}
+
+				gAllocs[count++] = elapsed;
+				misaligned += ((uintptr_t) memory & (kSlab_PageBytes - 1)) != 0;
+				ring->ring = memory;
+				ring->bytes = bytes;
+				Stamp(ring, owner);
+			} else {
+				broken += !Check(ring, owner);
+
+				uint64_t start = Bench_Now();
+				if (useSlab) {
+					CaptainJack_SlabFree(&slab, ring->ring);
+				} else {
+					free(ring->ring);
+				}
+				gFrees[frees++ % kBench_Steps] = Bench_Now() - start;
+				ring->ring = NULL;
+			}
+
+			if (useSlab) {
+				occupancy += (double) slab.bytesUsed / kBench_Region;
+			}
+		}
+
+		// everyone disconnects
+		for (unsigned int owner = 0; owner < kBench_Clients; owner++) {
+			if (gRings[owner].ring != NULL) {
+				broken += !Check(&gRings[owner], owner);
+				if (useSlab) {
+					CaptainJack_SlabFree(&slab, gRings[owner].ring);
+				} else {
+					free(gRings[owner].ring);
+				}
+				gRings[owner].ring = NULL;
+			}
+		}
+
+		if (pass == 0) {
+			allocs = count;
+			printf("{\"benchmark\":\"slab\",\"clients\":%d,\"steps\":%d,\"region_mib\":%u,\"slab\":{\"alloc_p50_ns\":%llu,\"alloc_p99_ns\":%llu,",
+				kBench_Clients,
+				kBench_Steps,
+				kBench_Region >> 20,
+				(unsigned long long) Bench_Percentile(gAllocs, count, 50.0),
+				(unsigned long long) Bench_Percentile(gAllocs, count, 99.0));
+			printf("\"free_p50_ns\":%llu,\"free_p99_ns\":%llu,\"allocations\":%zu,\"mean_occupancy_percent\":%.1f,\"peak_occupancy_percent\":%.1f,\"classes\":[",
+				(unsigned long long) Bench_Percentile(gFrees, frees < kBench_Steps ? frees : kBench_Steps, 50.0),
+				(unsigned long long) Bench_Percentile(gFrees, frees < kBench_Steps ? frees : kBench_Steps, 99.0),
+				allocs,
+				100.0 * occupancy / kBench_Steps,
+				100.0 * (double) slab.peakBytesUsed / kBench_Region);
+
+			for (unsigned int i = 0; i < slab.classCount; i++) {
+				printf("%s{\"bytes\":%zu,\"allocations\":%llu,\"failures\":%llu}",
+					i ? "," : "",
+					slab.classes[i].slotBytes,
+					(unsigned long long) slab.classes[i].allocations,
+					(unsigned long long) slab.classes[i].failures);
+			}
+
+			printf("],\"fragmented\":%llu,\"all_free_after\":%s},",
+				(unsigned long long) fragmented,
+				slab.bytesUsed == 0 && slab.freeSlabs == slab.slabCount ? "true" : "false");
+		} else {
+			printf("\"posix_memalign\":{\"alloc_p50_ns\":%llu,\"alloc_p99_ns\":%llu,\"free_p50_ns\":%llu,\"free_p99_ns\":%llu},",
+				(unsigned long long) Bench_Percentile(gAllocs, count, 50.0),
+				(unsigned long long) Bench_Percentile(gAllocs, count, 99.0),
+				(unsigned long long) Bench_Percentile(gFrees, frees < kBench_Steps ? frees : kBench_Steps, 50.0),
+				(unsigned long long) Bench_Percentile(gFrees, frees < kBench_Steps ? frees : kBench_Steps, 99.0));
+		}
+
+		frees = 0;
+	}
+
+	bool correct = broken == 0 && misaligned == 0 && slab.bytesUsed == 0 && slab.freeSlabs == slab.slabCount;
+	printf("\"broken\":%llu,\"misaligned\":%llu,\"correct\":%s}\n",
+		(unsigned long long) broken,
+		(unsigned long long) misaligned,
+		correct ? "true" : "false");
+
+	return correct ? EXIT_SUCCESS : EXIT_FAILURE;
+}
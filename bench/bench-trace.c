@@ -0,0 +1,100 @@
+/*
+	,---.         .              ,-_/
+	|  -' ,-. ,-. |- ,-. . ,-.   '  | ,-. ,-. . ,
+	|   . ,-| | | |  ,-| | | |      | ,-| |   |/
+	`---' `-^ |-' `' `-^ ' ' '      | `-^ `-' |\
+	          |                  /  |         ' `
+	          '                  `--'
+	          captain jack audio device
+	         github.com/qix-/captainjack
+
+	        copyright (c) 2016 josh junon
+	        released under the MIT license
+*/
+
+/*
+	times recording trace events, alone and with a few threads
+	recording at once, and how long dumping the rings takes.
+
+	stamp_ns is what reading the cycle counter alone costs; on
+	virtual machines that's most of an event.
+*/
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "../src/trace.h"
+#include "bench.h"
+
+#define kBench_Events   2000000
+#define kBench_Threads  4
+
+static double TimeEvents(void) {
+	uint64_t start = Bench_Now();
+	for (int i = 0; i < kBench_Events / 2; i++) {
+		CaptainJack_TraceBegin("bench", "event");
+		CaptainJack_TraceEnd("bench", "event");
+	}
+	return (double) (Bench_Now() - start) / kBench_Events;
+}
+
+static void * Record(void *arg) {
+	*(double *) arg = TimeEvents();
+	return NULL;
+}
+
+int main(void) {
+	uint64_t start = Bench_Now();
+	for (int i = 0; i < kBench_Events; i++) {
+		Bench_Consume((void *) (uintptr_t) CaptainJack_TraceTicks());
+	}
+	double stamp = (double) (Bench_Now() - start) / kBench_Events;
+
+	// warm up (and claim) this thread's ring
+	TimeEvents();
+	double single = TimeEvents();
+
+	pthread_t threads[kBench_Threads];
+	double results[kBench_Threads];
+	for (int i = 0; i < kBench_Threads; i++) {
+		pthread_create(&threads[i], NULL, &Record, &results[i]);
+	}
+
+	double worst = 0.0;
+	for (int i = 0; i < kBench_Threads; i++) {
+		pthread_join(threads[i], NULL);
+		if (results[i] > worst) {
+			worst = results[i];
+		}
+	}
+
+	char path[] = "/tmp/captain-jack-trace-XXXXXX";
+	int fd = mkstemp(path);
+	if (fd < 0) {
+		perror("bench-trace: could not create dump file");
+		return EXIT_FAILURE;
+	}
+	close(fd);
+
+	start = Bench_Now();
+	bool dumped = CaptainJack_DumpTrace(path);
+	uint64_t dump = Bench_Now() - start;
+	unlink(path);
+
+	if (!dumped) {
+		fprintf(stderr, "bench-trace: could not dump the trace\n");
+		return EXIT_FAILURE;
+	}
+
+	printf("{\"benchmark\":\"trace\",\"events\":%d,\"stamp_ns\":%.1f,\"event_ns\":%.1f,\"threads\":%d,\"event_ns_contended\":%.1f,\"dump_ms\":%.2f}\n",
+		kBench_Events,
+		stamp,
+		single,
+		kBench_Threads,
+		worst,
+		dump / 1e6);
+
+	return EXIT_SUCCESS;
+}
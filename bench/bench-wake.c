@@ -0,0 +1,198 @@
+/*
+	,---.         .              ,-_/
+	|  -' ,-. ,-. |- ,-. . ,-.   '  | ,-. ,-. . ,
+	|   . ,-| | | |  ,-| | | |      | ,-| |   |/
+	`---' `-^ |-' `' `-^ ' ' '      | `-^ `-' |\
+	          |                  /  |         ' `
+	          '                  `--'
+	          captain jack audio device
+	         github.com/qix-/captainjack
+
+	        copyright (c) 2016 josh junon
+	        released under the MIT license
+*/
+
+
+/*
+	how long the daemon takes to notice the device has
+	written a period, with the daemon in a process of its
+	own waiting on the transport region's wake word. the
+	device wakes it once every kBench_IntervalUs, stamping
+	the time it did.
+
+	spin never sleeps (and so burns its core: cpu_percent
+	is the daemon's CPU time over the run). pipe is a byte
+	down a pipe each time, read after poll(), for what a
+	message per cycle costs. every backend that works here
+	then goes once blocking straight away and once spinning
+	for kBench_SpinUs first.
+
+	lost is waits that timed out; with a wake every
+	interval, any at all means one went missing.
+*/
+
+#include <poll.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "../src/wake.h"
+#include "bench.h"
+
+#define kBench_Wakes       500
+#define kBench_IntervalUs  1000
+#define kBench_SpinUs      20
+#define kBench_TimeoutNs   1000000000ull
+
+typedef struct {
+	CaptainJack_WakeWord word;
+	uint64_t             stamps[kBench_Wakes + 1];
+	uint64_t             latencies[kBench_Wakes];
+	uint32_t             received;
+	uint32_t             lost;
+	uint64_t             cpu;
+	uint64_t             wall;
+} Shared;
+
+static Shared *gShared = NULL;
+
+static void Consume(uint64_t spinNanos, int pipe) {
+	CaptainJack_Waker waker;
+	if (pipe < 0 && !CaptainJack_OpenWaker(&waker, &gShared->word)) {
+		_exit(EXIT_FAILURE);
+	}
+
+	uint64_t start = Bench_Now();
+	uint64_t cpu = Bench_ThreadTime();
+	uint32_t seen = 0;
+
+	while (seen < kBench_Wakes && gShared->lost < 3) {
+		uint32_t sequence;
+
+		if (pipe >= 0) {
+			struct pollfd fd = { pipe, POLLIN, 0 };
+			char bytes[64];
+			ssize_t got;
+
+			if (poll(&fd, 1, (int) (kBench_TimeoutNs / 1000000)) <= 0 || (got = read(pipe, bytes, sizeof(bytes))) <= 0) {
+				gShared->lost++;
+				continue;
+			}
+
+			sequence = seen + (uint32_t) got;
+		} else {
+			if (!CaptainJack_WaitForWake(&waker, seen, spinNanos, kBench_TimeoutNs)) {
+				gShared->lost++;
+				continue;
+			}
+
+			sequence = CaptainJack_WakeSequence(&waker);
+		}
+
+		gShared->latencies[gShared->received++] = Bench_Now() - gShared->stamps[sequence];
+		seen = sequence;
+	}
+
+	gShared->cpu = Bench_ThreadTime() - cpu;
+	gShared->wall = Bench_Now() - start;
+
+	if (pipe < 0) {
+		CaptainJack_CloseWaker(&waker);
+	}
+
+	_exit(EXIT_SUCCESS);
+}
+
+// false if the consumer didn't see every wake
+static bool Run(const char *mode, CaptainJack_WakeBackend backend, uint64_t spinNanos, bool first) {
+	CaptainJack_Waker waker;
+	const char *used = "pipe";
+	int pipes[2] = { -1, -1 };
+
+	memset(gShared, 0, sizeof(*gShared));
+
+	if (backend == kWake_Count) {
+		if (pipe(pipes) != 0) {
+			perror("bench-wake: could not open a pipe");
+			exit(EXIT_FAILURE);
+		}
+	} else if (!CaptainJack_CreateWaker(&waker, &gShared->word, backend)) {
+		fprintf(stderr, "bench-wake: could not set up %s\n", CaptainJack_WakeBackendName(backend));
+		exit(EXIT_FAILURE);
+	} else {
+		used = CaptainJack_WakeBackendName(waker.backend);
+	}
+
+	pid_t child = fork();
+	if (child < 0) {
+		perror("bench-wake: could not fork");
+		exit(EXIT_FAILURE);
+	} else if (child == 0) {
+		Consume(spinNanos, pipes[0]);
+	}
+
+	for (uint32_t n = 1; n <= kBench_Wakes; n++) {
+		usleep(kBench_IntervalUs);
+		gShared->stamps[n] = Bench_Now();
+
+		if (backend == kWake_Count) {
+			if (write(pipes[1], "", 1) != 1) {
+				perror("bench-wake: could not write to the pipe");
+			}
+		} else {
+			CaptainJack_Wake(&waker);
+		}
+	}
+
+	int status = 0;
+	waitpid(child, &status, 0);
+
+	if (backend == kWake_Count) {
+		close(pipes[0]);
+		close(pipes[1]);
+	} else {
+		CaptainJack_CloseWaker(&waker);
+	}
+
+	uint32_t received = gShared->received;
+	printf("%s{\"mode\":\"%s\",\"backend\":\"%s\",\"spin_us\":%.0f,\"woken\":%u,\"lost\":%u,\"wake_p50_us\":%.1f,\"wake_p99_us\":%.1f,\"wake_worst_us\":%.1f,\"cpu_percent\":%.1f}",
+		first ? "" : ",",
+		mode,
+		used,
+		spinNanos == UINT64_MAX ? -1.0 : spinNanos / 1000.0,
+		received,
+		gShared->lost,
+		Bench_Percentile(gShared->latencies, received, 50.0) / 1000.0,
+		Bench_Percentile(gShared->latencies, received, 99.0) / 1000.0,
+		Bench_Percentile(gShared->latencies, received, 100.0) / 1000.0,
+		gShared->wall ? 100.0 * gShared->cpu / gShared->wall : 0.0);
+
+	return WIFEXITED(status) && WEXITSTATUS(status) == EXIT_SUCCESS && gShared->lost == 0;
+}
+
+int main(void) {
+	gShared = mmap(NULL, sizeof(*gShared), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (gShared == MAP_FAILED) {
+		perror("bench-wake: could not map shared memory");
+		return EXIT_FAILURE;
+	}
+
+	printf("{\"benchmark\":\"wake\",\"wakes\":%d,\"interval_us\":%d,\"results\":[", kBench_Wakes, kBench_IntervalUs);
+
+	bool correct = Run("spin", kWake_Auto, UINT64_MAX, true);
+	correct = Run("pipe", kWake_Count, 0, false) && correct;
+
+	for (int backend = kWake_Auto + 1; backend < kWake_Count; backend++) {
+		if (CaptainJack_HasWakeBackend((CaptainJack_WakeBackend) backend)) {
+			correct = Run("block", (CaptainJack_WakeBackend) backend, 0, false) && correct;
+			correct = Run("hybrid", (CaptainJack_WakeBackend) backend, kBench_SpinUs * 1000ull, false) && correct;
+		}
+	}
+
+	printf("],\"correct\":%s}\n", correct ? "true" : "false");
+	return correct ? EXIT_SUCCESS : EXIT_FAILURE;
+}
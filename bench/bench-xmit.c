@@ -0,0 +1,218 @@
+/*
+	,---.         .              ,-_/
+	|  -' ,-. ,-. |- ,-. . ,-.   '  | ,-. ,-. . ,
+	|   . ,-| | | |  ,-| | | |      | ,-| |   |/
+	`---' `-^ |-' `' `-^ ' ' '      | `-^ `-' |\
+	          |                  /  |         ' `
+	          '                  `--'
+	          captain jack audio device
+	         github.com/qix-/captainjack
+
+	        copyright (c) 2016 josh junon
+	        released under the MIT license
+*/
+
+/*
+	runs the real xmit subsystem between two processes over
+	loopback: the parent plays the device and sends, a forked
+	child plays the daemon and ticks the xmitter as fast as it
+	can.
+
+	for every message type and burst size it reports the rate,
+	the send-to-callback latency percentiles and the sender's
+	CPU time per message (the receiver spins, so its CPU time
+	says nothing). send and callback times are taken from the
+	same monotonic clock and shared through an anonymous map.
+*/
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "../src/xmit.h"
+#include "bench.h"
+
+#define kBench_Messages  4000
+#define kBench_Types     6
+#define kBench_Total     (1 + kBench_Types * 3 * kBench_Messages)
+
+typedef struct {
+	uint64_t received;
+	bool     done;
+	uint64_t sent[kBench_Total];
+	uint64_t arrived[kBench_Total];
+} Shared;
+
+static Shared *gShared      = NULL;
+static bool    gSawSynthetic = false;
+
+static void Arrived(void) {
+	uint64_t index = gShared->received;
+	gShared->arrived[index] = Bench_Now();
+	__atomic_store_n(&gShared->received, index + 1, __ATOMIC_RELEASE);
+}
+
+static void OnReady(void) {
+	// the xmitter makes up a ready message for itself when it connects
+	if (!gSawSynthetic) {
+		gSawSynthetic = true;
+		return;
+	}
+	Arrived();
+}
+
+static void OnPIDCID(unsigned int cid, pid_t pid) {
+	Arrived();
+}
+
+static void OnCID(unsigned int cid) {
+	Arrived();
+}
+
+static void OnSilence(unsigned int cid, bool silent) {
+	Arrived();
+}
+
+static void OnSnapshot(const CaptainJack_XmitClient *clients, unsigned int count) {
+	// stands in for the first message if that went out before we'd connected
+	if (count > 0) {
+		Arrived();
+	}
+}
+
+static CaptainJack_Xmitter gReceiver = {
+	&OnReady,
+	&OnPIDCID,
+	&OnPIDCID,
+	&OnCID,
+	&OnCID,
+	&OnSilence,
+	&OnSnapshot,
+};
+
+static void Receive(void) {
+	CaptainJack_RegisterXmitterClient(&gReceiver);
+
+	while (!__atomic_load_n(&gShared->done, __ATOMIC_ACQUIRE)) {
+		if (!CaptainJack_TickXmitter()) {
+			// not listening yet, or the sender went away
+			usleep(1000);
+		}
+	}
+
+	_exit(EXIT_SUCCESS);
+}
+
+static void Send(CaptainJack_Xmitter *xmitter, int type, unsigned int cid) {
+	switch (type) {
+	case 0:
+		xmitter->do_device_ready();
+		break;
+	case 1:
+		xmitter->do_client_connect(cid, 1);
+		break;
+	case 2:
+		xmitter->do_client_disconnect(cid, 1);
+		break;
+	case 3:
+		xmitter->do_client_enable_io(cid);
+		break;
+	case 4:
+		xmitter->do_client_disable_io(cid);
+		break;
+	default:
+		xmitter->do_client_silence(cid, (cid & 1) != 0);
+	}
+}
+
+static void WaitFor(uint64_t count) {
+	// sleep rather than yield so a receiver sharing our core gets to run
+	while (__atomic_load_n(&gShared->received, __ATOMIC_ACQUIRE) < count) {
+		usleep(10);
+	}
+}
+
+int main(void) {
+	static const int bursts[] = { 1, 16, 256 };
+	static const char *names[kBench_Types] = { "ready", "new_client", "client_disconnect", "client_enable_io", "client_disable_io", "client_silence" };
+	static uint64_t latencies[kBench_Messages];
+
+	// this is about the transport; bench-flap is the one about holding back StopIO
+	setenv("CAPTAIN_JACK_IO_COALESCE_MS", "0", 1);
+
+	gShared = mmap(NULL, sizeof(*gShared), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (gShared == MAP_FAILED) {
+		perror("bench-xmit: could not map shared memory");
+		return EXIT_FAILURE;
+	}
+
+	pid_t child = fork();
+	if (child < 0) {
+		perror("bench-xmit: could not fork");
+		return EXIT_FAILURE;
+	} else if (child == 0) {
+		Receive();
+	}
+
+	CaptainJack_Xmitter *xmitter = CaptainJack_GetXmitterServer();
+
+	/*
+		sending doesn't wait for the child to connect; if it
+		hasn't yet, this message is dropped and the client
+		turns up in the snapshot it gets when it does
+	*/
+	uint64_t index = 0;
+	gShared->sent[index++] = Bench_Now();
+	Send(xmitter, 1, 0);
+	WaitFor(index);
+
+	printf("{\"benchmark\":\"xmit\",\"messages\":%d,\"results\":[", kBench_Messages);
+
+	bool first = true;
+	for (int type = 0; type < kBench_Types; type++) {
+		for (size_t b = 0; b < sizeof(bursts) / sizeof(bursts[0]); b++) {
+			uint64_t start = index;
+			uint64_t wall = Bench_Now();
+			uint64_t cpu = 0;
+
+			for (int sent = 0; sent < kBench_Messages; sent += bursts[b]) {
+				uint64_t burst = Bench_ThreadTime();
+				for (int i = 0; i < bursts[b] && sent + i < kBench_Messages; i++) {
+					gShared->sent[index++] = Bench_Now();
+					Send(xmitter, type, (unsigned int) i);
+				}
+				cpu += Bench_ThreadTime() - burst;
+				WaitFor(index);
+			}
+
+			wall = Bench_Now() - wall;
+
+			for (int i = 0; i < kBench_Messages; i++) {
+				latencies[i] = gShared->arrived[start + i] - gShared->sent[start + i];
+			}
+
+			printf("%s{\"type\":\"%s\",\"burst\":%d,\"msgs_per_sec\":%.0f,\"p50_us\":%.1f,\"p99_us\":%.1f,\"p999_us\":%.1f,\"send_cpu_ns\":%.0f}",
+				first ? "" : ",",
+				names[type],
+				bursts[b],
+				kBench_Messages * 1e9 / wall,
+				Bench_Percentile(latencies, kBench_Messages, 50.0) / 1000.0,
+				Bench_Percentile(latencies, kBench_Messages, 99.0) / 1000.0,
+				Bench_Percentile(latencies, kBench_Messages, 99.9) / 1000.0,
+				(double) cpu / kBench_Messages);
+			fflush(stdout);
+			first = false;
+		}
+	}
+
+	printf("]}\n");
+
+	__atomic_store_n(&gShared->done, true, __ATOMIC_RELEASE);
+	waitpid(child, NULL, 0);
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,71 @@
+#ifndef CAPTAIN_JACK_BENCH_H__
+#define CAPTAIN_JACK_BENCH_H__
+/*
+	,---.         .              ,-_/
+	|  -' ,-. ,-. |- ,-. . ,-.   '  | ,-. ,-. . ,
+	|   . ,-| | | |  ,-| | | |      | ,-| |   |/
+	`---' `-^ |-' `' `-^ ' ' '      | `-^ `-' |\
+	          |                  /  |         ' `
+	          '                  `--'
+	          captain jack audio device
+	         github.com/qix-/captainjack
+
+	        copyright (c) 2016 josh junon
+	        released under the MIT license
+*/
+
+/*
+	bits shared between the benchmarks. every benchmark
+	prints a single JSON object to stdout so results can
+	be diffed between commits.
+*/
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+
+static inline uint64_t Bench_Now(void) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t) now.tv_sec * 1000000000ull + (uint64_t) now.tv_nsec;
+}
+
+/*
+	CPU time used by the calling thread
+*/
+static inline uint64_t Bench_ThreadTime(void) {
+	struct timespec now;
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+	return (uint64_t) now.tv_sec * 1000000000ull + (uint64_t) now.tv_nsec;
+}
+
+static inline int Bench_CompareSamples(const void *a, const void *b) {
+	uint64_t left = *(const uint64_t *) a;
+	uint64_t right = *(const uint64_t *) b;
+	return left < right ? -1 : left > right;
+}
+
+/*
+	sorts `samples` in place and returns the given percentile
+	(0 - 100) of them
+*/
+static inline uint64_t Bench_Percentile(uint64_t *samples, size_t count, double percentile) {
+	if (count == 0) {
+		return 0;
+	}
+
+	qsort(samples, count, sizeof(*samples), &Bench_CompareSamples);
+
+	size_t index = (size_t) (percentile / 100.0 * count);
+	return samples[index < count ? index : count - 1];
+}
+
+/*
+	keeps the compiler from throwing away work whose
+	result is otherwise unused
+*/
+static inline void Bench_Consume(const void *value) {
+	__asm__ __volatile__("" : : "r"(value) : "memory");
+}
+
+#endif
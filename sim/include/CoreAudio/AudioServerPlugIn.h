@@ -0,0 +1,299 @@
+#ifndef CAPTAIN_JACK_SIM_AUDIOSERVERPLUGIN_H__
+#define CAPTAIN_JACK_SIM_AUDIOSERVERPLUGIN_H__
+/*
+	,---.         .              ,-_/
+	|  -' ,-. ,-. |- ,-. . ,-.   '  | ,-. ,-. . ,
+	|   . ,-| | | |  ,-| | | |      | ,-| |   |/
+	`---' `-^ |-' `' `-^ ' ' '      | `-^ `-' |\
+	          |                  /  |         ' `
+	          '                  `--'
+	          captain jack audio device
+	         github.com/qix-/captainjack
+
+	        copyright (c) 2016 josh junon
+	        released under the MIT license
+*/
+
+/*
+	stand-in for the parts of AudioServerPlugIn.h (and the
+	CoreAudio headers it pulls in) that the device uses, so
+	it builds on Linux under the host simulator.
+
+	the four character codes match Apple's, but only what
+	the device touches is here, and structures the device
+	only passes along (AudioTimeStamp and friends) are cut
+	down to what the simulator fills in.
+*/
+
+#include <CoreFoundation/CoreFoundation.h>
+
+#define kSim_FourCC(a, b, c, d) ((UInt32) (((UInt32) (a) << 24) | ((UInt32) (b) << 16) | ((UInt32) (c) << 8) | (UInt32) (d)))
+
+typedef UInt32 AudioObjectID;
+typedef UInt32 AudioClassID;
+typedef UInt32 AudioObjectPropertySelector;
+typedef UInt32 AudioObjectPropertyScope;
+typedef UInt32 AudioObjectPropertyElement;
+typedef UInt32 AudioFormatID;
+typedef UInt32 AudioFormatFlags;
+typedef UInt32 AudioChannelLabel;
+typedef UInt32 AudioChannelLayoutTag;
+typedef UInt32 AudioChannelBitmap;
+typedef UInt32 AudioChannelFlags;
+
+typedef struct {
+	AudioObjectPropertySelector mSelector;
+	AudioObjectPropertyScope    mScope;
+	AudioObjectPropertyElement  mElement;
+} AudioObjectPropertyAddress;
+
+typedef struct {
+	Float64 mMinimum;
+	Float64 mMaximum;
+} AudioValueRange;
+
+typedef struct {
+	Float64          mSampleRate;
+	AudioFormatID    mFormatID;
+	AudioFormatFlags mFormatFlags;
+	UInt32           mBytesPerPacket;
+	UInt32           mFramesPerPacket;
+	UInt32           mBytesPerFrame;
+	UInt32           mChannelsPerFrame;
+	UInt32           mBitsPerChannel;
+	UInt32           mReserved;
+} AudioStreamBasicDescription;
+
+typedef struct {
+	AudioStreamBasicDescription mFormat;
+	AudioValueRange             mSampleRateRange;
+} AudioStreamRangedDescription;
+
+typedef struct {
+	AudioChannelLabel mChannelLabel;
+	AudioChannelFlags mChannelFlags;
+	Float32           mCoordinates[3];
+} AudioChannelDescription;
+
+typedef struct {
+	AudioChannelLayoutTag   mChannelLayoutTag;
+	AudioChannelBitmap      mChannelBitmap;
+	UInt32                  mNumberChannelDescriptions;
+	AudioChannelDescription mChannelDescriptions[1];
+} AudioChannelLayout;
+
+typedef struct {
+	Float64 mSampleTime;
+	UInt64  mHostTime;
+	Float64 mRateScalar;
+	UInt32  mFlags;
+} AudioTimeStamp;
+
+typedef struct {
+	UInt64         mIOCycleCounter;
+	UInt32         mNominalIOBufferFrameSize;
+	AudioTimeStamp mCurrentTime;
+	AudioTimeStamp mInputTime;
+	AudioTimeStamp mOutputTime;
+	Float64        mMainHostTicksPerFrame;
+	Float64        mDeviceHostTicksPerFrame;
+} AudioServerPlugInIOCycleInfo;
+
+typedef struct {
+	UInt32      mClientID;
+	pid_t       mProcessID;
+	Boolean     mIsNativeEndian;
+	CFStringRef mBundleID;
+} AudioServerPlugInClientInfo;
+
+typedef struct AudioServerPlugInHostInterface AudioServerPlugInHostInterface;
+typedef const AudioServerPlugInHostInterface *AudioServerPlugInHostRef;
+
+struct AudioServerPlugInHostInterface {
+	OSStatus (*PropertiesChanged)(AudioServerPlugInHostRef inHost, AudioObjectID inObjectID, UInt32 inNumberAddresses, const AudioObjectPropertyAddress *inAddresses);
+	OSStatus (*CopyFromStorage)(AudioServerPlugInHostRef inHost, CFStringRef inKey, CFPropertyListRef *outData);
+	OSStatus (*WriteToStorage)(AudioServerPlugInHostRef inHost, CFStringRef inKey, CFPropertyListRef inData);
+	OSStatus (*DeleteFromStorage)(AudioServerPlugInHostRef inHost, CFStringRef inKey);
+	OSStatus (*RequestDeviceConfigurationChange)(AudioServerPlugInHostRef inHost, AudioObjectID inDeviceObjectID, UInt64 inChangeAction, void *inChangeInfo);
+};
+
+typedef struct AudioServerPlugInDriverInterface AudioServerPlugInDriverInterface;
+typedef AudioServerPlugInDriverInterface **AudioServerPlugInDriverRef;
+
+struct AudioServerPlugInDriverInterface {
+	void     *_reserved;
+	HRESULT  (*QueryInterface)(void *inDriver, REFIID inUUID, LPVOID *outInterface);
+	ULONG    (*AddRef)(void *inDriver);
+	ULONG    (*Release)(void *inDriver);
+	OSStatus (*Initialize)(AudioServerPlugInDriverRef inDriver, AudioServerPlugInHostRef inHost);
+	OSStatus (*CreateDevice)(AudioServerPlugInDriverRef inDriver, CFDictionaryRef inDescription, const AudioServerPlugInClientInfo *inClientInfo, AudioObjectID *outDeviceObjectID);
+	OSStatus (*DestroyDevice)(AudioServerPlugInDriverRef inDriver, AudioObjectID inDeviceObjectID);
+	OSStatus (*AddDeviceClient)(AudioServerPlugInDriverRef inDriver, AudioObjectID inDeviceObjectID, const AudioServerPlugInClientInfo *inClientInfo);
+	OSStatus (*RemoveDeviceClient)(AudioServerPlugInDriverRef inDriver, AudioObjectID inDeviceObjectID, const AudioServerPlugInClientInfo *inClientInfo);
+	OSStatus (*PerformDeviceConfigurationChange)(AudioServerPlugInDriverRef inDriver, AudioObjectID inDeviceObjectID, UInt64 inChangeAction, void *inChangeInfo);
+	OSStatus (*AbortDeviceConfigurationChange)(AudioServerPlugInDriverRef inDriver, AudioObjectID inDeviceObjectID, UInt64 inChangeAction, void *inChangeInfo);
+	Boolean  (*HasProperty)(AudioServerPlugInDriverRef inDriver, AudioObjectID inObjectID, pid_t inClientProcessID, const AudioObjectPropertyAddress *inAddress);
+	OSStatus (*IsPropertySettable)(AudioServerPlugInDriverRef inDriver, AudioObjectID inObjectID, pid_t inClientProcessID, const AudioObjectPropertyAddress *inAddress, Boolean *outIsSettable);
+	OSStatus (*GetPropertyDataSize)(AudioServerPlugInDriverRef inDriver, AudioObjectID inObjectID, pid_t inClientProcessID, const AudioObjectPropertyAddress *inAddress, UInt32 inQualifierDataSize, const void *inQualifierData, UInt32 *outDataSize);
+	OSStatus (*GetPropertyData)(AudioServerPlugInDriverRef inDriver, AudioObjectID inObjectID, pid_t inClientProcessID, const AudioObjectPropertyAddress *inAddress, UInt32 inQualifierDataSize, const void *inQualifierData, UInt32 inDataSize, UInt32 *outDataSize, void *outData);
+	OSStatus (*SetPropertyData)(AudioServerPlugInDriverRef inDriver, AudioObjectID inObjectID, pid_t inClientProcessID, const AudioObjectPropertyAddress *inAddress, UInt32 inQualifierDataSize, const void *inQualifierData, UInt32 inDataSize, const void *inData);
+	OSStatus (*StartIO)(AudioServerPlugInDriverRef inDriver, AudioObjectID inDeviceObjectID, UInt32 inClientID);
+	OSStatus (*StopIO)(AudioServerPlugInDriverRef inDriver, AudioObjectID inDeviceObjectID, UInt32 inClientID);
+	OSStatus (*GetZeroTimeStamp)(AudioServerPlugInDriverRef inDriver, AudioObjectID inDeviceObjectID, UInt32 inClientID, Float64 *outSampleTime, UInt64 *outHostTime, UInt64 *outSeed);
+	OSStatus (*WillDoIOOperation)(AudioServerPlugInDriverRef inDriver, AudioObjectID inDeviceObjectID, UInt32 inClientID, UInt32 inOperationID, Boolean *outWillDo, Boolean *outWillDoInPlace);
+	OSStatus (*BeginIOOperation)(AudioServerPlugInDriverRef inDriver, AudioObjectID inDeviceObjectID, UInt32 inClientID, UInt32 inOperationID, UInt32 inIOBufferFrameSize, const AudioServerPlugInIOCycleInfo *inIOCycleInfo);
+	OSStatus (*DoIOOperation)(AudioServerPlugInDriverRef inDriver, AudioObjectID inDeviceObjectID, AudioObjectID inStreamObjectID, UInt32 inClientID, UInt32 inOperationID, UInt32 inIOBufferFrameSize, const AudioServerPlugInIOCycleInfo *inIOCycleInfo, void *ioMainBuffer, void *ioSecondaryBuffer);
+	OSStatus (*EndIOOperation)(AudioServerPlugInDriverRef inDriver, AudioObjectID inDeviceObjectID, UInt32 inClientID, UInt32 inOperationID, UInt32 inIOBufferFrameSize, const AudioServerPlugInIOCycleInfo *inIOCycleInfo);
+};
+
+#define kAudioServerPlugInTypeUUID             CFUUIDGetConstantUUIDWithBytes(NULL, 0x44, 0x3A, 0xBA, 0xB8, 0xE7, 0xB3, 0x49, 0x1A, 0xB9, 0x85, 0xBE, 0xB9, 0x18, 0x70, 0x30, 0xDB)
+#define kAudioServerPlugInDriverInterfaceUUID  CFUUIDGetConstantUUIDWithBytes(NULL, 0xEE, 0xA5, 0x77, 0x3D, 0xCC, 0x43, 0x49, 0xF1, 0x8E, 0x00, 0x8F, 0x96, 0xE7, 0xD2, 0x3B, 0x17)
+
+enum {
+	kAudioHardwareUnspecifiedError          = kSim_FourCC('w', 'h', 'a', 't'),
+	kAudioHardwareUnknownPropertyError      = kSim_FourCC('w', 'h', 'o', '?'),
+	kAudioHardwareBadPropertySizeError      = kSim_FourCC('!', 's', 'i', 'z'),
+	kAudioHardwareIllegalOperationError     = kSim_FourCC('n', 'o', 'p', 'e'),
+	kAudioHardwareBadObjectError            = kSim_FourCC('!', 'o', 'b', 'j'),
+	kAudioHardwareUnsupportedOperationError = kSim_FourCC('u', 'n', 'o', 'p'),
+	kAudioDeviceUnsupportedFormatError      = kSim_FourCC('!', 'd', 'a', 't')
+};
+
+enum {
+	kAudioObjectUnknown         = 0,
+	kAudioObjectPlugInObject    = 1,
+
+	kAudioObjectClassID         = kSim_FourCC('a', 'o', 'b', 'j'),
+	kAudioPlugInClassID         = kSim_FourCC('a', 'p', 'l', 'g'),
+	kAudioBoxClassID            = kSim_FourCC('a', 'b', 'o', 'x'),
+	kAudioDeviceClassID         = kSim_FourCC('a', 'd', 'e', 'v'),
+	kAudioStreamClassID         = kSim_FourCC('a', 's', 't', 'r'),
+	kAudioLevelControlClassID   = kSim_FourCC('l', 'e', 'v', 'l'),
+	kAudioVolumeControlClassID  = kSim_FourCC('v', 'l', 'm', 'e'),
+	kAudioBooleanControlClassID = kSim_FourCC('t', 'o', 'g', 'l'),
+	kAudioMuteControlClassID    = kSim_FourCC('m', 'u', 't', 'e'),
+	kAudioSelectorControlClassID = kSim_FourCC('s', 'l', 'c', 't'),
+	kAudioDataSourceControlClassID = kSim_FourCC('d', 's', 'r', 'c')
+};
+
+enum {
+	kAudioObjectPropertyScopeGlobal   = kSim_FourCC('g', 'l', 'o', 'b'),
+	kAudioObjectPropertyScopeInput    = kSim_FourCC('i', 'n', 'p', 't'),
+	kAudioObjectPropertyScopeOutput   = kSim_FourCC('o', 'u', 't', 'p'),
+	kAudioObjectPropertyElementMaster = 0
+};
+
+enum {
+	kAudioObjectPropertyBaseClass       = kSim_FourCC('b', 'c', 'l', 's'),
+	kAudioObjectPropertyClass           = kSim_FourCC('c', 'l', 'a', 's'),
+	kAudioObjectPropertyOwner           = kSim_FourCC('s', 't', 'd', 'v'),
+	kAudioObjectPropertyName            = kSim_FourCC('l', 'n', 'a', 'm'),
+	kAudioObjectPropertyModelName       = kSim_FourCC('l', 'm', 'o', 'd'),
+	kAudioObjectPropertyManufacturer    = kSim_FourCC('l', 'm', 'a', 'k'),
+	kAudioObjectPropertyOwnedObjects    = kSim_FourCC('o', 'w', 'n', 'd'),
+	kAudioObjectPropertyIdentify        = kSim_FourCC('i', 'd', 'e', 'n'),
+	kAudioObjectPropertySerialNumber    = kSim_FourCC('s', 'n', 'u', 'm'),
+	kAudioObjectPropertyFirmwareVersion = kSim_FourCC('f', 'w', 'v', 'n'),
+	kAudioObjectPropertyControlList     = kSim_FourCC('c', 't', 'r', 'l')
+};
+
+enum {
+	kAudioPlugInPropertyBoxList              = kSim_FourCC('b', 'o', 'x', '#'),
+	kAudioPlugInPropertyTranslateUIDToBox    = kSim_FourCC('u', 'i', 'd', 'b'),
+	kAudioPlugInPropertyDeviceList           = kSim_FourCC('d', 'e', 'v', '#'),
+	kAudioPlugInPropertyTranslateUIDToDevice = kSim_FourCC('u', 'i', 'd', 'd'),
+	kAudioPlugInPropertyResourceBundle       = kSim_FourCC('r', 's', 'r', 'c')
+};
+
+enum {
+	kAudioBoxPropertyBoxUID            = kSim_FourCC('b', 'u', 'i', 'd'),
+	kAudioBoxPropertyTransportType     = kSim_FourCC('t', 'r', 'a', 'n'),
+	kAudioBoxPropertyHasAudio          = kSim_FourCC('b', 'h', 'a', 'u'),
+	kAudioBoxPropertyHasVideo          = kSim_FourCC('b', 'h', 'v', 'i'),
+	kAudioBoxPropertyHasMIDI           = kSim_FourCC('b', 'h', 'm', 'i'),
+	kAudioBoxPropertyIsProtected       = kSim_FourCC('b', 'p', 'r', 'o'),
+	kAudioBoxPropertyAcquired          = kSim_FourCC('b', 'x', 'o', 'n'),
+	kAudioBoxPropertyAcquisitionFailed = kSim_FourCC('b', 'x', 'o', 'f'),
+	kAudioBoxPropertyDeviceList        = kSim_FourCC('b', 'd', 'v', '#')
+};
+
+enum {
+	kAudioDevicePropertyDeviceUID                      = kSim_FourCC('u', 'i', 'd', ' '),
+	kAudioDevicePropertyModelUID                       = kSim_FourCC('m', 'u', 'i', 'd'),
+	kAudioDevicePropertyTransportType                  = kSim_FourCC('t', 'r', 'a', 'n'),
+	kAudioDevicePropertyRelatedDevices                 = kSim_FourCC('a', 'k', 'i', 'n'),
+	kAudioDevicePropertyClockDomain                    = kSim_FourCC('c', 'l', 'k', 'd'),
+	kAudioDevicePropertyDeviceIsAlive                  = kSim_FourCC('l', 'i', 'v', 'n'),
+	kAudioDevicePropertyDeviceIsRunning                = kSim_FourCC('g', 'o', 'i', 'n'),
+	kAudioDevicePropertyDeviceCanBeDefaultDevice       = kSim_FourCC('d', 'f', 'l', 't'),
+	kAudioDevicePropertyDeviceCanBeDefaultSystemDevice = kSim_FourCC('s', 'f', 'l', 't'),
+	kAudioDevicePropertyLatency                        = kSim_FourCC('l', 't', 'n', 'c'),
+	kAudioDevicePropertyStreams                        = kSim_FourCC('s', 't', 'm', '#'),
+	kAudioDevicePropertySafetyOffset                   = kSim_FourCC('s', 'a', 'f', 't'),
+	kAudioDevicePropertyNominalSampleRate              = kSim_FourCC('n', 's', 'r', 't'),
+	kAudioDevicePropertyAvailableNominalSampleRates    = kSim_FourCC('n', 's', 'r', '#'),
+	kAudioDevicePropertyIcon                           = kSim_FourCC('i', 'c', 'o', 'n'),
+	kAudioDevicePropertyIsHidden                       = kSim_FourCC('h', 'i', 'd', 'n'),
+	kAudioDevicePropertyPreferredChannelsForStereo     = kSim_FourCC('d', 'c', 'h', '2'),
+	kAudioDevicePropertyPreferredChannelLayout         = kSim_FourCC('s', 'r', 'n', 'd'),
+	kAudioDevicePropertyZeroTimeStampPeriod            = kSim_FourCC('r', 'i', 'n', 'g'),
+	kAudioDeviceTransportTypeVirtual                   = kSim_FourCC('v', 'i', 'r', 't')
+};
+
+enum {
+	kAudioStreamPropertyIsActive                 = kSim_FourCC('s', 'a', 'c', 't'),
+	kAudioStreamPropertyDirection                = kSim_FourCC('s', 'd', 'i', 'r'),
+	kAudioStreamPropertyTerminalType             = kSim_FourCC('t', 'e', 'r', 'm'),
+	kAudioStreamPropertyStartingChannel          = kSim_FourCC('s', 'c', 'h', 'n'),
+	kAudioStreamPropertyLatency                  = kSim_FourCC('l', 't', 'n', 'c'),
+	kAudioStreamPropertyVirtualFormat            = kSim_FourCC('s', 'f', 'm', 't'),
+	kAudioStreamPropertyAvailableVirtualFormats  = kSim_FourCC('s', 'f', 'm', 'a'),
+	kAudioStreamPropertyPhysicalFormat           = kSim_FourCC('p', 'f', 't', ' '),
+	kAudioStreamPropertyAvailablePhysicalFormats = kSim_FourCC('p', 'f', 't', 'a'),
+	kAudioStreamTerminalTypeMicrophone           = kSim_FourCC('m', 'i', 'c', 'r'),
+	kAudioStreamTerminalTypeSpeaker              = kSim_FourCC('s', 'p', 'k', 'r')
+};
+
+enum {
+	kAudioControlPropertyScope                        = kSim_FourCC('c', 's', 'c', 'p'),
+	kAudioControlPropertyElement                      = kSim_FourCC('c', 'e', 'l', 'm'),
+	kAudioLevelControlPropertyScalarValue             = kSim_FourCC('l', 'c', 's', 'v'),
+	kAudioLevelControlPropertyDecibelValue            = kSim_FourCC('l', 'c', 'd', 'v'),
+	kAudioLevelControlPropertyDecibelRange            = kSim_FourCC('l', 'c', 'd', 'r'),
+	kAudioLevelControlPropertyConvertScalarToDecibels = kSim_FourCC('l', 'c', 's', 'd'),
+	kAudioLevelControlPropertyConvertDecibelsToScalar = kSim_FourCC('l', 'c', 'd', 's'),
+	kAudioBooleanControlPropertyValue                 = kSim_FourCC('b', 'c', 'v', 'l'),
+	kAudioSelectorControlPropertyCurrentItem          = kSim_FourCC('s', 'c', 'c', 'i'),
+	kAudioSelectorControlPropertyAvailableItems       = kSim_FourCC('s', 'c', 'a', 'i'),
+	kAudioSelectorControlPropertyItemName             = kSim_FourCC('s', 'c', 'i', 'n')
+};
+
+enum {
+	kAudioFormatLinearPCM       = kSim_FourCC('l', 'p', 'c', 'm'),
+	kAudioFormatFlagIsFloat     = 1u << 0,
+	kAudioFormatFlagIsBigEndian = 1u << 1,
+	kAudioFormatFlagIsSignedInteger = 1u << 2,
+	kAudioFormatFlagIsPacked    = 1u << 3,
+	kAudioFormatFlagsNativeEndian = 0
+};
+
+enum {
+	kAudioChannelLabel_Left                     = 1,
+	kAudioChannelLabel_Right                    = 2,
+	kAudioChannelLayoutTag_UseChannelDescriptions = 0
+};
+
+enum {
+	kAudioServerPlugInIOOperationThread        = kSim_FourCC('t', 'h', 'r', 'd'),
+	kAudioServerPlugInIOOperationCycle         = kSim_FourCC('c', 'y', 'c', 'l'),
+	kAudioServerPlugInIOOperationReadInput     = kSim_FourCC('r', 'e', 'a', 'd'),
+	kAudioServerPlugInIOOperationConvertInput  = kSim_FourCC('c', 'i', 'n', 'p'),
+	kAudioServerPlugInIOOperationProcessInput  = kSim_FourCC('p', 'i', 'n', 'p'),
+	kAudioServerPlugInIOOperationProcessOutput = kSim_FourCC('p', 'o', 'u', 't'),
+	kAudioServerPlugInIOOperationMixOutput     = kSim_FourCC('m', 'i', 'x', 'o'),
+	kAudioServerPlugInIOOperationProcessMix    = kSim_FourCC('p', 'm', 'i', 'x'),
+	kAudioServerPlugInIOOperationConvertMix    = kSim_FourCC('c', 'm', 'i', 'x'),
+	kAudioServerPlugInIOOperationWriteMix      = kSim_FourCC('r', 'i', 't', 'e')
+};
+
+#endif
@@ -0,0 +1,114 @@
+#ifndef CAPTAIN_JACK_SIM_COREFOUNDATION_H__
+#define CAPTAIN_JACK_SIM_COREFOUNDATION_H__
+/*
+	,---.         .              ,-_/
+	|  -' ,-. ,-. |- ,-. . ,-.   '  | ,-. ,-. . ,
+	|   . ,-| | | |  ,-| | | |      | ,-| |   |/
+	`---' `-^ |-' `' `-^ ' ' '      | `-^ `-' |\
+	          |                  /  |         ' `
+	          '                  `--'
+	          captain jack audio device
+	         github.com/qix-/captainjack
+
+	        copyright (c) 2016 josh junon
+	        released under the MIT license
+*/
+
+/*
+	just enough CoreFoundation for the device to build and
+	run under the host simulator. objects are never freed;
+	CFRetain() and CFRelease() don't count anything.
+
+	CFSTR() interns its literal at runtime, so it can't be
+	used in a static initializer like the real one can.
+*/
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+typedef uint8_t   UInt8;
+typedef uint16_t  UInt16;
+typedef uint32_t  UInt32;
+typedef uint64_t  UInt64;
+typedef int8_t    SInt8;
+typedef int16_t   SInt16;
+typedef int32_t   SInt32;
+typedef int64_t   SInt64;
+typedef float     Float32;
+typedef double    Float64;
+typedef uint8_t   Boolean;
+typedef SInt32    OSStatus;
+typedef long      CFIndex;
+typedef unsigned long CFTypeID;
+typedef UInt32    CFOptionFlags;
+
+typedef const void              *CFTypeRef;
+typedef const void              *CFPropertyListRef;
+typedef const struct __CFString *CFStringRef;
+typedef const struct __CFUUID   *CFUUIDRef;
+typedef const struct __CFNumber *CFNumberRef;
+typedef const struct __CFNumber *CFBooleanRef;
+typedef const struct __CFURL    *CFURLRef;
+typedef const struct __CFDict   *CFDictionaryRef;
+typedef const struct __CFAlloc  *CFAllocatorRef;
+typedef struct __CFBundle       *CFBundleRef;
+
+typedef struct {
+	UInt8 byte0, byte1, byte2, byte3, byte4, byte5, byte6, byte7;
+	UInt8 byte8, byte9, byte10, byte11, byte12, byte13, byte14, byte15;
+} CFUUIDBytes;
+
+typedef enum {
+	kCFCompareLessThan = -1,
+	kCFCompareEqualTo = 0,
+	kCFCompareGreaterThan = 1
+} CFComparisonResult;
+
+typedef enum {
+	kCFNumberSInt32Type = 3,
+	kCFNumberFloat64Type = 6
+} CFNumberType;
+
+extern const CFBooleanRef kCFBooleanTrue;
+extern const CFBooleanRef kCFBooleanFalse;
+
+#define CFSTR(literal) CFSim_ConstantString("" literal "")
+
+CFStringRef        CFSim_ConstantString(const char *literal);
+const char *       CFSim_StringChars(CFStringRef string);
+
+CFTypeRef          CFRetain(CFTypeRef object);
+void               CFRelease(CFTypeRef object);
+Boolean            CFEqual(CFTypeRef left, CFTypeRef right);
+CFTypeID           CFGetTypeID(CFTypeRef object);
+
+CFTypeID           CFStringGetTypeID(void);
+CFComparisonResult CFStringCompare(CFStringRef left, CFStringRef right, CFOptionFlags options);
+
+CFTypeID           CFNumberGetTypeID(void);
+Boolean            CFNumberGetValue(CFNumberRef number, CFNumberType type, void *value);
+
+CFTypeID           CFBooleanGetTypeID(void);
+Boolean            CFBooleanGetValue(CFBooleanRef boolean);
+
+CFUUIDRef          CFUUIDGetConstantUUIDWithBytes(CFAllocatorRef allocator, UInt8 byte0, UInt8 byte1, UInt8 byte2, UInt8 byte3, UInt8 byte4, UInt8 byte5, UInt8 byte6, UInt8 byte7, UInt8 byte8, UInt8 byte9, UInt8 byte10, UInt8 byte11, UInt8 byte12, UInt8 byte13, UInt8 byte14, UInt8 byte15);
+CFUUIDRef          CFUUIDCreateFromUUIDBytes(CFAllocatorRef allocator, CFUUIDBytes bytes);
+CFUUIDBytes        CFUUIDGetUUIDBytes(CFUUIDRef uuid);
+
+CFBundleRef        CFBundleGetBundleWithIdentifier(CFStringRef identifier);
+CFURLRef           CFBundleCopyResourceURL(CFBundleRef bundle, CFStringRef name, CFStringRef type, CFStringRef directory);
+
+/*
+	the COM bits of CFPlugInCOM.h
+*/
+typedef SInt32       HRESULT;
+typedef UInt32       ULONG;
+typedef void        *LPVOID;
+typedef CFUUIDBytes  REFIID;
+
+#define E_NOINTERFACE ((HRESULT) 0x80000004)
+#define IUnknownUUID  CFUUIDGetConstantUUIDWithBytes(NULL, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xC0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x46)
+
+#endif
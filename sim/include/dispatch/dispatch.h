@@ -0,0 +1,38 @@
+#ifndef CAPTAIN_JACK_SIM_DISPATCH_H__
+#define CAPTAIN_JACK_SIM_DISPATCH_H__
+/*
+	,---.         .              ,-_/
+	|  -' ,-. ,-. |- ,-. . ,-.   '  | ,-. ,-. . ,
+	|   . ,-| | | |  ,-| | | |      | ,-| |   |/
+	`---' `-^ |-' `' `-^ ' ' '      | `-^ `-' |\
+	          |                  /  |         ' `
+	          '                  `--'
+	          captain jack audio device
+	         github.com/qix-/captainjack
+
+	        copyright (c) 2016 josh junon
+	        released under the MIT license
+*/
+
+/*
+	the function (not block) flavour of libdispatch's global
+	queues. every piece of work gets its own detached thread,
+	which is plenty for the handful the device dispatches.
+*/
+
+#include <stdint.h>
+
+typedef struct __dispatch_queue *dispatch_queue_t;
+typedef uint64_t                 dispatch_time_t;
+typedef void                   (*dispatch_function_t)(void *);
+
+#define DISPATCH_TIME_NOW                0ull
+#define NSEC_PER_MSEC                    1000000ull
+#define DISPATCH_QUEUE_PRIORITY_DEFAULT  0
+
+dispatch_queue_t dispatch_get_global_queue(long priority, unsigned long flags);
+dispatch_time_t  dispatch_time(dispatch_time_t when, int64_t delta);
+void             dispatch_async_f(dispatch_queue_t queue, void *context, dispatch_function_t work);
+void             dispatch_after_f(dispatch_time_t when, dispatch_queue_t queue, void *context, dispatch_function_t work);
+
+#endif
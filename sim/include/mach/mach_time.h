@@ -0,0 +1,44 @@
+#ifndef CAPTAIN_JACK_SIM_MACH_TIME_H__
+#define CAPTAIN_JACK_SIM_MACH_TIME_H__
+/*
+	,---.         .              ,-_/
+	|  -' ,-. ,-. |- ,-. . ,-.   '  | ,-. ,-. . ,
+	|   . ,-| | | |  ,-| | | |      | ,-| |   |/
+	`---' `-^ |-' `' `-^ ' ' '      | `-^ `-' |\
+	          |                  /  |         ' `
+	          '                  `--'
+	          captain jack audio device
+	         github.com/qix-/captainjack
+
+	        copyright (c) 2016 josh junon
+	        released under the MIT license
+*/
+
+/*
+	host time for the simulator is CLOCK_MONOTONIC in
+	nanoseconds, which is also what clock.h uses off OS/X.
+*/
+
+#include <stdint.h>
+#include <time.h>
+
+struct mach_timebase_info {
+	uint32_t numer;
+	uint32_t denom;
+};
+
+typedef struct mach_timebase_info *mach_timebase_info_t;
+
+static inline int mach_timebase_info(mach_timebase_info_t info) {
+	info->numer = 1;
+	info->denom = 1;
+	return 0;
+}
+
+static inline uint64_t mach_absolute_time(void) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t) now.tv_sec * 1000000000ull + (uint64_t) now.tv_nsec;
+}
+
+#endif
@@ -0,0 +1,251 @@
+/*
+	,---.         .              ,-_/
+	|  -' ,-. ,-. |- ,-. . ,-.   '  | ,-. ,-. . ,
+	|   . ,-| | | |  ,-| | | |      | ,-| |   |/
+	`---' `-^ |-' `' `-^ ' ' '      | `-^ `-' |\
+	          |                  /  |         ' `
+	          '                  `--'
+	          captain jack audio device
+	         github.com/qix-/captainjack
+
+	        copyright (c) 2016 josh junon
+	        released under the MIT license
+*/
+
+/*
+	the runtime behind the simulator's CoreFoundation and
+	libdispatch stand-ins.
+*/
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <CoreFoundation/CoreFoundation.h>
+#include <dispatch/dispatch.h>
+
+#define kSim_Interned  256
+
+enum {
+	kSim_StringType = 1,
+	kSim_UUIDType,
+	kSim_NumberType,
+	kSim_BooleanType
+};
+
+struct __CFString {
+	CFTypeID    type;
+	const char *chars;
+};
+
+struct __CFUUID {
+	CFTypeID    type;
+	CFUUIDBytes bytes;
+};
+
+struct __CFNumber {
+	CFTypeID    type;
+	SInt64      value;
+};
+
+typedef struct {
+	CFTypeID type;
+} Object;
+
+static const struct __CFNumber gTrue                 = { kSim_BooleanType, 1 };
+static const struct __CFNumber gFalse                = { kSim_BooleanType, 0 };
+const CFBooleanRef             kCFBooleanTrue        = &gTrue;
+const CFBooleanRef             kCFBooleanFalse       = &gFalse;
+
+static pthread_mutex_t         gInternMutex          = PTHREAD_MUTEX_INITIALIZER;
+static struct __CFString       gStrings[kSim_Interned];
+static unsigned int            gStringCount          = 0;
+static struct __CFUUID         gUUIDs[kSim_Interned];
+static unsigned int            gUUIDCount            = 0;
+
+CFStringRef CFSim_ConstantString(const char *literal) {
+	pthread_mutex_lock(&gInternMutex);
+
+	// literals are compared by address; the same text from two places is two strings, like in CF
+	struct __CFString *string = NULL;
+	for (unsigned int i = 0; i < gStringCount; i++) {
+		if (gStrings[i].chars == literal) {
+			string = &gStrings[i];
+			break;
+		}
+	}
+
+	if (string == NULL && gStringCount < kSim_Interned) {
+		string = &gStrings[gStringCount++];
+		string->type = kSim_StringType;
+		string->chars = literal;
+	}
+
+	pthread_mutex_unlock(&gInternMutex);
+	return string;
+}
+
+const char * CFSim_StringChars(CFStringRef string) {
+	return string != NULL ? string->chars : NULL;
+}
+
+CFTypeRef CFRetain(CFTypeRef object) {
+	return object;
+}
+
+void CFRelease(CFTypeRef object) {
+}
+
+CFTypeID CFGetTypeID(CFTypeRef object) {
+	return ((const Object *) object)->type;
+}
+
+Boolean CFEqual(CFTypeRef left, CFTypeRef right) {
+	if (left == right) {
+		return true;
+	}
+
+	if (left == NULL || right == NULL || CFGetTypeID(left) != CFGetTypeID(right)) {
+		return false;
+	}
+
+	switch (CFGetTypeID(left)) {
+	case kSim_StringType:
+		return strcmp(((CFStringRef) left)->chars, ((CFStringRef) right)->chars) == 0;
+	case kSim_UUIDType:
+		return memcmp(&((CFUUIDRef) left)->bytes, &((CFUUIDRef) right)->bytes, sizeof(CFUUIDBytes)) == 0;
+	default:
+		return ((CFNumberRef) left)->value == ((CFNumberRef) right)->value;
+	}
+}
+
+CFTypeID CFStringGetTypeID(void) {
+	return kSim_StringType;
+}
+
+CFComparisonResult CFStringCompare(CFStringRef left, CFStringRef right, CFOptionFlags options) {
+	int result = strcmp(left->chars, right->chars);
+	return result < 0 ? kCFCompareLessThan : result > 0 ? kCFCompareGreaterThan : kCFCompareEqualTo;
+}
+
+CFTypeID CFNumberGetTypeID(void) {
+	return kSim_NumberType;
+}
+
+Boolean CFNumberGetValue(CFNumberRef number, CFNumberType type, void *value) {
+	if (type == kCFNumberFloat64Type) {
+		*(Float64 *) value = (Float64) number->value;
+	} else {
+		*(SInt32 *) value = (SInt32) number->value;
+	}
+	return true;
+}
+
+CFTypeID CFBooleanGetTypeID(void) {
+	return kSim_BooleanType;
+}
+
+Boolean CFBooleanGetValue(CFBooleanRef boolean) {
+	return boolean->value != 0;
+}
+
+CFUUIDRef CFUUIDGetConstantUUIDWithBytes(CFAllocatorRef allocator, UInt8 byte0, UInt8 byte1, UInt8 byte2, UInt8 byte3, UInt8 byte4, UInt8 byte5, UInt8 byte6, UInt8 byte7, UInt8 byte8, UInt8 byte9, UInt8 byte10, UInt8 byte11, UInt8 byte12, UInt8 byte13, UInt8 byte14, UInt8 byte15) {
+	CFUUIDBytes bytes = { byte0, byte1, byte2, byte3, byte4, byte5, byte6, byte7, byte8, byte9, byte10, byte11, byte12, byte13, byte14, byte15 };
+
+	pthread_mutex_lock(&gInternMutex);
+
+	struct __CFUUID *uuid = NULL;
+	for (unsigned int i = 0; i < gUUIDCount; i++) {
+		if (memcmp(&gUUIDs[i].bytes, &bytes, sizeof(bytes)) == 0) {
+			uuid = &gUUIDs[i];
+			break;
+		}
+	}
+
+	if (uuid == NULL && gUUIDCount < kSim_Interned) {
+		uuid = &gUUIDs[gUUIDCount++];
+		uuid->type = kSim_UUIDType;
+		uuid->bytes = bytes;
+	}
+
+	pthread_mutex_unlock(&gInternMutex);
+	return uuid;
+}
+
+CFUUIDRef CFUUIDCreateFromUUIDBytes(CFAllocatorRef allocator, CFUUIDBytes bytes) {
+	return CFUUIDGetConstantUUIDWithBytes(allocator,
+		bytes.byte0, bytes.byte1, bytes.byte2, bytes.byte3, bytes.byte4, bytes.byte5, bytes.byte6, bytes.byte7,
+		bytes.byte8, bytes.byte9, bytes.byte10, bytes.byte11, bytes.byte12, bytes.byte13, bytes.byte14, bytes.byte15);
+}
+
+CFUUIDBytes CFUUIDGetUUIDBytes(CFUUIDRef uuid) {
+	return uuid->bytes;
+}
+
+CFBundleRef CFBundleGetBundleWithIdentifier(CFStringRef identifier) {
+	return NULL;
+}
+
+CFURLRef CFBundleCopyResourceURL(CFBundleRef bundle, CFStringRef name, CFStringRef type, CFStringRef directory) {
+	return NULL;
+}
+
+typedef struct {
+	dispatch_time_t     when;
+	void               *context;
+	dispatch_function_t work;
+} Work;
+
+static void * RunWork(void *arg) {
+	Work work = *(Work *) arg;
+	free(arg);
+
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	uint64_t current = (uint64_t) now.tv_sec * 1000000000ull + (uint64_t) now.tv_nsec;
+
+	if (work.when > current) {
+		uint64_t delay = work.when - current;
+		struct timespec wait = { (time_t) (delay / 1000000000ull), (long) (delay % 1000000000ull) };
+		nanosleep(&wait, NULL);
+	}
+
+	work.work(work.context);
+	return NULL;
+}
+
+dispatch_queue_t dispatch_get_global_queue(long priority, unsigned long flags) {
+	return NULL;
+}
+
+dispatch_time_t dispatch_time(dispatch_time_t when, int64_t delta) {
+	if (when == DISPATCH_TIME_NOW) {
+		struct timespec now;
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		when = (uint64_t) now.tv_sec * 1000000000ull + (uint64_t) now.tv_nsec;
+	}
+
+	return when + (uint64_t) delta;
+}
+
+void dispatch_after_f(dispatch_time_t when, dispatch_queue_t queue, void *context, dispatch_function_t work) {
+	Work *item = malloc(sizeof(*item));
+	if (item == NULL) {
+		abort();
+	}
+
+	item->when = when;
+	item->context = context;
+	item->work = work;
+
+	pthread_t thread;
+	if (pthread_create(&thread, NULL, &RunWork, item) != 0) {
+		abort();
+	}
+	pthread_detach(thread);
+}
+
+void dispatch_async_f(dispatch_queue_t queue, void *context, dispatch_function_t work) {
+	dispatch_after_f(0, queue, context, work);
+}
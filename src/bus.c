@@ -0,0 +1,452 @@
+/*
+	,---.         .              ,-_/
+	|  -' ,-. ,-. |- ,-. . ,-.   '  | ,-. ,-. . ,
+	|   . ,-| | | |  ,-| | | |      | ,-| |   |/
+	`---' `-^ |-' `' `-^ ' ' '      | `-^ `-' |\
+	          |                  /  |         ' `
+	          '                  `--'
+	          captain jack audio device
+	         github.com/qix-/captainjack
+
+	        copyright (c) 2016 josh junon
+	        released under the MIT license
+*/
+
+
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/syslog.h>
+
+#include "bus.h"
+#include "dsp.h"
+
+#define kBus_Spins      2000
+#define kBus_DequeSize  256
+#define kBus_CacheLine  64
+
+#if kBus_DequeSize < kBus_MaxTasks || (kBus_DequeSize & (kBus_DequeSize - 1)) != 0
+#	error "a deque has to fit every task, and be a power of two"
+#endif
+
+/*
+	a Chase-Lev deque of task numbers: the owner pushes and
+	pops at the bottom, thieves take from the top. a task is
+	pushed at most once a period, so it never wraps around
+	onto anything still in it.
+*/
+typedef struct {
+	int64_t  top;
+	char     pad0[kBus_CacheLine - sizeof(int64_t)];
+	int64_t  bottom;
+	char     pad1[kBus_CacheLine - sizeof(int64_t)];
+	uint16_t tasks[kBus_DequeSize];
+} Deque;
+
+typedef struct {
+	CaptainJack_BusPool *pool;
+	unsigned int         index;
+	pthread_t            thread;
+} Worker;
+
+struct CaptainJack_BusPool {
+	Deque                          deques[kBus_MaxThreads];
+	Worker                         workers[kBus_MaxThreads];
+	unsigned int                   threads;
+	unsigned int                   started;
+
+	// the period being run; all set before anything is pushed
+	const CaptainJack_BusSchedule *schedule;
+	float *const                  *buffers;
+	size_t                         frames;
+	uint32_t                       pending[kBus_MaxTasks];
+	uint32_t                       remaining;
+	uint64_t                       generation;
+
+	pthread_mutex_t                lock;
+	pthread_cond_t                 wake;
+	uint32_t                       sleepers;
+	bool                           stopping;
+};
+
+bool CaptainJack_ScheduleBuses(CaptainJack_BusSchedule *schedule, const bool *isBus, unsigned int nodes, const CaptainJack_BusSend *sends, size_t count) {
+	// where each node ends up in the schedule, and how many buses still feed it
+	static uint16_t position[kBus_MaxNodes];
+	static uint16_t waiting[kBus_MaxNodes];
+	static uint16_t ready[kBus_MaxBuses];
+
+	if (nodes > kBus_MaxNodes || count > kBus_MaxSends) {
+		syslog(LOG_ERR, "CaptainJack_ScheduleBuses: %u nodes and %zu sends is more than %d and %d", nodes, count, kBus_MaxNodes, kBus_MaxSends);
+		return false;
+	}
+
+	memset(waiting, 0, nodes * sizeof(waiting[0]));
+	unsigned int buses = 0;
+
+	for (unsigned int node = 0; node < nodes; node++) {
+		buses += isBus[node];
+	}
+
+	if (buses > kBus_MaxBuses) {
+		syslog(LOG_ERR, "CaptainJack_ScheduleBuses: %u buses is more than %d", buses, kBus_MaxBuses);
+		return false;
+	}
+
+	for (size_t i = 0; i < count; i++) {
+		if (sends[i].from >= nodes || sends[i].to >= nodes || !isBus[sends[i].to]) {
+			syslog(LOG_ERR, "CaptainJack_ScheduleBuses: send %zu goes from %u to %u, which isn't a bus", i, sends[i].from, sends[i].to);
+			return false;
+		}
+
+		waiting[sends[i].to] += isBus[sends[i].from];
+	}
+
+	// Kahn's: a bus is ready once every bus feeding it has been scheduled
+	unsigned int readyCount = 0;
+	for (unsigned int node = 0; node < nodes; node++) {
+		if (isBus[node] && waiting[node] == 0) {
+			ready[readyCount++] = (uint16_t) node;
+		}
+	}
+
+	schedule->busCount = 0;
+	while (readyCount > 0) {
+		uint16_t bus = ready[--readyCount];
+		position[bus] = (uint16_t) schedule->busCount;
+		schedule->buses[schedule->busCount++] = bus;
+
+		for (size_t i = 0; i < count; i++) {
+			if (sends[i].from == bus && --waiting[sends[i].to] == 0) {
+				ready[readyCount++] = sends[i].to;
+			}
+		}
+	}
+
+	if (schedule->busCount != buses) {
+		syslog(LOG_ERR, "CaptainJack_ScheduleBuses: %u buses send into each other in a loop", buses - schedule->busCount);
+		return false;
+	}
+
+	// counting sort of the sends by where their bus landed, keeping their order otherwise
+	uint16_t ends[kBus_MaxBuses] = { 0 };
+	for (size_t i = 0; i < count; i++) {
+		ends[position[sends[i].to]] += sends[i].gain != 0.0f;
+	}
+
+	unsigned int total = 0;
+	for (unsigned int i = 0; i < schedule->busCount; i++) {
+		total += ends[i];
+		schedule->sendsEnd[i] = (uint16_t) total;
+		ends[i] = (uint16_t) (total - ends[i]);
+	}
+
+	for (size_t i = 0; i < count; i++) {
+		if (sends[i].gain != 0.0f) {
+			schedule->sends[ends[position[sends[i].to]]++] = sends[i];
+		}
+	}
+
+	schedule->sendCount = total;
+
+	// and the same again for the pool, grouped by the bus doing the feeding
+	uint16_t feeds[kBus_MaxBuses] = { 0 };
+	memset(schedule->waits, 0, sizeof(schedule->waits));
+	for (unsigned int i = 0; i < total; i++) {
+		const CaptainJack_BusSend *send = &schedule->sends[i];
+		if (isBus[send->from]) {
+			schedule->waits[position[send->to]]++;
+			feeds[position[send->from]]++;
+		}
+	}
+
+	unsigned int fed = 0;
+	for (unsigned int i = 0; i < schedule->busCount; i++) {
+		fed += feeds[i];
+		schedule->feedsEnd[i] = (uint16_t) fed;
+		feeds[i] = (uint16_t) (fed - feeds[i]);
+	}
+
+	for (unsigned int i = 0; i < total; i++) {
+		const CaptainJack_BusSend *send = &schedule->sends[i];
+		if (isBus[send->from]) {
+			schedule->feeds[feeds[position[send->from]]++] = position[send->to];
+		}
+	}
+
+	return true;
+}
+
+static void MixChannel(const CaptainJack_BusSchedule *schedule, float *const *buffers, size_t frames, unsigned int index, int channel) {
+	float *out = buffers[schedule->buses[index] * kBus_Channels + channel];
+	if (out == NULL) {
+		return;
+	}
+
+	memset(out, 0, frames * sizeof(float));
+
+	for (unsigned int send = index > 0 ? schedule->sendsEnd[index - 1] : 0; send < schedule->sendsEnd[index]; send++) {
+		const CaptainJack_BusSend *step = &schedule->sends[send];
+		const float *in = buffers[step->from * kBus_Channels + channel];
+
+		if (in != NULL) {
+			CaptainJack_MixInto(out, in, frames, step->gain);
+		}
+	}
+}
+
+void CaptainJack_RunBuses(const CaptainJack_BusSchedule *schedule, float *const *buffers, size_t frames) {
+	for (unsigned int i = 0; i < schedule->busCount; i++) {
+		for (int channel = 0; channel < kBus_Channels; channel++) {
+			MixChannel(schedule, buffers, frames, i, channel);
+		}
+	}
+}
+
+static void Push(Deque *deque, unsigned int task) {
+	int64_t bottom = __atomic_load_n(&deque->bottom, __ATOMIC_RELAXED);
+	__atomic_store_n(&deque->tasks[bottom & (kBus_DequeSize - 1)], (uint16_t) task, __ATOMIC_RELAXED);
+	__atomic_store_n(&deque->bottom, bottom + 1, __ATOMIC_RELEASE);
+}
+
+static int Pop(Deque *deque) {
+	int64_t bottom = __atomic_load_n(&deque->bottom, __ATOMIC_RELAXED) - 1;
+	__atomic_store_n(&deque->bottom, bottom, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	int64_t top = __atomic_load_n(&deque->top, __ATOMIC_RELAXED);
+
+	if (top > bottom) {
+		__atomic_store_n(&deque->bottom, bottom + 1, __ATOMIC_RELAXED);
+		return -1;
+	}
+
+	int task = __atomic_load_n(&deque->tasks[bottom & (kBus_DequeSize - 1)], __ATOMIC_RELAXED);
+	if (top == bottom) {
+		// the last one; a thief might be after it too
+		if (!__atomic_compare_exchange_n(&deque->top, &top, top + 1, false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) {
+			task = -1;
+		}
+		__atomic_store_n(&deque->bottom, bottom + 1, __ATOMIC_RELAXED);
+	}
+
+	return task;
+}
+
+static int Steal(Deque *deque) {
+	int64_t top = __atomic_load_n(&deque->top, __ATOMIC_ACQUIRE);
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	int64_t bottom = __atomic_load_n(&deque->bottom, __ATOMIC_ACQUIRE);
+
+	if (top >= bottom) {
+		return -1;
+	}
+
+	int task = __atomic_load_n(&deque->tasks[top & (kBus_DequeSize - 1)], __ATOMIC_RELAXED);
+	if (!__atomic_compare_exchange_n(&deque->top, &top, top + 1, false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) {
+		return -1;
+	}
+
+	return task;
+}
+
+static void Relax(unsigned int *spins) {
+	if (++*spins < kBus_Spins) {
+#if defined(__x86_64__) || defined(__i386__)
+		__builtin_ia32_pause();
+#endif
+	} else {
+		sched_yield();
+	}
+}
+
+static void RunTask(CaptainJack_BusPool *pool, unsigned int self, unsigned int task) {
+	const CaptainJack_BusSchedule *schedule = pool->schedule;
+	unsigned int index = task / kBus_Channels;
+	int channel = (int) (task % kBus_Channels);
+
+	MixChannel(schedule, pool->buffers, pool->frames, index, channel);
+
+	// whoever finishes the last input to a bus gets to mix it
+	for (unsigned int i = index > 0 ? schedule->feedsEnd[index - 1] : 0; i < schedule->feedsEnd[index]; i++) {
+		unsigned int next = schedule->feeds[i] * kBus_Channels + (unsigned int) channel;
+		if (__atomic_sub_fetch(&pool->pending[next], 1, __ATOMIC_ACQ_REL) == 0) {
+			Push(&pool->deques[self], next);
+		}
+	}
+
+	__atomic_sub_fetch(&pool->remaining, 1, __ATOMIC_RELEASE);
+}
+
+/*
+	runs tasks until there are none left in the period. a worker
+	that wakes up late might find the next period's tasks instead,
+	which is fine: it only ever sees a task after everything about
+	the period it belongs to has been set.
+*/
+static void Work(CaptainJack_BusPool *pool, unsigned int self) {
+	unsigned int spins = 0;
+
+	while (__atomic_load_n(&pool->remaining, __ATOMIC_ACQUIRE) > 0) {
+		int task = Pop(&pool->deques[self]);
+		for (unsigned int i = 1; task < 0 && i < pool->threads; i++) {
+			task = Steal(&pool->deques[(self + i) % pool->threads]);
+		}
+
+		if (task < 0) {
+			Relax(&spins);
+			continue;
+		}
+
+		spins = 0;
+		RunTask(pool, self, (unsigned int) task);
+	}
+}
+
+static void * WorkerMain(void *arg) {
+	Worker *worker = arg;
+	CaptainJack_BusPool *pool = worker->pool;
+	uint64_t seen = 0;
+
+	for (;;) {
+		// periods tend to come in quick succession when they're small, so spin a little first
+		uint64_t generation = __atomic_load_n(&pool->generation, __ATOMIC_ACQUIRE);
+		for (unsigned int spins = 0; generation == seen && spins < kBus_Spins; spins++) {
+#if defined(__x86_64__) || defined(__i386__)
+			__builtin_ia32_pause();
+#endif
+			generation = __atomic_load_n(&pool->generation, __ATOMIC_ACQUIRE);
+		}
+
+		if (generation == seen) {
+			pthread_mutex_lock(&pool->lock);
+			__atomic_add_fetch(&pool->sleepers, 1, __ATOMIC_SEQ_CST);
+			while (!pool->stopping && (generation = __atomic_load_n(&pool->generation, __ATOMIC_SEQ_CST)) == seen) {
+				pthread_cond_wait(&pool->wake, &pool->lock);
+			}
+			__atomic_sub_fetch(&pool->sleepers, 1, __ATOMIC_SEQ_CST);
+			bool stopping = pool->stopping;
+			pthread_mutex_unlock(&pool->lock);
+
+			if (stopping) {
+				return NULL;
+			}
+		}
+
+		seen = generation;
+		Work(pool, worker->index);
+	}
+}
+
+static bool StartWorker(Worker *worker, int priority) {
+	pthread_attr_t attributes;
+	pthread_attr_init(&attributes);
+
+	if (priority > 0) {
+		struct sched_param param;
+		memset(&param, 0, sizeof(param));
+		param.sched_priority = priority;
+		pthread_attr_setinheritsched(&attributes, PTHREAD_EXPLICIT_SCHED);
+		pthread_attr_setschedpolicy(&attributes, SCHED_FIFO);
+		pthread_attr_setschedparam(&attributes, &param);
+	}
+
+	int error = pthread_create(&worker->thread, &attributes, &WorkerMain, worker);
+	pthread_attr_destroy(&attributes);
+
+	if (error == EPERM && priority > 0) {
+		syslog(LOG_NOTICE, "CaptainJack_StartBusPool: not allowed real-time priority %d; mixing on the JACK thread alone", priority);
+		return false;
+	}
+
+	if (error != 0) {
+		syslog(LOG_ERR, "CaptainJack_StartBusPool: could not start a worker: %s", strerror(error));
+		return false;
+	}
+
+	return true;
+}
+
+CaptainJack_BusPool * CaptainJack_StartBusPool(unsigned int threads, int priority) {
+	void *memory = NULL;
+	if (posix_memalign(&memory, kBus_CacheLine, sizeof(CaptainJack_BusPool)) != 0) {
+		syslog(LOG_ERR, "CaptainJack_StartBusPool: out of memory");
+		return NULL;
+	}
+
+	CaptainJack_BusPool *pool = memory;
+	memset(pool, 0, sizeof(*pool));
+	pool->threads = threads < 1 ? 1 : threads > kBus_MaxThreads ? kBus_MaxThreads : threads;
+	pthread_mutex_init(&pool->lock, NULL);
+	pthread_cond_init(&pool->wake, NULL);
+
+	for (unsigned int i = 1; i < pool->threads; i++) {
+		Worker *worker = &pool->workers[i];
+		worker->pool = pool;
+		worker->index = i;
+
+		if (!StartWorker(worker, priority)) {
+			CaptainJack_StopBusPool(pool);
+			return NULL;
+		}
+
+		pool->started++;
+	}
+
+	syslog(LOG_NOTICE, "CaptainJack_StartBusPool: mixing on up to %u threads", pool->threads);
+	return pool;
+}
+
+void CaptainJack_StopBusPool(CaptainJack_BusPool *pool) {
+	if (pool == NULL) {
+		return;
+	}
+
+	pthread_mutex_lock(&pool->lock);
+	pool->stopping = true;
+	pthread_cond_broadcast(&pool->wake);
+	pthread_mutex_unlock(&pool->lock);
+
+	for (unsigned int i = 1; i <= pool->started; i++) {
+		pthread_join(pool->workers[i].thread, NULL);
+	}
+
+	pthread_cond_destroy(&pool->wake);
+	pthread_mutex_destroy(&pool->lock);
+	free(pool);
+}
+
+void CaptainJack_RunBusesParallel(CaptainJack_BusPool *pool, const CaptainJack_BusSchedule *schedule, float *const *buffers, size_t frames) {
+	size_t samples = (size_t) schedule->sendCount * frames * kBus_Channels;
+	if (pool == NULL || pool->threads < 2 || schedule->busCount < 2 || samples < kBus_ParallelSamples) {
+		CaptainJack_RunBuses(schedule, buffers, frames);
+		return;
+	}
+
+	pool->schedule = schedule;
+	pool->buffers = buffers;
+	pool->frames = frames;
+
+	unsigned int tasks = schedule->busCount * kBus_Channels;
+	for (unsigned int task = 0; task < tasks; task++) {
+		__atomic_store_n(&pool->pending[task], schedule->waits[task / kBus_Channels], __ATOMIC_RELAXED);
+	}
+	__atomic_store_n(&pool->remaining, tasks, __ATOMIC_RELAXED);
+
+	// backwards, so we pop them in schedule order and thieves take from the far end
+	for (unsigned int task = tasks; task-- > 0;) {
+		if (schedule->waits[task / kBus_Channels] == 0) {
+			Push(&pool->deques[0], task);
+		}
+	}
+
+	__atomic_add_fetch(&pool->generation, 1, __ATOMIC_SEQ_CST);
+	if (__atomic_load_n(&pool->sleepers, __ATOMIC_SEQ_CST) > 0) {
+		pthread_mutex_lock(&pool->lock);
+		pthread_cond_broadcast(&pool->wake);
+		pthread_mutex_unlock(&pool->lock);
+	}
+
+	// doubles as the barrier at the end of the period: it only returns once every task is done
+	Work(pool, 0);
+}
@@ -0,0 +1,137 @@
+#ifndef CAPTAIN_JACK_BUS_H__
+#define CAPTAIN_JACK_BUS_H__
+/*
+	,---.         .              ,-_/
+	|  -' ,-. ,-. |- ,-. . ,-.   '  | ,-. ,-. . ,
+	|   . ,-| | | |  ,-| | | |      | ,-| |   |/
+	`---' `-^ |-' `' `-^ ' ' '      | `-^ `-' |\
+	          |                  /  |         ' `
+	          '                  `--'
+	          captain jack audio device
+	         github.com/qix-/captainjack
+
+	        copyright (c) 2016 josh junon
+	        released under the MIT license
+*/
+
+/*
+	mix buses: a bus sums any number of sources (clients or
+	other buses), each scaled by the gain of its send, into
+	one stereo pair.
+
+	the graph is compiled into a schedule on the control
+	thread: the buses in an order where everything feeding
+	a bus comes before it, each with its sends lined up
+	behind it. the process thread just walks that front to
+	back; running a schedule doesn't allocate, lock or
+	sort anything.
+
+	nodes are numbered by the caller. which ones are buses
+	is up to it too; anything else is only ever read from.
+
+	a big graph can be spread over a pool of worker threads.
+	each channel of each bus is a task; a task is ready once
+	every bus feeding it is done, and whoever finishes the
+	last of those pushes it onto their own work-stealing
+	deque. idle workers steal from the others. the calling
+	thread works too, and returns once every task is done.
+	periods with too little work to pay for waking anyone
+	are just run on the calling thread.
+*/
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define kBus_Channels  2
+#define kBus_MaxNodes  512
+#define kBus_MaxBuses  64
+#define kBus_MaxSends  2048
+#define kBus_MaxTasks  (kBus_MaxBuses * kBus_Channels)
+
+// total, counting the thread that runs the period
+#define kBus_MaxThreads 16
+
+// samples (sends x frames x channels) below which a period stays on one thread
+#define kBus_ParallelSamples 65536
+
+typedef struct {
+	uint16_t from;
+	uint16_t to;
+	float    gain;
+} CaptainJack_BusSend;
+
+typedef struct {
+	/*
+		buses in the order they're mixed
+	*/
+	unsigned int        busCount;
+	uint16_t            buses[kBus_MaxBuses];
+
+	/*
+		the sends into buses[i] are sends[sendsEnd[i - 1]]
+		up to (not including) sends[sendsEnd[i]]
+	*/
+	uint16_t            sendsEnd[kBus_MaxBuses];
+	unsigned int        sendCount;
+	CaptainJack_BusSend sends[kBus_MaxSends];
+
+	/*
+		for the pool: how many sends from other buses each bus
+		waits on, and the positions of the buses that buses[i]
+		feeds, as feeds[feedsEnd[i - 1]] up to feeds[feedsEnd[i]]
+	*/
+	uint16_t            waits[kBus_MaxBuses];
+	uint16_t            feedsEnd[kBus_MaxBuses];
+	uint16_t            feeds[kBus_MaxSends];
+} CaptainJack_BusSchedule;
+
+typedef struct CaptainJack_BusPool CaptainJack_BusPool;
+
+/*
+	compiles a graph into a schedule. `isBus` says which of
+	the `nodes` nodes are buses; every send has to go into
+	one. returns false (and logs why) if the graph is too
+	big, a send goes somewhere that isn't a bus or buses
+	feed back into each other. sends with no gain are left
+	out.
+*/
+bool CaptainJack_ScheduleBuses(CaptainJack_BusSchedule *schedule, const bool *isBus, unsigned int nodes, const CaptainJack_BusSend *sends, size_t count);
+
+/*
+	mixes every bus for one period. `buffers` has
+	kBus_Channels entries per node; a NULL source channel is
+	silent and is skipped, and a bus with NULL buffers isn't
+	mixed at all (and is silent to anything it feeds).
+
+	real-time safe.
+*/
+void CaptainJack_RunBuses(const CaptainJack_BusSchedule *schedule, float *const *buffers, size_t frames);
+
+/*
+	starts a pool that mixes with `threads` threads in total,
+	the caller of CaptainJack_RunBusesParallel() being one of
+	them. the others are made SCHED_FIFO at `priority` if
+	it's above 0. returns NULL (and logs why) if threads
+	couldn't be started, or couldn't be given that priority.
+*/
+CaptainJack_BusPool * CaptainJack_StartBusPool(unsigned int threads, int priority);
+
+/*
+	stops and frees a pool. nothing may be running on it
+*/
+void CaptainJack_StopBusPool(CaptainJack_BusPool *pool);
+
+/*
+	CaptainJack_RunBuses(), spread over a pool. falls back
+	to running on the calling thread if `pool` is NULL or
+	the period is too small.
+
+	the only lock it takes is the one sleeping workers are
+	woken through, which they only hold for a moment, and
+	only when one has gone to sleep. only one thread may
+	run a pool at a time.
+*/
+void CaptainJack_RunBusesParallel(CaptainJack_BusPool *pool, const CaptainJack_BusSchedule *schedule, float *const *buffers, size_t frames);
+
+#endif
@@ -13,36 +13,1118 @@
 */
 
 #include <jack/jack.h>
-#include <libproc.h>
+#include <math.h>
+#include <signal.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
 #include <sys/syslog.h>
 #include <unistd.h>
 
+#include "bus.h"
+#include "clock.h"
+#include "dsp.h"
+#include "log.h"
+#include "meters.h"
+#include "portpool.h"
+#include "proc-names.h"
+#include "routes.h"
+#include "slab.h"
+#include "spsc.h"
+#include "stats.h"
+#include "trace.h"
+#include "transport.h"
+#include "triple.h"
 #include "xmit.h"
 
+#define kClient_Max          kMeters_MaxClients
+#define kTicks_PerSecond     100
+#define kRoutes_DefaultPath  "/opt/captain-jack/routes"
+#define kRoutes_CheckTicks   kTicks_PerSecond
+#define kMeters_DefaultRate  20
+#define kStats_DefaultPort   50964
+#define kTrace_DaemonPath    "/tmp/captain-jack-daemon.json"
+#define kBus_Max             32
+#define kBus_FirstNode       kClient_Max
+#define kBus_DefaultThreads  4
+#define kProcess_Commands    256
+#define kIO_DebounceMillis   100
+#define kPorts_DefaultSpares 4
+#define kTransport_Path      "/var/run/captain-jack.transport"
+#define kTransport_Megabytes 16
+#define kTransport_RingFrames 8192
+
+// clients are nodes [0, kClient_Max) of the bus graph, buses the ones after
+#if kBus_FirstNode + kBus_Max > kBus_MaxNodes || kBus_Max > kBus_MaxBuses || kBus_Channels != kRoute_MaxChannels
+#	error "the bus graph can't fit every client and bus"
+#endif
+
+// a client's ring goes in the transport header's entry of the same index
+#if kClient_Max > kTransport_MaxRings
+#	error "the transport header can't fit every client's ring"
+#endif
+
+typedef struct {
+	bool                     used;
+	unsigned int             cid;
+	pid_t                    pid;
+	char                     name[64];
+	const CaptainJack_Route *route;
+	float                    gain;
+	jack_port_t             *ports[kRoute_MaxChannels];
+	bool                     silent;
+	bool                     silencePending;
+	uint64_t                 releaseAt;
+	void                    *ring;
+} Client;
+
+/*
+	the JACK process thread's view of a client. the control thread
+	fills in the CID before publishing the ports, and clears the ports
+	and waits out a process cycle before unregistering them.
+
+	`silent` is whether the device says the client's output has gone
+	quiet; changes come in through gProcessCommands. `zeroed` is the
+	buffers the process thread has already cleared while the client
+	was silent, which don't need touching again until it isn't. both
+	belong to the process thread once the slot is live.
+*/
+typedef struct {
+	jack_port_t             *ports[kRoute_MaxChannels];
+	unsigned int             cid;
+	bool                     silent;
+	void                    *zeroed[kRoute_MaxChannels];
+} ProcessSlot;
+
+/*
+	a mix bus from the rules file. the process thread sees its ports
+	through gBusPorts, published and torn down like a client's.
+*/
+typedef struct {
+	bool                        used;
+	char                        name[64];
+	const CaptainJack_RouteBus *def;
+	jack_port_t                *ports[kRoute_MaxChannels];
+} Bus;
+
+/*
+	something for the process thread to do at the start of its next
+	cycle. `cid` guards against the slot having changed hands since.
+*/
+typedef struct {
+	unsigned int             slot;
+	unsigned int             cid;
+	bool                     silent;
+} ProcessCommand;
+
+/*
+	levels are accumulated by the process thread from the moment a
+	client shows up: peaks until the publisher asks for a reset, and
+	squares/frames forever so the publisher can diff them into an RMS
+	over whatever interval it likes.
+*/
+typedef struct {
+	bool                     active;
+	unsigned int             cid;
+	float                    peak[kRoute_MaxChannels];
+	double                   squares[kRoute_MaxChannels];
+	uint64_t                 frames;
+} MeterSample;
+
+typedef struct {
+	unsigned int             count;
+	MeterSample              clients[kClient_Max];
+} MeterFrame;
+
+static const char          *kChannel_Names[kRoute_MaxChannels] = { "L", "R" };
+
+static jack_client_t       *gJack                = NULL;
+static Client               gClients[kClient_Max];
+static const char          *gRoutesPath          = kRoutes_DefaultPath;
+static CaptainJack_Routes  *gRoutes              = NULL;
+static struct stat          gRoutesStat;
+
+static ProcessSlot          gProcessSlots[kClient_Max];
+static ProcessCommand       gProcessCommandItems[kProcess_Commands];
+static CaptainJack_SPSCQueue gProcessCommands;
+static unsigned int         gProcessInCycle      = 0;
+static uint64_t             gProcessCycles       = 0;
+
+static MeterSample          gMeterLevels[kClient_Max];
+static MeterFrame           gMeterFrames[3];
+static CaptainJack_TripleBuffer gMeterBuffer;
+static unsigned int         gMeterResetEpoch     = 0;
+static unsigned int         gMeterSeenEpoch      = 0;
+static CaptainJack_MeterPage *gMeterPage         = NULL;
+static MeterSample          gMeterLast[kClient_Max];
+static unsigned int         gMeterRate           = kMeters_DefaultRate;
+static volatile sig_atomic_t gTraceRequested     = 0;
+
+static Bus                  gBuses[kBus_Max];
+static jack_port_t         *gBusPorts[kBus_Max][kRoute_MaxChannels];
+static CaptainJack_BusSchedule gBusSchedules[3];
+static CaptainJack_TripleBuffer gBusScheduleBuffer;
+static bool                 gBusesChanged        = false;
+static float               *gBusBuffers[kBus_MaxNodes * kBus_Channels];
+static CaptainJack_BusPool *gBusPool             = NULL;
+static uint64_t             gIODebounce          = kIO_DebounceMillis * 1000000ull;
+static CaptainJack_PortPool *gPortPool           = NULL;
+static CaptainJack_Transport gRegion;
+static CaptainJack_Waker    gRingWaker;
+static CaptainJack_Slab     gTransport;
+static bool                 gTransportMapped     = false;
+static size_t               gRingBytes           = kTransport_RingFrames * kRoute_MaxChannels * sizeof(float);
+
+static Client * find_client(unsigned int cid) {
+	for (int i = 0; i < kClient_Max; i++) {
+		if (gClients[i].used && gClients[i].cid == cid) {
+			return &gClients[i];
+		}
+	}
+
+	return NULL;
+}
+
+static void free_ring(Client *client) {
+	if (client->ring != NULL) {
+		CaptainJack_RetractRing(&gRegion, (unsigned int) (client - gClients));
+		CaptainJack_SlabFree(&gTransport, client->ring);
+		client->ring = NULL;
+	}
+}
+
+static Client * add_client(unsigned int cid, pid_t pid) {
+	Client *client = NULL;
+
+	for (int i = 0; client == NULL && i < kClient_Max; i++) {
+		if (!gClients[i].used) {
+			client = &gClients[i];
+		}
+	}
+
+	if (client != NULL) {
+		memset(client, 0, sizeof(*client));
+		client->used = true;
+		client->cid = cid;
+		client->pid = pid;
+		client->gain = 1.0f;
+	}
+
+	return client;
+}
+
+static const CaptainJack_Route * match_route(const Client *client, const CaptainJack_Routes *routes) {
+	if (routes == NULL) {
+		return NULL;
+	}
+
+	char path[1024];
+	char bundle[256];
+	CaptainJack_RouteSubject subject = {{ NULL }};
+
+	subject.keys[kRouteKey_Name] = client->name[0] ? client->name : NULL;
+
+	// these take a few syscalls each, so only bother if some rule wants them
+	if (CaptainJack_RoutesUseKey(routes, kRouteKey_Path) && CaptainJack_ResolveProcPath(client->pid, path, sizeof(path))) {
+		subject.keys[kRouteKey_Path] = path;
+	}
+
+	if (CaptainJack_RoutesUseKey(routes, kRouteKey_Bundle) && CaptainJack_ResolveProcBundleID(client->pid, bundle, sizeof(bundle))) {
+		subject.keys[kRouteKey_Bundle] = bundle;
+	}
+
+	return CaptainJack_MatchRoute(routes, &subject);
+}
+
+/*
+	moves a pair of ports from one route's destinations to another's.
+	new connections are made before old ones are broken so a re-route
+	never drops audio.
+*/
+static void connect_ports(jack_port_t **ports, const CaptainJack_Route *previous, const CaptainJack_Route *next) {
+	if (ports[0] == NULL) {
+		return;
+	}
+
+	for (int i = 0; i < kRoute_MaxChannels; i++) {
+		const char *from = previous ? previous->destinations[i] : NULL;
+		const char *to = next ? next->destinations[i] : NULL;
+
+		if (to != NULL && (from == NULL || strcmp(from, to) != 0)) {
+			if (jack_connect(gJack, jack_port_name(ports[i]), to) != 0) {
+				syslog(LOG_ERR, "could not connect %s to %s", jack_port_name(ports[i]), to);
+			}
+		}
+	}
+
+	for (int i = 0; i < kRoute_MaxChannels; i++) {
+		const char *from = previous ? previous->destinations[i] : NULL;
+		const char *to = next ? next->destinations[i] : NULL;
+
+		if (from != NULL && (to == NULL || strcmp(from, to) != 0)) {
+			jack_disconnect(gJack, jack_port_name(ports[i]), from);
+		}
+	}
+}
+
+static void apply_route(Client *client, const CaptainJack_Route *previous, const CaptainJack_Route *next) {
+	client->route = next;
+	client->gain = next ? next->gain : 1.0f;
+	gBusesChanged = true;
+
+	connect_ports(client->ports, previous, next);
+}
+
+/*
+	registers a pair of output ports, unregistering the first if the
+	second fails
+*/
+static bool register_port_pair(const char *prefix, unsigned int number, jack_port_t **ports) {
+	for (int i = 0; i < kRoute_MaxChannels; i++) {
+		char name[128];
+		snprintf(name, sizeof(name), "%s %u %s", prefix, number, kChannel_Names[i]);
+
+		ports[i] = jack_port_register(gJack, name, JACK_DEFAULT_AUDIO_TYPE, JackPortIsOutput, 0);
+		if (ports[i] == NULL) {
+			syslog(LOG_ERR, "could not register port %s", name);
+
+			while (i-- > 0) {
+				jack_port_unregister(gJack, ports[i]);
+				ports[i] = NULL;
+			}
+			return false;
+		}
+	}
+
+	CaptainJack_CountStat(kStat_PortRegistrations, 1);
+	return true;
+}
+
+// the port pool's side; called on its own thread
+static bool make_spare_ports(void *context, unsigned int index, void *pair[2]) {
+	jack_port_t *ports[kRoute_MaxChannels];
+	if (!register_port_pair("spare", index, ports)) {
+		return false;
+	}
+
+	pair[0] = ports[0];
+	pair[1] = ports[1];
+	return true;
+}
+
+static void free_spare_ports(void *context, void *pair[2]) {
+	jack_port_unregister(gJack, pair[0]);
+	jack_port_unregister(gJack, pair[1]);
+}
+
+/*
+	a spare pair only has to be renamed, which doesn't touch the
+	graph; without one, it's a trip to the server for each port
+*/
+static void register_ports(Client *client) {
+	const char *prefix = client->name[0] ? client->name : "client";
+	void *pair[2];
+
+	if (CaptainJack_TakePortPair(gPortPool, pair)) {
+		for (int i = 0; i < kRoute_MaxChannels; i++) {
+			char name[128];
+			snprintf(name, sizeof(name), "%s %u %s", prefix, client->cid, kChannel_Names[i]);
+
+			client->ports[i] = pair[i];
+			if (jack_port_rename(gJack, client->ports[i], name) != 0) {
+				syslog(LOG_NOTICE, "could not rename %s to %s", jack_port_name(client->ports[i]), name);
+			}
+		}
+	} else if (!register_port_pair(prefix, client->cid, client->ports)) {
+		return;
+	}
+
+	// the first port goes last; the process thread treats it as the slot being live
+	ProcessSlot *slot = &gProcessSlots[client - gClients];
+	slot->cid = client->cid;
+	slot->silent = client->silent;
+	memset(slot->zeroed, 0, sizeof(slot->zeroed));
+	for (int i = kRoute_MaxChannels; i-- > 0;) {
+		__atomic_store_n(&slot->ports[i], client->ports[i], __ATOMIC_SEQ_CST);
+	}
+
+	apply_route(client, NULL, client->route);
+}
+
+/*
+	returns once the process thread can no longer be using anything that
+	was unpublished before the call; if it's mid-cycle, that's the end of
+	that cycle.
+*/
+static void wait_for_process_cycle(void) {
+	uint64_t cycle = __atomic_load_n(&gProcessCycles, __ATOMIC_SEQ_CST);
+	if (!__atomic_load_n(&gProcessInCycle, __ATOMIC_SEQ_CST)) {
+		return;
+	}
+
+	for (int i = 0; i < 10000 && __atomic_load_n(&gProcessCycles, __ATOMIC_SEQ_CST) == cycle; i++) {
+		usleep(100);
+	}
+}
+
+static void unregister_ports(Client *client) {
+	if (client->ports[0] == NULL) {
+		return;
+	}
+
+	ProcessSlot *slot = &gProcessSlots[client - gClients];
+	for (int i = 0; i < kRoute_MaxChannels; i++) {
+		__atomic_store_n(&slot->ports[i], NULL, __ATOMIC_SEQ_CST);
+	}
+
+	wait_for_process_cycle();
+
+	for (int i = 0; i < kRoute_MaxChannels; i++) {
+		jack_port_unregister(gJack, client->ports[i]);
+		client->ports[i] = NULL;
+	}
+
+	gBusesChanged = true;
+}
+
+static int find_bus(const char *name) {
+	for (int i = 0; i < kBus_Max; i++) {
+		if (gBuses[i].used && strcmp(gBuses[i].name, name) == 0) {
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+static size_t add_sends(CaptainJack_BusSend *sends, size_t count, unsigned int from, const CaptainJack_Route *route) {
+	for (unsigned int i = 0; route != NULL && i < route->sendCount && count < kBus_MaxSends; i++) {
+		// a bus that's in the rules but couldn't get its ports isn't here
+		int bus = find_bus(route->sends[i].bus);
+		if (bus < 0) {
+			continue;
+		}
+
+		// the bus' own gain is folded into everything going into it
+		sends[count].from = (uint16_t) from;
+		sends[count].to = (uint16_t) (kBus_FirstNode + bus);
+		sends[count].gain = route->sends[i].gain * gBuses[bus].def->route.gain;
+		count++;
+	}
+
+	return count;
+}
+
+/*
+	compiles the bus graph as it stands and hands it to the process
+	thread, which picks it up at the start of its next cycle. the
+	triple buffer never hands back the schedule the process thread is
+	holding on to, so there's nothing to wait for.
+*/
+static void rebuild_buses(void) {
+	static bool isBus[kBus_MaxNodes];
+	static CaptainJack_BusSend sends[kBus_MaxSends];
+	size_t count = 0;
+
+	gBusesChanged = false;
+	memset(isBus, 0, sizeof(isBus));
+
+	for (int i = 0; i < kBus_Max; i++) {
+		if (gBuses[i].used) {
+			isBus[kBus_FirstNode + i] = true;
+			count = add_sends(sends, count, kBus_FirstNode + i, &gBuses[i].def->route);
+		}
+	}
+
+	for (int i = 0; i < kClient_Max; i++) {
+		if (gClients[i].used && gClients[i].ports[0] != NULL) {
+			count = add_sends(sends, count, (unsigned int) i, gClients[i].route);
+		}
+	}
+
+	CaptainJack_BusSchedule *next = CaptainJack_TripleBufferBack(&gBusScheduleBuffer);
+	if (!CaptainJack_ScheduleBuses(next, isBus, kBus_FirstNode + kBus_Max, sends, count)) {
+		syslog(LOG_ERR, "keeping the previous bus schedule");
+		return;
+	}
+
+	CaptainJack_PublishTripleBuffer(&gBusScheduleBuffer);
+
+	CaptainJack_SetGauge(kGauge_Buses, next->busCount);
+	CaptainJack_SetGauge(kGauge_BusSends, next->sendCount);
+}
+
+static void add_bus(const CaptainJack_RouteBus *def) {
+	int index = -1;
+	for (int i = 0; index < 0 && i < kBus_Max; i++) {
+		if (!gBuses[i].used) {
+			index = i;
+		}
+	}
+
+	if (index < 0) {
+		syslog(LOG_ERR, "no room for bus %s; only %d buses are supported", def->name, kBus_Max);
+		return;
+	}
+
+	Bus *bus = &gBuses[index];
+	memset(bus, 0, sizeof(*bus));
+	snprintf(bus->name, sizeof(bus->name), "%s", def->name);
+
+	for (int i = 0; i < kRoute_MaxChannels; i++) {
+		char name[128];
+		snprintf(name, sizeof(name), "bus %s %s", bus->name, kChannel_Names[i]);
+
+		bus->ports[i] = jack_port_register(gJack, name, JACK_DEFAULT_AUDIO_TYPE, JackPortIsOutput, 0);
+		if (bus->ports[i] == NULL) {
+			syslog(LOG_ERR, "could not register port %s", name);
+
+			while (i-- > 0) {
+				jack_port_unregister(gJack, bus->ports[i]);
+			}
+			return;
+		}
+	}
+
+	bus->used = true;
+	bus->def = def;
+
+	// same as a client's slot: the first port goes last
+	for (int i = kRoute_MaxChannels; i-- > 0;) {
+		__atomic_store_n(&gBusPorts[index][i], bus->ports[i], __ATOMIC_SEQ_CST);
+	}
+
+	connect_ports(bus->ports, NULL, &def->route);
+}
+
+static void remove_bus(Bus *bus) {
+	for (int i = 0; i < kRoute_MaxChannels; i++) {
+		__atomic_store_n(&gBusPorts[bus - gBuses][i], NULL, __ATOMIC_SEQ_CST);
+	}
+
+	wait_for_process_cycle();
+
+	for (int i = 0; i < kRoute_MaxChannels; i++) {
+		jack_port_unregister(gJack, bus->ports[i]);
+	}
+
+	memset(bus, 0, sizeof(*bus));
+}
+
+/*
+	brings the buses in line with a new set of rules. buses that are
+	still in the file keep their ports (and anything connected to
+	them); the rest are torn down before any new ones are added, so a
+	renamed bus can reuse its slot.
+*/
+static void sync_buses(const CaptainJack_Routes *routes) {
+	size_t count = routes != NULL ? CaptainJack_CountRouteBuses(routes) : 0;
+
+	for (int i = 0; i < kBus_Max; i++) {
+		Bus *bus = &gBuses[i];
+		if (!bus->used) {
+			continue;
+		}
+
+		const CaptainJack_RouteBus *def = NULL;
+		for (size_t j = 0; def == NULL && j < count; j++) {
+			if (strcmp(CaptainJack_GetRouteBus(routes, j)->name, bus->name) == 0) {
+				def = CaptainJack_GetRouteBus(routes, j);
+			}
+		}
+
+		if (def == NULL) {
+			remove_bus(bus);
+		} else {
+			connect_ports(bus->ports, &bus->def->route, &def->route);
+			bus->def = def;
+		}
+	}
+
+	rebuild_buses();
+
+	for (size_t j = 0; j < count; j++) {
+		const CaptainJack_RouteBus *def = CaptainJack_GetRouteBus(routes, j);
+		if (find_bus(def->name) < 0) {
+			add_bus(def);
+		}
+	}
+
+	rebuild_buses();
+}
+
+static int on_process(jack_nframes_t frames, void *arg) {
+	__atomic_store_n(&gProcessInCycle, 1, __ATOMIC_SEQ_CST);
+	CaptainJack_TraceBegin("jack", "process");
+	uint64_t start = CaptainJack_Now();
+
+	ProcessCommand command;
+	while (CaptainJack_PopSPSC(&gProcessCommands, &command)) {
+		ProcessSlot *slot = &gProcessSlots[command.slot];
+		if (__atomic_load_n(&slot->ports[0], __ATOMIC_SEQ_CST) != NULL && slot->cid == command.cid) {
+			slot->silent = command.silent;
+		}
+	}
+
+	unsigned int epoch = __atomic_load_n(&gMeterResetEpoch, __ATOMIC_ACQUIRE);
+	bool resetPeaks = epoch != gMeterSeenEpoch;
+	gMeterSeenEpoch = epoch;
+
+	MeterFrame *frame = CaptainJack_TripleBufferBack(&gMeterBuffer);
+	frame->count = 0;
+
+	uint64_t written = 0;
+	uint64_t skipped = 0;
+
+	for (unsigned int i = 0; i < kClient_Max; i++) {
+		ProcessSlot *slot = &gProcessSlots[i];
+		MeterSample *level = &gMeterLevels[i];
+
+		jack_port_t *ports[kRoute_MaxChannels];
+		bool live = true;
+
+		// the control thread clears these one at a time, so any of them can go
+		for (int channel = 0; channel < kRoute_MaxChannels; channel++) {
+			ports[channel] = __atomic_load_n(&slot->ports[channel], __ATOMIC_SEQ_CST);
+			live = live && ports[channel] != NULL;
+		}
+
+		if (!live) {
+			level->active = false;
+			frame->clients[i].active = false;
+			for (int channel = 0; channel < kRoute_MaxChannels; channel++) {
+				gBusBuffers[i * kBus_Channels + channel] = NULL;
+			}
+			continue;
+		}
+
+		if (!level->active || level->cid != slot->cid) {
+			memset(level, 0, sizeof(*level));
+			level->active = true;
+			level->cid = slot->cid;
+		}
+
+		bool silent = slot->silent;
+
+		for (int channel = 0; channel < kRoute_MaxChannels; channel++) {
+			jack_default_audio_sample_t *buffer = jack_port_get_buffer(ports[channel], frames);
+
+			/*
+				JACK hands an output port the same buffer every cycle
+				until the graph changes, so a silent client's buffer
+				only has to be cleared once. after that there's nothing
+				to write or measure; it's silence until told otherwise.
+			*/
+			if (silent && buffer == slot->zeroed[channel]) {
+				if (resetPeaks) {
+					level->peak[channel] = 0.0f;
+				}
+				gBusBuffers[i * kBus_Channels + channel] = NULL;
+				skipped++;
+				continue;
+			}
+
+			// nothing carries audio over from the device yet, so the ports play silence
+			memset(buffer, 0, frames * sizeof(*buffer));
+			slot->zeroed[channel] = silent ? buffer : NULL;
+			gBusBuffers[i * kBus_Channels + channel] = buffer;
+			written++;
+
+			float peak;
+			float squares;
+			CaptainJack_Measure(buffer, frames, &peak, &squares);
+
+			if (resetPeaks || peak > level->peak[channel]) {
+				level->peak[channel] = peak;
+			}
+			level->squares[channel] += squares;
+		}
+
+		level->frames += frames;
+		frame->clients[i] = *level;
+		frame->count = i + 1;
+	}
+
+	const CaptainJack_BusSchedule *schedule = CaptainJack_ReadTripleBuffer(&gBusScheduleBuffer, NULL);
+	if (schedule->busCount > 0) {
+		for (unsigned int i = 0; i < schedule->busCount; i++) {
+			unsigned int node = schedule->buses[i];
+			jack_port_t *ports[kRoute_MaxChannels];
+			bool live = true;
+
+			for (int channel = 0; channel < kRoute_MaxChannels; channel++) {
+				ports[channel] = __atomic_load_n(&gBusPorts[node - kBus_FirstNode][channel], __ATOMIC_SEQ_CST);
+				live = live && ports[channel] != NULL;
+			}
+
+			// a bus on its way in or out is left alone, and is silence to anything it feeds
+			for (int channel = 0; channel < kRoute_MaxChannels; channel++) {
+				gBusBuffers[node * kBus_Channels + channel] = live ? jack_port_get_buffer(ports[channel], frames) : NULL;
+			}
+		}
+
+		CaptainJack_RunBusesParallel(gBusPool, schedule, gBusBuffers, frames);
+	}
+
+	CaptainJack_PublishTripleBuffer(&gMeterBuffer);
+	CaptainJack_CountStat(kStat_PortBuffersWritten, written);
+	CaptainJack_CountStat(kStat_PortBuffersSkipped, skipped);
+	CaptainJack_ObserveStat(kHistogram_Process, CaptainJack_Now() - start);
+	CaptainJack_TraceEnd("jack", "process");
+
+	__atomic_add_fetch(&gProcessCycles, 1, __ATOMIC_SEQ_CST);
+	__atomic_store_n(&gProcessInCycle, 0, __ATOMIC_SEQ_CST);
+	return 0;
+}
+
+#ifdef CAPTAIN_JACK_TRACE
+static void on_trace_signal(int signal) {
+	gTraceRequested = 1;
+}
+#endif
+
+static int on_xrun(void *arg) {
+	CaptainJack_CountStat(kStat_JackXruns, 1);
+	return 0;
+}
+
+/*
+	copies the latest levels out to the meter page. runs on the control
+	thread, which is the only one allowed to look at the client table.
+
+	this runs even without a page, since the stats server reports the
+	frame counts it leaves behind in gMeterLast.
+*/
+static void publish_meters(void) {
+	bool fresh;
+	const MeterFrame *frame = CaptainJack_ReadTripleBuffer(&gMeterBuffer, &fresh);
+	if (!fresh) {
+		return;
+	}
+
+	// start the next interval's peaks; the process thread resets them on its next cycle
+	__atomic_add_fetch(&gMeterResetEpoch, 1, __ATOMIC_RELEASE);
+
+	static CaptainJack_MeterEntry discard;
+	if (gMeterPage != NULL) {
+		CaptainJack_BeginMeterUpdate(gMeterPage);
+	}
+
+	unsigned int count = 0;
+	for (unsigned int i = 0; i < frame->count; i++) {
+		const MeterSample *level = &frame->clients[i];
+		MeterSample *last = &gMeterLast[i];
+
+		if (!level->active || !gClients[i].used || gClients[i].cid != level->cid) {
+			last->active = false;
+			continue;
+		}
+
+		bool continued = last->active && last->cid == level->cid && level->frames > last->frames;
+		uint64_t frames = continued ? level->frames - last->frames : level->frames;
+
+		CaptainJack_MeterEntry *entry = gMeterPage != NULL ? &gMeterPage->clients[count++] : &discard;
+		entry->cid = level->cid;
+		entry->pid = gClients[i].pid;
+		strncpy(entry->name, gClients[i].name, sizeof(entry->name) - 1);
+		entry->name[sizeof(entry->name) - 1] = 0;
+
+		for (int channel = 0; channel < kRoute_MaxChannels; channel++) {
+			double squares = continued ? level->squares[channel] - last->squares[channel] : level->squares[channel];
+			entry->peak[channel] = level->peak[channel];
+			entry->rms[channel] = frames ? (float) sqrt(squares / frames) : 0.0f;
+		}
+
+		*last = *level;
+	}
+
+	if (gMeterPage != NULL) {
+		gMeterPage->rate = gMeterRate;
+		gMeterPage->count = count;
+		CaptainJack_EndMeterUpdate(gMeterPage);
+	}
+}
+
+/*
+	appends the per-client stats to a scrape
+*/
+static void collect_stats(CaptainJack_StatsWriter *writer) {
+	CaptainJack_PortPoolStats spares;
+	CaptainJack_GetPortPoolStats(gPortPool, &spares);
+	CaptainJack_AppendStats(writer,
+		"# HELP captainjack_spare_ports Spare port pairs ready to hand out\n"
+		"# TYPE captainjack_spare_ports gauge\n"
+		"captainjack_spare_ports %u\n"
+		"# HELP captainjack_spare_ports_taken_total Clients given a spare port pair\n"
+		"# TYPE captainjack_spare_ports_taken_total counter\n"
+		"captainjack_spare_ports_taken_total %llu\n"
+		"# HELP captainjack_spare_ports_empty_total Clients that found no spare port pair and waited for one\n"
+		"# TYPE captainjack_spare_ports_empty_total counter\n"
+		"captainjack_spare_ports_empty_total %llu\n",
+		spares.available,
+		(unsigned long long) spares.taken,
+		(unsigned long long) spares.empty);
+
+	if (gTransportMapped) {
+		CaptainJack_AppendStats(writer,
+			"# HELP captainjack_transport_bytes Bytes of the transport region handed out to client rings\n"
+			"# TYPE captainjack_transport_bytes gauge\n"
+			"captainjack_transport_bytes %zu\n"
+			"# HELP captainjack_transport_peak_bytes Most of the transport region ever handed out at once\n"
+			"# TYPE captainjack_transport_peak_bytes gauge\n"
+			"captainjack_transport_peak_bytes %zu\n"
+			"# HELP captainjack_transport_huge_pages Whether the transport region is mapped with huge pages\n"
+			"# TYPE captainjack_transport_huge_pages gauge\n"
+			"captainjack_transport_huge_pages %d\n"
+			"# HELP captainjack_transport_locked Whether the transport region is locked in memory\n"
+			"# TYPE captainjack_transport_locked gauge\n"
+			"captainjack_transport_locked %d\n"
+			"# HELP captainjack_transport_wake How the device wakes the daemon when its rings have something in them\n"
+			"# TYPE captainjack_transport_wake gauge\n"
+			"captainjack_transport_wake{backend=\"%s\"} 1\n"
+			"# HELP captainjack_transport_free_slabs Transport slabs not given to any size class\n"
+			"# TYPE captainjack_transport_free_slabs gauge\n"
+			"captainjack_transport_free_slabs %u\n"
+			"# HELP captainjack_transport_slots Transport ring slots in use, by size\n"
+			"# TYPE captainjack_transport_slots gauge\n",
+			gTransport.bytesUsed,
+			gTransport.peakBytesUsed,
+			gRegion.huge,
+			gRegion.locked,
+			CaptainJack_WakeBackendName(gRingWaker.backend),
+			gTransport.freeSlabs);
+
+		for (unsigned int i = 0; i < gTransport.classCount; i++) {
+			CaptainJack_AppendStats(writer, "captainjack_transport_slots{size=\"%zu\"} %u\n", gTransport.classes[i].slotBytes, gTransport.classes[i].used);
+		}
+
+		CaptainJack_AppendStats(writer,
+			"# HELP captainjack_transport_failures_total Client rings there was no room for, by size\n"
+			"# TYPE captainjack_transport_failures_total counter\n");
+
+		for (unsigned int i = 0; i < gTransport.classCount; i++) {
+			CaptainJack_AppendStats(writer, "captainjack_transport_failures_total{size=\"%zu\"} %llu\n", gTransport.classes[i].slotBytes, (unsigned long long) gTransport.classes[i].failures);
+		}
+	}
+
+	CaptainJack_AppendStats(writer,
+		"# HELP captainjack_client_frames_total Frames processed for each client\n"
+		"# TYPE captainjack_client_frames_total counter\n");
+
+	for (unsigned int i = 0; i < kClient_Max; i++) {
+		const MeterSample *last = &gMeterLast[i];
+		if (!last->active || !gClients[i].used || gClients[i].cid != last->cid) {
+			continue;
+		}
+
+		// label values can't carry raw quotes, backslashes or newlines
+		char name[sizeof(gClients[i].name)];
+		size_t length = 0;
+		for (const char *c = gClients[i].name; *c && length < sizeof(name) - 1; c++) {
+			name[length++] = (*c == '"' || *c == '\\' || *c == '\n') ? '_' : *c;
+		}
+		name[length] = 0;
+
+		CaptainJack_AppendStats(writer, "captainjack_client_frames_total{cid=\"%u\",pid=\"%d\",name=\"%s\"} %llu\n",
+			last->cid,
+			gClients[i].pid,
+			name,
+			(unsigned long long) last->frames);
+	}
+}
+
+static void update_client_gauge(void) {
+	unsigned int count = 0;
+	for (unsigned int i = 0; i < kClient_Max; i++) {
+		count += gClients[i].used;
+	}
+	CaptainJack_SetGauge(kGauge_Clients, count);
+}
+
+/*
+	maps the region the clients' transport rings are carved out of.
+	it's sized and cleared once, here; rings are only ever handed
+	out of it and back by the slab allocator after that.
+*/
+static bool map_transport(const char *path, size_t megabytes) {
+	static const size_t sizes[] = { 16384, 65536, 262144 };
+
+	if (!CaptainJack_MapTransport(&gRegion, path, megabytes << 20, kTransportFlag_All)) {
+		return false;
+	}
+
+	if (!CaptainJack_InitSlab(&gTransport, gRegion.rings, gRegion.ringBytes, sizes, sizeof(sizes) / sizeof(sizes[0]))) {
+		syslog(LOG_ERR, "could not set up the transport region");
+		CaptainJack_UnmapTransport(&gRegion);
+		return false;
+	}
+
+	if (!CaptainJack_CreateWaker(&gRingWaker, &gRegion.header->wake, kWake_Auto)) {
+		syslog(LOG_ERR, "could not set up the transport region's wakeups");
+		CaptainJack_UnmapTransport(&gRegion);
+		return false;
+	}
+
+	syslog(LOG_NOTICE, "transport region: %zu MiB at %s (%s pages, %s, woken by %s), %zu bytes per client ring",
+		megabytes,
+		path,
+		gRegion.huge ? "huge" : "normal",
+		gRegion.locked ? "locked" : "not locked",
+		CaptainJack_WakeBackendName(gRingWaker.backend),
+		gRingBytes);
+	return true;
+}
+
+/*
+	picks up changes to the rules file. existing clients are re-routed
+	against the new rules; a file that fails to parse keeps the old ones.
+*/
+static void reload_routes(bool force) {
+	struct stat info;
+	bool exists = stat(gRoutesPath, &info) == 0;
+
+	if (!force && exists == (gRoutes != NULL) && (!exists || (info.st_mtime == gRoutesStat.st_mtime && info.st_size == gRoutesStat.st_size))) {
+		return;
+	}
+
+	if (exists) {
+		gRoutesStat = info;
+	}
+
+	CaptainJack_Routes *routes = NULL;
+	if (exists && (routes = CaptainJack_LoadRoutes(gRoutesPath)) == NULL) {
+		syslog(LOG_ERR, "keeping the previous routing rules");
+		return;
+	}
+
+	if (!exists) {
+		if (gRoutes != NULL || force) {
+			syslog(LOG_NOTICE, "no routing rules at %s; clients will be left unconnected", gRoutesPath);
+		}
+		memset(&gRoutesStat, 0, sizeof(gRoutesStat));
+	}
+
+	for (int i = 0; i < kClient_Max; i++) {
+		if (gClients[i].used) {
+			apply_route(&gClients[i], gClients[i].route, match_route(&gClients[i], routes));
+		}
+	}
+
+	sync_buses(routes);
+
+	CaptainJack_FreeRoutes(gRoutes);
+	gRoutes = routes;
+}
+
 static void on_ready(void) {
 	syslog(LOG_NOTICE, "device has signaled it's ready");
 }
 
+static void log_proc_name_stats(void) {
+	CaptainJack_ProcNameStats stats;
+	CaptainJack_GetProcNameStats(&stats);
+
+	// only every so often; a connect storm shouldn't turn into a log storm
+	if (stats.lookups == 0 || stats.lookups % 64 != 0) {
+		return;
+	}
+
+	syslog(LOG_NOTICE, "process name cache: %lu lookups, %lu hits (%.1f%%), %lu misses, %lu reused, %lu evictions, %lu failures",
+		stats.lookups,
+		stats.hits,
+		100.0 * stats.hits / stats.lookups,
+		stats.misses,
+		stats.reused,
+		stats.evictions,
+		stats.failures);
+}
+
+static void on_client_disconnect(unsigned int cid, pid_t pid) {
+	// the process has usually exited by now, so the kernel can't tell us who it was; the cache can
+	const char *name = CaptainJack_LookupProcName(pid);
+	syslog(LOG_NOTICE, "client disconnected: %u (%s %d)", cid, name != NULL ? name : "?", pid);
+
+	Client *client = find_client(cid);
+	if (client != NULL) {
+		unregister_ports(client);
+		free_ring(client);
+		client->used = false;
+	}
+
+	update_client_gauge();
+}
+
 static void on_new_client(unsigned int cid, pid_t pid) {
-	char buffer[1024];
-	if (proc_name(pid, &buffer[0], sizeof(buffer)) == -1) {
+	const char *name = CaptainJack_ResolveProcName(pid);
+	if (name == NULL) {
 		syslog(LOG_NOTICE, "could not get name of client: %u (%u)", cid, pid);
 	} else {
-		syslog(LOG_NOTICE, "client connected: %u (%s %u)", cid, &buffer[0], pid);
+		syslog(LOG_NOTICE, "client connected: %u (%s %u)", cid, name, pid);
 	}
+
+	log_proc_name_stats();
+
+	// one we already have went away without us hearing; its ports and ring go with it
+	Client *existing = find_client(cid);
+	if (existing != NULL) {
+		on_client_disconnect(existing->cid, existing->pid);
+	}
+
+	Client *client = add_client(cid, pid);
+	if (client == NULL) {
+		syslog(LOG_ERR, "too many clients; not routing %u", cid);
+		return;
+	}
+
+	if (name != NULL) {
+		strncpy(client->name, name, sizeof(client->name) - 1);
+	}
+
+	client->route = match_route(client, gRoutes);
+	if (client->route != NULL) {
+		syslog(LOG_NOTICE, "client %u matched routing rule on line %u", cid, client->route->line);
+	}
+
+	update_client_gauge();
 }
 
-static void on_client_disconnect(unsigned int cid, pid_t pid) {
-	syslog(LOG_NOTICE, "client disconnected: %u (%d)", cid, pid);
+/*
+	queues every client's silence change that hasn't been yet. if the
+	process thread has fallen behind (or JACK has stopped calling it)
+	the rest wait for the next tick; only the latest state matters,
+	and the slot picks that up when it's registered anyway.
+*/
+static void send_process_commands(void) {
+	for (int i = 0; i < kClient_Max; i++) {
+		Client *client = &gClients[i];
+		if (!client->used || !client->silencePending) {
+			continue;
+		}
+
+		ProcessCommand command = { (unsigned int) i, client->cid, client->silent };
+		if (!CaptainJack_PushSPSC(&gProcessCommands, &command)) {
+			return;
+		}
+
+		client->silencePending = false;
+	}
 }
 
 static void on_client_enables_io(unsigned int cid) {
 	syslog(LOG_NOTICE, "client enabled IO: %u", cid);
+
+	Client *client = find_client(cid);
+	if (client == NULL) {
+		return;
+	}
+
+	// whatever the client was before it stopped, it starts out playing
+	client->silent = false;
+	client->silencePending = true;
+	send_process_commands();
+
+	if (client->releaseAt != 0) {
+		// back before its ports went; as if it never stopped
+		client->releaseAt = 0;
+		CaptainJack_CountStat(kStat_IODebounced, 1);
+	} else if (client->ports[0] == NULL) {
+		register_ports(client);
+	}
+
+	// the ring stays until the client disconnects, however often it stops and starts
+	if (gTransportMapped && client->ring == NULL) {
+		client->ring = CaptainJack_SlabAlloc(&gTransport, gRingBytes);
+		if (client->ring == NULL) {
+			syslog(LOG_ERR, "no room in the transport region for client %u's ring", cid);
+		} else {
+			memset(client->ring, 0, gRingBytes);
+			CaptainJack_PublishRing(&gRegion, (unsigned int) (client - gClients), cid, client->ring, gRingBytes);
+		}
+	}
 }
 
+/*
+	a client that stops IO keeps its ports for gIODebounce, so one
+	that's only stopped between two sounds doesn't cost any JACK
+	port work (or lose any connections someone made by hand)
+*/
 static void on_client_disables_io(unsigned int cid) {
 	syslog(LOG_NOTICE, "client disabled IO: %u", cid);
+
+	Client *client = find_client(cid);
+	if (client == NULL) {
+		return;
+	}
+
+	client->silent = false;
+	client->silencePending = true;
+	send_process_commands();
+
+	if (client->ports[0] != NULL && client->releaseAt == 0) {
+		client->releaseAt = CaptainJack_Now() + gIODebounce;
+	}
+}
+
+static void release_idle_ports(void) {
+	uint64_t now = CaptainJack_Now();
+
+	for (int i = 0; i < kClient_Max; i++) {
+		Client *client = &gClients[i];
+		if (client->used && client->releaseAt != 0 && now >= client->releaseAt) {
+			client->releaseAt = 0;
+			unregister_ports(client);
+		}
+	}
+}
+
+static void on_client_silence(unsigned int cid, bool silent) {
+	Client *client = find_client(cid);
+	if (client != NULL) {
+		client->silent = silent;
+		client->silencePending = true;
+		send_process_commands();
+	}
+}
+
+/*
+	the device sends its whole client table whenever we connect.
+	anything we remember that it doesn't is gone; anything it has
+	that we don't is set up just as if we'd heard it happen.
+*/
+static void on_snapshot(const CaptainJack_XmitClient *clients, unsigned int count) {
+	syslog(LOG_NOTICE, "device sent its client table (%u clients); resyncing", count);
+
+	for (int i = 0; i < kClient_Max; i++) {
+		if (!gClients[i].used) {
+			continue;
+		}
+
+		bool present = false;
+		for (unsigned int j = 0; j < count && !present; j++) {
+			present = clients[j].cid == gClients[i].cid && clients[j].pid == gClients[i].pid;
+		}
+
+		if (!present) {
+			on_client_disconnect(gClients[i].cid, gClients[i].pid);
+		}
+	}
+
+	for (unsigned int j = 0; j < count; j++) {
+		if (find_client(clients[j].cid) == NULL) {
+			on_new_client(clients[j].cid, clients[j].pid);
+		}
+
+		if (clients[j].io) {
+			on_client_enables_io(clients[j].cid);
+		} else {
+			on_client_disables_io(clients[j].cid);
+		}
+
+		on_client_silence(clients[j].cid, clients[j].silent);
+	}
 }
 
 static CaptainJack_Xmitter xmitterClient = {
@@ -51,6 +1133,8 @@ static CaptainJack_Xmitter xmitterClient = {
 	&on_client_disconnect,
 	&on_client_enables_io,
 	&on_client_disables_io,
+	&on_client_silence,
+	&on_snapshot,
 };
 
 static void CaptainJack_LogJackError(const char *message, jack_status_t status) {
@@ -78,29 +1162,133 @@ static void CaptainJack_LogJackError(const char *message, jack_status_t status)
 int main(void) {
 	openlog("CaptainJack", LOG_NDELAY | LOG_PERROR | LOG_PID, LOG_DAEMON);
 	setlogmask(0);
+	CaptainJack_StartLogger();
 	syslog(LOG_NOTICE, "Captain Jack is portside at ye embarcadero");
 
 	CaptainJack_RegisterXmitterClient(&xmitterClient);
+	CaptainJack_InitTripleBuffer(&gMeterBuffer, &gMeterFrames[0], &gMeterFrames[1], &gMeterFrames[2]);
+	CaptainJack_InitTripleBuffer(&gBusScheduleBuffer, &gBusSchedules[0], &gBusSchedules[1], &gBusSchedules[2]);
+	CaptainJack_InitSPSCQueue(&gProcessCommands, gProcessCommandItems, kProcess_Commands, sizeof(gProcessCommandItems[0]));
+
+	if (getenv("CAPTAIN_JACK_METER_HZ") != NULL) {
+		int rate = atoi(getenv("CAPTAIN_JACK_METER_HZ"));
+		gMeterRate = rate < 1 ? 1 : rate > kTicks_PerSecond ? kTicks_PerSecond : rate;
+	}
+
+	if (getenv("CAPTAIN_JACK_RING_FRAMES") != NULL && atoi(getenv("CAPTAIN_JACK_RING_FRAMES")) > 0) {
+		gRingBytes = (size_t) atoi(getenv("CAPTAIN_JACK_RING_FRAMES")) * kRoute_MaxChannels * sizeof(float);
+	}
+
+	int transportMegabytes = getenv("CAPTAIN_JACK_TRANSPORT_MB") ? atoi(getenv("CAPTAIN_JACK_TRANSPORT_MB")) : kTransport_Megabytes;
+	gTransportMapped = transportMegabytes > 0 && map_transport(getenv("CAPTAIN_JACK_TRANSPORT") ? getenv("CAPTAIN_JACK_TRANSPORT") : kTransport_Path, (size_t) transportMegabytes);
+	if (!gTransportMapped) {
+		syslog(LOG_ERR, "clients won't get transport rings");
+	}
+
+	gMeterPage = CaptainJack_MapMeterPage(getenv("CAPTAIN_JACK_METERS") ? getenv("CAPTAIN_JACK_METERS") : kMeters_DefaultPath, true);
+	if (gMeterPage == NULL) {
+		syslog(LOG_ERR, "levels won't be published");
+	}
 
 	jack_status_t status = 0;
-	jack_client_t *jack = jack_client_open("Captain Jack", JackNoStartServer, &status);
-	if (jack == NULL) {
+	gJack = jack_client_open("Captain Jack", JackNoStartServer, &status);
+	if (gJack == NULL) {
 		CaptainJack_LogJackError("could not connect to server", status);
 		return EXIT_FAILURE;
 	} else {
 		syslog(LOG_NOTICE, "connected successfully");
 	}
 
-	bool shouldRunAgain = true;
-	while (shouldRunAgain) {
+	// the JACK thread mixes too, so one thread means no pool at all
+	long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	int mixThreads = cpus < 1 ? 1 : cpus > kBus_DefaultThreads ? kBus_DefaultThreads : (int) cpus;
+	if (getenv("CAPTAIN_JACK_MIX_THREADS") != NULL) {
+		mixThreads = atoi(getenv("CAPTAIN_JACK_MIX_THREADS"));
+	}
+
+	// the JACK thread waits on the workers, so they're no use unless they're real-time too
+	int mixPriority = jack_client_real_time_priority(gJack);
+	if (mixThreads > 1 && mixPriority <= 0) {
+		syslog(LOG_NOTICE, "JACK isn't running real-time; mixing on the JACK thread alone");
+	} else if (mixThreads > 1) {
+		gBusPool = CaptainJack_StartBusPool((unsigned int) mixThreads, mixPriority);
+	}
+
+	jack_set_process_callback(gJack, &on_process, NULL);
+	jack_set_xrun_callback(gJack, &on_xrun, NULL);
+
+	if (jack_activate(gJack) != 0) {
+		syslog(LOG_ERR, "could not activate the JACK client");
+		return EXIT_FAILURE;
+	}
+
+	// CAPTAIN_JACK_PORT_SPARES=0 registers every client's ports as it starts playing
+	int spares = getenv("CAPTAIN_JACK_PORT_SPARES") ? atoi(getenv("CAPTAIN_JACK_PORT_SPARES")) : kPorts_DefaultSpares;
+	if (spares > 0) {
+		gPortPool = CaptainJack_StartPortPool((unsigned int) spares, &make_spare_ports, &free_spare_ports, NULL);
+	}
+
+	if (getenv("CAPTAIN_JACK_IO_DEBOUNCE_MS") != NULL && atoi(getenv("CAPTAIN_JACK_IO_DEBOUNCE_MS")) >= 0) {
+		gIODebounce = (uint64_t) atoi(getenv("CAPTAIN_JACK_IO_DEBOUNCE_MS")) * 1000000ull;
+	}
+
+	if (getenv("CAPTAIN_JACK_ROUTES") != NULL) {
+		gRoutesPath = getenv("CAPTAIN_JACK_ROUTES");
+	}
+
+	reload_routes(true);
+
+#ifdef CAPTAIN_JACK_TRACE
+	// `kill -USR1` dumps the trace rings
+	signal(SIGUSR1, &on_trace_signal);
+#endif
+
+	int statsPort = getenv("CAPTAIN_JACK_STATS_PORT") ? atoi(getenv("CAPTAIN_JACK_STATS_PORT")) : kStats_DefaultPort;
+	if (statsPort > 0 && statsPort < 65536) {
+		CaptainJack_StartStatsServer((uint16_t) statsPort);
+	}
+
+	// by the clock rather than by ticks, so rates that don't divide the tick rate come out right on average
+	uint64_t meterPeriod = 1000000000ull / gMeterRate;
+	uint64_t meterAt = CaptainJack_Now() + meterPeriod;
+
+	for (unsigned long ticks = 1;; ticks++) {
 		usleep(10000);
 
-		if (!CaptainJack_TickXmitter()) {
-			shouldRunAgain = false;
+		if (ticks % kRoutes_CheckTicks == 0) {
+			reload_routes(false);
+		}
+
+		// clients coming, going and being re-routed all change what feeds the buses
+		if (gBusesChanged) {
+			rebuild_buses();
+		}
+
+		send_process_commands();
+		release_idle_ports();
+
+		uint64_t now = CaptainJack_Now();
+		if (now >= meterAt) {
+			publish_meters();
+
+			// after a stall, carry on from now rather than making up for it all at once
+			meterAt = now - meterAt < meterPeriod ? meterAt + meterPeriod : now + meterPeriod;
+		}
+
+		if (ticks % kTicks_PerSecond == 0) {
+			CaptainJack_SetGauge(kGauge_JackCPULoad, jack_cpu_load(gJack));
 		}
-	}
 
-	syslog(LOG_CRIT, "terminating");
+		// if the device goes away, this keeps trying to reconnect (backing off as it goes)
+		uint64_t start = CaptainJack_Now();
+		CaptainJack_TickXmitter();
+		CaptainJack_ObserveStat(kHistogram_XmitTick, CaptainJack_Now() - start);
 
-	return EXIT_FAILURE;
+		CaptainJack_TickStatsServer(&collect_stats);
+
+		if (gTraceRequested) {
+			gTraceRequested = 0;
+			CaptainJack_DumpTrace(kTrace_DaemonPath);
+		}
+	}
 }
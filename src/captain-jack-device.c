@@ -14,15 +14,26 @@
 
 #include <CoreAudio/AudioServerPlugIn.h>
 #include <dispatch/dispatch.h>
-#include <jack/jack.h>
 #include <mach/mach_time.h>
+#include <math.h>
 #include <pthread.h>
+#include <signal.h>
 #include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
 #include <sys/syslog.h>
 
+#include "config.h"
+#include "convert.h"
+#include "dsp.h"
+#include "log.h"
+#include "props.h"
+#include "trace.h"
 #include "xmit.h"
 
-#define DebugMsg(inFormat, ...) syslog(LOG_NOTICE, inFormat, ## __VA_ARGS__)
+#define kTrace_DevicePath "/tmp/captain-jack-device.json"
+
+#define DebugMsg(inFormat, ...) CaptainJack_Log(LOG_NOTICE, inFormat, ## __VA_ARGS__)
 
 //  - a box
 //  - a device
@@ -58,6 +69,8 @@ enum {
 static pthread_mutex_t          gPlugIn_StateMutex              = PTHREAD_MUTEX_INITIALIZER;
 static UInt32                   gPlugIn_RefCount                = 0;
 static AudioServerPlugInHostRef gPlugIn_Host                    = NULL;
+static bool                     gPlugIn_CacheProperties         = false;
+static bool                     gPlugIn_Dither                  = false;
 
 #define                         kBox_UID                        "CaptainJackBox_UID"
 static CFStringRef              gBox_Name                       = NULL;
@@ -66,19 +79,17 @@ static Boolean                  gBox_Acquired                   = true;
 #define                         kDevice_UID                     "CaptainJackDevice_UID"
 #define                         kDevice_ModelUID                "CaptainJackDevice_ModelUID"
 static pthread_mutex_t          gDevice_IOMutex                 = PTHREAD_MUTEX_INITIALIZER;
-static Float64                  gDevice_SampleRate              = 44100.0;
 static UInt64                   gDevice_IOIsRunning             = 0;
 static const UInt32             kDevice_RingBufferSize          = 16384;
-static Float64                  gDevice_HostTicksPerFrame       = 0.0;
 static UInt64                   gDevice_NumberTimeStamps        = 0;
 static Float64                  gDevice_AnchorSampleTime        = 0.0;
 static UInt64                   gDevice_AnchorHostTime          = 0;
 
-static bool                     gStream_Input_IsActive          = true;
-static bool                     gStream_Output_IsActive         = true;
-
 static const Float32            kVolume_MinDB                   = -96.0;
 static const Float32            kVolume_MaxDB                   = 6.0;
+
+//  The control values are read and written with atomics, not under a lock: the IO thread reads
+//  them every cycle for the gain stage, and scrubbing a slider shouldn't ever make it wait.
 static Float32                  gVolume_Input_Master_Value      = 0.0;
 static Float32                  gVolume_Output_Master_Value     = 0.0;
 
@@ -88,6 +99,56 @@ static bool                     gMute_Output_Master_Value       = false;
 static UInt32                   gDataSource_Input_Master_Value  = 0;
 static UInt32                   gDataSource_Output_Master_Value = 0;
 
+//  one bit per control object ID whose value changed since the host was last told about it
+static UInt32                   gControls_Changed               = 0;
+static const int64_t            kControls_NotifyDelay           = 10 * NSEC_PER_MSEC;
+
+#ifdef CAPTAIN_JACK_TRACE
+//  set by `kill -USR1` on coreaudiod; a timer on the dispatch queue notices and writes the trace
+static volatile sig_atomic_t    gTrace_Requested                = 0;
+static const int64_t            kTrace_PollDelay                = 250 * NSEC_PER_MSEC;
+#endif
+
+//  the gain each stream's last buffer ended on; only touched by the IO thread
+static Float32                  gIO_Input_Gain                  = 0.0;
+static Float32                  gIO_Output_Gain                 = 0.0;
+static CaptainJack_Dither       gIO_Output_Dither;
+
+//  Each client doing IO gets a slot, claimed in StartIO, that the IO thread finds by client ID
+//  in ProcessOutput. A client whose output stays below the threshold for kSilence_HoldFrames is
+//  marked silent and the daemon is told, so it can stop doing work on its behalf; the first
+//  audible buffer clears it again. The hold keeps short gaps between sounds from flapping.
+#define                         kIO_MaxClients                  64
+static const Float32            kSilence_Threshold              = 1.0f / 65536.0f;
+static const UInt32             kSilence_HoldFrames             = 8192;
+
+typedef struct {
+	bool                        mUsed;
+	UInt32                      mClientID;
+	UInt32                      mQuietFrames;
+	bool                        mSilent;
+} CaptainJack_ClientSilence;
+
+static CaptainJack_ClientSilence gIO_Clients[kIO_MaxClients];
+
+//  The physical formats the streams can be switched to, in the order they're advertised. The
+//  virtual format is always 32 bit float; the device converts between the two itself.
+static const CaptainJack_SampleFormat kStream_PhysicalFormats[] = { kSampleFormat_Float32, kSampleFormat_Int32, kSampleFormat_Int24, kSampleFormat_Int16 };
+#define                         kStream_NumberPhysicalFormats   (sizeof(kStream_PhysicalFormats) / sizeof(kStream_PhysicalFormats[0]))
+static const Float64            kStream_SampleRates[]           = { 44100.0, 48000.0 };
+#define                         kStream_NumberSampleRates       (sizeof(kStream_SampleRates) / sizeof(kStream_SampleRates[0]))
+
+//  Configuration change actions other than a sample rate change (whose action is the new rate).
+//  The change info is the new CaptainJack_SampleFormat.
+enum {
+	kChangeAction_InputFormat           = 1,
+	kChangeAction_OutputFormat          = 2
+};
+
+//  The sample rate, stream and control state live in one snapshot that the IO paths can read
+//  without taking gPlugIn_StateMutex; setters build a new one and swap it in (see config.h).
+static CaptainJack_ConfigCell   gDevice_Config                  = CAPTAIN_JACK_CONFIG_CELL({ .sampleRate = 44100.0, .inputActive = true, .outputActive = true });
+
 static CaptainJack_Xmitter     *gXmitter                        = 0;
 
 void               *CaptainJack_Create(CFAllocatorRef inAllocator, CFUUIDRef inRequestedTypeUUID);
@@ -175,9 +236,251 @@ static AudioServerPlugInDriverInterface    *gAudioServerPlugInDriverInterfacePtr
 static AudioServerPlugInDriverRef           gAudioServerPlugInDriverRef             = &gAudioServerPlugInDriverInterfacePtr;
 
 
+//  These are dispatched to a global queue so the host hears about changes after we've returned to it.
+static void CaptainJack_NotifyBoxIdentify(void *inContext) {
+#pragma unused(inContext)
+	AudioObjectPropertyAddress theAddress = { kAudioObjectPropertyIdentify, kAudioObjectPropertyScopeGlobal, kAudioObjectPropertyElementMaster };
+	gPlugIn_Host->PropertiesChanged(gPlugIn_Host, kObjectID_Box, 1, &theAddress);
+}
+
+static void CaptainJack_NotifyPlugInDeviceList(void *inContext) {
+#pragma unused(inContext)
+	AudioObjectPropertyAddress theAddress = { kAudioPlugInPropertyDeviceList, kAudioObjectPropertyScopeGlobal, kAudioObjectPropertyElementMaster };
+	gPlugIn_Host->PropertiesChanged(gPlugIn_Host, kObjectID_PlugIn, 1, &theAddress);
+}
+
+static Float32 CaptainJack_ExchangeVolume(AudioObjectID inObjectID, Float32 inNewVolume) {
+	//  stores the new scalar value for a volume control and returns the old one
+	Float32 theOldVolume;
+	__atomic_exchange((inObjectID == kObjectID_Volume_Input_Master) ? &gVolume_Input_Master_Value : &gVolume_Output_Master_Value, &inNewVolume, &theOldVolume, __ATOMIC_RELAXED);
+	return theOldVolume;
+}
+
+static Float32 CaptainJack_StreamGain(AudioObjectID inStreamObjectID) {
+	//  the linear gain the controls on a stream ask for. Note that we square the scalar value
+	//  before converting to dB the same way the dB property does.
+	bool isInput = inStreamObjectID == kObjectID_Stream_Input;
+	Float32 theVolume;
+
+	if (__atomic_load_n(isInput ? &gMute_Input_Master_Value : &gMute_Output_Master_Value, __ATOMIC_RELAXED)) {
+		return 0.0;
+	}
+
+	__atomic_load(isInput ? &gVolume_Input_Master_Value : &gVolume_Output_Master_Value, &theVolume, __ATOMIC_RELAXED);
+	return powf(10.0f, (kVolume_MinDB + (theVolume * theVolume * (kVolume_MaxDB - kVolume_MinDB))) / 20.0f);
+}
+
+static void CaptainJack_NotifyControls(void *inContext) {
+#pragma unused(inContext)
+	//  everything that changed while this was pending goes out now, one call per control
+	UInt32 theChanged = __atomic_exchange_n(&gControls_Changed, 0, __ATOMIC_ACQ_REL);
+	AudioObjectPropertyAddress theAddresses[2] = {
+		{ kAudioLevelControlPropertyScalarValue, kAudioObjectPropertyScopeGlobal, kAudioObjectPropertyElementMaster },
+		{ kAudioLevelControlPropertyDecibelValue, kAudioObjectPropertyScopeGlobal, kAudioObjectPropertyElementMaster }
+	};
+
+	for (AudioObjectID theObjectID = kObjectID_Volume_Input_Master; theObjectID <= kObjectID_DataSource_Output_Master; ++theObjectID) {
+		if ((theChanged & (1u << theObjectID)) == 0) {
+			continue;
+		}
+
+		switch (theObjectID) {
+		case kObjectID_Volume_Input_Master:
+		case kObjectID_Volume_Output_Master:
+			theAddresses[0].mSelector = kAudioLevelControlPropertyScalarValue;
+			gPlugIn_Host->PropertiesChanged(gPlugIn_Host, theObjectID, 2, theAddresses);
+			break;
+
+		case kObjectID_Mute_Input_Master:
+		case kObjectID_Mute_Output_Master:
+			theAddresses[0].mSelector = kAudioBooleanControlPropertyValue;
+			gPlugIn_Host->PropertiesChanged(gPlugIn_Host, theObjectID, 1, theAddresses);
+			break;
+
+		case kObjectID_DataSource_Input_Master:
+		case kObjectID_DataSource_Output_Master:
+			theAddresses[0].mSelector = kAudioSelectorControlPropertyCurrentItem;
+			gPlugIn_Host->PropertiesChanged(gPlugIn_Host, theObjectID, 1, theAddresses);
+			break;
+		}
+	}
+}
+
+static void CaptainJack_ControlChanged(AudioObjectID inObjectID) {
+	//  the first change since the last notification schedules the next one; the rest just
+	//  ride along with it, so a control panel scrubbing a slider causes a few notifications
+	//  rather than one per value
+	if (__atomic_fetch_or(&gControls_Changed, 1u << inObjectID, __ATOMIC_ACQ_REL) == 0) {
+		dispatch_after_f(dispatch_time(DISPATCH_TIME_NOW, kControls_NotifyDelay), dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), NULL, &CaptainJack_NotifyControls);
+	}
+}
+
+#ifdef CAPTAIN_JACK_TRACE
+static void CaptainJack_OnTraceSignal(int inSignal) {
+	gTrace_Requested = 1;
+}
+
+static void CaptainJack_PollTrace(void *inContext) {
+	//  writing the rings out takes a while, so it happens here rather than on any of the HAL's
+	//  threads, and never under the state lock
+	if (gTrace_Requested) {
+		gTrace_Requested = 0;
+		CaptainJack_DumpTrace(kTrace_DevicePath);
+	}
+
+	dispatch_after_f(dispatch_time(DISPATCH_TIME_NOW, kTrace_PollDelay), dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), NULL, &CaptainJack_PollTrace);
+}
+#endif
+
+static inline const char *CaptainJack_IOOperationName(UInt32 inOperationID) {
+	//  trace names for the IO operations; they have to be literals, since only the pointer is kept
+	switch (inOperationID) {
+	case kAudioServerPlugInIOOperationThread:
+		return "Thread";
+	case kAudioServerPlugInIOOperationCycle:
+		return "Cycle";
+	case kAudioServerPlugInIOOperationReadInput:
+		return "ReadInput";
+	case kAudioServerPlugInIOOperationConvertInput:
+		return "ConvertInput";
+	case kAudioServerPlugInIOOperationProcessInput:
+		return "ProcessInput";
+	case kAudioServerPlugInIOOperationProcessOutput:
+		return "ProcessOutput";
+	case kAudioServerPlugInIOOperationMixOutput:
+		return "MixOutput";
+	case kAudioServerPlugInIOOperationProcessMix:
+		return "ProcessMix";
+	case kAudioServerPlugInIOOperationConvertMix:
+		return "ConvertMix";
+	case kAudioServerPlugInIOOperationWriteMix:
+		return "WriteMix";
+	default:
+		return "IOOperation";
+	}
+}
+
+static void CaptainJack_NotifySilence(void *inContext) {
+	//  sends whatever the slot's state is by the time this runs, rather than what it was when the
+	//  IO thread queued it, so even if two of these pass each other the last one sent is current
+	CaptainJack_ClientSilence *theClient = &gIO_Clients[(uintptr_t)inContext];
+	if (__atomic_load_n(&theClient->mUsed, __ATOMIC_ACQUIRE)) {
+		gXmitter->do_client_silence(theClient->mClientID, __atomic_load_n(&theClient->mSilent, __ATOMIC_ACQUIRE));
+	}
+}
+
+static void CaptainJack_TrackSilence(UInt32 inClientID, const Float32 *inBuffer, UInt32 inFrameCount) {
+	//  find the client's slot; only StartIO and StopIO change them
+	CaptainJack_ClientSilence *theClient = NULL;
+	for (UInt32 theIndex = 0; theIndex < kIO_MaxClients; ++theIndex) {
+		if (__atomic_load_n(&gIO_Clients[theIndex].mUsed, __ATOMIC_ACQUIRE) && gIO_Clients[theIndex].mClientID == inClientID) {
+			theClient = &gIO_Clients[theIndex];
+			break;
+		}
+	}
+
+	if (theClient == NULL) {
+		return;
+	}
+
+	bool theWasSilent = theClient->mSilent;
+	if (CaptainJack_IsSilent(inBuffer, inFrameCount * 2, kSilence_Threshold)) {
+		if (theClient->mQuietFrames < kSilence_HoldFrames) {
+			theClient->mQuietFrames += inFrameCount;
+		}
+		__atomic_store_n(&theClient->mSilent, theClient->mQuietFrames >= kSilence_HoldFrames, __ATOMIC_RELEASE);
+	} else {
+		theClient->mQuietFrames = 0;
+		__atomic_store_n(&theClient->mSilent, false, __ATOMIC_RELEASE);
+	}
+
+	//  the socket is no place for the IO thread, so the daemon hears about it from a queue
+	if (theClient->mSilent != theWasSilent) {
+		dispatch_async_f(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), (void *)(uintptr_t)(theClient - gIO_Clients), &CaptainJack_NotifySilence);
+	}
+}
+
+static void CaptainJack_EndConfigChange(UInt32 inNumberPropertiesChanged) {
+	//  setters only publish a new snapshot (and wait out its readers) if they changed something
+	if (inNumberPropertiesChanged > 0) {
+		CaptainJack_CommitConfig(&gDevice_Config);
+	} else {
+		CaptainJack_AbandonConfig(&gDevice_Config);
+	}
+}
+
+static void CaptainJack_RequestSampleRateChange(void *inContext) {
+	//  the context is the new sample rate
+	gPlugIn_Host->RequestDeviceConfigurationChange(gPlugIn_Host, kObjectID_Device, (UInt64)(uintptr_t)inContext, NULL);
+}
+
+static void CaptainJack_RequestFormatChange(void *inContext) {
+	//  the context is the change action in the high byte and the new format in the low one
+	UInt64 theChangeAction = (uintptr_t)inContext >> 8;
+	gPlugIn_Host->RequestDeviceConfigurationChange(gPlugIn_Host, kObjectID_Device, theChangeAction, (void *)((uintptr_t)inContext & 0xFF));
+}
+
+static void CaptainJack_FillFormat(AudioStreamBasicDescription *outFormat, Float64 inSampleRate, CaptainJack_SampleFormat inFormat) {
+	//  describes 2 channels of packed, native endian samples in the given format
+	UInt32 theBytesPerFrame = 2 * CaptainJack_SampleBytes(inFormat);
+	outFormat->mSampleRate = inSampleRate;
+	outFormat->mFormatID = kAudioFormatLinearPCM;
+	outFormat->mFormatFlags = ((inFormat == kSampleFormat_Float32) ? kAudioFormatFlagIsFloat : kAudioFormatFlagIsSignedInteger) | kAudioFormatFlagsNativeEndian | kAudioFormatFlagIsPacked;
+	outFormat->mBytesPerPacket = theBytesPerFrame;
+	outFormat->mFramesPerPacket = 1;
+	outFormat->mBytesPerFrame = theBytesPerFrame;
+	outFormat->mChannelsPerFrame = 2;
+	outFormat->mBitsPerChannel = CaptainJack_SampleBits(inFormat);
+}
+
+static bool CaptainJack_FindFormat(const AudioStreamBasicDescription *inFormat, CaptainJack_SampleFormat *outFormat) {
+	//  finds the physical format the description asks for, ignoring the sample rate
+	AudioStreamBasicDescription theFormat;
+
+	for (UInt32 theIndex = 0; theIndex < kStream_NumberPhysicalFormats; ++theIndex) {
+		CaptainJack_FillFormat(&theFormat, inFormat->mSampleRate, kStream_PhysicalFormats[theIndex]);
+
+		if ((inFormat->mFormatID == theFormat.mFormatID) && (inFormat->mFormatFlags == theFormat.mFormatFlags) && (inFormat->mBytesPerPacket == theFormat.mBytesPerPacket) && (inFormat->mFramesPerPacket == theFormat.mFramesPerPacket) && (inFormat->mBytesPerFrame == theFormat.mBytesPerFrame) && (inFormat->mChannelsPerFrame == theFormat.mChannelsPerFrame) && (inFormat->mBitsPerChannel == theFormat.mBitsPerChannel)) {
+			*outFormat = kStream_PhysicalFormats[theIndex];
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static UInt32 CaptainJack_FillAvailableFormats(AudioStreamRangedDescription *outFormats, UInt32 inNumberItems, bool inPhysical) {
+	//  every format at every sample rate; virtual formats are only ever float
+	UInt32 theNumberFormats = inPhysical ? kStream_NumberPhysicalFormats : 1;
+	UInt32 theItemIndex = 0;
+
+	for (UInt32 theFormatIndex = 0; theFormatIndex < theNumberFormats; ++theFormatIndex) {
+		for (UInt32 theRateIndex = 0; (theRateIndex < kStream_NumberSampleRates) && (theItemIndex < inNumberItems); ++theRateIndex, ++theItemIndex) {
+			CaptainJack_FillFormat(&outFormats[theItemIndex].mFormat, kStream_SampleRates[theRateIndex], kStream_PhysicalFormats[theFormatIndex]);
+			outFormats[theItemIndex].mSampleRateRange.mMinimum = kStream_SampleRates[theRateIndex];
+			outFormats[theItemIndex].mSampleRateRange.mMaximum = kStream_SampleRates[theRateIndex];
+		}
+	}
+
+	return theItemIndex;
+}
+
+
 void *CaptainJack_Create(CFAllocatorRef inAllocator, CFUUIDRef inRequestedTypeUUID) {
 #pragma unused(inAllocator)
 
+	//  CAPTAIN_JACK_PROPERTY_CACHE=1 answers immutable properties from the property cache. It's off by
+	//  default: most of those answers are constants that cost less to produce than to look up (see
+	//  bench-props).
+	const char *theCacheSetting = getenv("CAPTAIN_JACK_PROPERTY_CACHE");
+	gPlugIn_CacheProperties = theCacheSetting != NULL && strcmp(theCacheSetting, "1") == 0;
+
+	//  CAPTAIN_JACK_DITHER=1 adds TPDF dither when output is converted to a 16 or 24 bit physical
+	//  format.
+	const char *theDitherSetting = getenv("CAPTAIN_JACK_DITHER");
+	gPlugIn_Dither = theDitherSetting != NULL && strcmp(theDitherSetting, "1") == 0;
+	CaptainJack_SeedDither(&gIO_Output_Dither, 0x43a7);
+
 	if (CFEqual(inRequestedTypeUUID, kAudioServerPlugInTypeUUID)) {
 		return gAudioServerPlugInDriverRef;
 	}
@@ -254,10 +557,17 @@ static ULONG CaptainJack_Release(void *inDriver) {
 static OSStatus CaptainJack_Initialize(AudioServerPlugInDriverRef inDriver, AudioServerPlugInHostRef inHost) {
 	openlog("CaptainJack-Driver", LOG_CONS | LOG_NDELAY | LOG_PID, LOG_DAEMON);
 	setlogmask(0);
+	CaptainJack_StartLogger();
 	syslog(LOG_NOTICE, "Captain Jack is sailing the seas!");
 
 	gXmitter = CaptainJack_GetXmitterServer();
 
+#ifdef CAPTAIN_JACK_TRACE
+	//  `sudo killall -USR1 coreaudiod` writes out the trace rings, the same as for the daemon
+	signal(SIGUSR1, &CaptainJack_OnTraceSignal);
+	CaptainJack_PollTrace(NULL);
+#endif
+
 	if (inDriver != gAudioServerPlugInDriverRef) {
 		DebugMsg("CaptainJack_Initialize: bad driver reference");
 		return kAudioHardwareBadObjectError;
@@ -302,7 +612,9 @@ static OSStatus CaptainJack_Initialize(AudioServerPlugInDriverRef inDriver, Audi
 
 	theHostClockFrequency *= 1000000000.0;
 
-	gDevice_HostTicksPerFrame = theHostClockFrequency / gDevice_SampleRate;
+	CaptainJack_Config *theConfig = CaptainJack_BeginConfig(&gDevice_Config);
+	theConfig->hostTicksPerFrame = theHostClockFrequency / theConfig->sampleRate;
+	CaptainJack_CommitConfig(&gDevice_Config);
 
 	gXmitter->do_device_ready();
 
@@ -368,7 +680,6 @@ static OSStatus CaptainJack_RemoveDeviceClient(AudioServerPlugInDriverRef inDriv
 }
 
 static OSStatus CaptainJack_PerformDeviceConfigurationChange(AudioServerPlugInDriverRef inDriver, AudioObjectID inDeviceObjectID, UInt64 inChangeAction, void *inChangeInfo) {
-#pragma unused(inChangeInfo)
 
 	//  This method is called to tell the device that it can perform the configuation change that it
 	//  had requested via a call to the host method, RequestDeviceConfigurationChange(). The
@@ -389,19 +700,41 @@ static OSStatus CaptainJack_PerformDeviceConfigurationChange(AudioServerPlugInDr
 		return kAudioHardwareBadObjectError;
 	}
 
+	//  physical format changes carry the new format in the change info
+	if ((inChangeAction == kChangeAction_InputFormat) || (inChangeAction == kChangeAction_OutputFormat)) {
+		if ((uintptr_t)inChangeInfo >= kSampleFormat_Count) {
+			DebugMsg("CaptainJack_PerformDeviceConfigurationChange: bad format");
+			return kAudioHardwareBadObjectError;
+		}
+
+		CaptainJack_Config *theConfig = CaptainJack_BeginConfig(&gDevice_Config);
+
+		if (inChangeAction == kChangeAction_InputFormat) {
+			theConfig->inputFormat = (CaptainJack_SampleFormat)(uintptr_t)inChangeInfo;
+		} else {
+			theConfig->outputFormat = (CaptainJack_SampleFormat)(uintptr_t)inChangeInfo;
+		}
+
+		CaptainJack_CommitConfig(&gDevice_Config);
+		return 0;
+	}
+
+	//  anything else is a sample rate change
 	if ((inChangeAction != 44100) && (inChangeAction != 48000)) {
 		DebugMsg("CaptainJack_PerformDeviceConfigurationChange: bad sample rate");
 		return kAudioHardwareBadObjectError;
 	}
 
-	pthread_mutex_lock(&gPlugIn_StateMutex);
-	gDevice_SampleRate = inChangeAction;
 	struct mach_timebase_info theTimeBaseInfo;
 	mach_timebase_info(&theTimeBaseInfo);
 	Float64 theHostClockFrequency = theTimeBaseInfo.denom / theTimeBaseInfo.numer;
 	theHostClockFrequency *= 1000000000.0;
-	gDevice_HostTicksPerFrame = theHostClockFrequency / gDevice_SampleRate;
-	pthread_mutex_unlock(&gPlugIn_StateMutex);
+
+	//  the rate and the tick ratio that depends on it are published together
+	CaptainJack_Config *theConfig = CaptainJack_BeginConfig(&gDevice_Config);
+	theConfig->sampleRate = inChangeAction;
+	theConfig->hostTicksPerFrame = theHostClockFrequency / theConfig->sampleRate;
+	CaptainJack_CommitConfig(&gDevice_Config);
 	return 0;
 }
 
@@ -424,6 +757,64 @@ static OSStatus CaptainJack_AbortDeviceConfigurationChange(AudioServerPlugInDriv
 	return 0;
 }
 
+//  Answers to these never change for the life of the driver, so once one has been computed it
+//  can be handed straight back out of the property cache. Anything that depends on the box being
+//  acquired, the sample rate, IO state or a control's value must not be listed here, and neither
+//  can anything that takes a qualifier (those are never cached).
+static bool CaptainJack_IsPropertyImmutable(AudioObjectID inObjectID, const AudioObjectPropertyAddress *inAddress) {
+	switch (inAddress->mSelector) {
+	case kAudioObjectPropertyBaseClass:
+	case kAudioObjectPropertyClass:
+	case kAudioObjectPropertyOwner:
+	case kAudioObjectPropertyModelName:
+	case kAudioObjectPropertyManufacturer:
+	case kAudioObjectPropertySerialNumber:
+	case kAudioObjectPropertyFirmwareVersion:
+	case kAudioObjectPropertyControlList:
+	case kAudioPlugInPropertyResourceBundle:
+	case kAudioBoxPropertyBoxUID:
+	case kAudioBoxPropertyHasAudio:
+	case kAudioBoxPropertyHasVideo:
+	case kAudioBoxPropertyHasMIDI:
+	case kAudioBoxPropertyIsProtected:
+	case kAudioDevicePropertyDeviceUID:
+	case kAudioDevicePropertyModelUID:
+	case kAudioDevicePropertyTransportType:
+	case kAudioDevicePropertyRelatedDevices:
+	case kAudioDevicePropertyClockDomain:
+	case kAudioDevicePropertyDeviceCanBeDefaultDevice:
+	case kAudioDevicePropertyDeviceCanBeDefaultSystemDevice:
+	case kAudioDevicePropertyLatency:
+	case kAudioDevicePropertyStreams:
+	case kAudioDevicePropertySafetyOffset:
+	case kAudioDevicePropertyAvailableNominalSampleRates:
+	case kAudioDevicePropertyIsHidden:
+	case kAudioDevicePropertyPreferredChannelsForStereo:
+	case kAudioDevicePropertyPreferredChannelLayout:
+	case kAudioDevicePropertyZeroTimeStampPeriod:
+	case kAudioStreamPropertyDirection:
+	case kAudioStreamPropertyTerminalType:
+	case kAudioStreamPropertyStartingChannel:
+	case kAudioStreamPropertyAvailableVirtualFormats:
+	case kAudioStreamPropertyAvailablePhysicalFormats:
+	case kAudioControlPropertyScope:
+	case kAudioControlPropertyElement:
+	case kAudioLevelControlPropertyDecibelRange:
+	case kAudioSelectorControlPropertyAvailableItems:
+		return true;
+
+	case kAudioObjectPropertyName:
+		//  the box can be renamed
+		return inObjectID != kObjectID_Box;
+
+	case kAudioObjectPropertyOwnedObjects:
+		//  the plug-in only owns the device while the box is acquired
+		return inObjectID != kObjectID_PlugIn;
+	};
+
+	return false;
+}
+
 static Boolean CaptainJack_HasProperty(AudioServerPlugInDriverRef inDriver, AudioObjectID inObjectID, pid_t inClientProcessID, const AudioObjectPropertyAddress *inAddress) {
 	if (inDriver != gAudioServerPlugInDriverRef) {
 		DebugMsg("CaptainJack_HasProperty: bad driver reference");
@@ -519,6 +910,13 @@ static OSStatus CaptainJack_GetPropertyDataSize(AudioServerPlugInDriverRef inDri
 		return kAudioHardwareIllegalOperationError;
 	}
 
+	if (gPlugIn_CacheProperties && inQualifierDataSize == 0 && CaptainJack_IsPropertyImmutable(inObjectID, inAddress)) {
+		CaptainJack_PropertyKey theKey = { inObjectID, inAddress->mSelector, inAddress->mScope, inAddress->mElement };
+		if (CaptainJack_LookupProperty(&theKey, 0, outDataSize, NULL)) {
+			return 0;
+		}
+	}
+
 	switch (inObjectID) {
 	case kObjectID_PlugIn:
 		return CaptainJack_GetPlugInPropertyDataSize(inDriver, inObjectID, inClientProcessID, inAddress, inQualifierDataSize, inQualifierData, outDataSize);
@@ -567,19 +965,32 @@ static OSStatus CaptainJack_GetPropertyData(AudioServerPlugInDriverRef inDriver,
 		return kAudioHardwareIllegalOperationError;
 	}
 
+	CaptainJack_PropertyKey theKey = { inObjectID, inAddress->mSelector, inAddress->mScope, inAddress->mElement };
+	bool theIsCacheable = gPlugIn_CacheProperties && inQualifierDataSize == 0 && CaptainJack_IsPropertyImmutable(inObjectID, inAddress);
+
+	if (theIsCacheable && CaptainJack_LookupProperty(&theKey, inDataSize, outDataSize, outData)) {
+		return 0;
+	}
+
+	OSStatus theAnswer = 0;
+
 	switch (inObjectID) {
 	case kObjectID_PlugIn:
-		return CaptainJack_GetPlugInPropertyData(inDriver, inObjectID, inClientProcessID, inAddress, inQualifierDataSize, inQualifierData, inDataSize, outDataSize, outData);
+		theAnswer = CaptainJack_GetPlugInPropertyData(inDriver, inObjectID, inClientProcessID, inAddress, inQualifierDataSize, inQualifierData, inDataSize, outDataSize, outData);
+		break;
 
 	case kObjectID_Box:
-		return CaptainJack_GetBoxPropertyData(inDriver, inObjectID, inClientProcessID, inAddress, inQualifierDataSize, inQualifierData, inDataSize, outDataSize, outData);
+		theAnswer = CaptainJack_GetBoxPropertyData(inDriver, inObjectID, inClientProcessID, inAddress, inQualifierDataSize, inQualifierData, inDataSize, outDataSize, outData);
+		break;
 
 	case kObjectID_Device:
-		return CaptainJack_GetDevicePropertyData(inDriver, inObjectID, inClientProcessID, inAddress, inQualifierDataSize, inQualifierData, inDataSize, outDataSize, outData);
+		theAnswer = CaptainJack_GetDevicePropertyData(inDriver, inObjectID, inClientProcessID, inAddress, inQualifierDataSize, inQualifierData, inDataSize, outDataSize, outData);
+		break;
 
 	case kObjectID_Stream_Input:
 	case kObjectID_Stream_Output:
-		return CaptainJack_GetStreamPropertyData(inDriver, inObjectID, inClientProcessID, inAddress, inQualifierDataSize, inQualifierData, inDataSize, outDataSize, outData);
+		theAnswer = CaptainJack_GetStreamPropertyData(inDriver, inObjectID, inClientProcessID, inAddress, inQualifierDataSize, inQualifierData, inDataSize, outDataSize, outData);
+		break;
 
 	case kObjectID_Volume_Input_Master:
 	case kObjectID_Volume_Output_Master:
@@ -587,10 +998,21 @@ static OSStatus CaptainJack_GetPropertyData(AudioServerPlugInDriverRef inDriver,
 	case kObjectID_Mute_Output_Master:
 	case kObjectID_DataSource_Input_Master:
 	case kObjectID_DataSource_Output_Master:
-		return CaptainJack_GetControlPropertyData(inDriver, inObjectID, inClientProcessID, inAddress, inQualifierDataSize, inQualifierData, inDataSize, outDataSize, outData);
+		theAnswer = CaptainJack_GetControlPropertyData(inDriver, inObjectID, inClientProcessID, inAddress, inQualifierDataSize, inQualifierData, inDataSize, outDataSize, outData);
+		break;
+
+	default:
+		return kAudioHardwareBadObjectError;
 	};
 
-	return kAudioHardwareBadObjectError;
+	//  list properties are allowed to come back truncated, so only cache an answer if it's the whole thing
+	UInt32 theFullSize = 0;
+
+	if (theAnswer == 0 && theIsCacheable && CaptainJack_GetPropertyDataSize(inDriver, inObjectID, inClientProcessID, inAddress, 0, NULL, &theFullSize) == 0 && theFullSize == *outDataSize) {
+		CaptainJack_CacheProperty(&theKey, *outDataSize, outData);
+	}
+
+	return theAnswer;
 }
 
 static OSStatus CaptainJack_SetPropertyData(AudioServerPlugInDriverRef inDriver, AudioObjectID inObjectID, pid_t inClientProcessID, const AudioObjectPropertyAddress *inAddress, UInt32 inQualifierDataSize, const void *inQualifierData, UInt32 inDataSize, const void *inData) {
@@ -611,16 +1033,20 @@ static OSStatus CaptainJack_SetPropertyData(AudioServerPlugInDriverRef inDriver,
 	switch (inObjectID) {
 	case kObjectID_PlugIn:
 		status = CaptainJack_SetPlugInPropertyData(inDriver, inObjectID, inClientProcessID, inAddress, inQualifierDataSize, inQualifierData, inDataSize, inData, &theNumberPropertiesChanged, theChangedAddresses);
+		break;
 
 	case kObjectID_Box:
 		status = CaptainJack_SetBoxPropertyData(inDriver, inObjectID, inClientProcessID, inAddress, inQualifierDataSize, inQualifierData, inDataSize, inData, &theNumberPropertiesChanged, theChangedAddresses);
+		break;
 
 	case kObjectID_Device:
 		status = CaptainJack_SetDevicePropertyData(inDriver, inObjectID, inClientProcessID, inAddress, inQualifierDataSize, inQualifierData, inDataSize, inData, &theNumberPropertiesChanged, theChangedAddresses);
+		break;
 
 	case kObjectID_Stream_Input:
 	case kObjectID_Stream_Output:
 		status = CaptainJack_SetStreamPropertyData(inDriver, inObjectID, inClientProcessID, inAddress, inQualifierDataSize, inQualifierData, inDataSize, inData, &theNumberPropertiesChanged, theChangedAddresses);
+		break;
 
 	case kObjectID_Volume_Input_Master:
 	case kObjectID_Volume_Output_Master:
@@ -629,6 +1055,7 @@ static OSStatus CaptainJack_SetPropertyData(AudioServerPlugInDriverRef inDriver,
 	case kObjectID_DataSource_Input_Master:
 	case kObjectID_DataSource_Output_Master:
 		status = CaptainJack_SetControlPropertyData(inDriver, inObjectID, inClientProcessID, inAddress, inQualifierDataSize, inQualifierData, inDataSize, inData, &theNumberPropertiesChanged, theChangedAddresses);
+		break;
 
 	default:
 		return kAudioHardwareBadObjectError;
@@ -1671,17 +2098,14 @@ static OSStatus CaptainJack_SetBoxPropertyData(AudioServerPlugInDriverRef inDriv
 		//  of this property should only send the notificaiton if the hardware wants the app to
 		//  flash it's UI for the device.
 	{
-		syslog(LOG_NOTICE, "The identify property has been set on the Box implemented by the CaptainJack driver.");
+		DebugMsg("The identify property has been set on the Box implemented by the CaptainJack driver.");
 
 		if (inDataSize != sizeof(UInt32)) {
 			DebugMsg("CaptainJack_SetBoxPropertyData: wrong size for the data for kAudioObjectPropertyIdentify");
 			return kAudioHardwareBadPropertySizeError;
 		}
 
-		dispatch_after(dispatch_time(0, 2ULL * 1000ULL * 1000ULL * 1000ULL), dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^() {
-			AudioObjectPropertyAddress theAddress = { kAudioObjectPropertyIdentify, kAudioObjectPropertyScopeGlobal, kAudioObjectPropertyElementMaster };
-			gPlugIn_Host->PropertiesChanged(gPlugIn_Host, kObjectID_Box, 1, &theAddress);
-		});
+		dispatch_after_f(dispatch_time(0, 2ULL * 1000ULL * 1000ULL * 1000ULL), dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), NULL, &CaptainJack_NotifyBoxIdentify);
 	}
 	break;
 
@@ -1708,10 +2132,7 @@ static OSStatus CaptainJack_SetBoxPropertyData(AudioServerPlugInDriverRef inDriv
 			outChangedAddresses[1].mScope = kAudioObjectPropertyScopeGlobal;
 			outChangedAddresses[1].mElement = kAudioObjectPropertyElementMaster;
 			//  but it also means that the device list has changed for the plug-in too
-			dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0),   ^() {
-				AudioObjectPropertyAddress theAddress = { kAudioPlugInPropertyDeviceList, kAudioObjectPropertyScopeGlobal, kAudioObjectPropertyElementMaster };
-				gPlugIn_Host->PropertiesChanged(gPlugIn_Host, kObjectID_PlugIn, 1, &theAddress);
-			});
+			dispatch_async_f(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), NULL, &CaptainJack_NotifyPlugInDeviceList);
 		}
 
 		pthread_mutex_unlock(&gPlugIn_StateMutex);
@@ -2029,6 +2450,7 @@ static OSStatus CaptainJack_GetDevicePropertyData(AudioServerPlugInDriverRef inD
 #pragma unused(inClientProcessID, inQualifierDataSize, inQualifierData)
 	//  declare the local variables
 	OSStatus theAnswer = 0;
+	CaptainJack_Config theConfig;
 	UInt32 theNumberItemsToFetch;
 	UInt32 theItemIndex;
 
@@ -2438,15 +2860,14 @@ static OSStatus CaptainJack_GetDevicePropertyData(AudioServerPlugInDriverRef inD
 	case kAudioDevicePropertyNominalSampleRate:
 
 		//  This property returns the nominal sample rate of the device. Note that we
-		//  only need to take the state lock to get this value.
+		//  read it from the current configuration snapshot rather than taking the state lock.
 		if (inDataSize < sizeof(Float64)) {
 			DebugMsg("CaptainJack_GetDevicePropertyData: not enough space for the return value of kAudioDevicePropertyNominalSampleRate for the device");
 			return kAudioHardwareBadPropertySizeError;
 		}
 
-		pthread_mutex_lock(&gPlugIn_StateMutex);
-		*((Float64 *)outData) = gDevice_SampleRate;
-		pthread_mutex_unlock(&gPlugIn_StateMutex);
+		CaptainJack_ReadConfig(&gDevice_Config, &theConfig);
+		*((Float64 *)outData) = theConfig.sampleRate;
 		*outDataSize = sizeof(Float64);
 		break;
 
@@ -2635,15 +3056,14 @@ static OSStatus CaptainJack_SetDevicePropertyData(AudioServerPlugInDriverRef inD
 		}
 
 		//  make sure that the new value is different than the old value
-		pthread_mutex_lock(&gPlugIn_StateMutex);
-		theOldSampleRate = gDevice_SampleRate;
-		pthread_mutex_unlock(&gPlugIn_StateMutex);
+		theOldSampleRate = CaptainJack_BeginRead(&gDevice_Config)->sampleRate;
+		CaptainJack_EndRead();
 
 		if (*((const Float64 *)inData) != theOldSampleRate) {
 			//  we dispatch this so that the change can happen asynchronously
 			theOldSampleRate = *((const Float64 *)inData);
 			theNewSampleRate = (UInt64)theOldSampleRate;
-			dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^ { gPlugIn_Host->RequestDeviceConfigurationChange(gPlugIn_Host, kObjectID_Device, theNewSampleRate, NULL); });
+			dispatch_async_f(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), (void *)(uintptr_t)theNewSampleRate, &CaptainJack_RequestSampleRateChange);
 		}
 
 		break;
@@ -2832,8 +3252,11 @@ static OSStatus CaptainJack_GetStreamPropertyDataSize(AudioServerPlugInDriverRef
 		break;
 
 	case kAudioStreamPropertyAvailableVirtualFormats:
+		*outDataSize = kStream_NumberSampleRates * sizeof(AudioStreamRangedDescription);
+		break;
+
 	case kAudioStreamPropertyAvailablePhysicalFormats:
-		*outDataSize = 2 * sizeof(AudioStreamRangedDescription);
+		*outDataSize = kStream_NumberPhysicalFormats * kStream_NumberSampleRates * sizeof(AudioStreamRangedDescription);
 		break;
 
 	default:
@@ -2847,6 +3270,7 @@ static OSStatus CaptainJack_GetStreamPropertyData(AudioServerPlugInDriverRef inD
 #pragma unused(inClientProcessID, inQualifierDataSize, inQualifierData)
 	//  declare the local variables
 	OSStatus theAnswer = 0;
+	CaptainJack_Config theConfig;
 	UInt32 theNumberItemsToFetch;
 
 	//  check the arguments
@@ -2925,16 +3349,15 @@ static OSStatus CaptainJack_GetStreamPropertyData(AudioServerPlugInDriverRef inD
 	case kAudioStreamPropertyIsActive:
 
 		//  This property tells the device whether or not the given stream is going to
-		//  be used for IO. Note that we need to take the state lock to examine this
-		//  value.
+		//  be used for IO. Note that this value comes from the current
+		//  configuration snapshot.
 		if (inDataSize < sizeof(UInt32)) {
 			DebugMsg("CaptainJack_GetStreamPropertyData: not enough space for the return value of kAudioStreamPropertyIsActive for the stream");
 			return kAudioHardwareBadPropertySizeError;
 		}
 
-		pthread_mutex_lock(&gPlugIn_StateMutex);
-		*((UInt32 *)outData) = (inObjectID == kObjectID_Stream_Input) ? gStream_Input_IsActive : gStream_Output_IsActive;
-		pthread_mutex_unlock(&gPlugIn_StateMutex);
+		CaptainJack_ReadConfig(&gDevice_Config, &theConfig);
+		*((UInt32 *)outData) = (inObjectID == kObjectID_Stream_Input) ? theConfig.inputActive : theConfig.outputActive;
 		*outDataSize = sizeof(UInt32);
 		break;
 
@@ -2995,25 +3418,24 @@ static OSStatus CaptainJack_GetStreamPropertyData(AudioServerPlugInDriverRef inD
 	case kAudioStreamPropertyPhysicalFormat:
 
 		//  This returns the current format of the stream in an
-		//  AudioStreamBasicDescription. Note that we need to hold the state lock to get
-		//  this value.
-		//  Note that for devices that don't override the mix operation, the virtual
-		//  format has to be the same as the physical format.
+		//  AudioStreamBasicDescription. Note that the sample rate and physical format come
+		//  from the current configuration snapshot.
+		//  The virtual format is always 32 bit float. The physical format can be an integer
+		//  format too, in which case the device does the ConvertInput and ConvertMix
+		//  operations itself.
 		if (inDataSize < sizeof(AudioStreamBasicDescription)) {
 			DebugMsg("CaptainJack_GetStreamPropertyData: not enough space for the return value of kAudioStreamPropertyVirtualFormat for the stream");
 			return kAudioHardwareBadPropertySizeError;
 		}
 
-		pthread_mutex_lock(&gPlugIn_StateMutex);
-		((AudioStreamBasicDescription *)outData)->mSampleRate = gDevice_SampleRate;
-		((AudioStreamBasicDescription *)outData)->mFormatID = kAudioFormatLinearPCM;
-		((AudioStreamBasicDescription *)outData)->mFormatFlags = kAudioFormatFlagIsFloat | kAudioFormatFlagsNativeEndian | kAudioFormatFlagIsPacked;
-		((AudioStreamBasicDescription *)outData)->mBytesPerPacket = 8;
-		((AudioStreamBasicDescription *)outData)->mFramesPerPacket = 1;
-		((AudioStreamBasicDescription *)outData)->mBytesPerFrame = 8;
-		((AudioStreamBasicDescription *)outData)->mChannelsPerFrame = 2;
-		((AudioStreamBasicDescription *)outData)->mBitsPerChannel = 32;
-		pthread_mutex_unlock(&gPlugIn_StateMutex);
+		CaptainJack_ReadConfig(&gDevice_Config, &theConfig);
+
+		if (inAddress->mSelector == kAudioStreamPropertyVirtualFormat) {
+			CaptainJack_FillFormat((AudioStreamBasicDescription *)outData, theConfig.sampleRate, kSampleFormat_Float32);
+		} else {
+			CaptainJack_FillFormat((AudioStreamBasicDescription *)outData, theConfig.sampleRate, (inObjectID == kObjectID_Stream_Input) ? theConfig.inputFormat : theConfig.outputFormat);
+		}
+
 		*outDataSize = sizeof(AudioStreamBasicDescription);
 		break;
 
@@ -3026,37 +3448,8 @@ static OSStatus CaptainJack_GetStreamPropertyData(AudioServerPlugInDriverRef inD
 		//  case, only that number of items will be returned
 		theNumberItemsToFetch = inDataSize / sizeof(AudioStreamRangedDescription);
 
-		//  clamp it to the number of items we have
-		if (theNumberItemsToFetch > 2) {
-			theNumberItemsToFetch = 2;
-		}
-
-		//  fill out the return array
-		if (theNumberItemsToFetch > 0) {
-			((AudioStreamRangedDescription *)outData)[0].mFormat.mSampleRate = 44100.0;
-			((AudioStreamRangedDescription *)outData)[0].mFormat.mFormatID = kAudioFormatLinearPCM;
-			((AudioStreamRangedDescription *)outData)[0].mFormat.mFormatFlags = kAudioFormatFlagIsFloat | kAudioFormatFlagsNativeEndian | kAudioFormatFlagIsPacked;
-			((AudioStreamRangedDescription *)outData)[0].mFormat.mBytesPerPacket = 8;
-			((AudioStreamRangedDescription *)outData)[0].mFormat.mFramesPerPacket = 1;
-			((AudioStreamRangedDescription *)outData)[0].mFormat.mBytesPerFrame = 8;
-			((AudioStreamRangedDescription *)outData)[0].mFormat.mChannelsPerFrame = 2;
-			((AudioStreamRangedDescription *)outData)[0].mFormat.mBitsPerChannel = 32;
-			((AudioStreamRangedDescription *)outData)[0].mSampleRateRange.mMinimum = 44100.0;
-			((AudioStreamRangedDescription *)outData)[0].mSampleRateRange.mMaximum = 44100.0;
-		}
-
-		if (theNumberItemsToFetch > 1) {
-			((AudioStreamRangedDescription *)outData)[1].mFormat.mSampleRate = 48000.0;
-			((AudioStreamRangedDescription *)outData)[1].mFormat.mFormatID = kAudioFormatLinearPCM;
-			((AudioStreamRangedDescription *)outData)[1].mFormat.mFormatFlags = kAudioFormatFlagIsFloat | kAudioFormatFlagsNativeEndian | kAudioFormatFlagIsPacked;
-			((AudioStreamRangedDescription *)outData)[1].mFormat.mBytesPerPacket = 8;
-			((AudioStreamRangedDescription *)outData)[1].mFormat.mFramesPerPacket = 1;
-			((AudioStreamRangedDescription *)outData)[1].mFormat.mBytesPerFrame = 8;
-			((AudioStreamRangedDescription *)outData)[1].mFormat.mChannelsPerFrame = 2;
-			((AudioStreamRangedDescription *)outData)[1].mFormat.mBitsPerChannel = 32;
-			((AudioStreamRangedDescription *)outData)[1].mSampleRateRange.mMinimum = 48000.0;
-			((AudioStreamRangedDescription *)outData)[1].mSampleRateRange.mMaximum = 48000.0;
-		}
+		//  fill out the return array (which clamps it to the number of items we have)
+		theNumberItemsToFetch = CaptainJack_FillAvailableFormats((AudioStreamRangedDescription *)outData, theNumberItemsToFetch, inAddress->mSelector == kAudioStreamPropertyAvailablePhysicalFormats);
 
 		//  report how much we wrote
 		*outDataSize = theNumberItemsToFetch * sizeof(AudioStreamRangedDescription);
@@ -3073,8 +3466,11 @@ static OSStatus CaptainJack_SetStreamPropertyData(AudioServerPlugInDriverRef inD
 #pragma unused(inClientProcessID, inQualifierDataSize, inQualifierData)
 	//  declare the local variables
 	OSStatus theAnswer = 0;
+	CaptainJack_Config *theConfig;
 	Float64 theOldSampleRate;
 	UInt64 theNewSampleRate;
+	CaptainJack_SampleFormat theOldFormat;
+	CaptainJack_SampleFormat theNewFormat;
 
 	//  check the arguments
 	if (inDriver != gAudioServerPlugInDriverRef) {
@@ -3118,19 +3514,19 @@ static OSStatus CaptainJack_SetStreamPropertyData(AudioServerPlugInDriverRef inD
 			return kAudioHardwareBadPropertySizeError;
 		}
 
-		pthread_mutex_lock(&gPlugIn_StateMutex);
+		theConfig = CaptainJack_BeginConfig(&gDevice_Config);
 
 		if (inObjectID == kObjectID_Stream_Input) {
-			if (gStream_Input_IsActive != (*((const UInt32 *)inData) != 0)) {
-				gStream_Input_IsActive = *((const UInt32 *)inData) != 0;
+			if (theConfig->inputActive != (*((const UInt32 *)inData) != 0)) {
+				theConfig->inputActive = *((const UInt32 *)inData) != 0;
 				*outNumberPropertiesChanged = 1;
 				outChangedAddresses[0].mSelector = kAudioStreamPropertyIsActive;
 				outChangedAddresses[0].mScope = kAudioObjectPropertyScopeGlobal;
 				outChangedAddresses[0].mElement = kAudioObjectPropertyElementMaster;
 			}
 		} else {
-			if (gStream_Output_IsActive != (*((const UInt32 *)inData) != 0)) {
-				gStream_Output_IsActive = *((const UInt32 *)inData) != 0;
+			if (theConfig->outputActive != (*((const UInt32 *)inData) != 0)) {
+				theConfig->outputActive = *((const UInt32 *)inData) != 0;
 				*outNumberPropertiesChanged = 1;
 				outChangedAddresses[0].mSelector = kAudioStreamPropertyIsActive;
 				outChangedAddresses[0].mScope = kAudioObjectPropertyScopeGlobal;
@@ -3138,53 +3534,23 @@ static OSStatus CaptainJack_SetStreamPropertyData(AudioServerPlugInDriverRef inD
 			}
 		}
 
-		pthread_mutex_unlock(&gPlugIn_StateMutex);
+		CaptainJack_EndConfigChange(*outNumberPropertiesChanged);
 		break;
 
 	case kAudioStreamPropertyVirtualFormat:
 	case kAudioStreamPropertyPhysicalFormat:
 
 		//  Changing the stream format needs to be handled via the
-		//  RequestConfigChange/PerformConfigChange machinery. Note that because this
-		//  device only supports 2 channel 32 bit float data, the only thing that can
-		//  change is the sample rate.
+		//  RequestConfigChange/PerformConfigChange machinery. The virtual format is always
+		//  2 channel 32 bit float, so only its sample rate can change; the physical format
+		//  can also be one of the integer formats.
 		if (inDataSize != sizeof(AudioStreamBasicDescription)) {
 			DebugMsg("CaptainJack_SetStreamPropertyData: wrong size for the data for kAudioStreamPropertyPhysicalFormat");
 			return kAudioHardwareBadPropertySizeError;
 		}
 
-		if (((const AudioStreamBasicDescription *)inData)->mFormatID != kAudioFormatLinearPCM) {
-			DebugMsg("CaptainJack_SetStreamPropertyData: unsupported format ID for kAudioStreamPropertyPhysicalFormat");
-			return kAudioDeviceUnsupportedFormatError;
-		}
-
-		if (((const AudioStreamBasicDescription *)inData)->mFormatFlags != (kAudioFormatFlagIsFloat | kAudioFormatFlagsNativeEndian | kAudioFormatFlagIsPacked)) {
-			DebugMsg("CaptainJack_SetStreamPropertyData: unsupported format flags for kAudioStreamPropertyPhysicalFormat");
-			return kAudioDeviceUnsupportedFormatError;
-		}
-
-		if (((const AudioStreamBasicDescription *)inData)->mBytesPerPacket != 8) {
-			DebugMsg("CaptainJack_SetStreamPropertyData: unsupported bytes per packet for kAudioStreamPropertyPhysicalFormat");
-			return kAudioDeviceUnsupportedFormatError;
-		}
-
-		if (((const AudioStreamBasicDescription *)inData)->mFramesPerPacket != 1) {
-			DebugMsg("CaptainJack_SetStreamPropertyData: unsupported frames per packet for kAudioStreamPropertyPhysicalFormat");
-			return kAudioDeviceUnsupportedFormatError;
-		}
-
-		if (((const AudioStreamBasicDescription *)inData)->mBytesPerFrame != 8) {
-			DebugMsg("CaptainJack_SetStreamPropertyData: unsupported bytes per frame for kAudioStreamPropertyPhysicalFormat");
-			return kAudioDeviceUnsupportedFormatError;
-		}
-
-		if (((const AudioStreamBasicDescription *)inData)->mChannelsPerFrame != 2) {
-			DebugMsg("CaptainJack_SetStreamPropertyData: unsupported channels per frame for kAudioStreamPropertyPhysicalFormat");
-			return kAudioDeviceUnsupportedFormatError;
-		}
-
-		if (((const AudioStreamBasicDescription *)inData)->mBitsPerChannel != 32) {
-			DebugMsg("CaptainJack_SetStreamPropertyData: unsupported bits per channel for kAudioStreamPropertyPhysicalFormat");
+		if (!CaptainJack_FindFormat((const AudioStreamBasicDescription *)inData, &theNewFormat) || ((inAddress->mSelector == kAudioStreamPropertyVirtualFormat) && (theNewFormat != kSampleFormat_Float32))) {
+			DebugMsg("CaptainJack_SetStreamPropertyData: unsupported format for kAudioStreamPropertyPhysicalFormat");
 			return kAudioDeviceUnsupportedFormatError;
 		}
 
@@ -3193,16 +3559,27 @@ static OSStatus CaptainJack_SetStreamPropertyData(AudioServerPlugInDriverRef inD
 			return kAudioHardwareIllegalOperationError;
 		}
 
+		//  the physical format changes on its own, separately from the sample rate below
+		if (inAddress->mSelector == kAudioStreamPropertyPhysicalFormat) {
+			const CaptainJack_Config *theCurrentConfig = CaptainJack_BeginRead(&gDevice_Config);
+			theOldFormat = (inObjectID == kObjectID_Stream_Input) ? theCurrentConfig->inputFormat : theCurrentConfig->outputFormat;
+			CaptainJack_EndRead();
+
+			if (theNewFormat != theOldFormat) {
+				uintptr_t theChange = (((inObjectID == kObjectID_Stream_Input) ? kChangeAction_InputFormat : kChangeAction_OutputFormat) << 8) | theNewFormat;
+				dispatch_async_f(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), (void *)theChange, &CaptainJack_RequestFormatChange);
+			}
+		}
+
 		//  If we made it this far, the requested format is something we support, so make sure the sample rate is actually different
-		pthread_mutex_lock(&gPlugIn_StateMutex);
-		theOldSampleRate = gDevice_SampleRate;
-		pthread_mutex_unlock(&gPlugIn_StateMutex);
+		theOldSampleRate = CaptainJack_BeginRead(&gDevice_Config)->sampleRate;
+		CaptainJack_EndRead();
 
 		if (((const AudioStreamBasicDescription *)inData)->mSampleRate != theOldSampleRate) {
 			//  we dispatch this so that the change can happen asynchronously
 			theOldSampleRate = ((const AudioStreamBasicDescription *)inData)->mSampleRate;
 			theNewSampleRate = (UInt64)theOldSampleRate;
-			dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^ { gPlugIn_Host->RequestDeviceConfigurationChange(gPlugIn_Host, kObjectID_Device, theNewSampleRate, NULL); });
+			dispatch_async_f(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), (void *)(uintptr_t)theNewSampleRate, &CaptainJack_RequestSampleRateChange);
 		}
 
 		break;
@@ -3670,30 +4047,26 @@ static OSStatus CaptainJack_GetControlPropertyData(AudioServerPlugInDriverRef in
 		case kAudioLevelControlPropertyScalarValue:
 
 			//  This returns the value of the control in the normalized range of 0 to 1.
-			//  Note that we need to take the state lock to examine the value.
+			//  Note that the value is read atomically rather than under the state lock.
 			if (inDataSize < sizeof(Float32)) {
 				DebugMsg("CaptainJack_GetControlPropertyData: not enough space for the return value of kAudioLevelControlPropertyScalarValue for the volume control");
 				return kAudioHardwareBadPropertySizeError;
 			}
 
-			pthread_mutex_lock(&gPlugIn_StateMutex);
-			*((Float32 *)outData) = (inObjectID == kObjectID_Volume_Input_Master) ? gVolume_Input_Master_Value : gVolume_Output_Master_Value;
-			pthread_mutex_unlock(&gPlugIn_StateMutex);
+			__atomic_load((inObjectID == kObjectID_Volume_Input_Master) ? &gVolume_Input_Master_Value : &gVolume_Output_Master_Value, (Float32 *)outData, __ATOMIC_RELAXED);
 			*outDataSize = sizeof(Float32);
 			break;
 
 		case kAudioLevelControlPropertyDecibelValue:
 
 			//  This returns the dB value of the control.
-			//  Note that we need to take the state lock to examine the value.
+			//  Note that the value is read atomically rather than under the state lock.
 			if (inDataSize < sizeof(Float32)) {
 				DebugMsg("CaptainJack_GetControlPropertyData: not enough space for the return value of kAudioLevelControlPropertyDecibelValue for the volume control");
 				return kAudioHardwareBadPropertySizeError;
 			}
 
-			pthread_mutex_lock(&gPlugIn_StateMutex);
-			*((Float32 *)outData) = (inObjectID == kObjectID_Volume_Input_Master) ? gVolume_Input_Master_Value : gVolume_Output_Master_Value;
-			pthread_mutex_unlock(&gPlugIn_StateMutex);
+			__atomic_load((inObjectID == kObjectID_Volume_Input_Master) ? &gVolume_Input_Master_Value : &gVolume_Output_Master_Value, (Float32 *)outData, __ATOMIC_RELAXED);
 			//  Note that we square the scalar value before converting to dB so as to
 			//  provide a better curve for the slider
 			*((Float32 *)outData) *= *((Float32 *)outData);
@@ -3844,15 +4217,13 @@ static OSStatus CaptainJack_GetControlPropertyData(AudioServerPlugInDriverRef in
 
 			//  This returns the value of the mute control where 0 means that mute is off
 			//  and audio can be heard and 1 means that mute is on and audio cannot be heard.
-			//  Note that we need to take the state lock to examine this value.
+			//  Note that the value is read atomically rather than under the state lock.
 			if (inDataSize < sizeof(UInt32)) {
 				DebugMsg("CaptainJack_GetControlPropertyData: not enough space for the return value of kAudioBooleanControlPropertyValue for the mute control");
 				return kAudioHardwareBadPropertySizeError;
 			}
 
-			pthread_mutex_lock(&gPlugIn_StateMutex);
-			*((UInt32 *)outData) = (inObjectID == kObjectID_Mute_Input_Master) ? (gMute_Input_Master_Value ? 1 : 0) : (gMute_Output_Master_Value ? 1 : 0);
-			pthread_mutex_unlock(&gPlugIn_StateMutex);
+			*((UInt32 *)outData) = __atomic_load_n((inObjectID == kObjectID_Mute_Input_Master) ? &gMute_Input_Master_Value : &gMute_Output_Master_Value, __ATOMIC_RELAXED) ? 1 : 0;
 			*outDataSize = sizeof(UInt32);
 			break;
 
@@ -3933,15 +4304,13 @@ static OSStatus CaptainJack_GetControlPropertyData(AudioServerPlugInDriverRef in
 		case kAudioSelectorControlPropertyCurrentItem:
 
 			//  This returns the value of the data source selector.
-			//  Note that we need to take the state lock to examine this value.
+			//  Note that the value is read atomically rather than under the state lock.
 			if (inDataSize < sizeof(UInt32)) {
 				DebugMsg("CaptainJack_GetControlPropertyData: not enough space for the return value of kAudioSelectorControlPropertyCurrentItem for the data source control");
 				return kAudioHardwareBadPropertySizeError;
 			}
 
-			pthread_mutex_lock(&gPlugIn_StateMutex);
-			*((UInt32 *)outData) = (inObjectID == kObjectID_DataSource_Input_Master) ? gDataSource_Input_Master_Value : gDataSource_Output_Master_Value;
-			pthread_mutex_unlock(&gPlugIn_StateMutex);
+			*((UInt32 *)outData) = __atomic_load_n((inObjectID == kObjectID_DataSource_Input_Master) ? &gDataSource_Input_Master_Value : &gDataSource_Output_Master_Value, __ATOMIC_RELAXED);
 			*outDataSize = sizeof(UInt32);
 			break;
 
@@ -3988,6 +4357,7 @@ static OSStatus CaptainJack_SetControlPropertyData(AudioServerPlugInDriverRef in
 #pragma unused(inClientProcessID, inQualifierDataSize, inQualifierData)
 	OSStatus theAnswer = 0;
 	Float32 theNewVolume;
+	bool theNewMute;
 
 	//  check the arguments
 	if (inDriver != gAudioServerPlugInDriverRef) {
@@ -4037,33 +4407,11 @@ static OSStatus CaptainJack_SetControlPropertyData(AudioServerPlugInDriverRef in
 				theNewVolume = 1.0;
 			}
 
-			pthread_mutex_lock(&gPlugIn_StateMutex);
-
-			if (inObjectID == kObjectID_Volume_Input_Master) {
-				if (gVolume_Input_Master_Value != theNewVolume) {
-					gVolume_Input_Master_Value = theNewVolume;
-					*outNumberPropertiesChanged = 2;
-					outChangedAddresses[0].mSelector = kAudioLevelControlPropertyScalarValue;
-					outChangedAddresses[0].mScope = kAudioObjectPropertyScopeGlobal;
-					outChangedAddresses[0].mElement = kAudioObjectPropertyElementMaster;
-					outChangedAddresses[1].mSelector = kAudioLevelControlPropertyDecibelValue;
-					outChangedAddresses[1].mScope = kAudioObjectPropertyScopeGlobal;
-					outChangedAddresses[1].mElement = kAudioObjectPropertyElementMaster;
-				}
-			} else {
-				if (gVolume_Output_Master_Value != theNewVolume) {
-					gVolume_Output_Master_Value = theNewVolume;
-					*outNumberPropertiesChanged = 2;
-					outChangedAddresses[0].mSelector = kAudioLevelControlPropertyScalarValue;
-					outChangedAddresses[0].mScope = kAudioObjectPropertyScopeGlobal;
-					outChangedAddresses[0].mElement = kAudioObjectPropertyElementMaster;
-					outChangedAddresses[1].mSelector = kAudioLevelControlPropertyDecibelValue;
-					outChangedAddresses[1].mScope = kAudioObjectPropertyScopeGlobal;
-					outChangedAddresses[1].mElement = kAudioObjectPropertyElementMaster;
-				}
+			//  the IO thread picks the new value up on its next cycle; the host hears about it once
+			//  the notification for this batch of changes goes out
+			if (CaptainJack_ExchangeVolume(inObjectID, theNewVolume) != theNewVolume) {
+				CaptainJack_ControlChanged(inObjectID);
 			}
-
-			pthread_mutex_unlock(&gPlugIn_StateMutex);
 			break;
 
 		case kAudioLevelControlPropertyDecibelValue:
@@ -4089,33 +4437,12 @@ static OSStatus CaptainJack_SetControlPropertyData(AudioServerPlugInDriverRef in
 			theNewVolume = theNewVolume - kVolume_MinDB;
 			theNewVolume /= kVolume_MaxDB - kVolume_MinDB;
 			theNewVolume = sqrtf(theNewVolume);
-			pthread_mutex_lock(&gPlugIn_StateMutex);
-
-			if (inObjectID == kObjectID_Volume_Input_Master) {
-				if (gVolume_Input_Master_Value != theNewVolume) {
-					gVolume_Input_Master_Value = theNewVolume;
-					*outNumberPropertiesChanged = 2;
-					outChangedAddresses[0].mSelector = kAudioLevelControlPropertyScalarValue;
-					outChangedAddresses[0].mScope = kAudioObjectPropertyScopeGlobal;
-					outChangedAddresses[0].mElement = kAudioObjectPropertyElementMaster;
-					outChangedAddresses[1].mSelector = kAudioLevelControlPropertyDecibelValue;
-					outChangedAddresses[1].mScope = kAudioObjectPropertyScopeGlobal;
-					outChangedAddresses[1].mElement = kAudioObjectPropertyElementMaster;
-				}
-			} else {
-				if (gVolume_Output_Master_Value != theNewVolume) {
-					gVolume_Output_Master_Value = theNewVolume;
-					*outNumberPropertiesChanged = 2;
-					outChangedAddresses[0].mSelector = kAudioLevelControlPropertyScalarValue;
-					outChangedAddresses[0].mScope = kAudioObjectPropertyScopeGlobal;
-					outChangedAddresses[0].mElement = kAudioObjectPropertyElementMaster;
-					outChangedAddresses[1].mSelector = kAudioLevelControlPropertyDecibelValue;
-					outChangedAddresses[1].mScope = kAudioObjectPropertyScopeGlobal;
-					outChangedAddresses[1].mElement = kAudioObjectPropertyElementMaster;
-				}
-			}
 
-			pthread_mutex_unlock(&gPlugIn_StateMutex);
+			//  the IO thread picks the new value up on its next cycle; the host hears about it once
+			//  the notification for this batch of changes goes out
+			if (CaptainJack_ExchangeVolume(inObjectID, theNewVolume) != theNewVolume) {
+				CaptainJack_ControlChanged(inObjectID);
+			}
 			break;
 
 		default:
@@ -4133,27 +4460,11 @@ static OSStatus CaptainJack_SetControlPropertyData(AudioServerPlugInDriverRef in
 				return kAudioHardwareBadPropertySizeError;
 			}
 
-			pthread_mutex_lock(&gPlugIn_StateMutex);
+			theNewMute = *((const UInt32 *)inData) != 0;
 
-			if (inObjectID == kObjectID_Mute_Input_Master) {
-				if (gMute_Input_Master_Value != (*((const UInt32 *)inData) != 0)) {
-					gMute_Input_Master_Value = *((const UInt32 *)inData) != 0;
-					*outNumberPropertiesChanged = 1;
-					outChangedAddresses[0].mSelector = kAudioBooleanControlPropertyValue;
-					outChangedAddresses[0].mScope = kAudioObjectPropertyScopeGlobal;
-					outChangedAddresses[0].mElement = kAudioObjectPropertyElementMaster;
-				}
-			} else {
-				if (gMute_Output_Master_Value != (*((const UInt32 *)inData) != 0)) {
-					gMute_Output_Master_Value = *((const UInt32 *)inData) != 0;
-					*outNumberPropertiesChanged = 1;
-					outChangedAddresses[0].mSelector = kAudioBooleanControlPropertyValue;
-					outChangedAddresses[0].mScope = kAudioObjectPropertyScopeGlobal;
-					outChangedAddresses[0].mElement = kAudioObjectPropertyElementMaster;
-				}
+			if (__atomic_exchange_n((inObjectID == kObjectID_Mute_Input_Master) ? &gMute_Input_Master_Value : &gMute_Output_Master_Value, theNewMute, __ATOMIC_RELAXED) != theNewMute) {
+				CaptainJack_ControlChanged(inObjectID);
 			}
-
-			pthread_mutex_unlock(&gPlugIn_StateMutex);
 			break;
 
 		default:
@@ -4179,27 +4490,9 @@ static OSStatus CaptainJack_SetControlPropertyData(AudioServerPlugInDriverRef in
 				return kAudioHardwareIllegalOperationError;
 			}
 
-			pthread_mutex_lock(&gPlugIn_StateMutex);
-
-			if (inObjectID == kObjectID_DataSource_Input_Master) {
-				if (gDataSource_Input_Master_Value != *((const UInt32 *)inData)) {
-					gDataSource_Input_Master_Value = *((const UInt32 *)inData);
-					*outNumberPropertiesChanged = 1;
-					outChangedAddresses[0].mSelector = kAudioSelectorControlPropertyCurrentItem;
-					outChangedAddresses[0].mScope = kAudioObjectPropertyScopeGlobal;
-					outChangedAddresses[0].mElement = kAudioObjectPropertyElementMaster;
-				}
-			} else {
-				if (gDataSource_Output_Master_Value != *((const UInt32 *)inData)) {
-					gDataSource_Output_Master_Value = *((const UInt32 *)inData);
-					*outNumberPropertiesChanged = 1;
-					outChangedAddresses[0].mSelector = kAudioSelectorControlPropertyCurrentItem;
-					outChangedAddresses[0].mScope = kAudioObjectPropertyScopeGlobal;
-					outChangedAddresses[0].mElement = kAudioObjectPropertyElementMaster;
-				}
+			if (__atomic_exchange_n((inObjectID == kObjectID_DataSource_Input_Master) ? &gDataSource_Input_Master_Value : &gDataSource_Output_Master_Value, *((const UInt32 *)inData), __ATOMIC_RELAXED) != *((const UInt32 *)inData)) {
+				CaptainJack_ControlChanged(inObjectID);
 			}
-
-			pthread_mutex_unlock(&gPlugIn_StateMutex);
 			break;
 
 		default:
@@ -4254,8 +4547,32 @@ static OSStatus CaptainJack_StartIO(AudioServerPlugInDriverRef inDriver, AudioOb
 		++gDevice_IOIsRunning;
 	}
 
+	//  give the client a silence slot, unless it already has one; a client that doesn't get one is
+	//  just never marked silent
+	CaptainJack_ClientSilence *theFree = NULL;
+	bool theHasSlot = false;
+	for (UInt32 theIndex = 0; theAnswer == 0 && theIndex < kIO_MaxClients && !theHasSlot; ++theIndex) {
+		if (!gIO_Clients[theIndex].mUsed) {
+			theFree = theFree != NULL ? theFree : &gIO_Clients[theIndex];
+		} else if (gIO_Clients[theIndex].mClientID == inClientID) {
+			theHasSlot = true;
+		}
+	}
+
+	if (theAnswer == 0 && !theHasSlot && theFree != NULL) {
+		theFree->mClientID = inClientID;
+		theFree->mQuietFrames = 0;
+		theFree->mSilent = false;
+		__atomic_store_n(&theFree->mUsed, true, __ATOMIC_RELEASE);
+	}
+
 	gXmitter->do_client_enable_io(inClientID);
 
+	//  the slot starts out not silent, and the daemon has to hear that too, since the last thing
+	//  it was told may have been that the client went quiet; queued behind the enable, it
+	//  survives even when the enable cancels a held StopIO and neither gets sent
+	gXmitter->do_client_silence(inClientID, false);
+
 	//  unlock the state lock
 	pthread_mutex_unlock(&gPlugIn_StateMutex);
 	return theAnswer;
@@ -4294,6 +4611,13 @@ static OSStatus CaptainJack_StopIO(AudioServerPlugInDriverRef inDriver, AudioObj
 		--gDevice_IOIsRunning;
 	}
 
+	for (UInt32 theIndex = 0; theIndex < kIO_MaxClients; ++theIndex) {
+		if (gIO_Clients[theIndex].mUsed && gIO_Clients[theIndex].mClientID == inClientID) {
+			__atomic_store_n(&gIO_Clients[theIndex].mUsed, false, __ATOMIC_RELEASE);
+			break;
+		}
+	}
+
 	gXmitter->do_client_disable_io(inClientID);
 
 	//  unlock the state lock
@@ -4309,7 +4633,7 @@ static OSStatus CaptainJack_GetZeroTimeStamp(AudioServerPlugInDriverRef inDriver
 	//  where the zero time stamp is updated when wrapping around the ring buffer.
 	//
 	//  For this device, the zero time stamps' sample time increments every kDevice_RingBufferSize
-	//  frames and the host time increments by kDevice_RingBufferSize * gDevice_HostTicksPerFrame.
+	//  frames and the host time increments by kDevice_RingBufferSize * hostTicksPerFrame.
 #pragma unused(inClientID)
 	//  declare the local variables
 	OSStatus theAnswer = 0;
@@ -4329,12 +4653,14 @@ static OSStatus CaptainJack_GetZeroTimeStamp(AudioServerPlugInDriverRef inDriver
 		return kAudioHardwareBadObjectError;
 	}
 
+	CaptainJack_TraceBegin("hal", "GetZeroTimeStamp");
 	//  we need to hold the locks
 	pthread_mutex_lock(&gDevice_IOMutex);
 	//  get the current host time
 	theCurrentHostTime = mach_absolute_time();
 	//  calculate the next host time
-	theHostTicksPerRingBuffer = gDevice_HostTicksPerFrame * ((Float64)kDevice_RingBufferSize);
+	theHostTicksPerRingBuffer = CaptainJack_BeginRead(&gDevice_Config)->hostTicksPerFrame * ((Float64)kDevice_RingBufferSize);
+	CaptainJack_EndRead();
 	theHostTickOffset = ((Float64)(gDevice_NumberTimeStamps + 1)) * theHostTicksPerRingBuffer;
 	theNextHostTime = gDevice_AnchorHostTime + ((UInt64)theHostTickOffset);
 
@@ -4349,6 +4675,7 @@ static OSStatus CaptainJack_GetZeroTimeStamp(AudioServerPlugInDriverRef inDriver
 	*outSeed = 1;
 	//  unlock the state lock
 	pthread_mutex_unlock(&gDevice_IOMutex);
+	CaptainJack_TraceEnd("hal", "GetZeroTimeStamp");
 	return theAnswer;
 }
 
@@ -4380,6 +4707,21 @@ static OSStatus CaptainJack_WillDoIOOperation(AudioServerPlugInDriverRef inDrive
 		willDoInPlace = true;
 		break;
 
+	case kAudioServerPlugInIOOperationConvertInput:
+		willDo = true;
+		willDoInPlace = true;
+		break;
+
+	case kAudioServerPlugInIOOperationProcessOutput:
+		willDo = true;
+		willDoInPlace = true;
+		break;
+
+	case kAudioServerPlugInIOOperationConvertMix:
+		willDo = true;
+		willDoInPlace = true;
+		break;
+
 	case kAudioServerPlugInIOOperationWriteMix:
 		willDo = true;
 		willDoInPlace = true;
@@ -4399,9 +4741,9 @@ static OSStatus CaptainJack_WillDoIOOperation(AudioServerPlugInDriverRef inDrive
 }
 
 static OSStatus CaptainJack_BeginIOOperation(AudioServerPlugInDriverRef inDriver, AudioObjectID inDeviceObjectID, UInt32 inClientID, UInt32 inOperationID, UInt32 inIOBufferFrameSize, const AudioServerPlugInIOCycleInfo *inIOCycleInfo) {
-	//  This is called at the beginning of an IO operation. This device doesn't do anything, so just
-	//  check the arguments and return.
-#pragma unused(inClientID, inOperationID, inIOBufferFrameSize, inIOCycleInfo)
+	//  This is called at the beginning of an IO operation. This device doesn't do anything but open
+	//  the operation's trace span, which EndIOOperation closes, so just check the arguments and return.
+#pragma unused(inClientID, inIOBufferFrameSize, inIOCycleInfo)
 	//  declare the local variables
 	OSStatus theAnswer = 0;
 
@@ -4416,15 +4758,18 @@ static OSStatus CaptainJack_BeginIOOperation(AudioServerPlugInDriverRef inDriver
 		return kAudioHardwareBadObjectError;
 	}
 
+	CaptainJack_TraceBegin("hal io", CaptainJack_IOOperationName(inOperationID));
 	return theAnswer;
 }
 
 static OSStatus CaptainJack_DoIOOperation(AudioServerPlugInDriverRef inDriver, AudioObjectID inDeviceObjectID, AudioObjectID inStreamObjectID, UInt32 inClientID, UInt32 inOperationID, UInt32 inIOBufferFrameSize, const AudioServerPlugInIOCycleInfo *inIOCycleInfo, void *ioMainBuffer, void *ioSecondaryBuffer) {
 	//  This is called to actuall perform a given operation. For this device, all we need to do is
-	//  clear the buffer for the ReadInput operation.
-#pragma unused(inClientID, inIOCycleInfo, ioSecondaryBuffer)
+	//  clear the buffer for the ReadInput operation, and convert between the physical and virtual
+	//  formats (applying the volume and mute controls on the way) for the Convert operations.
+#pragma unused(inIOCycleInfo, ioSecondaryBuffer)
 	//  declare the local variables
 	OSStatus theAnswer = 0;
+	Float32 theGain;
 
 	//  check the arguments
 	if (inDriver != gAudioServerPlugInDriverRef) {
@@ -4442,19 +4787,52 @@ static OSStatus CaptainJack_DoIOOperation(AudioServerPlugInDriverRef inDriver, A
 		return kAudioHardwareBadObjectError;
 	}
 
-	//  clear the buffer if this iskAudioServerPlugInIOOperationReadInput
-	if (inOperationID == kAudioServerPlugInIOOperationReadInput) {
-		//  we are always dealing with a 2 channel 32 bit float buffer
-		memset(ioMainBuffer, 0, inIOBufferFrameSize * 8);
-	}
+	CaptainJack_TraceBegin("hal", "DoIOOperation");
+
+	//  the physical formats for this cycle
+	const CaptainJack_Config *theConfig = CaptainJack_BeginRead(&gDevice_Config);
+	CaptainJack_SampleFormat theInputFormat = theConfig->inputFormat;
+	CaptainJack_SampleFormat theOutputFormat = theConfig->outputFormat;
+	CaptainJack_EndRead();
+
+	//  we are always dealing with 2 channels; the virtual format is 32 bit float and the physical
+	//  format is whatever the stream is set to
+	switch (inOperationID) {
+	case kAudioServerPlugInIOOperationReadInput:
+		//  clear the buffer (in the physical format)
+		memset(ioMainBuffer, 0, inIOBufferFrameSize * 2 * CaptainJack_SampleBytes(theInputFormat));
+		break;
+
+	case kAudioServerPlugInIOOperationConvertInput:
+		//  physical to float, then the gain stage
+		CaptainJack_ToFloat(ioMainBuffer, (Float32 *)ioMainBuffer, inIOBufferFrameSize * 2, theInputFormat);
+		theGain = CaptainJack_StreamGain(kObjectID_Stream_Input);
+		CaptainJack_Gain((Float32 *)ioMainBuffer, inIOBufferFrameSize, 2, gIO_Input_Gain, theGain);
+		gIO_Input_Gain = theGain;
+		break;
+
+	case kAudioServerPlugInIOOperationProcessOutput:
+		//  each client's own output, before it's mixed; this is where we find out who's silent
+		CaptainJack_TrackSilence(inClientID, (const Float32 *)ioMainBuffer, inIOBufferFrameSize);
+		break;
+
+	case kAudioServerPlugInIOOperationConvertMix:
+		//  the gain stage, then float to physical
+		theGain = CaptainJack_StreamGain(kObjectID_Stream_Output);
+		CaptainJack_Gain((Float32 *)ioMainBuffer, inIOBufferFrameSize, 2, gIO_Output_Gain, theGain);
+		gIO_Output_Gain = theGain;
+		CaptainJack_FromFloat((const Float32 *)ioMainBuffer, ioMainBuffer, inIOBufferFrameSize * 2, theOutputFormat, gPlugIn_Dither ? &gIO_Output_Dither : NULL);
+		break;
+	};
 
+	CaptainJack_TraceEnd("hal", "DoIOOperation");
 	return theAnswer;
 }
 
 static OSStatus CaptainJack_EndIOOperation(AudioServerPlugInDriverRef inDriver, AudioObjectID inDeviceObjectID, UInt32 inClientID, UInt32 inOperationID, UInt32 inIOBufferFrameSize, const AudioServerPlugInIOCycleInfo *inIOCycleInfo) {
-	//  This is called at the end of an IO operation. This device doesn't do anything, so just check
-	//  the arguments and return.
-#pragma unused(inClientID, inOperationID, inIOBufferFrameSize, inIOCycleInfo)
+	//  This is called at the end of an IO operation. This device doesn't do anything but close the
+	//  operation's trace span, so just check the arguments and return.
+#pragma unused(inClientID, inIOBufferFrameSize, inIOCycleInfo)
 	//  declare the local variables
 	OSStatus theAnswer = 0;
 
@@ -4469,5 +4847,6 @@ static OSStatus CaptainJack_EndIOOperation(AudioServerPlugInDriverRef inDriver,
 		return kAudioHardwareBadObjectError;
 	}
 
+	CaptainJack_TraceEnd("hal io", CaptainJack_IOOperationName(inOperationID));
 	return theAnswer;
 }
@@ -0,0 +1,95 @@
+/*
+	,---.         .              ,-_/
+	|  -' ,-. ,-. |- ,-. . ,-.   '  | ,-. ,-. . ,
+	|   . ,-| | | |  ,-| | | |      | ,-| |   |/
+	`---' `-^ |-' `' `-^ ' ' '      | `-^ `-' |\
+	          |                  /  |         ' `
+	          '                  `--'
+	          captain jack audio device
+	         github.com/qix-/captainjack
+
+	        copyright (c) 2016 josh junon
+	        released under the MIT license
+*/
+
+/*
+	prints the per-client levels the daemon publishes.
+
+		captain-jack-meter [-1] [path]
+
+	-1 prints a single snapshot instead of refreshing.
+*/
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "meters.h"
+
+static double to_decibels(float value) {
+	return value > 0.0f ? 20.0 * log10(value) : -INFINITY;
+}
+
+static void print_page(const CaptainJack_MeterPage *page) {
+	printf("%-6s %-7s %-24s %8s %8s %8s %8s\n", "cid", "pid", "name", "peak L", "peak R", "rms L", "rms R");
+
+	for (uint32_t i = 0; i < page->count && i < kMeters_MaxClients; i++) {
+		const CaptainJack_MeterEntry *entry = &page->clients[i];
+		printf("%-6u %-7d %-24.24s %8.1f %8.1f %8.1f %8.1f%s\n",
+			entry->cid,
+			entry->pid,
+			entry->name,
+			to_decibels(entry->peak[0]),
+			to_decibels(entry->peak[1]),
+			to_decibels(entry->rms[0]),
+			to_decibels(entry->rms[1]),
+			(entry->peak[0] >= 1.0f || entry->peak[1] >= 1.0f) ? "  CLIP" : "");
+	}
+}
+
+int main(int argc, char **argv) {
+	bool once = false;
+	const char *path = kMeters_DefaultPath;
+
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "-1") == 0) {
+			once = true;
+		} else {
+			path = argv[i];
+		}
+	}
+
+	CaptainJack_MeterPage *page = CaptainJack_MapMeterPage(path, false);
+	if (page == NULL) {
+		fprintf(stderr, "captain-jack-meter: could not map %s (is the daemon running?)\n", path);
+		return EXIT_FAILURE;
+	}
+
+	static CaptainJack_MeterPage snapshot;
+	uint64_t lastUpdate = 0;
+
+	do {
+		if (!CaptainJack_ReadMeterPage(page, &snapshot)) {
+			fprintf(stderr, "captain-jack-meter: %s is not a meter page\n", path);
+			return EXIT_FAILURE;
+		}
+
+		if (snapshot.updates != lastUpdate || once) {
+			lastUpdate = snapshot.updates;
+			if (!once) {
+				printf("\033[H\033[2J");
+			}
+			print_page(&snapshot);
+			fflush(stdout);
+		}
+
+		if (!once) {
+			usleep(1000000 / (snapshot.rate ? snapshot.rate : 10));
+		}
+	} while (!once);
+
+	return EXIT_SUCCESS;
+}
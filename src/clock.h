@@ -0,0 +1,46 @@
+#ifndef CAPTAIN_JACK_CLOCK_H__
+#define CAPTAIN_JACK_CLOCK_H__
+/*
+	,---.         .              ,-_/
+	|  -' ,-. ,-. |- ,-. . ,-.   '  | ,-. ,-. . ,
+	|   . ,-| | | |  ,-| | | |      | ,-| |   |/
+	`---' `-^ |-' `' `-^ ' ' '      | `-^ `-' |\
+	          |                  /  |         ' `
+	          '                  `--'
+	          captain jack audio device
+	         github.com/qix-/captainjack
+
+	        copyright (c) 2016 josh junon
+	        released under the MIT license
+*/
+
+/*
+	a monotonic nanosecond clock that's cheap enough for the
+	audio paths. it's the same clock in every process on the
+	machine, so timestamps from the device and the daemon can
+	be compared directly.
+*/
+
+#include <stdint.h>
+
+#ifdef __APPLE__
+#	include <mach/mach_time.h>
+#else
+#	include <time.h>
+#endif
+
+static inline uint64_t CaptainJack_Now(void) {
+#ifdef __APPLE__
+	static mach_timebase_info_data_t timebase;
+	if (timebase.denom == 0) {
+		mach_timebase_info(&timebase);
+	}
+	return mach_absolute_time() * timebase.numer / timebase.denom;
+#else
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t) now.tv_sec * 1000000000ull + (uint64_t) now.tv_nsec;
+#endif
+}
+
+#endif
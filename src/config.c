@@ -0,0 +1,154 @@
+/*
+	,---.         .              ,-_/
+	|  -' ,-. ,-. |- ,-. . ,-.   '  | ,-. ,-. . ,
+	|   . ,-| | | |  ,-| | | |      | ,-| |   |/
+	`---' `-^ |-' `' `-^ ' ' '      | `-^ `-' |\
+	          |                  /  |         ' `
+	          '                  `--'
+	          captain jack audio device
+	         github.com/qix-/captainjack
+
+	        copyright (c) 2016 josh junon
+	        released under the MIT license
+*/
+
+#include <sched.h>
+
+#include "config.h"
+
+#define kConfig_Unclaimed -1
+#define kConfig_Overflow  -2
+#define kConfig_Spins     256
+
+typedef struct {
+	uint64_t epoch;
+	uint32_t claimed;
+} __attribute__((aligned(64))) ReaderSlot;
+
+static ReaderSlot     gReaders[kConfig_Readers];
+static uint64_t       gEpoch     __attribute__((aligned(64))) = 1;
+static uint64_t       gOverflow  __attribute__((aligned(64))) = 0;
+static pthread_once_t gSlotOnce  = PTHREAD_ONCE_INIT;
+static pthread_key_t  gSlotKey;
+
+static __thread int          gSlot  = kConfig_Unclaimed;
+static __thread unsigned int gDepth = 0;
+
+static void ReleaseSlot(void *slot) {
+	__atomic_store_n(&((ReaderSlot *) slot)->epoch, 0, __ATOMIC_RELEASE);
+	__atomic_store_n(&((ReaderSlot *) slot)->claimed, 0, __ATOMIC_RELEASE);
+}
+
+static void CreateSlotKey(void) {
+	pthread_key_create(&gSlotKey, &ReleaseSlot);
+}
+
+static int ClaimSlot(void) {
+	pthread_once(&gSlotOnce, &CreateSlotKey);
+
+	for (int i = 0; i < kConfig_Readers; i++) {
+		uint32_t expected = 0;
+		if (__atomic_compare_exchange_n(&gReaders[i].claimed, &expected, 1, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+			// hands the slot back when the thread exits
+			pthread_setspecific(gSlotKey, &gReaders[i]);
+			return i;
+		}
+	}
+
+	/*
+		more threads than slots; these readers share a counter,
+		and a writer waits for it to drain completely.
+	*/
+	return kConfig_Overflow;
+}
+
+const CaptainJack_Config * CaptainJack_BeginRead(CaptainJack_ConfigCell *cell) {
+	if (gDepth++ == 0) {
+		if (gSlot == kConfig_Unclaimed) {
+			gSlot = ClaimSlot();
+		}
+
+		if (gSlot == kConfig_Overflow) {
+			__atomic_add_fetch(&gOverflow, 1, __ATOMIC_SEQ_CST);
+		} else {
+			/*
+				the stamp has to be visible before the index is
+				loaded below; a writer that misses it must have
+				published first, so we'd see the new snapshot.
+			*/
+			__atomic_store_n(&gReaders[gSlot].epoch, __atomic_load_n(&gEpoch, __ATOMIC_SEQ_CST), __ATOMIC_SEQ_CST);
+		}
+	}
+
+	return &cell->snapshots[__atomic_load_n(&cell->current, __ATOMIC_SEQ_CST)];
+}
+
+void CaptainJack_EndRead(void) {
+	if (--gDepth != 0) {
+		return;
+	}
+
+	if (gSlot == kConfig_Overflow) {
+		__atomic_sub_fetch(&gOverflow, 1, __ATOMIC_RELEASE);
+	} else {
+		__atomic_store_n(&gReaders[gSlot].epoch, 0, __ATOMIC_RELEASE);
+	}
+}
+
+void CaptainJack_ReadConfig(CaptainJack_ConfigCell *cell, CaptainJack_Config *config) {
+	*config = *CaptainJack_BeginRead(cell);
+	CaptainJack_EndRead();
+}
+
+CaptainJack_Config * CaptainJack_BeginConfig(CaptainJack_ConfigCell *cell) {
+	pthread_mutex_lock(&cell->writer);
+
+	// only writers change the index, and we're the only writer
+	uint32_t current = __atomic_load_n(&cell->current, __ATOMIC_RELAXED);
+	cell->snapshots[current ^ 1] = cell->snapshots[current];
+	return &cell->snapshots[current ^ 1];
+}
+
+static void Relax(unsigned int *spins) {
+	if (++*spins < kConfig_Spins) {
+#if defined(__x86_64__) || defined(__i386__)
+		__builtin_ia32_pause();
+#endif
+	} else {
+		sched_yield();
+	}
+}
+
+void CaptainJack_CommitConfig(CaptainJack_ConfigCell *cell) {
+	__atomic_store_n(&cell->current, __atomic_load_n(&cell->current, __ATOMIC_RELAXED) ^ 1, __ATOMIC_SEQ_CST);
+	uint64_t epoch = __atomic_add_fetch(&gEpoch, 1, __ATOMIC_SEQ_CST);
+
+	/*
+		the grace period: anyone stamped with an older epoch
+		could still be looking at the snapshot we just replaced,
+		which the next writer is about to scribble over.
+	*/
+	for (int i = 0; i < kConfig_Readers; i++) {
+		unsigned int spins = 0;
+
+		for (;;) {
+			uint64_t stamp = __atomic_load_n(&gReaders[i].epoch, __ATOMIC_SEQ_CST);
+			if (stamp == 0 || stamp >= epoch) {
+				break;
+			}
+
+			Relax(&spins);
+		}
+	}
+
+	unsigned int spins = 0;
+	while (__atomic_load_n(&gOverflow, __ATOMIC_SEQ_CST) != 0) {
+		Relax(&spins);
+	}
+
+	pthread_mutex_unlock(&cell->writer);
+}
+
+void CaptainJack_AbandonConfig(CaptainJack_ConfigCell *cell) {
+	pthread_mutex_unlock(&cell->writer);
+}
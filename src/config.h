@@ -0,0 +1,97 @@
+#ifndef CAPTAIN_JACK_CONFIG_H__
+#define CAPTAIN_JACK_CONFIG_H__
+/*
+	,---.         .              ,-_/
+	|  -' ,-. ,-. |- ,-. . ,-.   '  | ,-. ,-. . ,
+	|   . ,-| | | |  ,-| | | |      | ,-| |   |/
+	`---' `-^ |-' `' `-^ ' ' '      | `-^ `-' |\
+	          |                  /  |         ' `
+	          '                  `--'
+	          captain jack audio device
+	         github.com/qix-/captainjack
+
+	        copyright (c) 2016 josh junon
+	        released under the MIT license
+*/
+
+/*
+	the device's configuration (sample rate, stream state and
+	formats) as an immutable snapshot that readers can look at from any
+	thread, IO included, without taking a lock.
+
+	a cell holds two snapshots. writers are serialized, fill in
+	the one nobody's reading, publish it, and then wait for a
+	grace period (every reader that might still be looking at
+	the old one has left its read section) before it can be
+	reused. readers announce themselves by stamping the current
+	epoch into a slot of their own, which is the only thing a
+	read section writes.
+
+	read sections are cheap and can nest, but they shouldn't
+	be held across anything that blocks: a writer waits for
+	them.
+*/
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "convert.h"
+
+#define kConfig_Readers 64
+
+typedef struct {
+	double                   sampleRate;
+	double                   hostTicksPerFrame;
+	bool                     inputActive;
+	bool                     outputActive;
+
+	// physical formats; the virtual ones are always float
+	CaptainJack_SampleFormat inputFormat;
+	CaptainJack_SampleFormat outputFormat;
+} CaptainJack_Config;
+
+typedef struct {
+	CaptainJack_Config snapshots[2];
+	uint32_t           current;
+	pthread_mutex_t    writer;
+} CaptainJack_ConfigCell;
+
+#define CAPTAIN_JACK_CONFIG_CELL(...) { { __VA_ARGS__, __VA_ARGS__ }, 0, PTHREAD_MUTEX_INITIALIZER }
+
+/*
+	enters a read section and returns the current snapshot,
+	which stays valid until the matching CaptainJack_EndRead()
+*/
+const CaptainJack_Config * CaptainJack_BeginRead(CaptainJack_ConfigCell *cell);
+
+/*
+	leaves a read section
+*/
+void CaptainJack_EndRead(void);
+
+/*
+	copies out the current snapshot in a read section of its own
+*/
+void CaptainJack_ReadConfig(CaptainJack_ConfigCell *cell, CaptainJack_Config *config);
+
+/*
+	starts a change: takes the writer lock and returns a copy
+	of the current snapshot to modify. must be followed by
+	either CaptainJack_CommitConfig() or
+	CaptainJack_AbandonConfig() on the same thread
+*/
+CaptainJack_Config * CaptainJack_BeginConfig(CaptainJack_ConfigCell *cell);
+
+/*
+	publishes the modified copy and waits out the grace period
+	for the snapshot it replaced
+*/
+void CaptainJack_CommitConfig(CaptainJack_ConfigCell *cell);
+
+/*
+	drops the modified copy without publishing it
+*/
+void CaptainJack_AbandonConfig(CaptainJack_ConfigCell *cell);
+
+#endif
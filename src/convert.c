@@ -0,0 +1,328 @@
+/*
+	,---.         .              ,-_/
+	|  -' ,-. ,-. |- ,-. . ,-.   '  | ,-. ,-. . ,
+	|   . ,-| | | |  ,-| | | |      | ,-| |   |/
+	`---' `-^ |-' `' `-^ ' ' '      | `-^ `-' |\
+	          |                  /  |         ' `
+	          '                  `--'
+	          captain jack audio device
+	         github.com/qix-/captainjack
+
+	        copyright (c) 2016 josh junon
+	        released under the MIT license
+*/
+
+#include <math.h>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(__x86_64__)
+#	include <emmintrin.h>
+#	define CAPTAIN_JACK_SSE2 1
+#elif defined(__aarch64__)
+// rounding float to int (vcvtnq) is ARMv8 only; 32 bit ARM gets the scalar code
+#	include <arm_neon.h>
+#	define CAPTAIN_JACK_NEON 1
+#endif
+
+#include "convert.h"
+
+// 2^-32; turns a random 32 bit value into a uniform [-0.5, 0.5)
+#define kDither_Scale 2.3283064e-10f
+
+typedef struct {
+	unsigned int bytes;
+	unsigned int bits;
+	float        scale;
+	float        top;
+} Format;
+
+/*
+	`top` is the largest value that still fits once scaled;
+	for 32 bit that's the largest float below 2^31, since
+	2^31 - 1 itself rounds up and out of range.
+*/
+static const Format kFormats[kSampleFormat_Count] = {
+	[kSampleFormat_Float32] = { 4, 32, 1.0f, 1.0f },
+	[kSampleFormat_Int16] = { 2, 16, 32768.0f, 32767.0f },
+	[kSampleFormat_Int24] = { 3, 24, 8388608.0f, 8388607.0f },
+	[kSampleFormat_Int32] = { 4, 32, 2147483648.0f, 2147483520.0f }
+};
+
+unsigned int CaptainJack_SampleBytes(CaptainJack_SampleFormat format) {
+	return kFormats[format].bytes;
+}
+
+unsigned int CaptainJack_SampleBits(CaptainJack_SampleFormat format) {
+	return kFormats[format].bits;
+}
+
+static inline uint32_t Advance(uint32_t x) {
+	// xorshift32
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	return x;
+}
+
+void CaptainJack_SeedDither(CaptainJack_Dither *dither, uint32_t seed) {
+	for (int lane = 0; lane < 4; lane++) {
+		// xorshift never leaves zero, so keep every lane off it
+		seed = seed * 1664525u + 1013904223u;
+		dither->state[lane] = seed != 0 ? seed : 1;
+	}
+}
+
+static inline float Noise(uint32_t *lane) {
+	uint32_t a = Advance(*lane);
+	uint32_t b = Advance(a);
+	*lane = b;
+	return ((float) (int32_t) a + (float) (int32_t) b) * kDither_Scale;
+}
+
+static inline void StoreSample(uint8_t *bytes, size_t index, int32_t value, CaptainJack_SampleFormat format) {
+	switch (format) {
+	case kSampleFormat_Int16: {
+		int16_t sample = (int16_t) value;
+		memcpy(&bytes[index * 2], &sample, 2);
+		break;
+	}
+
+	case kSampleFormat_Int24:
+		// native endian is little endian on everything this runs on
+		bytes[index * 3] = (uint8_t) value;
+		bytes[index * 3 + 1] = (uint8_t) (value >> 8);
+		bytes[index * 3 + 2] = (uint8_t) (value >> 16);
+		break;
+
+	default:
+		memcpy(&bytes[index * 4], &value, 4);
+		break;
+	}
+}
+
+static inline int32_t LoadSample(const uint8_t *bytes, size_t index, CaptainJack_SampleFormat format) {
+	switch (format) {
+	case kSampleFormat_Int16: {
+		int16_t sample;
+		memcpy(&sample, &bytes[index * 2], 2);
+		return sample;
+	}
+
+	case kSampleFormat_Int24: {
+		// into the top three bytes, then back down to sign extend
+		uint32_t sample = ((uint32_t) bytes[index * 3] << 8) | ((uint32_t) bytes[index * 3 + 1] << 16) | ((uint32_t) bytes[index * 3 + 2] << 24);
+		return (int32_t) sample >> 8;
+	}
+
+	default: {
+		int32_t sample;
+		memcpy(&sample, &bytes[index * 4], 4);
+		return sample;
+	}
+	}
+}
+
+#if defined(CAPTAIN_JACK_SSE2)
+static inline __m128i Advance4(__m128i x) {
+	x = _mm_xor_si128(x, _mm_slli_epi32(x, 13));
+	x = _mm_xor_si128(x, _mm_srli_epi32(x, 17));
+	return _mm_xor_si128(x, _mm_slli_epi32(x, 5));
+}
+
+static inline void Store4(uint8_t *bytes, size_t index, __m128i values, CaptainJack_SampleFormat format) {
+	switch (format) {
+	case kSampleFormat_Int16:
+		_mm_storel_epi64((__m128i *) &bytes[index * 2], _mm_packs_epi32(values, values));
+		break;
+
+	case kSampleFormat_Int32:
+		_mm_storeu_si128((__m128i *) &bytes[index * 4], values);
+		break;
+
+	default: {
+		int32_t lanes[4];
+		_mm_storeu_si128((__m128i *) lanes, values);
+		for (int lane = 0; lane < 4; lane++) {
+			StoreSample(bytes, index + lane, lanes[lane], format);
+		}
+		break;
+	}
+	}
+}
+
+static inline __m128i Load4(const uint8_t *bytes, size_t index, CaptainJack_SampleFormat format) {
+	switch (format) {
+	case kSampleFormat_Int16: {
+		__m128i values = _mm_loadl_epi64((const __m128i *) &bytes[index * 2]);
+		return _mm_srai_epi32(_mm_unpacklo_epi16(values, values), 16);
+	}
+
+	case kSampleFormat_Int32:
+		return _mm_loadu_si128((const __m128i *) &bytes[index * 4]);
+
+	default:
+		return _mm_setr_epi32(LoadSample(bytes, index, format), LoadSample(bytes, index + 1, format), LoadSample(bytes, index + 2, format), LoadSample(bytes, index + 3, format));
+	}
+}
+#elif defined(CAPTAIN_JACK_NEON)
+static inline uint32x4_t Advance4(uint32x4_t x) {
+	x = veorq_u32(x, vshlq_n_u32(x, 13));
+	x = veorq_u32(x, vshrq_n_u32(x, 17));
+	return veorq_u32(x, vshlq_n_u32(x, 5));
+}
+
+static inline void Store4(uint8_t *bytes, size_t index, int32x4_t values, CaptainJack_SampleFormat format) {
+	switch (format) {
+	case kSampleFormat_Int16:
+		vst1_s16((int16_t *) &bytes[index * 2], vqmovn_s32(values));
+		break;
+
+	case kSampleFormat_Int32:
+		vst1q_s32((int32_t *) &bytes[index * 4], values);
+		break;
+
+	default: {
+		int32_t lanes[4];
+		vst1q_s32(lanes, values);
+		for (int lane = 0; lane < 4; lane++) {
+			StoreSample(bytes, index + lane, lanes[lane], format);
+		}
+		break;
+	}
+	}
+}
+
+static inline int32x4_t Load4(const uint8_t *bytes, size_t index, CaptainJack_SampleFormat format) {
+	switch (format) {
+	case kSampleFormat_Int16:
+		return vmovl_s16(vld1_s16((const int16_t *) &bytes[index * 2]));
+
+	case kSampleFormat_Int32:
+		return vld1q_s32((const int32_t *) &bytes[index * 4]);
+
+	default: {
+		int32_t lanes[4];
+		for (int lane = 0; lane < 4; lane++) {
+			lanes[lane] = LoadSample(bytes, index + lane, format);
+		}
+		return vld1q_s32(lanes);
+	}
+	}
+}
+#endif
+
+void CaptainJack_FromFloat(const float *in, void *out, size_t count, CaptainJack_SampleFormat format, CaptainJack_Dither *dither) {
+	if (format == kSampleFormat_Float32) {
+		if (out != in) {
+			memmove(out, in, count * sizeof(float));
+		}
+		return;
+	}
+
+	/*
+		front to back; a sample is never wider than the float it
+		came from, so in place we only ever overwrite floats that
+		have already been read.
+	*/
+	uint8_t *bytes = out;
+	const float scale = kFormats[format].scale;
+	const float top = kFormats[format].top;
+	size_t i = 0;
+
+#if defined(CAPTAIN_JACK_SSE2)
+	const __m128 scale4 = _mm_set1_ps(scale);
+	const __m128 top4 = _mm_set1_ps(top);
+	const __m128 bottom4 = _mm_set1_ps(-scale);
+	const __m128 noise4 = _mm_set1_ps(kDither_Scale);
+	__m128i state = dither != NULL ? _mm_loadu_si128((const __m128i *) dither->state) : _mm_setzero_si128();
+
+	for (; i + 4 <= count; i += 4) {
+		__m128 x = _mm_mul_ps(_mm_loadu_ps(&in[i]), scale4);
+
+		if (dither != NULL) {
+			__m128i a = Advance4(state);
+			state = Advance4(a);
+			x = _mm_add_ps(x, _mm_mul_ps(_mm_add_ps(_mm_cvtepi32_ps(a), _mm_cvtepi32_ps(state)), noise4));
+		}
+
+		x = _mm_max_ps(_mm_min_ps(x, top4), bottom4);
+		Store4(bytes, i, _mm_cvtps_epi32(x), format);
+	}
+
+	if (dither != NULL) {
+		_mm_storeu_si128((__m128i *) dither->state, state);
+	}
+#elif defined(CAPTAIN_JACK_NEON)
+	const float32x4_t top4 = vdupq_n_f32(top);
+	const float32x4_t bottom4 = vdupq_n_f32(-scale);
+	uint32x4_t state = dither != NULL ? vld1q_u32(dither->state) : vdupq_n_u32(0);
+
+	for (; i + 4 <= count; i += 4) {
+		float32x4_t x = vmulq_n_f32(vld1q_f32(&in[i]), scale);
+
+		if (dither != NULL) {
+			uint32x4_t a = Advance4(state);
+			state = Advance4(a);
+			float32x4_t noise = vaddq_f32(vcvtq_f32_s32(vreinterpretq_s32_u32(a)), vcvtq_f32_s32(vreinterpretq_s32_u32(state)));
+			x = vmlaq_n_f32(x, noise, kDither_Scale);
+		}
+
+		x = vmaxq_f32(vminq_f32(x, top4), bottom4);
+		Store4(bytes, i, vcvtnq_s32_f32(x), format);
+	}
+
+	if (dither != NULL) {
+		vst1q_u32(dither->state, state);
+	}
+#endif
+
+	for (; i < count; i++) {
+		float x = in[i] * scale;
+
+		if (dither != NULL) {
+			x += Noise(&dither->state[i & 3]);
+		}
+
+		x = x > top ? top : (x < -scale ? -scale : x);
+		StoreSample(bytes, i, (int32_t) lrintf(x), format);
+	}
+}
+
+void CaptainJack_ToFloat(const void *in, float *out, size_t count, CaptainJack_SampleFormat format) {
+	if (format == kSampleFormat_Float32) {
+		if (out != in) {
+			memmove(out, in, count * sizeof(float));
+		}
+		return;
+	}
+
+	/*
+		back to front, the opposite of the above: the floats are
+		wider, so in place they'd run over samples that haven't
+		been read yet going the other way. the odd samples at
+		the end go first so the blocks line up with the start.
+	*/
+	const uint8_t *bytes = in;
+	const float scale = 1.0f / kFormats[format].scale;
+	size_t i = count;
+
+	for (; (i & 3) != 0; i--) {
+		out[i - 1] = (float) LoadSample(bytes, i - 1, format) * scale;
+	}
+
+#if defined(CAPTAIN_JACK_SSE2)
+	const __m128 scale4 = _mm_set1_ps(scale);
+
+	for (; i >= 4; i -= 4) {
+		_mm_storeu_ps(&out[i - 4], _mm_mul_ps(_mm_cvtepi32_ps(Load4(bytes, i - 4, format)), scale4));
+	}
+#elif defined(CAPTAIN_JACK_NEON)
+	for (; i >= 4; i -= 4) {
+		vst1q_f32(&out[i - 4], vmulq_n_f32(vcvtq_f32_s32(Load4(bytes, i - 4, format)), scale));
+	}
+#endif
+
+	for (; i > 0; i--) {
+		out[i - 1] = (float) LoadSample(bytes, i - 1, format) * scale;
+	}
+}
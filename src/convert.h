@@ -0,0 +1,82 @@
+#ifndef CAPTAIN_JACK_CONVERT_H__
+#define CAPTAIN_JACK_CONVERT_H__
+/*
+	,---.         .              ,-_/
+	|  -' ,-. ,-. |- ,-. . ,-.   '  | ,-. ,-. . ,
+	|   . ,-| | | |  ,-| | | |      | ,-| |   |/
+	`---' `-^ |-' `' `-^ ' ' '      | `-^ `-' |\
+	          |                  /  |         ' `
+	          '                  `--'
+	          captain jack audio device
+	         github.com/qix-/captainjack
+
+	        copyright (c) 2016 josh junon
+	        released under the MIT license
+*/
+
+/*
+	converts samples between the float format everything is
+	mixed in and the packed integer formats a stream can be
+	carried in (16, 24 and 32 bit, native endian).
+
+	same rules as the dsp kernels: real-time safe, SSE2 and
+	NEON paths with a scalar fallback. both directions work
+	in place, so the device can convert inside the buffer the
+	host hands it.
+
+	going to 16 or 24 bits can add TPDF dither (two uniform
+	randoms summed, one LSB either way) so quiet signals
+	turn into a little noise instead of distortion. it's
+	only worth it if something downstream actually listens
+	to the low bits, so it's optional.
+*/
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef enum {
+	kSampleFormat_Float32 = 0,
+	kSampleFormat_Int16,
+	kSampleFormat_Int24,
+	kSampleFormat_Int32,
+	kSampleFormat_Count
+} CaptainJack_SampleFormat;
+
+/*
+	per-stream dither noise generator; only ever touched by
+	whoever does the converting
+*/
+typedef struct {
+	uint32_t state[4];
+} CaptainJack_Dither;
+
+/*
+	bytes one sample takes up in the given format
+*/
+unsigned int CaptainJack_SampleBytes(CaptainJack_SampleFormat format);
+
+/*
+	bits per sample in the given format
+*/
+unsigned int CaptainJack_SampleBits(CaptainJack_SampleFormat format);
+
+/*
+	seeds a dither generator. any seed works, zero included
+*/
+void CaptainJack_SeedDither(CaptainJack_Dither *dither, uint32_t seed);
+
+/*
+	converts `count` float samples to `format`, clipping
+	anything outside [-1, 1). `dither` may be NULL for
+	none. `out` may be the same buffer as `in`
+*/
+void CaptainJack_FromFloat(const float *in, void *out, size_t count, CaptainJack_SampleFormat format, CaptainJack_Dither *dither);
+
+/*
+	converts `count` samples in `format` to float. `out` may
+	be the same buffer as `in`, as long as it's big enough
+	for the floats
+*/
+void CaptainJack_ToFloat(const void *in, float *out, size_t count, CaptainJack_SampleFormat format);
+
+#endif
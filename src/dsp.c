@@ -0,0 +1,190 @@
+/*
+	,---.         .              ,-_/
+	|  -' ,-. ,-. |- ,-. . ,-.   '  | ,-. ,-. . ,
+	|   . ,-| | | |  ,-| | | |      | ,-| |   |/
+	`---' `-^ |-' `' `-^ ' ' '      | `-^ `-' |\
+	          |                  /  |         ' `
+	          '                  `--'
+	          captain jack audio device
+	         github.com/qix-/captainjack
+
+	        copyright (c) 2016 josh junon
+	        released under the MIT license
+*/
+
+#include <math.h>
+
+#if defined(__SSE__) || defined(__x86_64__)
+#	include <xmmintrin.h>
+#	define CAPTAIN_JACK_SSE 1
+#	if defined(__FMA__)
+// only when built for a CPU that has it (-mfma, -march=haswell, ...)
+#		include <immintrin.h>
+#		define CAPTAIN_JACK_FMA 1
+#	endif
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#	include <arm_neon.h>
+#	define CAPTAIN_JACK_NEON 1
+#endif
+
+#include "dsp.h"
+
+void CaptainJack_Measure(const float *samples, size_t count, float *peak, float *squares) {
+	size_t i = 0;
+	float lanes[4] = { 0, 0, 0, 0 };
+	float sums[4] = { 0, 0, 0, 0 };
+
+#if defined(CAPTAIN_JACK_SSE)
+	const __m128 sign = _mm_set1_ps(-0.0f);
+	__m128 peak4 = _mm_setzero_ps();
+	__m128 sum4 = _mm_setzero_ps();
+
+	for (; i + 4 <= count; i += 4) {
+		__m128 x = _mm_loadu_ps(&samples[i]);
+		peak4 = _mm_max_ps(peak4, _mm_andnot_ps(sign, x));
+		sum4 = _mm_add_ps(sum4, _mm_mul_ps(x, x));
+	}
+
+	_mm_storeu_ps(lanes, peak4);
+	_mm_storeu_ps(sums, sum4);
+#elif defined(CAPTAIN_JACK_NEON)
+	float32x4_t peak4 = vdupq_n_f32(0.0f);
+	float32x4_t sum4 = vdupq_n_f32(0.0f);
+
+	for (; i + 4 <= count; i += 4) {
+		float32x4_t x = vld1q_f32(&samples[i]);
+		peak4 = vmaxq_f32(peak4, vabsq_f32(x));
+		sum4 = vmlaq_f32(sum4, x, x);
+	}
+
+	vst1q_f32(lanes, peak4);
+	vst1q_f32(sums, sum4);
+#endif
+
+	for (; i < count; i++) {
+		float x = fabsf(samples[i]);
+		lanes[i & 3] = x > lanes[i & 3] ? x : lanes[i & 3];
+		sums[i & 3] += x * x;
+	}
+
+	float top = lanes[0];
+	for (int lane = 1; lane < 4; lane++) {
+		top = lanes[lane] > top ? lanes[lane] : top;
+	}
+
+	*peak = top;
+	*squares = (sums[0] + sums[1]) + (sums[2] + sums[3]);
+}
+
+static void Scale(float *samples, size_t count, float gain) {
+	size_t i = 0;
+
+#if defined(CAPTAIN_JACK_SSE)
+	const __m128 gain4 = _mm_set1_ps(gain);
+
+	for (; i + 4 <= count; i += 4) {
+		_mm_storeu_ps(&samples[i], _mm_mul_ps(_mm_loadu_ps(&samples[i]), gain4));
+	}
+#elif defined(CAPTAIN_JACK_NEON)
+	for (; i + 4 <= count; i += 4) {
+		vst1q_f32(&samples[i], vmulq_n_f32(vld1q_f32(&samples[i]), gain));
+	}
+#endif
+
+	for (; i < count; i++) {
+		samples[i] *= gain;
+	}
+}
+
+void CaptainJack_Gain(float *samples, size_t frames, unsigned int channels, float from, float to) {
+	if (from == to) {
+		if (to != 1.0f) {
+			Scale(samples, frames * channels, to);
+		}
+		return;
+	}
+
+	// ramps are rare (one buffer per change), so they stay scalar
+	float step = (to - from) / (float) frames;
+	for (size_t frame = 0; frame < frames; frame++) {
+		float gain = from + step * (float) (frame + 1);
+		for (unsigned int channel = 0; channel < channels; channel++) {
+			samples[frame * channels + channel] *= gain;
+		}
+	}
+}
+
+void CaptainJack_MixInto(float *out, const float *in, size_t count, float gain) {
+	size_t i = 0;
+
+	// two vectors per iteration; the loads are what it waits on, not the math
+#if defined(CAPTAIN_JACK_SSE)
+	const __m128 gain4 = _mm_set1_ps(gain);
+
+	for (; i + 8 <= count; i += 8) {
+		__m128 a = _mm_loadu_ps(&in[i]);
+		__m128 b = _mm_loadu_ps(&in[i + 4]);
+#	if defined(CAPTAIN_JACK_FMA)
+		_mm_storeu_ps(&out[i], _mm_fmadd_ps(a, gain4, _mm_loadu_ps(&out[i])));
+		_mm_storeu_ps(&out[i + 4], _mm_fmadd_ps(b, gain4, _mm_loadu_ps(&out[i + 4])));
+#	else
+		_mm_storeu_ps(&out[i], _mm_add_ps(_mm_loadu_ps(&out[i]), _mm_mul_ps(a, gain4)));
+		_mm_storeu_ps(&out[i + 4], _mm_add_ps(_mm_loadu_ps(&out[i + 4]), _mm_mul_ps(b, gain4)));
+#	endif
+	}
+#elif defined(CAPTAIN_JACK_NEON)
+	const float32x4_t gain4 = vdupq_n_f32(gain);
+
+	for (; i + 8 <= count; i += 8) {
+#	if defined(__ARM_FEATURE_FMA)
+		vst1q_f32(&out[i], vfmaq_f32(vld1q_f32(&out[i]), vld1q_f32(&in[i]), gain4));
+		vst1q_f32(&out[i + 4], vfmaq_f32(vld1q_f32(&out[i + 4]), vld1q_f32(&in[i + 4]), gain4));
+#	else
+		vst1q_f32(&out[i], vmlaq_f32(vld1q_f32(&out[i]), vld1q_f32(&in[i]), gain4));
+		vst1q_f32(&out[i + 4], vmlaq_f32(vld1q_f32(&out[i + 4]), vld1q_f32(&in[i + 4]), gain4));
+#	endif
+	}
+#endif
+
+	for (; i < count; i++) {
+		out[i] += in[i] * gain;
+	}
+}
+
+bool CaptainJack_IsSilent(const float *samples, size_t count, float threshold) {
+	size_t i = 0;
+
+	// 16 samples per test; checking every vector would cost a branch each
+#if defined(CAPTAIN_JACK_SSE)
+	const __m128 sign = _mm_set1_ps(-0.0f);
+	const __m128 threshold4 = _mm_set1_ps(threshold);
+
+	for (; i + 16 <= count; i += 16) {
+		__m128 a = _mm_max_ps(_mm_andnot_ps(sign, _mm_loadu_ps(&samples[i])), _mm_andnot_ps(sign, _mm_loadu_ps(&samples[i + 4])));
+		__m128 b = _mm_max_ps(_mm_andnot_ps(sign, _mm_loadu_ps(&samples[i + 8])), _mm_andnot_ps(sign, _mm_loadu_ps(&samples[i + 12])));
+		if (_mm_movemask_ps(_mm_cmpgt_ps(_mm_max_ps(a, b), threshold4)) != 0) {
+			return false;
+		}
+	}
+#elif defined(CAPTAIN_JACK_NEON)
+	const float32x4_t threshold4 = vdupq_n_f32(threshold);
+
+	for (; i + 16 <= count; i += 16) {
+		float32x4_t a = vmaxq_f32(vabsq_f32(vld1q_f32(&samples[i])), vabsq_f32(vld1q_f32(&samples[i + 4])));
+		float32x4_t b = vmaxq_f32(vabsq_f32(vld1q_f32(&samples[i + 8])), vabsq_f32(vld1q_f32(&samples[i + 12])));
+		uint32x4_t louder = vcgtq_f32(vmaxq_f32(a, b), threshold4);
+		uint32x2_t folded = vorr_u32(vget_low_u32(louder), vget_high_u32(louder));
+		if ((vget_lane_u32(folded, 0) | vget_lane_u32(folded, 1)) != 0) {
+			return false;
+		}
+	}
+#endif
+
+	for (; i < count; i++) {
+		if (fabsf(samples[i]) > threshold) {
+			return false;
+		}
+	}
+
+	return true;
+}
@@ -0,0 +1,61 @@
+#ifndef CAPTAIN_JACK_DSP_H__
+#define CAPTAIN_JACK_DSP_H__
+/*
+	,---.         .              ,-_/
+	|  -' ,-. ,-. |- ,-. . ,-.   '  | ,-. ,-. . ,
+	|   . ,-| | | |  ,-| | | |      | ,-| |   |/
+	`---' `-^ |-' `' `-^ ' ' '      | `-^ `-' |\
+	          |                  /  |         ' `
+	          '                  `--'
+	          captain jack audio device
+	         github.com/qix-/captainjack
+
+	        copyright (c) 2016 josh junon
+	        released under the MIT license
+*/
+
+/*
+	sample crunching kernels used on the audio paths.
+
+	everything in here is real-time safe (no locks, no
+	allocation, no syscalls) and has SSE and NEON paths
+	with a scalar fallback, since the debug builds we
+	ship aren't optimized and can't be trusted to auto-
+	vectorize anything.
+*/
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+	scans a block of samples, returning the largest absolute
+	sample value in `peak` and the sum of the squared samples
+	in `squares`
+*/
+void CaptainJack_Measure(const float *samples, size_t count, float *peak, float *squares);
+
+/*
+	scales a block of interleaved frames in place, ramping
+	linearly from `from` to `to` across it so a gain change
+	lands within one buffer without a click
+*/
+void CaptainJack_Gain(float *samples, size_t frames, unsigned int channels, float from, float to);
+
+/*
+	adds a block of samples, scaled by `gain`, into another:
+	one send into a mix bus. uses fused multiply-adds where
+	the target has them (always on arm64, on x86 only when
+	built for a CPU with FMA3)
+*/
+void CaptainJack_MixInto(float *out, const float *in, size_t count, float gain);
+
+/*
+	returns true if no sample in the block is louder than
+	`threshold` (an absolute value). stops at the first one
+	that is, so it's cheapest on exactly the blocks it's
+	looking for: silent ones are read once, anything else
+	usually bails in the first few samples
+*/
+bool CaptainJack_IsSilent(const float *samples, size_t count, float threshold);
+
+#endif
@@ -0,0 +1,151 @@
+/*
+	,---.         .              ,-_/
+	|  -' ,-. ,-. |- ,-. . ,-.   '  | ,-. ,-. . ,
+	|   . ,-| | | |  ,-| | | |      | ,-| |   |/
+	`---' `-^ |-' `' `-^ ' ' '      | `-^ `-' |\
+	          |                  /  |         ' `
+	          '                  `--'
+	          captain jack audio device
+	         github.com/qix-/captainjack
+
+	        copyright (c) 2016 josh junon
+	        released under the MIT license
+*/
+
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include "clock.h"
+#include "log.h"
+
+#define kLog_Slots         256
+#define kLog_Length        192
+#define kLog_Window        1000000000ull
+#define kLog_DrainMicros   20000
+
+/*
+	a bounded multi-producer ring (Vyukov's): a slot is free for
+	position p when its sequence is p, and full when it's p + 1.
+
+	sequences are stored less the slot's index so the ring starts
+	out valid when zeroed, and nothing has to initialize it first.
+*/
+typedef struct {
+	unsigned long sequence;
+	int           level;
+	char          text[kLog_Length];
+} LogSlot;
+
+static LogSlot              gSlots[kLog_Slots];
+static unsigned long        gHead                 __attribute__((aligned(64))) = 0;
+static unsigned long        gTail                 __attribute__((aligned(64))) = 0;
+static unsigned long        gDropped              = 0;
+static pthread_once_t       gStartOnce            = PTHREAD_ONCE_INIT;
+
+static LogSlot * ClaimSlot(void) {
+	unsigned long position = __atomic_load_n(&gHead, __ATOMIC_RELAXED);
+
+	for (;;) {
+		LogSlot *slot = &gSlots[position % kLog_Slots];
+		long difference = (long) (__atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE) + position % kLog_Slots - position);
+
+		if (difference == 0) {
+			if (__atomic_compare_exchange_n(&gHead, &position, position + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+				return slot;
+			}
+		} else if (difference < 0) {
+			return NULL;
+		} else {
+			position = __atomic_load_n(&gHead, __ATOMIC_RELAXED);
+		}
+	}
+}
+
+static void Enqueue(int level, const char *format, va_list args, unsigned int suppressed) {
+	LogSlot *slot = ClaimSlot();
+	if (slot == NULL) {
+		__atomic_add_fetch(&gDropped, 1, __ATOMIC_RELAXED);
+		return;
+	}
+
+	slot->level = level;
+	int length = vsnprintf(slot->text, sizeof(slot->text), format, args);
+
+	if (suppressed && length >= 0 && (size_t) length < sizeof(slot->text)) {
+		snprintf(&slot->text[length], sizeof(slot->text) - length, " (and %u more like it)", suppressed);
+	}
+
+	// nobody else touches a claimed slot, so its sequence is still what we claimed it at
+	unsigned long position = __atomic_load_n(&slot->sequence, __ATOMIC_RELAXED);
+	__atomic_store_n(&slot->sequence, position + 1, __ATOMIC_RELEASE);
+}
+
+void CaptainJack_LogAt(CaptainJack_LogSite *site, int level, const char *format, ...) {
+	uint64_t now = CaptainJack_Now();
+	uint64_t window = __atomic_load_n(&site->window, __ATOMIC_RELAXED);
+	unsigned int suppressed = 0;
+
+	if (now - window >= kLog_Window) {
+		// racing threads might both start a window; that only lets an extra message through
+		__atomic_store_n(&site->window, now, __ATOMIC_RELAXED);
+		__atomic_store_n(&site->count, 0, __ATOMIC_RELAXED);
+		suppressed = __atomic_exchange_n(&site->suppressed, 0, __ATOMIC_RELAXED);
+	}
+
+	if (__atomic_add_fetch(&site->count, 1, __ATOMIC_RELAXED) > kLog_Burst) {
+		__atomic_add_fetch(&site->suppressed, 1, __ATOMIC_RELAXED);
+		return;
+	}
+
+	va_list args;
+	va_start(args, format);
+	Enqueue(level, format, args, suppressed);
+	va_end(args);
+}
+
+static void * DrainThread(void *arg) {
+	unsigned long reported = 0;
+
+	for (;;) {
+		for (;;) {
+			LogSlot *slot = &gSlots[gTail % kLog_Slots];
+			unsigned long base = gTail - gTail % kLog_Slots;
+			if (__atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE) != base + 1) {
+				break;
+			}
+
+			syslog(slot->level, "%s", slot->text);
+
+			__atomic_store_n(&slot->sequence, base + kLog_Slots, __ATOMIC_RELEASE);
+			gTail++;
+		}
+
+		unsigned long dropped = __atomic_load_n(&gDropped, __ATOMIC_RELAXED);
+		if (dropped != reported) {
+			syslog(LOG_WARNING, "CaptainJack_Log: log ring was full; dropped %lu messages", dropped - reported);
+			reported = dropped;
+		}
+
+		usleep(kLog_DrainMicros);
+	}
+
+	return NULL;
+}
+
+static void StartDrainThread(void) {
+	pthread_t thread;
+	int error = pthread_create(&thread, NULL, &DrainThread, NULL);
+	if (error != 0) {
+		syslog(LOG_ERR, "CaptainJack_StartLogger: could not start the log thread: %d", error);
+		return;
+	}
+
+	pthread_detach(thread);
+}
+
+void CaptainJack_StartLogger(void) {
+	pthread_once(&gStartOnce, &StartDrainThread);
+}
@@ -0,0 +1,71 @@
+#ifndef CAPTAIN_JACK_LOG_H__
+#define CAPTAIN_JACK_LOG_H__
+/*
+	,---.         .              ,-_/
+	|  -' ,-. ,-. |- ,-. . ,-.   '  | ,-. ,-. . ,
+	|   . ,-| | | |  ,-| | | |      | ,-| |   |/
+	`---' `-^ |-' `' `-^ ' ' '      | `-^ `-' |\
+	          |                  /  |         ' `
+	          '                  `--'
+	          captain jack audio device
+	         github.com/qix-/captainjack
+
+	        copyright (c) 2016 josh junon
+	        released under the MIT license
+*/
+
+/*
+	a logger that's safe to call from the audio threads.
+
+	syslog() takes locks and talks to syslogd, which is
+	the last thing you want to do from a HAL IO callback.
+	CaptainJack_Log() instead formats the message into a
+	preallocated ring and returns; a background thread
+	drains the ring into syslog. if the ring is full the
+	message is dropped (and counted) rather than waiting.
+
+	each call site is rate limited on its own: after a
+	burst of kLog_Burst messages in one second, the rest
+	are counted and tacked onto that site's next message
+	once the second is up, so a bad argument on every IO
+	cycle can't flood the log.
+
+	levels are the usual syslog ones. anything less severe
+	than CAPTAIN_JACK_LOG_LEVEL is compiled out entirely.
+*/
+
+#include <stdint.h>
+#include <sys/syslog.h>
+
+#ifndef CAPTAIN_JACK_LOG_LEVEL
+#	define CAPTAIN_JACK_LOG_LEVEL LOG_NOTICE
+#endif
+
+#define kLog_Burst  5
+
+typedef struct {
+	uint64_t     window;
+	unsigned int count;
+	unsigned int suppressed;
+} CaptainJack_LogSite;
+
+#define CaptainJack_Log(level, format, ...) \
+	do { \
+		if ((level) <= CAPTAIN_JACK_LOG_LEVEL) { \
+			static CaptainJack_LogSite _site; \
+			CaptainJack_LogAt(&_site, (level), format, ## __VA_ARGS__); \
+		} \
+	} while (0)
+
+/*
+	starts the thread that drains the ring into syslog.
+	messages logged before this are held in the ring.
+*/
+void CaptainJack_StartLogger(void);
+
+/*
+	queues a message; use CaptainJack_Log() instead
+*/
+void CaptainJack_LogAt(CaptainJack_LogSite *site, int level, const char *format, ...) __attribute__((format(printf, 3, 4)));
+
+#endif
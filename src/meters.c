@@ -0,0 +1,80 @@
+/*
+	,---.         .              ,-_/
+	|  -' ,-. ,-. |- ,-. . ,-.   '  | ,-. ,-. . ,
+	|   . ,-| | | |  ,-| | | |      | ,-| |   |/
+	`---' `-^ |-' `' `-^ ' ' '      | `-^ `-' |\
+	          |                  /  |         ' `
+	          '                  `--'
+	          captain jack audio device
+	         github.com/qix-/captainjack
+
+	        copyright (c) 2016 josh junon
+	        released under the MIT license
+*/
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syslog.h>
+#include <unistd.h>
+
+#include "meters.h"
+
+CaptainJack_MeterPage * CaptainJack_MapMeterPage(const char *path, bool writable) {
+	int fd = open(path, writable ? (O_RDWR | O_CREAT) : O_RDONLY, 0644);
+	if (fd < 0) {
+		syslog(LOG_ERR, "CaptainJack_MapMeterPage: could not open %s: %s", path, strerror(errno));
+		return NULL;
+	}
+
+	if (writable && ftruncate(fd, sizeof(CaptainJack_MeterPage)) != 0) {
+		syslog(LOG_ERR, "CaptainJack_MapMeterPage: could not size %s: %s", path, strerror(errno));
+		close(fd);
+		return NULL;
+	}
+
+	void *page = mmap(NULL, sizeof(CaptainJack_MeterPage), writable ? (PROT_READ | PROT_WRITE) : PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+
+	if (page == MAP_FAILED) {
+		syslog(LOG_ERR, "CaptainJack_MapMeterPage: could not map %s: %s", path, strerror(errno));
+		return NULL;
+	}
+
+	if (writable) {
+		memset(page, 0, sizeof(CaptainJack_MeterPage));
+		((CaptainJack_MeterPage *) page)->magic = kMeters_Magic;
+	}
+
+	return page;
+}
+
+void CaptainJack_BeginMeterUpdate(CaptainJack_MeterPage *page) {
+	__atomic_store_n(&page->sequence, page->sequence + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+void CaptainJack_EndMeterUpdate(CaptainJack_MeterPage *page) {
+	++page->updates;
+	__atomic_store_n(&page->sequence, page->sequence + 1, __ATOMIC_RELEASE);
+}
+
+bool CaptainJack_ReadMeterPage(const CaptainJack_MeterPage *page, CaptainJack_MeterPage *out) {
+	for (int attempt = 0; attempt < 100; attempt++) {
+		uint32_t before = __atomic_load_n(&page->sequence, __ATOMIC_ACQUIRE);
+		if (before & 1) {
+			usleep(100);
+			continue;
+		}
+
+		memcpy(out, page, sizeof(*out));
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+		if (__atomic_load_n(&page->sequence, __ATOMIC_RELAXED) == before) {
+			return out->magic == kMeters_Magic;
+		}
+	}
+
+	return false;
+}
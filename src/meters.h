@@ -0,0 +1,71 @@
+#ifndef CAPTAIN_JACK_METERS_H__
+#define CAPTAIN_JACK_METERS_H__
+/*
+	,---.         .              ,-_/
+	|  -' ,-. ,-. |- ,-. . ,-.   '  | ,-. ,-. . ,
+	|   . ,-| | | |  ,-| | | |      | ,-| |   |/
+	`---' `-^ |-' `' `-^ ' ' '      | `-^ `-' |\
+	          |                  /  |         ' `
+	          '                  `--'
+	          captain jack audio device
+	         github.com/qix-/captainjack
+
+	        copyright (c) 2016 josh junon
+	        released under the MIT license
+*/
+
+/*
+	per-client levels, published by the daemon into a
+	memory mapped file that any process can read.
+
+	the daemon is the only writer. the page is guarded by
+	a sequence counter that is odd while an update is in
+	progress; readers copy the page out and retry if the
+	counter moved underneath them, so nothing on either
+	side ever takes a lock.
+*/
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define kMeters_Magic        0x434a4d31
+#define kMeters_MaxClients   256
+#define kMeters_DefaultPath  "/var/run/captain-jack.meters"
+
+typedef struct {
+	uint32_t cid;
+	int32_t  pid;
+	char     name[40];
+	float    peak[2];
+	float    rms[2];
+} CaptainJack_MeterEntry;
+
+typedef struct {
+	uint32_t               magic;
+	uint32_t               sequence;
+	uint32_t               rate;
+	uint32_t               count;
+	uint64_t               updates;
+	CaptainJack_MeterEntry clients[kMeters_MaxClients];
+} CaptainJack_MeterPage;
+
+/*
+	maps the meter page at `path`, creating it if `writable`.
+	returns NULL on failure.
+*/
+CaptainJack_MeterPage * CaptainJack_MapMeterPage(const char *path, bool writable);
+
+/*
+	marks the page as being written; readers will retry
+	until CaptainJack_EndMeterUpdate() is called
+*/
+void CaptainJack_BeginMeterUpdate(CaptainJack_MeterPage *page);
+void CaptainJack_EndMeterUpdate(CaptainJack_MeterPage *page);
+
+/*
+	takes a consistent copy of the page. returns false if
+	the page isn't a meter page or stayed busy.
+*/
+bool CaptainJack_ReadMeterPage(const CaptainJack_MeterPage *page, CaptainJack_MeterPage *out);
+
+#endif
@@ -0,0 +1,126 @@
+#ifndef CAPTAIN_JACK_MPSC_H__
+#define CAPTAIN_JACK_MPSC_H__
+/*
+	,---.         .              ,-_/
+	|  -' ,-. ,-. |- ,-. . ,-.   '  | ,-. ,-. . ,
+	|   . ,-| | | |  ,-| | | |      | ,-| |   |/
+	`---' `-^ |-' `' `-^ ' ' '      | `-^ `-' |\
+	          |                  /  |         ' `
+	          '                  `--'
+	          captain jack audio device
+	         github.com/qix-/captainjack
+
+	        copyright (c) 2016 josh junon
+	        released under the MIT license
+*/
+
+/*
+	a bounded queue of fixed size items from any number of
+	producers to exactly one consumer, after Dmitry Vyukov's
+	bounded MPMC queue with the consumer's side simplified.
+
+	every cell carries a sequence number saying whose turn it
+	is: producers claim a cell by bumping the tail with a CAS,
+	fill it, then hand it over by storing the sequence; the
+	consumer hands it back the same way. there are no locks,
+	but a producer that's descheduled between claiming a cell
+	and filling it holds up the consumer (not the other
+	producers) until it runs again.
+
+	cells are a cache line each (or a multiple, for big items)
+	so producers filling neighbouring cells don't fight over
+	one. the storage is the caller's, 64 byte aligned, sized
+	with kMPSC_Bytes(); a full queue just says so.
+*/
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// the item goes after the cell's sequence number, 8 byte aligned
+#define kMPSC_ItemOffset            8
+#define kMPSC_Stride(size)          ((kMPSC_ItemOffset + (size) + 63) & ~(size_t) 63)
+#define kMPSC_Bytes(capacity, size) ((capacity) * kMPSC_Stride(size))
+
+typedef struct {
+	uint32_t  tail;
+	uint8_t   pad0[60];
+	uint32_t  head;
+	uint8_t   pad1[60];
+	uint32_t  mask;
+	size_t    size;
+	size_t    stride;
+	char     *cells;
+} __attribute__((aligned(64))) CaptainJack_MPSCQueue;
+
+static inline uint32_t * CaptainJack_MPSCCell(CaptainJack_MPSCQueue *q, uint32_t position) {
+	return (uint32_t *) &q->cells[(position & q->mask) * q->stride];
+}
+
+/*
+	`cells` is kMPSC_Bytes(capacity, size) bytes; `capacity`
+	has to be a power of two
+*/
+static inline void CaptainJack_InitMPSCQueue(CaptainJack_MPSCQueue *q, void *cells, uint32_t capacity, size_t size) {
+	q->tail = 0;
+	q->head = 0;
+	q->mask = capacity - 1;
+	q->size = size;
+	q->stride = kMPSC_Stride(size);
+	q->cells = cells;
+
+	for (uint32_t i = 0; i < capacity; i++) {
+		*CaptainJack_MPSCCell(q, i) = i;
+	}
+}
+
+/*
+	copies an item in; returns false if the queue is full.
+	any thread
+*/
+static inline bool CaptainJack_PushMPSC(CaptainJack_MPSCQueue *q, const void *item) {
+	uint32_t tail = __atomic_load_n(&q->tail, __ATOMIC_RELAXED);
+	uint32_t *cell;
+
+	for (;;) {
+		cell = CaptainJack_MPSCCell(q, tail);
+		int32_t turn = (int32_t) (__atomic_load_n(cell, __ATOMIC_ACQUIRE) - tail);
+
+		if (turn == 0) {
+			// ours if nobody beat us to it; if somebody did, `tail` is where they left it
+			if (__atomic_compare_exchange_n(&q->tail, &tail, tail + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+				break;
+			}
+		} else if (turn < 0) {
+			// the consumer hasn't emptied this one since last time around
+			return false;
+		} else {
+			tail = __atomic_load_n(&q->tail, __ATOMIC_RELAXED);
+		}
+	}
+
+	memcpy((char *) cell + kMPSC_ItemOffset, item, q->size);
+	__atomic_store_n(cell, tail + 1, __ATOMIC_RELEASE);
+	return true;
+}
+
+/*
+	copies the oldest item out; returns false if there isn't
+	one (or it's still being filled in). consumer only
+*/
+static inline bool CaptainJack_PopMPSC(CaptainJack_MPSCQueue *q, void *item) {
+	uint32_t head = q->head;
+	uint32_t *cell = CaptainJack_MPSCCell(q, head);
+
+	if (__atomic_load_n(cell, __ATOMIC_ACQUIRE) != head + 1) {
+		return false;
+	}
+
+	memcpy(item, (char *) cell + kMPSC_ItemOffset, q->size);
+	__atomic_store_n(cell, head + q->mask + 1, __ATOMIC_RELEASE);
+	q->head = head + 1;
+	return true;
+}
+
+#endif
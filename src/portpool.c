@@ -0,0 +1,164 @@
+/*
+	,---.         .              ,-_/
+	|  -' ,-. ,-. |- ,-. . ,-.   '  | ,-. ,-. . ,
+	|   . ,-| | | |  ,-| | | |      | ,-| |   |/
+	`---' `-^ |-' `' `-^ ' ' '      | `-^ `-' |\
+	          |                  /  |         ' `
+	          '                  `--'
+	          captain jack audio device
+	         github.com/qix-/captainjack
+
+	        copyright (c) 2016 josh junon
+	        released under the MIT license
+*/
+
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/syslog.h>
+
+#include "portpool.h"
+
+struct CaptainJack_PortPool {
+	pthread_mutex_t          lock;
+	pthread_cond_t           wake;
+	pthread_t                thread;
+	bool                     stopping;
+
+	CaptainJack_MakePortPair make;
+	CaptainJack_FreePortPair release;
+	void                    *context;
+
+	unsigned int             size;
+	unsigned int             count;
+	void                    *pairs[kPortPool_MaxPairs][2];
+	unsigned int             nextIndex;
+	CaptainJack_PortPoolStats stats;
+};
+
+/*
+	keeps the pool full. the pair's made with the lock let go,
+	since that's the slow part; only this thread ever adds to the
+	pool, so there's always room for it when it's done.
+*/
+static void * RefillMain(void *arg) {
+	CaptainJack_PortPool *pool = arg;
+	unsigned int failures = 0;
+
+	pthread_mutex_lock(&pool->lock);
+
+	while (!pool->stopping) {
+		if (pool->count >= pool->size || failures > 0) {
+			// a failed pair is retried when something's taken, not in a tight loop
+			failures = 0;
+			pthread_cond_wait(&pool->wake, &pool->lock);
+			continue;
+		}
+
+		unsigned int index = pool->nextIndex++;
+		pthread_mutex_unlock(&pool->lock);
+
+		void *pair[2] = { NULL, NULL };
+		bool made = pool->make(pool->context, index, pair);
+
+		pthread_mutex_lock(&pool->lock);
+		if (!made) {
+			pool->stats.failed++;
+			failures++;
+			continue;
+		}
+
+		pool->pairs[pool->count][0] = pair[0];
+		pool->pairs[pool->count][1] = pair[1];
+		pool->count++;
+		pool->stats.made++;
+	}
+
+	pthread_mutex_unlock(&pool->lock);
+	return NULL;
+}
+
+CaptainJack_PortPool * CaptainJack_StartPortPool(unsigned int size, CaptainJack_MakePortPair make, CaptainJack_FreePortPair release, void *context) {
+	CaptainJack_PortPool *pool = calloc(1, sizeof(*pool));
+	if (pool == NULL) {
+		syslog(LOG_ERR, "CaptainJack_StartPortPool: out of memory");
+		return NULL;
+	}
+
+	pool->size = size > kPortPool_MaxPairs ? kPortPool_MaxPairs : size;
+	pool->make = make;
+	pool->release = release;
+	pool->context = context;
+	pthread_mutex_init(&pool->lock, NULL);
+	pthread_cond_init(&pool->wake, NULL);
+
+	int error = pthread_create(&pool->thread, NULL, &RefillMain, pool);
+	if (error != 0) {
+		syslog(LOG_ERR, "CaptainJack_StartPortPool: could not start the refill thread: %s", strerror(error));
+		pthread_cond_destroy(&pool->wake);
+		pthread_mutex_destroy(&pool->lock);
+		free(pool);
+		return NULL;
+	}
+
+	syslog(LOG_NOTICE, "CaptainJack_StartPortPool: keeping %u spare port pairs", pool->size);
+	return pool;
+}
+
+void CaptainJack_StopPortPool(CaptainJack_PortPool *pool) {
+	if (pool == NULL) {
+		return;
+	}
+
+	pthread_mutex_lock(&pool->lock);
+	pool->stopping = true;
+	pthread_cond_signal(&pool->wake);
+	pthread_mutex_unlock(&pool->lock);
+
+	pthread_join(pool->thread, NULL);
+
+	while (pool->count > 0) {
+		pool->count--;
+		pool->release(pool->context, pool->pairs[pool->count]);
+	}
+
+	pthread_cond_destroy(&pool->wake);
+	pthread_mutex_destroy(&pool->lock);
+	free(pool);
+}
+
+bool CaptainJack_TakePortPair(CaptainJack_PortPool *pool, void *pair[2]) {
+	if (pool == NULL) {
+		return false;
+	}
+
+	pthread_mutex_lock(&pool->lock);
+
+	bool taken = pool->count > 0;
+	if (taken) {
+		pool->count--;
+		pair[0] = pool->pairs[pool->count][0];
+		pair[1] = pool->pairs[pool->count][1];
+		pool->stats.taken++;
+	} else {
+		pool->stats.empty++;
+	}
+
+	pthread_cond_signal(&pool->wake);
+	pthread_mutex_unlock(&pool->lock);
+
+	return taken;
+}
+
+void CaptainJack_GetPortPoolStats(CaptainJack_PortPool *pool, CaptainJack_PortPoolStats *stats) {
+	if (pool == NULL) {
+		memset(stats, 0, sizeof(*stats));
+		return;
+	}
+
+	pthread_mutex_lock(&pool->lock);
+	*stats = pool->stats;
+	stats->available = pool->count;
+	pthread_mutex_unlock(&pool->lock);
+}
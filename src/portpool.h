@@ -0,0 +1,81 @@
+#ifndef CAPTAIN_JACK_PORTPOOL_H__
+#define CAPTAIN_JACK_PORTPOOL_H__
+/*
+	,---.         .              ,-_/
+	|  -' ,-. ,-. |- ,-. . ,-.   '  | ,-. ,-. . ,
+	|   . ,-| | | |  ,-| | | |      | ,-| |   |/
+	`---' `-^ |-' `' `-^ ' ' '      | `-^ `-' |\
+	          |                  /  |         ' `
+	          '                  `--'
+	          captain jack audio device
+	         github.com/qix-/captainjack
+
+	        copyright (c) 2016 josh junon
+	        released under the MIT license
+*/
+
+/*
+	a few stereo port pairs kept registered ahead of time, so
+	a client that starts playing gets its ports straight away
+	instead of waiting on the JACK server (and reordering the
+	graph under everyone else's feet) right when it wants to
+	be heard.
+
+	the pool doesn't know about JACK itself: the caller says
+	how to make and get rid of a pair. a thread of its own
+	tops the pool back up whenever something is taken, so
+	the slow part always happens off to the side. taking a
+	pair never waits on that; an empty pool just says so,
+	and the caller makes one the slow way.
+*/
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define kPortPool_MaxPairs 32
+
+typedef struct CaptainJack_PortPool CaptainJack_PortPool;
+
+/*
+	makes the `index`th spare pair; false if it couldn't
+*/
+typedef bool (*CaptainJack_MakePortPair)(void *context, unsigned int index, void *pair[2]);
+
+/*
+	gets rid of a spare pair nobody took
+*/
+typedef void (*CaptainJack_FreePortPair)(void *context, void *pair[2]);
+
+typedef struct {
+	unsigned int available;
+	uint64_t     taken;
+	uint64_t     empty;
+	uint64_t     made;
+	uint64_t     failed;
+} CaptainJack_PortPoolStats;
+
+/*
+	starts filling a pool of `size` pairs (at most
+	kPortPool_MaxPairs) in the background. NULL if the
+	thread couldn't be started
+*/
+CaptainJack_PortPool * CaptainJack_StartPortPool(unsigned int size, CaptainJack_MakePortPair make, CaptainJack_FreePortPair release, void *context);
+
+/*
+	stops the refill thread and frees whatever's left in
+	the pool. NULL is fine
+*/
+void CaptainJack_StopPortPool(CaptainJack_PortPool *pool);
+
+/*
+	hands over a spare pair; false if there isn't one
+	right now. never waits for one to be made
+*/
+bool CaptainJack_TakePortPair(CaptainJack_PortPool *pool, void *pair[2]);
+
+/*
+	how the pool has been doing
+*/
+void CaptainJack_GetPortPoolStats(CaptainJack_PortPool *pool, CaptainJack_PortPoolStats *stats);
+
+#endif
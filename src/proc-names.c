@@ -0,0 +1,388 @@
+/*
+	,---.         .              ,-_/
+	|  -' ,-. ,-. |- ,-. . ,-.   '  | ,-. ,-. . ,
+	|   . ,-| | | |  ,-| | | |      | ,-| |   |/
+	`---' `-^ |-' `' `-^ ' ' '      | `-^ `-' |\
+	          |                  /  |         ' `
+	          '                  `--'
+	          captain jack audio device
+	         github.com/qix-/captainjack
+
+	        copyright (c) 2016 josh junon
+	        released under the MIT license
+*/
+
+#include <stdint.h>
+#include <string.h>
+
+#ifdef __APPLE__
+#	include <CoreFoundation/CoreFoundation.h>
+#	include <libproc.h>
+#else
+#	include <fcntl.h>
+#	include <stdio.h>
+#	include <stdlib.h>
+#	include <unistd.h>
+#endif
+
+#include "proc-names.h"
+
+// proc_name() never gives back more than 2 * MAXCOMLEN characters
+#define kName_Length   33
+#define kCache_Size    256
+#define kCache_Buckets 512
+
+typedef struct {
+	pid_t    pid;
+	uint64_t generation;
+	int16_t  name;
+	int16_t  next;
+	int16_t  newer;
+	int16_t  older;
+} CacheEntry;
+
+typedef struct {
+	char     value[kName_Length];
+	uint32_t hash;
+	uint16_t refs;
+	int16_t  next;
+} NameSlot;
+
+static bool                      gInitialized                 = false;
+static CacheEntry                gEntries[kCache_Size];
+static int16_t                   gEntryBuckets[kCache_Buckets];
+static int16_t                   gEntryFree                   = -1;
+static int16_t                   gEntryNewest                 = -1;
+static int16_t                   gEntryOldest                 = -1;
+static NameSlot                  gNames[kCache_Size];
+static int16_t                   gNameBuckets[kCache_Buckets];
+static int16_t                   gNameFree                    = -1;
+static CaptainJack_ProcNameStats gStats;
+static CaptainJack_ProcQuery     gQuery                       = NULL;
+
+static void InitializeCache(void) {
+	for (int i = 0; i < kCache_Buckets; i++) {
+		gEntryBuckets[i] = -1;
+		gNameBuckets[i] = -1;
+	}
+
+	// there are exactly as many name slots as entries, so interning can never run dry
+	for (int i = 0; i < kCache_Size; i++) {
+		gEntries[i].next = (i + 1 < kCache_Size) ? i + 1 : -1;
+		gNames[i].next = (i + 1 < kCache_Size) ? i + 1 : -1;
+	}
+
+	gEntryFree = 0;
+	gNameFree = 0;
+	gInitialized = true;
+}
+
+static uint32_t HashPID(pid_t pid) {
+	return ((uint32_t) pid * 2654435761u) % kCache_Buckets;
+}
+
+static uint32_t HashName(const char *name) {
+	uint32_t hash = 2166136261u;
+	for (; *name; name++) {
+		hash = (hash ^ (uint8_t) *name) * 16777619u;
+	}
+	return hash;
+}
+
+static int16_t InternName(const char *name) {
+	uint32_t hash = HashName(name);
+	int16_t *bucket = &gNameBuckets[hash % kCache_Buckets];
+
+	for (int16_t i = *bucket; i >= 0; i = gNames[i].next) {
+		if (gNames[i].hash == hash && strcmp(gNames[i].value, name) == 0) {
+			++gNames[i].refs;
+			return i;
+		}
+	}
+
+	int16_t slot = gNameFree;
+	gNameFree = gNames[slot].next;
+
+	strncpy(gNames[slot].value, name, kName_Length - 1);
+	gNames[slot].value[kName_Length - 1] = 0;
+	gNames[slot].hash = hash;
+	gNames[slot].refs = 1;
+	gNames[slot].next = *bucket;
+	*bucket = slot;
+
+	return slot;
+}
+
+static void ReleaseName(int16_t slot) {
+	if (--gNames[slot].refs > 0) {
+		return;
+	}
+
+	int16_t *link = &gNameBuckets[gNames[slot].hash % kCache_Buckets];
+	while (*link != slot) {
+		link = &gNames[*link].next;
+	}
+	*link = gNames[slot].next;
+
+	gNames[slot].next = gNameFree;
+	gNameFree = slot;
+}
+
+static void UnlinkRecency(int16_t i) {
+	if (gEntries[i].newer >= 0) {
+		gEntries[gEntries[i].newer].older = gEntries[i].older;
+	} else {
+		gEntryNewest = gEntries[i].older;
+	}
+
+	if (gEntries[i].older >= 0) {
+		gEntries[gEntries[i].older].newer = gEntries[i].newer;
+	} else {
+		gEntryOldest = gEntries[i].newer;
+	}
+}
+
+static void LinkNewest(int16_t i) {
+	gEntries[i].newer = -1;
+	gEntries[i].older = gEntryNewest;
+
+	if (gEntryNewest >= 0) {
+		gEntries[gEntryNewest].newer = i;
+	} else {
+		gEntryOldest = i;
+	}
+
+	gEntryNewest = i;
+}
+
+static void Touch(int16_t i) {
+	if (gEntryNewest != i) {
+		UnlinkRecency(i);
+		LinkNewest(i);
+	}
+}
+
+static int16_t FindEntry(pid_t pid) {
+	for (int16_t i = gEntryBuckets[HashPID(pid)]; i >= 0; i = gEntries[i].next) {
+		if (gEntries[i].pid == pid) {
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+static void RemoveEntry(int16_t i) {
+	int16_t *link = &gEntryBuckets[HashPID(gEntries[i].pid)];
+	while (*link != i) {
+		link = &gEntries[*link].next;
+	}
+	*link = gEntries[i].next;
+
+	UnlinkRecency(i);
+	ReleaseName(gEntries[i].name);
+
+	gEntries[i].next = gEntryFree;
+	gEntryFree = i;
+}
+
+static int16_t AllocateEntry(void) {
+	if (gEntryFree < 0) {
+		++gStats.evictions;
+		RemoveEntry(gEntryOldest);
+	}
+
+	int16_t i = gEntryFree;
+	gEntryFree = gEntries[i].next;
+	return i;
+}
+
+/*
+	asks the kernel for a process' name and start time in
+	a single query. the start time doubles as the entry
+	generation, since a recycled PID can't share it.
+*/
+static bool QueryProcess(pid_t pid, char *name, uint64_t *generation) {
+#ifdef __APPLE__
+	struct proc_bsdinfo info;
+	if (proc_pidinfo(pid, PROC_PIDTBSDINFO, 0, &info, sizeof(info)) != sizeof(info)) {
+		return false;
+	}
+
+	const char *source = info.pbi_name[0] ? info.pbi_name : info.pbi_comm;
+	size_t limit = info.pbi_name[0] ? sizeof(info.pbi_name) : sizeof(info.pbi_comm);
+	size_t length = strnlen(source, limit);
+	memcpy(name, source, length);
+	name[length] = 0;
+
+	*generation = (uint64_t) info.pbi_start_tvsec * 1000000 + info.pbi_start_tvusec;
+	return true;
+#else
+	// /proc/<pid>/stat is "pid (comm) state ..." with the start time as the 22nd field
+	char path[32];
+	char stat[512];
+	snprintf(path, sizeof(path), "/proc/%d/stat", (int) pid);
+
+	int fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		return false;
+	}
+
+	ssize_t nread = read(fd, stat, sizeof(stat) - 1);
+	close(fd);
+	if (nread <= 0) {
+		return false;
+	}
+	stat[nread] = 0;
+
+	char *lparen = strchr(stat, '(');
+	char *rparen = strrchr(stat, ')');
+	if (lparen == NULL || rparen == NULL || rparen < lparen) {
+		return false;
+	}
+
+	size_t length = (size_t) (rparen - lparen - 1);
+	if (length >= kName_Length) {
+		length = kName_Length - 1;
+	}
+	memcpy(name, lparen + 1, length);
+	name[length] = 0;
+
+	char *field = rparen + 1;
+	for (int i = 3; i < 22 && field != NULL; i++) {
+		field = strchr(field + 1, ' ');
+	}
+	if (field == NULL) {
+		return false;
+	}
+
+	*generation = strtoull(field + 1, NULL, 10);
+	return true;
+#endif
+}
+
+const char * CaptainJack_ResolveProcName(pid_t pid) {
+	if (!gInitialized) {
+		InitializeCache();
+	}
+
+	++gStats.lookups;
+
+	char name[kName_Length];
+	uint64_t generation;
+	int16_t i = FindEntry(pid);
+	bool found = gQuery != NULL ? gQuery(pid, name, sizeof(name), &generation) : QueryProcess(pid, name, &generation);
+
+	if (!found) {
+		// the process is gone; whatever we had for it is stale now
+		++gStats.failures;
+		if (i >= 0) {
+			RemoveEntry(i);
+		}
+		return NULL;
+	}
+
+	if (i >= 0) {
+		const char *cached = gNames[gEntries[i].name].value;
+		if (gEntries[i].generation == generation && strcmp(cached, name) == 0) {
+			++gStats.hits;
+			Touch(i);
+			return cached;
+		}
+
+		// either the PID was recycled or the process exec()'d into something else
+		++gStats.reused;
+		ReleaseName(gEntries[i].name);
+		gEntries[i].name = InternName(name);
+		gEntries[i].generation = generation;
+		Touch(i);
+		return gNames[gEntries[i].name].value;
+	}
+
+	++gStats.misses;
+	i = AllocateEntry();
+
+	gEntries[i].pid = pid;
+	gEntries[i].generation = generation;
+	gEntries[i].name = InternName(name);
+
+	int16_t *bucket = &gEntryBuckets[HashPID(pid)];
+	gEntries[i].next = *bucket;
+	*bucket = i;
+	LinkNewest(i);
+
+	return gNames[gEntries[i].name].value;
+}
+
+const char * CaptainJack_LookupProcName(pid_t pid) {
+	if (!gInitialized) {
+		return NULL;
+	}
+
+	int16_t i = FindEntry(pid);
+	if (i < 0) {
+		return NULL;
+	}
+
+	Touch(i);
+	return gNames[gEntries[i].name].value;
+}
+
+bool CaptainJack_ResolveProcPath(pid_t pid, char *out, size_t size) {
+#ifdef __APPLE__
+	return proc_pidpath(pid, out, (uint32_t) size) > 0;
+#else
+	char path[32];
+	snprintf(path, sizeof(path), "/proc/%d/exe", (int) pid);
+
+	ssize_t length = readlink(path, out, size - 1);
+	if (length < 0) {
+		return false;
+	}
+
+	out[length] = 0;
+	return true;
+#endif
+}
+
+bool CaptainJack_ResolveProcBundleID(pid_t pid, char *out, size_t size) {
+#ifdef __APPLE__
+	char path[PROC_PIDPATHINFO_MAXSIZE];
+	if (!CaptainJack_ResolveProcPath(pid, path, sizeof(path))) {
+		return false;
+	}
+
+	// helpers live inside their app's bundle; the outermost one is what users think of
+	char *app = strstr(path, ".app/");
+	if (app == NULL) {
+		return false;
+	}
+	app[4] = 0;
+
+	CFURLRef url = CFURLCreateFromFileSystemRepresentation(NULL, (const UInt8 *) path, strlen(path), true);
+	if (url == NULL) {
+		return false;
+	}
+
+	CFBundleRef bundle = CFBundleCreate(NULL, url);
+	CFRelease(url);
+	if (bundle == NULL) {
+		return false;
+	}
+
+	CFStringRef identifier = CFBundleGetIdentifier(bundle);
+	bool result = identifier != NULL && CFStringGetCString(identifier, out, (CFIndex) size, kCFStringEncodingUTF8);
+	CFRelease(bundle);
+	return result;
+#else
+	return false;
+#endif
+}
+
+void CaptainJack_SetProcQuery(CaptainJack_ProcQuery query) {
+	gQuery = query;
+}
+
+void CaptainJack_GetProcNameStats(CaptainJack_ProcNameStats *stats) {
+	*stats = gStats;
+}
@@ -0,0 +1,102 @@
+#ifndef CAPTAIN_JACK_PROC_NAMES_H__
+#define CAPTAIN_JACK_PROC_NAMES_H__
+/*
+	,---.         .              ,-_/
+	|  -' ,-. ,-. |- ,-. . ,-.   '  | ,-. ,-. . ,
+	|   . ,-| | | |  ,-| | | |      | ,-| |   |/
+	`---' `-^ |-' `' `-^ ' ' '      | `-^ `-' |\
+	          |                  /  |         ' `
+	          '                  `--'
+	          captain jack audio device
+	         github.com/qix-/captainjack
+
+	        copyright (c) 2016 josh junon
+	        released under the MIT license
+*/
+
+/*
+	a small PID -> process name cache for the daemon.
+
+	resolving a name means asking the kernel, which is
+	fine once per connect but not fine for everything
+	that wants the name afterwards (port names, routing,
+	metrics...). the cache holds a bounded number of
+	entries, evicts the least recently used one when it
+	fills up and keeps the names themselves interned in
+	a fixed arena, so nothing here ever allocates.
+
+	each entry remembers the process' start time (its
+	'generation') so a recycled PID is noticed on the
+	next resolve instead of handing out a stale name.
+
+	NOTE: this is not thread safe; call it from the
+	daemon's control thread only.
+*/
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+typedef struct {
+	unsigned long lookups;
+	unsigned long hits;
+	unsigned long misses;
+	unsigned long reused;
+	unsigned long evictions;
+	unsigned long failures;
+} CaptainJack_ProcNameStats;
+
+/*
+	resolves the name of a process, validating the cached
+	entry against the process' current generation. this
+	costs one kernel query, hit or miss; call it when a
+	client connects.
+
+	returns NULL if the process could not be queried.
+	the returned string stays valid until the entry is
+	evicted; copy it if you need it for longer.
+*/
+const char * CaptainJack_ResolveProcName(pid_t pid);
+
+/*
+	returns the cached name of a process without touching
+	the kernel, or NULL if the PID isn't cached. this is
+	O(1) and is what hot paths should be calling.
+*/
+const char * CaptainJack_LookupProcName(pid_t pid);
+
+/*
+	copies the executable path of a process into `out`.
+	this isn't cached; it's only needed when routing rules
+	ask for it.
+*/
+bool CaptainJack_ResolveProcPath(pid_t pid, char *out, size_t size);
+
+/*
+	copies the bundle identifier of the outermost .app
+	bundle the process' executable lives in into `out`.
+	returns false if it isn't in a bundle. not cached.
+*/
+bool CaptainJack_ResolveProcBundleID(pid_t pid, char *out, size_t size);
+
+/*
+	asks about a process instead of the kernel: its name
+	(at most `size` - 1 characters) and a generation that
+	changes when the PID is recycled. false if there's no
+	such process.
+*/
+typedef bool (*CaptainJack_ProcQuery)(pid_t pid, char *name, size_t size, uint64_t *generation);
+
+/*
+	replaces the kernel query, so bench-procnames can play
+	back made up processes; NULL puts the kernel back
+*/
+void CaptainJack_SetProcQuery(CaptainJack_ProcQuery query);
+
+/*
+	copies out the cache counters
+*/
+void CaptainJack_GetProcNameStats(CaptainJack_ProcNameStats *stats);
+
+#endif
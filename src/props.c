@@ -0,0 +1,129 @@
+/*
+	,---.         .              ,-_/
+	|  -' ,-. ,-. |- ,-. . ,-.   '  | ,-. ,-. . ,
+	|   . ,-| | | |  ,-| | | |      | ,-| |   |/
+	`---' `-^ |-' `' `-^ ' ' '      | `-^ `-' |\
+	          |                  /  |         ' `
+	          '                  `--'
+	          captain jack audio device
+	         github.com/qix-/captainjack
+
+	        copyright (c) 2016 josh junon
+	        released under the MIT license
+*/
+
+#include <string.h>
+
+#include "props.h"
+
+enum {
+	kSlot_Empty = 0,
+	kSlot_Filling,
+	kSlot_Ready
+};
+
+typedef struct {
+	uint32_t                state;
+	uint32_t                size;
+	CaptainJack_PropertyKey key;
+	const uint8_t          *data;
+} Slot;
+
+static Slot     gSlots[kProps_Slots];
+static uint8_t  gArena[kProps_Arena] __attribute__((aligned(16)));
+static uint32_t gArenaUsed = 0;
+
+static unsigned int HashKey(const CaptainJack_PropertyKey *key) {
+	uint32_t hash = key->object * 0x9E3779B1u;
+	hash ^= key->selector * 0x85EBCA6Bu;
+	hash ^= key->scope * 0xC2B2AE35u;
+	hash ^= key->element;
+	return (hash ^ (hash >> 16)) % kProps_Slots;
+}
+
+static bool SameKey(const CaptainJack_PropertyKey *left, const CaptainJack_PropertyKey *right) {
+	return left->object == right->object
+		&& left->selector == right->selector
+		&& left->scope == right->scope
+		&& left->element == right->element;
+}
+
+bool CaptainJack_LookupProperty(const CaptainJack_PropertyKey *key, uint32_t inDataSize, uint32_t *outDataSize, void *outData) {
+	unsigned int start = HashKey(key);
+
+	for (unsigned int i = 0; i < kProps_Slots; i++) {
+		Slot *slot = &gSlots[(start + i) % kProps_Slots];
+
+		uint32_t state = __atomic_load_n(&slot->state, __ATOMIC_ACQUIRE);
+		if (state == kSlot_Empty) {
+			return false;
+		}
+
+		// a slot that's still filling might be ours; treat it as a miss until it's ready
+		if (state != kSlot_Ready || !SameKey(&slot->key, key)) {
+			continue;
+		}
+
+		if (outData != NULL) {
+			if (slot->size > inDataSize) {
+				return false;
+			}
+
+			memcpy(outData, slot->data, slot->size);
+		}
+
+		*outDataSize = slot->size;
+		return true;
+	}
+
+	return false;
+}
+
+bool CaptainJack_CacheProperty(const CaptainJack_PropertyKey *key, uint32_t size, const void *data) {
+	if (size > kProps_MaxSize) {
+		return false;
+	}
+
+	/*
+		the answer gets its own copy up front. if the slot
+		can't be claimed afterwards the space is simply lost,
+		which can only happen a handful of times before the
+		table is full anyway.
+	*/
+	uint32_t offset = __atomic_load_n(&gArenaUsed, __ATOMIC_RELAXED);
+	do {
+		if (offset + size > kProps_Arena) {
+			return false;
+		}
+	} while (!__atomic_compare_exchange_n(&gArenaUsed, &offset, offset + ((size + 15) & ~15u), true, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+
+	memcpy(&gArena[offset], data, size);
+	data = &gArena[offset];
+
+	unsigned int start = HashKey(key);
+
+	for (unsigned int i = 0; i < kProps_Slots; i++) {
+		Slot *slot = &gSlots[(start + i) % kProps_Slots];
+
+		uint32_t state = __atomic_load_n(&slot->state, __ATOMIC_ACQUIRE);
+		if (state == kSlot_Ready && SameKey(&slot->key, key)) {
+			return true;
+		}
+
+		/*
+			two threads racing to cache the same answer can end
+			up with a slot each; the answers are identical, so
+			that only costs a slot.
+		*/
+		uint32_t expected = kSlot_Empty;
+		if (state == kSlot_Empty && __atomic_compare_exchange_n(&slot->state, &expected, kSlot_Filling, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+			slot->key = *key;
+			slot->size = size;
+			slot->data = data;
+			__atomic_store_n(&slot->state, kSlot_Ready, __ATOMIC_RELEASE);
+			return true;
+		}
+	}
+
+	return false;
+}
@@ -0,0 +1,58 @@
+#ifndef CAPTAIN_JACK_PROPS_H__
+#define CAPTAIN_JACK_PROPS_H__
+/*
+	,---.         .              ,-_/
+	|  -' ,-. ,-. |- ,-. . ,-.   '  | ,-. ,-. . ,
+	|   . ,-| | | |  ,-| | | |      | ,-| |   |/
+	`---' `-^ |-' `' `-^ ' ' '      | `-^ `-' |\
+	          |                  /  |         ' `
+	          '                  `--'
+	          captain jack audio device
+	         github.com/qix-/captainjack
+
+	        copyright (c) 2016 josh junon
+	        released under the MIT license
+*/
+
+/*
+	remembers the answers to property queries that can never
+	change (UIDs, names, available formats and rates, etc.)
+	so the device can answer them straight from a table
+	instead of walking its switches again.
+
+	the device decides what's immutable; this only stores the
+	bytes. slots and the arena space behind them are claimed
+	once and never freed, lookups don't take a lock and a slot
+	only becomes visible once its answer is completely
+	written.
+*/
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define kProps_Slots   512
+#define kProps_Arena   16384
+#define kProps_MaxSize 512
+
+typedef struct {
+	uint32_t object;
+	uint32_t selector;
+	uint32_t scope;
+	uint32_t element;
+} CaptainJack_PropertyKey;
+
+/*
+	looks up a cached answer. when outData is NULL only the
+	size is reported. returns false on a miss, or when
+	inDataSize can't hold the whole answer (the caller's slow
+	path knows how to truncate or complain)
+*/
+bool CaptainJack_LookupProperty(const CaptainJack_PropertyKey *key, uint32_t inDataSize, uint32_t *outDataSize, void *outData);
+
+/*
+	caches a complete answer. returns false if it's too big or
+	the table (or the arena the answers live in) is full
+*/
+bool CaptainJack_CacheProperty(const CaptainJack_PropertyKey *key, uint32_t size, const void *data);
+
+#endif
@@ -0,0 +1,524 @@
+/*
+	,---.         .              ,-_/
+	|  -' ,-. ,-. |- ,-. . ,-.   '  | ,-. ,-. . ,
+	|   . ,-| | | |  ,-| | | |      | ,-| |   |/
+	`---' `-^ |-' `' `-^ ' ' '      | `-^ `-' |\
+	          |                  /  |         ' `
+	          '                  `--'
+	          captain jack audio device
+	         github.com/qix-/captainjack
+
+	        copyright (c) 2016 josh junon
+	        released under the MIT license
+*/
+
+#include <errno.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/syslog.h>
+
+#include "routes.h"
+
+// one more than a full line, so a line that's too long is noticed
+#define kRoute_MaxTokens (5 + 3 * kRoute_MaxSends + 1)
+
+typedef struct {
+	CaptainJack_Route route;
+	const char       *pattern;
+	size_t            prefix;
+	bool              literal;
+	int32_t           next;
+} Rule;
+
+typedef struct {
+	char    label;
+	int32_t child;
+	int32_t sibling;
+	int32_t rules;
+} TrieNode;
+
+struct CaptainJack_Routes {
+	char     *text;
+	Rule     *rules;
+	size_t    ruleCount;
+	TrieNode *nodes;
+	size_t    nodeCount;
+	size_t    nodeCapacity;
+	int32_t   roots[kRouteKey_Count];
+	CaptainJack_RouteBus *buses;
+	size_t    busCount;
+};
+
+static const char *kRouteKey_Names[kRouteKey_Count] = {
+	"name",
+	"path",
+	"bundle",
+};
+
+static bool ReadFile(const char *path, char **out) {
+	FILE *file = fopen(path, "rb");
+	if (file == NULL) {
+		syslog(LOG_ERR, "CaptainJack_LoadRoutes: could not open %s: %s", path, strerror(errno));
+		return false;
+	}
+
+	fseek(file, 0, SEEK_END);
+	long length = ftell(file);
+	fseek(file, 0, SEEK_SET);
+
+	char *text = length < 0 ? NULL : malloc((size_t) length + 1);
+	if (text == NULL || fread(text, 1, (size_t) length, file) != (size_t) length) {
+		syslog(LOG_ERR, "CaptainJack_LoadRoutes: could not read %s", path);
+		free(text);
+		fclose(file);
+		return false;
+	}
+
+	text[length] = 0;
+	fclose(file);
+	*out = text;
+	return true;
+}
+
+/*
+	splits a line into whitespace separated tokens in place,
+	honoring double quotes and stopping at comments
+*/
+static size_t Tokenize(char *line, char **tokens) {
+	size_t count = 0;
+
+	while (*line && count < kRoute_MaxTokens) {
+		while (*line == ' ' || *line == '\t' || *line == '\r') {
+			++line;
+		}
+
+		if (*line == 0 || *line == '#') {
+			break;
+		}
+
+		if (*line == '"') {
+			tokens[count++] = ++line;
+			while (*line && *line != '"') {
+				++line;
+			}
+		} else {
+			tokens[count++] = line;
+			while (*line && *line != ' ' && *line != '\t' && *line != '\r') {
+				++line;
+			}
+		}
+
+		if (*line) {
+			*line++ = 0;
+		}
+	}
+
+	return count;
+}
+
+static int32_t AddNode(CaptainJack_Routes *routes, char label) {
+	if (routes->nodeCount == routes->nodeCapacity) {
+		size_t capacity = routes->nodeCapacity ? routes->nodeCapacity * 2 : 256;
+		TrieNode *nodes = realloc(routes->nodes, capacity * sizeof(*nodes));
+		if (nodes == NULL) {
+			return -1;
+		}
+		routes->nodes = nodes;
+		routes->nodeCapacity = capacity;
+	}
+
+	TrieNode *node = &routes->nodes[routes->nodeCount];
+	node->label = label;
+	node->child = -1;
+	node->sibling = -1;
+	node->rules = -1;
+
+	return (int32_t) routes->nodeCount++;
+}
+
+static int32_t FindChild(const TrieNode *nodes, int32_t parent, char label) {
+	for (int32_t i = nodes[parent].child; i >= 0; i = nodes[i].sibling) {
+		if (nodes[i].label == label) {
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+static int32_t InsertPrefix(CaptainJack_Routes *routes, int32_t node, const char *prefix, size_t length) {
+	for (size_t i = 0; i < length; i++) {
+		int32_t child = FindChild(routes->nodes, node, prefix[i]);
+		if (child < 0) {
+			if ((child = AddNode(routes, prefix[i])) < 0) {
+				return -1;
+			}
+			routes->nodes[child].sibling = routes->nodes[node].child;
+			routes->nodes[node].child = child;
+		}
+		node = child;
+	}
+
+	return node;
+}
+
+static bool ParseDestinations(char *list, unsigned int line, CaptainJack_Route *route) {
+	size_t channels = 0;
+	for (char *destination = strtok(list, ","); destination != NULL; destination = strtok(NULL, ",")) {
+		if (channels == kRoute_MaxChannels) {
+			syslog(LOG_ERR, "CaptainJack_LoadRoutes: line %u: more than %d destinations", line, kRoute_MaxChannels);
+			return false;
+		}
+
+		route->destinations[channels++] = strcmp(destination, "-") == 0 ? NULL : destination;
+	}
+
+	if (channels == 1) {
+		for (size_t i = 1; i < kRoute_MaxChannels; i++) {
+			route->destinations[i] = route->destinations[0];
+		}
+	}
+
+	return true;
+}
+
+static bool ParseDecibels(const char *token, float *gain) {
+	char *end;
+	float decibels = strtof(token, &end);
+	if (*end != 0 || end == token) {
+		return false;
+	}
+
+	*gain = powf(10.0f, decibels / 20.0f);
+	return true;
+}
+
+/*
+	everything after the destinations: `gain <dB>` and any
+	number of `send <bus> <dB>`
+*/
+static bool ParseOptions(char **tokens, size_t count, unsigned int line, CaptainJack_Route *route) {
+	for (size_t i = 0; i < count;) {
+		if (strcmp(tokens[i], "gain") == 0 && i + 1 < count) {
+			if (!ParseDecibels(tokens[i + 1], &route->gain)) {
+				syslog(LOG_ERR, "CaptainJack_LoadRoutes: line %u: expected `gain <dB>`", line);
+				return false;
+			}
+			i += 2;
+		} else if (strcmp(tokens[i], "send") == 0 && i + 2 < count) {
+			if (route->sendCount == kRoute_MaxSends) {
+				syslog(LOG_ERR, "CaptainJack_LoadRoutes: line %u: more than %d sends", line, kRoute_MaxSends);
+				return false;
+			}
+
+			CaptainJack_RouteSend *send = &route->sends[route->sendCount++];
+			send->bus = tokens[i + 1];
+			if (!ParseDecibels(tokens[i + 2], &send->gain)) {
+				syslog(LOG_ERR, "CaptainJack_LoadRoutes: line %u: expected `send <bus> <dB>`", line);
+				return false;
+			}
+			i += 3;
+		} else {
+			syslog(LOG_ERR, "CaptainJack_LoadRoutes: line %u: expected `gain <dB>` or `send <bus> <dB>`, got `%s`", line, tokens[i]);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static bool ParseRule(char **tokens, size_t count, unsigned int line, Rule *rule, CaptainJack_RouteKey *key) {
+	if (count < 3 || count == kRoute_MaxTokens) {
+		syslog(LOG_ERR, "CaptainJack_LoadRoutes: line %u: expected `<key> <pattern> <destinations> [gain <dB>] [send <bus> <dB>]...`", line);
+		return false;
+	}
+
+	for (*key = 0; *key < kRouteKey_Count; (*key)++) {
+		if (strcmp(tokens[0], kRouteKey_Names[*key]) == 0) {
+			break;
+		}
+	}
+
+	if (*key == kRouteKey_Count) {
+		syslog(LOG_ERR, "CaptainJack_LoadRoutes: line %u: unknown key `%s`", line, tokens[0]);
+		return false;
+	}
+
+	memset(rule, 0, sizeof(*rule));
+	rule->route.line = line;
+	rule->route.gain = 1.0f;
+	rule->pattern = tokens[1];
+	rule->prefix = strcspn(tokens[1], "*?");
+	rule->literal = tokens[1][rule->prefix] == 0;
+
+	return ParseDestinations(tokens[2], line, &rule->route) && ParseOptions(&tokens[3], count - 3, line, &rule->route);
+}
+
+static bool ParseBus(char **tokens, size_t count, unsigned int line, CaptainJack_RouteBus *bus) {
+	if (count < 3 || count == kRoute_MaxTokens) {
+		syslog(LOG_ERR, "CaptainJack_LoadRoutes: line %u: expected `bus <name> <destinations> [gain <dB>] [send <bus> <dB>]...`", line);
+		return false;
+	}
+
+	memset(bus, 0, sizeof(*bus));
+	bus->name = tokens[1];
+	bus->route.line = line;
+	bus->route.gain = 1.0f;
+
+	return ParseDestinations(tokens[2], line, &bus->route) && ParseOptions(&tokens[3], count - 3, line, &bus->route);
+}
+
+static const CaptainJack_RouteBus * FindBus(const CaptainJack_Routes *routes, const char *name) {
+	for (size_t i = 0; i < routes->busCount; i++) {
+		if (strcmp(routes->buses[i].name, name) == 0) {
+			return &routes->buses[i];
+		}
+	}
+
+	return NULL;
+}
+
+static bool CheckSends(const CaptainJack_Routes *routes, const CaptainJack_Route *route) {
+	for (unsigned int i = 0; i < route->sendCount; i++) {
+		if (FindBus(routes, route->sends[i].bus) == NULL) {
+			syslog(LOG_ERR, "CaptainJack_LoadRoutes: line %u: there's no bus called `%s`", route->line, route->sends[i].bus);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/*
+	depth first over the bus sends; `marks` is 1 for buses on
+	the current path and 2 for ones known not to loop
+*/
+static bool FeedsBack(const CaptainJack_Routes *routes, size_t index, uint8_t *marks) {
+	const CaptainJack_RouteBus *bus = &routes->buses[index];
+
+	if (marks[index] == 1) {
+		syslog(LOG_ERR, "CaptainJack_LoadRoutes: line %u: bus `%s` ends up sending into itself", bus->route.line, bus->name);
+		return true;
+	}
+
+	if (marks[index] == 2) {
+		return false;
+	}
+
+	marks[index] = 1;
+	for (unsigned int i = 0; i < bus->route.sendCount; i++) {
+		if (FeedsBack(routes, (size_t) (FindBus(routes, bus->route.sends[i].bus) - routes->buses), marks)) {
+			return true;
+		}
+	}
+	marks[index] = 2;
+
+	return false;
+}
+
+static bool CheckBuses(const CaptainJack_Routes *routes) {
+	for (size_t i = 0; i < routes->busCount; i++) {
+		const CaptainJack_RouteBus *bus = &routes->buses[i];
+
+		if (FindBus(routes, bus->name) != bus) {
+			syslog(LOG_ERR, "CaptainJack_LoadRoutes: line %u: there's already a bus called `%s`", bus->route.line, bus->name);
+			return false;
+		}
+
+		if (!CheckSends(routes, &bus->route)) {
+			return false;
+		}
+	}
+
+	uint8_t *marks = calloc(routes->busCount + 1, 1);
+	if (marks == NULL) {
+		return false;
+	}
+
+	for (size_t i = 0; i < routes->busCount; i++) {
+		if (FeedsBack(routes, i, marks)) {
+			free(marks);
+			return false;
+		}
+	}
+
+	free(marks);
+
+	for (size_t i = 0; i < routes->ruleCount; i++) {
+		if (!CheckSends(routes, &routes->rules[i].route)) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static bool MatchGlob(const char *pattern, const char *subject) {
+	const char *star = NULL;
+	const char *resume = NULL;
+
+	while (*subject) {
+		if (*pattern == '?' || (*pattern != '*' && *pattern == *subject)) {
+			++pattern;
+			++subject;
+		} else if (*pattern == '*') {
+			star = pattern++;
+			resume = subject;
+		} else if (star != NULL) {
+			pattern = star + 1;
+			subject = ++resume;
+		} else {
+			return false;
+		}
+	}
+
+	while (*pattern == '*') {
+		++pattern;
+	}
+
+	return *pattern == 0;
+}
+
+CaptainJack_Routes * CaptainJack_LoadRoutes(const char *path) {
+	CaptainJack_Routes *routes = calloc(1, sizeof(*routes));
+	if (routes == NULL) {
+		return NULL;
+	}
+
+	if (!ReadFile(path, &routes->text)) {
+		free(routes);
+		return NULL;
+	}
+
+	size_t capacity = 1;
+	for (const char *c = routes->text; *c; c++) {
+		capacity += *c == '\n';
+	}
+
+	CaptainJack_RouteKey *keys = malloc(capacity * sizeof(*keys));
+	routes->rules = malloc(capacity * sizeof(*routes->rules));
+	routes->buses = malloc(capacity * sizeof(*routes->buses));
+	if (keys == NULL || routes->rules == NULL || routes->buses == NULL) {
+		goto fail;
+	}
+
+	unsigned int line = 0;
+	for (char *next = routes->text; next != NULL;) {
+		char *current = next;
+		++line;
+
+		if ((next = strchr(current, '\n')) != NULL) {
+			*next++ = 0;
+		}
+
+		char *tokens[kRoute_MaxTokens];
+		size_t count = Tokenize(current, tokens);
+		if (count == 0) {
+			continue;
+		}
+
+		if (strcmp(tokens[0], "bus") == 0) {
+			if (!ParseBus(tokens, count, line, &routes->buses[routes->busCount])) {
+				goto fail;
+			}
+
+			++routes->busCount;
+			continue;
+		}
+
+		if (!ParseRule(tokens, count, line, &routes->rules[routes->ruleCount], &keys[routes->ruleCount])) {
+			goto fail;
+		}
+
+		++routes->ruleCount;
+	}
+
+	if (!CheckBuses(routes)) {
+		goto fail;
+	}
+
+	for (int key = 0; key < kRouteKey_Count; key++) {
+		if ((routes->roots[key] = AddNode(routes, 0)) < 0) {
+			goto fail;
+		}
+	}
+
+	// candidate lists are built back to front so each one ends up in file order
+	for (size_t i = routes->ruleCount; i-- > 0;) {
+		Rule *rule = &routes->rules[i];
+		int32_t node = InsertPrefix(routes, routes->roots[keys[i]], rule->pattern, rule->prefix);
+		if (node < 0) {
+			goto fail;
+		}
+
+		rule->next = routes->nodes[node].rules;
+		routes->nodes[node].rules = (int32_t) i;
+	}
+
+	free(keys);
+
+	syslog(LOG_NOTICE, "CaptainJack_LoadRoutes: loaded %zu rules (%zu trie nodes) and %zu buses from %s", routes->ruleCount, routes->nodeCount, routes->busCount, path);
+	return routes;
+
+fail:
+	free(keys);
+	CaptainJack_FreeRoutes(routes);
+	return NULL;
+}
+
+void CaptainJack_FreeRoutes(CaptainJack_Routes *routes) {
+	if (routes == NULL) {
+		return;
+	}
+
+	free(routes->nodes);
+	free(routes->rules);
+	free(routes->buses);
+	free(routes->text);
+	free(routes);
+}
+
+bool CaptainJack_RoutesUseKey(const CaptainJack_Routes *routes, CaptainJack_RouteKey key) {
+	const TrieNode *root = &routes->nodes[routes->roots[key]];
+	return root->child >= 0 || root->rules >= 0;
+}
+
+const CaptainJack_Route * CaptainJack_MatchRoute(const CaptainJack_Routes *routes, const CaptainJack_RouteSubject *subject) {
+	int32_t best = -1;
+
+	for (int key = 0; key < kRouteKey_Count; key++) {
+		const char *value = subject->keys[key];
+		if (value == NULL) {
+			continue;
+		}
+
+		int32_t node = routes->roots[key];
+		for (const char *c = value;; c++) {
+			// candidates are in file order, so anything past the best match so far can't win
+			for (int32_t i = routes->nodes[node].rules; i >= 0 && (best < 0 || i < best); i = routes->rules[i].next) {
+				const Rule *rule = &routes->rules[i];
+				if (rule->literal ? *c == 0 : MatchGlob(rule->pattern + rule->prefix, c)) {
+					best = i;
+					break;
+				}
+			}
+
+			if (*c == 0 || (node = FindChild(routes->nodes, node, *c)) < 0) {
+				break;
+			}
+		}
+	}
+
+	return best < 0 ? NULL : &routes->rules[best].route;
+}
+
+size_t CaptainJack_CountRouteBuses(const CaptainJack_Routes *routes) {
+	return routes->busCount;
+}
+
+const CaptainJack_RouteBus * CaptainJack_GetRouteBus(const CaptainJack_Routes *routes, size_t index) {
+	return &routes->buses[index];
+}
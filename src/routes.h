@@ -0,0 +1,162 @@
+#ifndef CAPTAIN_JACK_ROUTES_H__
+#define CAPTAIN_JACK_ROUTES_H__
+/*
+	,---.         .              ,-_/
+	|  -' ,-. ,-. |- ,-. . ,-.   '  | ,-. ,-. . ,
+	|   . ,-| | | |  ,-| | | |      | ,-| |   |/
+	`---' `-^ |-' `' `-^ ' ' '      | `-^ `-' |\
+	          |                  /  |         ' `
+	          '                  `--'
+	          captain jack audio device
+	         github.com/qix-/captainjack
+
+	        copyright (c) 2016 josh junon
+	        released under the MIT license
+*/
+
+/*
+	routing rules tell the daemon where a client's ports
+	should be connected to, based on what the client is.
+
+	a rules file is a list of lines like
+
+		# key     pattern            destinations                       gain
+		name      Safari             bus:in_1,bus:in_2
+		bundle    com.google.Chrome* bus:in_1,bus:in_2                  gain -3
+		path      *Slack.app*        system:playback_1,system:playback_2
+
+	where the key is one of `name` (the process name),
+	`path` (the executable path) or `bundle` (the bundle
+	identifier of the enclosing .app). patterns are globs
+	supporting `*` and `?`, and can be double quoted if
+	they contain spaces. destinations are JACK port names
+	in channel order; a single destination receives both
+	channels and `-` leaves a channel unconnected. gain is
+	in dB and defaults to 0.
+
+	the first matching rule in the file wins.
+
+	rules can also send the client into one or more of the
+	daemon's own mix buses, each with its own gain in dB:
+
+		name      Slack              -                   send comms 0
+		name      zoom.us            -                   send comms -3 send recorder 0
+		bus       comms              system:playback_1,system:playback_2
+		bus       recorder           -                   gain -6 send comms 0
+
+	a bus line declares a bus, where its own ports go and
+	its output gain; buses can send into other buses as long
+	as nothing ends up feeding itself. buses can be used
+	before they're declared.
+
+	rules are compiled into a prefix trie per key when the
+	file is loaded, so matching only ever runs the glob
+	matcher on rules whose literal prefix already matched.
+*/
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#define kRoute_MaxChannels 2
+#define kRoute_MaxSends    4
+
+typedef enum {
+	kRouteKey_Name = 0,
+	kRouteKey_Path,
+	kRouteKey_Bundle,
+	kRouteKey_Count
+} CaptainJack_RouteKey;
+
+typedef struct {
+	/*
+		name of the bus to send into
+	*/
+	const char *bus;
+
+	/*
+		linear gain the send applies
+	*/
+	float gain;
+} CaptainJack_RouteSend;
+
+typedef struct {
+	/*
+		JACK port to connect each channel to, or NULL
+	*/
+	const char *destinations[kRoute_MaxChannels];
+
+	/*
+		linear gain to apply to the client
+	*/
+	float gain;
+
+	/*
+		buses the client (or bus) is mixed into
+	*/
+	CaptainJack_RouteSend sends[kRoute_MaxSends];
+	unsigned int sendCount;
+
+	/*
+		line in the rules file this route came from
+	*/
+	unsigned int line;
+} CaptainJack_Route;
+
+typedef struct {
+	/*
+		the bus' name, as used in sends
+	*/
+	const char *name;
+
+	/*
+		where the bus' ports go, its output gain and the
+		buses it sends into
+	*/
+	CaptainJack_Route route;
+} CaptainJack_RouteBus;
+
+typedef struct {
+	/*
+		the values to match against, indexed by
+		CaptainJack_RouteKey; NULL values never match
+	*/
+	const char *keys[kRouteKey_Count];
+} CaptainJack_RouteSubject;
+
+typedef struct CaptainJack_Routes CaptainJack_Routes;
+
+/*
+	loads and compiles a rules file. returns NULL (and logs
+	why) if the file couldn't be read or has errors.
+*/
+CaptainJack_Routes * CaptainJack_LoadRoutes(const char *path);
+
+/*
+	frees a compiled rule set. any routes returned from it
+	are invalid afterwards.
+*/
+void CaptainJack_FreeRoutes(CaptainJack_Routes *routes);
+
+/*
+	whether any rule in the set matches on the given key;
+	lets callers skip resolving keys that are expensive
+	to look up (paths, bundle identifiers)
+*/
+bool CaptainJack_RoutesUseKey(const CaptainJack_Routes *routes, CaptainJack_RouteKey key);
+
+/*
+	returns the first route matching the subject, or NULL
+*/
+const CaptainJack_Route * CaptainJack_MatchRoute(const CaptainJack_Routes *routes, const CaptainJack_RouteSubject *subject);
+
+/*
+	number of buses declared in the set
+*/
+size_t CaptainJack_CountRouteBuses(const CaptainJack_Routes *routes);
+
+/*
+	returns a bus declared in the set, in file order
+*/
+const CaptainJack_RouteBus * CaptainJack_GetRouteBus(const CaptainJack_Routes *routes, size_t index);
+
+#endif
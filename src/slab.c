@@ -0,0 +1,152 @@
+/*
+	,---.         .              ,-_/
+	|  -' ,-. ,-. |- ,-. . ,-.   '  | ,-. ,-. . ,
+	|   . ,-| | | |  ,-| | | |      | ,-| |   |/
+	`---' `-^ |-' `' `-^ ' ' '      | `-^ `-' |\
+	          |                  /  |         ' `
+	          '                  `--'
+	          captain jack audio device
+	         github.com/qix-/captainjack
+
+	        copyright (c) 2016 josh junon
+	        released under the MIT license
+*/
+
+
+#include <string.h>
+
+#include "slab.h"
+
+bool CaptainJack_InitSlab(CaptainJack_Slab *slab, void *base, size_t length, const size_t *sizes, unsigned int count) {
+	memset(slab, 0, sizeof(*slab));
+
+	if (((uintptr_t) base & (kSlab_PageBytes - 1)) != 0 || count == 0 || count > kSlab_MaxClasses) {
+		return false;
+	}
+
+	for (unsigned int i = 0; i < count; i++) {
+		if (sizes[i] < kSlab_PageBytes || sizes[i] > kSlab_Bytes || (sizes[i] & (sizes[i] - 1)) != 0) {
+			return false;
+		}
+
+		slab->classes[i].slotBytes = sizes[i];
+	}
+
+	// smallest first, so the first class that fits is the best one
+	for (unsigned int i = 1; i < count; i++) {
+		for (unsigned int j = i; j > 0 && slab->classes[j].slotBytes < slab->classes[j - 1].slotBytes; j--) {
+			CaptainJack_SlabClass swap = slab->classes[j];
+			slab->classes[j] = slab->classes[j - 1];
+			slab->classes[j - 1] = swap;
+		}
+	}
+
+	slab->base = base;
+	slab->classCount = count;
+	slab->slabCount = (unsigned int) (length / kSlab_Bytes > kSlab_MaxSlabs ? kSlab_MaxSlabs : length / kSlab_Bytes);
+	slab->freeSlabs = slab->slabCount;
+
+	for (unsigned int i = 0; i < slab->slabCount; i++) {
+		slab->slabs[i].sizeClass = -1;
+	}
+
+	return true;
+}
+
+static int TakeSlot(CaptainJack_SlabInfo *info, unsigned int slots) {
+	for (unsigned int word = 0; word * 64 < slots; word++) {
+		if (info->free[word] != 0) {
+			int bit = __builtin_ctzll(info->free[word]);
+			info->free[word] &= info->free[word] - 1;
+			info->used++;
+			return (int) (word * 64) + bit;
+		}
+	}
+
+	return -1;
+}
+
+void * CaptainJack_SlabAlloc(CaptainJack_Slab *slab, size_t bytes) {
+	unsigned int c = 0;
+	while (c < slab->classCount && slab->classes[c].slotBytes < bytes) {
+		c++;
+	}
+
+	if (c == slab->classCount) {
+		return NULL;
+	}
+
+	CaptainJack_SlabClass *sizeClass = &slab->classes[c];
+	unsigned int slots = (unsigned int) (kSlab_Bytes / sizeClass->slotBytes);
+
+	// a slab the class already has, before a free one; that's what keeps the others whole
+	unsigned int chosen = slab->slabCount;
+	for (unsigned int i = 0; i < slab->slabCount; i++) {
+		CaptainJack_SlabInfo *info = &slab->slabs[i];
+		if (info->sizeClass == (int16_t) c && info->used < slots) {
+			chosen = i;
+			break;
+		}
+
+		if (info->sizeClass < 0 && chosen == slab->slabCount) {
+			chosen = i;
+		}
+	}
+
+	if (chosen == slab->slabCount) {
+		sizeClass->failures++;
+		return NULL;
+	}
+
+	CaptainJack_SlabInfo *info = &slab->slabs[chosen];
+	if (info->sizeClass < 0) {
+		info->sizeClass = (int16_t) c;
+		info->used = 0;
+		memset(info->free, 0, sizeof(info->free));
+		for (unsigned int slot = 0; slot < slots; slot++) {
+			info->free[slot / 64] |= 1ull << (slot % 64);
+		}
+		sizeClass->slabs++;
+		slab->freeSlabs--;
+	}
+
+	int slot = TakeSlot(info, slots);
+
+	sizeClass->used++;
+	sizeClass->allocations++;
+	slab->bytesUsed += sizeClass->slotBytes;
+	if (slab->bytesUsed > slab->peakBytesUsed) {
+		slab->peakBytesUsed = slab->bytesUsed;
+	}
+
+	return &slab->base[(size_t) chosen * kSlab_Bytes + (size_t) slot * sizeClass->slotBytes];
+}
+
+void CaptainJack_SlabFree(CaptainJack_Slab *slab, void *slot) {
+	if (slot == NULL) {
+		return;
+	}
+
+	size_t offset = CaptainJack_SlabOffset(slab, slot);
+	CaptainJack_SlabInfo *info = &slab->slabs[offset / kSlab_Bytes];
+	CaptainJack_SlabClass *sizeClass = &slab->classes[info->sizeClass];
+	size_t index = (offset % kSlab_Bytes) / sizeClass->slotBytes;
+
+	info->free[index / 64] |= 1ull << (index % 64);
+	info->used--;
+
+	sizeClass->used--;
+	sizeClass->frees++;
+	slab->bytesUsed -= sizeClass->slotBytes;
+
+	// an empty slab goes back for any class to use
+	if (info->used == 0) {
+		info->sizeClass = -1;
+		sizeClass->slabs--;
+		slab->freeSlabs++;
+	}
+}
+
+size_t CaptainJack_SlabOffset(const CaptainJack_Slab *slab, const void *slot) {
+	return (size_t) ((const char *) slot - slab->base);
+}
@@ -0,0 +1,104 @@
+#ifndef CAPTAIN_JACK_SLAB_H__
+#define CAPTAIN_JACK_SLAB_H__
+/*
+	,---.         .              ,-_/
+	|  -' ,-. ,-. |- ,-. . ,-.   '  | ,-. ,-. . ,
+	|   . ,-| | | |  ,-| | | |      | ,-| |   |/
+	`---' `-^ |-' `' `-^ ' ' '      | `-^ `-' |\
+	          |                  /  |         ' `
+	          '                  `--'
+	          captain jack audio device
+	         github.com/qix-/captainjack
+
+	        copyright (c) 2016 josh junon
+	        released under the MIT license
+*/
+
+/*
+	a slab allocator for rings in a shared memory region,
+	so clients can come and go all day without the region
+	fragmenting and without ever calling malloc.
+
+	the region is cut into slabs of kSlab_Bytes. a slab is
+	given to one size class when that class needs room, is
+	cut into equal slots, and goes back to being free once
+	its last slot is, so any class can have it next. slots
+	are page aligned, and every size is a power of two.
+
+	the bookkeeping lives in the CaptainJack_Slab itself,
+	not in the region, and is all fixed size: after init,
+	nothing allocates. it isn't thread safe; it's meant for
+	the daemon's main thread, where clients come and go.
+*/
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define kSlab_Bytes      (1u << 20)
+#define kSlab_MaxSlabs   256
+#define kSlab_MaxClasses 8
+#define kSlab_PageBytes  4096u
+#define kSlab_MaxSlots   (kSlab_Bytes / kSlab_PageBytes)
+
+// a slab's class (-1 while it's free) and which of its slots are free
+typedef struct {
+	int16_t  sizeClass;
+	uint16_t used;
+	uint64_t free[kSlab_MaxSlots / 64];
+} CaptainJack_SlabInfo;
+
+/*
+	one size class, and how it's doing: `slabs` it holds,
+	slots `used` in them, and counts of everything asked
+	of it (`failures` being allocations there was no room
+	for)
+*/
+typedef struct {
+	size_t       slotBytes;
+	unsigned int slabs;
+	unsigned int used;
+	uint64_t     allocations;
+	uint64_t     frees;
+	uint64_t     failures;
+} CaptainJack_SlabClass;
+
+typedef struct {
+	char                 *base;
+	unsigned int          slabCount;
+	unsigned int          freeSlabs;
+	unsigned int          classCount;
+	CaptainJack_SlabClass classes[kSlab_MaxClasses];
+	CaptainJack_SlabInfo  slabs[kSlab_MaxSlabs];
+	size_t                bytesUsed;
+	size_t                peakBytesUsed;
+} CaptainJack_Slab;
+
+/*
+	sets up a slab allocator over `length` bytes at `base`
+	(which has to be page aligned; anything past the last
+	whole slab, or kSlab_MaxSlabs of them, goes unused).
+	`sizes` are the size classes: powers of two, from a
+	page up to kSlab_Bytes. false if any of that's wrong
+*/
+bool CaptainJack_InitSlab(CaptainJack_Slab *slab, void *base, size_t length, const size_t *sizes, unsigned int count);
+
+/*
+	hands out a slot of the smallest class that holds
+	`bytes`, or NULL if there's no room (or no class that
+	big). the memory isn't cleared
+*/
+void * CaptainJack_SlabAlloc(CaptainJack_Slab *slab, size_t bytes);
+
+/*
+	gives a slot back. NULL is fine
+*/
+void CaptainJack_SlabFree(CaptainJack_Slab *slab, void *slot);
+
+/*
+	where a slot is in the region, for anything else that
+	maps it
+*/
+size_t CaptainJack_SlabOffset(const CaptainJack_Slab *slab, const void *slot);
+
+#endif
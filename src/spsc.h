@@ -0,0 +1,88 @@
+#ifndef CAPTAIN_JACK_SPSC_H__
+#define CAPTAIN_JACK_SPSC_H__
+/*
+	,---.         .              ,-_/
+	|  -' ,-. ,-. |- ,-. . ,-.   '  | ,-. ,-. . ,
+	|   . ,-| | | |  ,-| | | |      | ,-| |   |/
+	`---' `-^ |-' `' `-^ ' ' '      | `-^ `-' |\
+	          |                  /  |         ' `
+	          '                  `--'
+	          captain jack audio device
+	         github.com/qix-/captainjack
+
+	        copyright (c) 2016 josh junon
+	        released under the MIT license
+*/
+
+
+/*
+	a wait-free queue of fixed size commands from exactly one
+	producer to exactly one consumer: the counterpart to the
+	triple buffer for things that have to arrive one by one,
+	in order, rather than just the latest of them.
+
+	the storage is the caller's (any power of two number of
+	items), so it never allocates. each side only writes its
+	own index and reads the other's; a push or pop is one
+	acquire load and one release store. a full queue just
+	says so, and it's up to the producer to try again later.
+*/
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+typedef struct {
+	uint32_t  head;
+	uint8_t   pad0[60];
+	uint32_t  tail;
+	uint8_t   pad1[60];
+	uint32_t  mask;
+	size_t    size;
+	char     *items;
+} CaptainJack_SPSCQueue;
+
+/*
+	`items` has room for `capacity` items of `size` bytes;
+	`capacity` has to be a power of two
+*/
+static inline void CaptainJack_InitSPSCQueue(CaptainJack_SPSCQueue *q, void *items, uint32_t capacity, size_t size) {
+	q->head = 0;
+	q->tail = 0;
+	q->mask = capacity - 1;
+	q->size = size;
+	q->items = items;
+}
+
+/*
+	copies an item in; returns false if the queue is full.
+	producer only
+*/
+static inline bool CaptainJack_PushSPSC(CaptainJack_SPSCQueue *q, const void *item) {
+	uint32_t tail = __atomic_load_n(&q->tail, __ATOMIC_RELAXED);
+	if (tail - __atomic_load_n(&q->head, __ATOMIC_ACQUIRE) > q->mask) {
+		return false;
+	}
+
+	memcpy(&q->items[(tail & q->mask) * q->size], item, q->size);
+	__atomic_store_n(&q->tail, tail + 1, __ATOMIC_RELEASE);
+	return true;
+}
+
+/*
+	copies the oldest item out; returns false if there isn't
+	one. consumer only
+*/
+static inline bool CaptainJack_PopSPSC(CaptainJack_SPSCQueue *q, void *item) {
+	uint32_t head = __atomic_load_n(&q->head, __ATOMIC_RELAXED);
+	if (head == __atomic_load_n(&q->tail, __ATOMIC_ACQUIRE)) {
+		return false;
+	}
+
+	memcpy(item, &q->items[(head & q->mask) * q->size], q->size);
+	__atomic_store_n(&q->head, head + 1, __ATOMIC_RELEASE);
+	return true;
+}
+
+#endif
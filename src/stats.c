@@ -0,0 +1,324 @@
+/*
+	,---.         .              ,-_/
+	|  -' ,-. ,-. |- ,-. . ,-.   '  | ,-. ,-. . ,
+	|   . ,-| | | |  ,-| | | |      | ,-| |   |/
+	`---' `-^ |-' `' `-^ ' ' '      | `-^ `-' |\
+	          |                  /  |         ' `
+	          '                  `--'
+	          captain jack audio device
+	         github.com/qix-/captainjack
+
+	        copyright (c) 2016 josh junon
+	        released under the MIT license
+*/
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/syslog.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "clock.h"
+#include "stats.h"
+#include "xmit.h"
+
+#define kStats_Shards          16
+#define kStats_Connections     4
+#define kStats_ResponseSize    65536
+#define kStats_RequestTimeout  1000000000ull
+
+typedef struct {
+	uint64_t counters[kStat_Count];
+	uint64_t buckets[kHistogram_Count][kStats_Buckets];
+	uint64_t sums[kHistogram_Count];
+} __attribute__((aligned(64))) StatsShard;
+
+typedef struct {
+	int      fd;
+	uint64_t accepted;
+	char     tail[4];
+} Connection;
+
+static StatsShard           gShards[kStats_Shards];
+static unsigned int         gNextShard                         = 0;
+static __thread int         tShard                             = -1;
+static uint64_t             gGauges[kGauge_Count];
+
+static int                  gListenSocket                      = -1;
+static Connection           gConnections[kStats_Connections];
+static char                 gResponse[kStats_ResponseSize];
+
+static const char *kHistogram_Names[kHistogram_Count] = {
+	"captainjack_xmit_tick_seconds",
+	"captainjack_process_seconds",
+};
+
+static const char *kHistogram_Help[kHistogram_Count] = {
+	"Time spent in one xmitter tick on the daemon",
+	"Time spent in the daemon's JACK process callback",
+};
+
+static StatsShard * GetShard(void) {
+	if (tShard < 0) {
+		tShard = (int) (__atomic_fetch_add(&gNextShard, 1, __ATOMIC_RELAXED) % kStats_Shards);
+	}
+
+	return &gShards[tShard];
+}
+
+void CaptainJack_CountStat(CaptainJack_Stat stat, uint64_t amount) {
+	__atomic_fetch_add(&GetShard()->counters[stat], amount, __ATOMIC_RELAXED);
+}
+
+void CaptainJack_ObserveStat(CaptainJack_Histogram histogram, uint64_t nanoseconds) {
+	// bucket n holds everything under 2^(n + 10) ns; the last one is +Inf
+	int bucket = nanoseconds < 1024 ? 0 : (63 - __builtin_clzll(nanoseconds)) - 9;
+	if (bucket >= kStats_Buckets) {
+		bucket = kStats_Buckets - 1;
+	}
+
+	StatsShard *shard = GetShard();
+	__atomic_fetch_add(&shard->buckets[histogram][bucket], 1, __ATOMIC_RELAXED);
+	__atomic_fetch_add(&shard->sums[histogram], nanoseconds, __ATOMIC_RELAXED);
+}
+
+void CaptainJack_SetGauge(CaptainJack_Gauge gauge, double value) {
+	uint64_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	__atomic_store_n(&gGauges[gauge], bits, __ATOMIC_RELAXED);
+}
+
+static uint64_t SumCounter(int stat) {
+	uint64_t total = 0;
+	for (int i = 0; i < kStats_Shards; i++) {
+		total += __atomic_load_n(&gShards[i].counters[stat], __ATOMIC_RELAXED);
+	}
+	return total;
+}
+
+static double GetGauge(CaptainJack_Gauge gauge) {
+	uint64_t bits = __atomic_load_n(&gGauges[gauge], __ATOMIC_RELAXED);
+	double value;
+	memcpy(&value, &bits, sizeof(value));
+	return value;
+}
+
+void CaptainJack_AppendStats(CaptainJack_StatsWriter *writer, const char *format, ...) {
+	if (writer->length >= writer->capacity) {
+		return;
+	}
+
+	va_list args;
+	va_start(args, format);
+	int written = vsnprintf(&writer->data[writer->length], writer->capacity - writer->length, format, args);
+	va_end(args);
+
+	if (written > 0) {
+		writer->length += (size_t) written;
+		if (writer->length > writer->capacity) {
+			writer->length = writer->capacity;
+		}
+	}
+}
+
+static void WriteMessageCounter(CaptainJack_StatsWriter *writer, const char *name, const char *help, int base) {
+	CaptainJack_AppendStats(writer, "# HELP %s %s\n# TYPE %s counter\n", name, help, name);
+
+	// skip XMPC_NONE; it never goes over the wire
+	for (int type = 1; type < kStats_MessageTypes; type++) {
+		const char *label = CaptainJack_XmitMessageName(type);
+		if (label != NULL) {
+			CaptainJack_AppendStats(writer, "%s{type=\"%s\"} %llu\n", name, label, (unsigned long long) SumCounter(base + type));
+		}
+	}
+}
+
+static void WriteCounter(CaptainJack_StatsWriter *writer, const char *name, const char *help, int stat) {
+	CaptainJack_AppendStats(writer, "# HELP %s %s\n# TYPE %s counter\n%s %llu\n", name, help, name, name, (unsigned long long) SumCounter(stat));
+}
+
+static void WriteGauge(CaptainJack_StatsWriter *writer, const char *name, const char *help, CaptainJack_Gauge gauge) {
+	CaptainJack_AppendStats(writer, "# HELP %s %s\n# TYPE %s gauge\n%s %g\n", name, help, name, name, GetGauge(gauge));
+}
+
+static void WriteHistogram(CaptainJack_StatsWriter *writer, CaptainJack_Histogram histogram) {
+	const char *name = kHistogram_Names[histogram];
+	CaptainJack_AppendStats(writer, "# HELP %s %s\n# TYPE %s histogram\n", name, kHistogram_Help[histogram], name);
+
+	uint64_t count = 0;
+	uint64_t sum = 0;
+	for (int bucket = 0; bucket < kStats_Buckets; bucket++) {
+		for (int i = 0; i < kStats_Shards; i++) {
+			count += __atomic_load_n(&gShards[i].buckets[histogram][bucket], __ATOMIC_RELAXED);
+		}
+
+		if (bucket < kStats_Buckets - 1) {
+			CaptainJack_AppendStats(writer, "%s_bucket{le=\"%g\"} %llu\n", name, (double) (1ull << (bucket + 10)) / 1e9, (unsigned long long) count);
+		} else {
+			CaptainJack_AppendStats(writer, "%s_bucket{le=\"+Inf\"} %llu\n", name, (unsigned long long) count);
+		}
+	}
+
+	for (int i = 0; i < kStats_Shards; i++) {
+		sum += __atomic_load_n(&gShards[i].sums[histogram], __ATOMIC_RELAXED);
+	}
+
+	CaptainJack_AppendStats(writer, "%s_sum %g\n%s_count %llu\n", name, sum / 1e9, name, (unsigned long long) count);
+}
+
+static void WriteStats(CaptainJack_StatsWriter *writer) {
+	WriteMessageCounter(writer, "captainjack_xmit_messages_sent_total", "Xmit messages sent, by type", kStat_XmitMessagesSent);
+	WriteMessageCounter(writer, "captainjack_xmit_messages_received_total", "Xmit messages received, by type", kStat_XmitMessagesReceived);
+	WriteCounter(writer, "captainjack_xmit_bytes_sent_total", "Xmit bytes sent", kStat_XmitBytesSent);
+	WriteCounter(writer, "captainjack_xmit_bytes_received_total", "Xmit bytes received", kStat_XmitBytesReceived);
+	WriteCounter(writer, "captainjack_xmit_reconnects_total", "Xmit connections (re)established", kStat_XmitReconnects);
+	WriteCounter(writer, "captainjack_xmit_errors_total", "Xmit socket errors", kStat_XmitErrors);
+	WriteCounter(writer, "captainjack_xmit_dropped_total", "Xmit messages that fell out of the window before the daemon had them", kStat_XmitDropped);
+	WriteCounter(writer, "captainjack_xmit_retransmits_total", "Xmit messages sent again to a daemon that reconnected", kStat_XmitRetransmits);
+	WriteCounter(writer, "captainjack_xmit_resyncs_total", "Xmit snapshots sent to a daemon that had to start over", kStat_XmitResyncs);
+	WriteCounter(writer, "captainjack_xmit_stalls_total", "Xmit connections dropped because the daemon stopped acknowledging", kStat_XmitStalls);
+	WriteCounter(writer, "captainjack_xmit_duplicates_total", "Xmit messages received more than once", kStat_XmitDuplicates);
+	WriteCounter(writer, "captainjack_xmit_lost_total", "Xmit messages missing from the sequence", kStat_XmitLost);
+	WriteCounter(writer, "captainjack_xmit_late_total", "Xmit messages received more than 50ms after they were sent", kStat_XmitLate);
+	WriteCounter(writer, "captainjack_xmit_queue_full_total", "HAL callbacks that found the xmit event queue full and had to wait", kStat_XmitQueueFull);
+	WriteCounter(writer, "captainjack_xmit_coalesced_total", "Xmit IO start and stop messages never sent because they cancelled each other out", kStat_XmitCoalesced);
+	WriteGauge(writer, "captainjack_xmit_pending_bytes", "Bytes waiting in the xmit socket buffer", kGauge_XmitPendingBytes);
+	WriteCounter(writer, "captainjack_jack_xruns_total", "JACK xruns", kStat_JackXruns);
+	WriteCounter(writer, "captainjack_port_buffers_written_total", "Client port buffers filled by the process callback", kStat_PortBuffersWritten);
+	WriteCounter(writer, "captainjack_port_buffers_skipped_total", "Client port buffers left alone because the client was silent", kStat_PortBuffersSkipped);
+	WriteCounter(writer, "captainjack_port_registrations_total", "Client port pairs registered with JACK", kStat_PortRegistrations);
+	WriteCounter(writer, "captainjack_io_debounced_total", "Client IO stops taken back before the client's ports were released", kStat_IODebounced);
+	WriteGauge(writer, "captainjack_jack_cpu_load", "JACK DSP load, in percent", kGauge_JackCPULoad);
+	WriteGauge(writer, "captainjack_clients", "Connected audio clients", kGauge_Clients);
+	WriteGauge(writer, "captainjack_buses", "Mix buses declared in the routing rules", kGauge_Buses);
+	WriteGauge(writer, "captainjack_bus_sends", "Sends into mix buses in the current schedule", kGauge_BusSends);
+
+	for (int histogram = 0; histogram < kHistogram_Count; histogram++) {
+		WriteHistogram(writer, histogram);
+	}
+}
+
+bool CaptainJack_StartStatsServer(uint16_t port) {
+	for (int i = 0; i < kStats_Connections; i++) {
+		gConnections[i].fd = -1;
+	}
+
+	gListenSocket = socket(PF_INET, SOCK_STREAM, 0);
+	if (gListenSocket < 0) {
+		syslog(LOG_ERR, "CaptainJack_StartStatsServer: could not create a socket: %s", strerror(errno));
+		return false;
+	}
+
+	int value = 1;
+	setsockopt(gListenSocket, SOL_SOCKET, SO_REUSEADDR, &value, sizeof(value));
+
+	struct sockaddr_in addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = PF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	addr.sin_port = htons(port);
+
+	if (bind(gListenSocket, (const struct sockaddr *) &addr, sizeof(addr)) != 0 || listen(gListenSocket, kStats_Connections) != 0) {
+		syslog(LOG_ERR, "CaptainJack_StartStatsServer: could not listen on 127.0.0.1:%d: %s", port, strerror(errno));
+		close(gListenSocket);
+		gListenSocket = -1;
+		return false;
+	}
+
+	fcntl(gListenSocket, F_SETFL, O_NONBLOCK);
+
+	syslog(LOG_NOTICE, "CaptainJack_StartStatsServer: serving stats on 127.0.0.1:%d", port);
+	return true;
+}
+
+static void Respond(Connection *connection, void (*collect)(CaptainJack_StatsWriter *)) {
+	static const size_t kHeaderSize = 128;
+	CaptainJack_StatsWriter body = { &gResponse[kHeaderSize], 0, sizeof(gResponse) - kHeaderSize };
+
+	WriteStats(&body);
+	if (collect != NULL) {
+		collect(&body);
+	}
+
+	char header[kHeaderSize];
+	int headerLength = snprintf(header, sizeof(header),
+		"HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: %zu\r\n\r\n",
+		body.length);
+
+	// the header goes right in front of the body so it's all one send
+	char *response = &gResponse[kHeaderSize - headerLength];
+	memcpy(response, header, (size_t) headerLength);
+
+	// localhost buffers are big enough for this, but don't let a stuck scraper hang the loop
+	struct timeval timeout = { 0, 100000 };
+	fcntl(connection->fd, F_SETFL, 0);
+	setsockopt(connection->fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+	size_t total = (size_t) headerLength + body.length;
+	for (size_t sent = 0; sent < total;) {
+		ssize_t result = send(connection->fd, &response[sent], total - sent, 0);
+		if (result <= 0) {
+			break;
+		}
+		sent += (size_t) result;
+	}
+
+	close(connection->fd);
+	connection->fd = -1;
+}
+
+void CaptainJack_TickStatsServer(void (*collect)(CaptainJack_StatsWriter *)) {
+	if (gListenSocket < 0) {
+		return;
+	}
+
+	uint64_t now = CaptainJack_Now();
+
+	for (int i = 0; i < kStats_Connections; i++) {
+		if (gConnections[i].fd >= 0) {
+			continue;
+		}
+
+		int fd = accept(gListenSocket, NULL, NULL);
+		if (fd < 0) {
+			break;
+		}
+
+		fcntl(fd, F_SETFL, O_NONBLOCK);
+		gConnections[i].fd = fd;
+		gConnections[i].accepted = now;
+		memset(gConnections[i].tail, 0, sizeof(gConnections[i].tail));
+	}
+
+	for (int i = 0; i < kStats_Connections; i++) {
+		Connection *connection = &gConnections[i];
+		if (connection->fd < 0) {
+			continue;
+		}
+
+		// whatever was asked for, the answer's the same; just wait for the request to end
+		char buffer[512];
+		ssize_t nread;
+		bool ended = false;
+		while ((nread = recv(connection->fd, buffer, sizeof(buffer), 0)) > 0) {
+			for (ssize_t c = 0; c < nread; c++) {
+				memmove(connection->tail, &connection->tail[1], 3);
+				connection->tail[3] = buffer[c];
+				ended = ended || memcmp(connection->tail, "\r\n\r\n", 4) == 0;
+			}
+		}
+
+		if (nread == 0 || (nread < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) {
+			close(connection->fd);
+			connection->fd = -1;
+		} else if (ended || now - connection->accepted > kStats_RequestTimeout) {
+			Respond(connection, collect);
+		}
+	}
+}
@@ -0,0 +1,116 @@
+#ifndef CAPTAIN_JACK_STATS_H__
+#define CAPTAIN_JACK_STATS_H__
+/*
+	,---.         .              ,-_/
+	|  -' ,-. ,-. |- ,-. . ,-.   '  | ,-. ,-. . ,
+	|   . ,-| | | |  ,-| | | |      | ,-| |   |/
+	`---' `-^ |-' `' `-^ ' ' '      | `-^ `-' |\
+	          |                  /  |         ' `
+	          '                  `--'
+	          captain jack audio device
+	         github.com/qix-/captainjack
+
+	        copyright (c) 2016 josh junon
+	        released under the MIT license
+*/
+
+/*
+	counters, gauges and histograms, and a tiny HTTP server
+	that exposes them in the Prometheus text format.
+
+	counters and histograms are sharded per thread and are
+	only ever touched with relaxed atomics, so bumping one
+	from the JACK process thread or a HAL IO thread costs
+	about as much as a plain increment. shards are summed
+	up when something scrapes the server.
+
+	the server is polled from the daemon's main loop and
+	only listens on the loopback interface.
+*/
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define kStats_MessageTypes 8
+#define kStats_Buckets      22
+
+typedef enum {
+	kStat_XmitMessagesSent     = 0,
+	kStat_XmitMessagesReceived = kStat_XmitMessagesSent + kStats_MessageTypes,
+	kStat_XmitBytesSent        = kStat_XmitMessagesReceived + kStats_MessageTypes,
+	kStat_XmitBytesReceived,
+	kStat_XmitReconnects,
+	kStat_XmitErrors,
+	kStat_XmitDropped,
+	kStat_XmitRetransmits,
+	kStat_XmitResyncs,
+	kStat_XmitStalls,
+	kStat_XmitDuplicates,
+	kStat_XmitLost,
+	kStat_XmitLate,
+	kStat_XmitQueueFull,
+	kStat_XmitCoalesced,
+	kStat_JackXruns,
+	kStat_PortBuffersWritten,
+	kStat_PortBuffersSkipped,
+	kStat_PortRegistrations,
+	kStat_IODebounced,
+	kStat_Count
+} CaptainJack_Stat;
+
+typedef enum {
+	kHistogram_XmitTick = 0,
+	kHistogram_Process,
+	kHistogram_Count
+} CaptainJack_Histogram;
+
+typedef enum {
+	kGauge_XmitPendingBytes = 0,
+	kGauge_Clients,
+	kGauge_JackCPULoad,
+	kGauge_Buses,
+	kGauge_BusSends,
+	kGauge_Count
+} CaptainJack_Gauge;
+
+typedef struct {
+	char   *data;
+	size_t  length;
+	size_t  capacity;
+} CaptainJack_StatsWriter;
+
+/*
+	adds to a counter
+*/
+void CaptainJack_CountStat(CaptainJack_Stat stat, uint64_t amount);
+
+/*
+	records a duration, in nanoseconds, into a histogram
+*/
+void CaptainJack_ObserveStat(CaptainJack_Histogram histogram, uint64_t nanoseconds);
+
+/*
+	sets a gauge
+*/
+void CaptainJack_SetGauge(CaptainJack_Gauge gauge, double value);
+
+/*
+	starts listening for scrapes on 127.0.0.1:port
+*/
+bool CaptainJack_StartStatsServer(uint16_t port);
+
+/*
+	answers any pending scrapes. `collect` (which may be NULL)
+	is called to append anything that isn't a plain stat.
+
+	call this from the same loop that ticks the xmitter.
+*/
+void CaptainJack_TickStatsServer(void (*collect)(CaptainJack_StatsWriter *));
+
+/*
+	printf()s into a scrape response
+*/
+void CaptainJack_AppendStats(CaptainJack_StatsWriter *writer, const char *format, ...);
+
+#endif
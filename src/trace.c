@@ -0,0 +1,124 @@
+/*
+	,---.         .              ,-_/
+	|  -' ,-. ,-. |- ,-. . ,-.   '  | ,-. ,-. . ,
+	|   . ,-| | | |  ,-| | | |      | ,-| |   |/
+	`---' `-^ |-' `' `-^ ' ' '      | `-^ `-' |\
+	          |                  /  |         ' `
+	          '                  `--'
+	          captain jack audio device
+	         github.com/qix-/captainjack
+
+	        copyright (c) 2016 josh junon
+	        released under the MIT license
+*/
+
+#include "trace.h"
+
+#ifdef CAPTAIN_JACK_TRACE
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/syslog.h>
+#include <unistd.h>
+
+static CaptainJack_TraceRing gRings[kTrace_Threads];
+static unsigned int          gRingCount            = 0;
+static __thread CaptainJack_TraceRing *tRing       = NULL;
+static __thread bool         tRingClaimed          = false;
+static uint64_t              gBaseTicks            = 0;
+static uint64_t              gBaseTime             = 0;
+
+CaptainJack_TraceRing * CaptainJack_GetTraceRing(void) {
+	if (!tRingClaimed) {
+		tRingClaimed = true;
+
+		unsigned int index = __atomic_fetch_add(&gRingCount, 1, __ATOMIC_RELAXED);
+		if (index == 0) {
+			// one end of the line the dump maps ticks onto the clock with
+			gBaseTime = CaptainJack_Now();
+			__atomic_store_n(&gBaseTicks, CaptainJack_TraceTicks(), __ATOMIC_RELEASE);
+		}
+
+		if (index < kTrace_Threads) {
+			tRing = &gRings[index];
+		}
+	}
+
+	return tRing;
+}
+
+static void DumpRing(FILE *file, unsigned int index, int pid, double scale, bool *first) {
+	static CaptainJack_TraceEvent events[kTrace_Events];
+	CaptainJack_TraceRing *ring = &gRings[index];
+
+	uint64_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+	uint64_t start = head > kTrace_Events ? head - kTrace_Events : 0;
+	for (uint64_t i = start; i < head; i++) {
+		events[i - start] = ring->events[i % kTrace_Events];
+	}
+
+	// the owner kept going while we copied; anything it lapped is garbage
+	uint64_t after = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+	uint64_t valid = after > kTrace_Events ? after - kTrace_Events : 0;
+
+	unsigned int depth = 0;
+	for (uint64_t i = start > valid ? start : valid; i < head; i++) {
+		const CaptainJack_TraceEvent *event = &events[i - start];
+
+		// ends whose begin already fell off the ring would confuse the viewer
+		if (event->phase == 'E' && depth == 0) {
+			continue;
+		}
+		depth += event->phase == 'B' ? 1 : -1;
+
+		fprintf(file, "%s\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":%d,\"tid\":%u}",
+			*first ? "" : ",",
+			event->name,
+			event->category,
+			event->phase,
+			(gBaseTime + ((double) event->time - (double) gBaseTicks) * scale) / 1000.0,
+			pid,
+			index + 1);
+		*first = false;
+	}
+}
+
+bool CaptainJack_DumpTrace(const char *path) {
+	FILE *file = fopen(path, "w");
+	if (file == NULL) {
+		syslog(LOG_ERR, "CaptainJack_DumpTrace: could not open %s: %s", path, strerror(errno));
+		return false;
+	}
+
+	unsigned int count = __atomic_load_n(&gRingCount, __ATOMIC_RELAXED);
+	if (count > kTrace_Threads) {
+		count = kTrace_Threads;
+	}
+
+	// the other end of the line
+	uint64_t ticks = CaptainJack_TraceTicks();
+	uint64_t time = CaptainJack_Now();
+	uint64_t baseTicks = __atomic_load_n(&gBaseTicks, __ATOMIC_ACQUIRE);
+	double scale = ticks > baseTicks && time > gBaseTime ? (double) (time - gBaseTime) / (ticks - baseTicks) : 1.0;
+
+	int pid = (int) getpid();
+	bool first = true;
+
+	fprintf(file, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+	for (unsigned int i = 0; i < count; i++) {
+		DumpRing(file, i, pid, scale, &first);
+	}
+	fprintf(file, "\n]}\n");
+
+	bool ok = ferror(file) == 0;
+	if (fclose(file) != 0 || !ok) {
+		syslog(LOG_ERR, "CaptainJack_DumpTrace: could not write %s", path);
+		return false;
+	}
+
+	syslog(LOG_NOTICE, "CaptainJack_DumpTrace: wrote %s", path);
+	return true;
+}
+
+#endif
@@ -0,0 +1,109 @@
+#ifndef CAPTAIN_JACK_TRACE_H__
+#define CAPTAIN_JACK_TRACE_H__
+/*
+	,---.         .              ,-_/
+	|  -' ,-. ,-. |- ,-. . ,-.   '  | ,-. ,-. . ,
+	|   . ,-| | | |  ,-| | | |      | ,-| |   |/
+	`---' `-^ |-' `' `-^ ' ' '      | `-^ `-' |\
+	          |                  /  |         ' `
+	          '                  `--'
+	          captain jack audio device
+	         github.com/qix-/captainjack
+
+	        copyright (c) 2016 josh junon
+	        released under the MIT license
+*/
+
+/*
+	a trace recorder for the hot paths.
+
+	begin/end events go into a ring owned by the calling
+	thread (a timestamp, two pointers and a store; no locks
+	and no syscalls), and CaptainJack_DumpTrace() writes
+	whatever the rings still hold out as Chrome trace JSON
+	that chrome://tracing or ui.perfetto.dev can open.
+
+	events are stamped with the raw cycle counter where
+	there is one, which is a good deal cheaper than going
+	through the clock, and are converted when dumped. the
+	dump is in the same clock in the device and the daemon,
+	so the two line up when loaded side by side.
+
+	category and name must be string literals (or otherwise
+	live forever); only the pointers are recorded.
+
+	this is all compiled out unless CAPTAIN_JACK_TRACE is
+	defined (`make TRACE=1`).
+*/
+
+#include <stdbool.h>
+
+#ifdef CAPTAIN_JACK_TRACE
+
+#include "clock.h"
+
+#define kTrace_Events   4096
+#define kTrace_Threads  32
+
+typedef struct {
+	uint64_t    time;
+	const char *category;
+	const char *name;
+	char        phase;
+} CaptainJack_TraceEvent;
+
+typedef struct {
+	uint64_t               head;
+	CaptainJack_TraceEvent events[kTrace_Events];
+} __attribute__((aligned(64))) CaptainJack_TraceRing;
+
+/*
+	gets (or claims) the calling thread's ring. NULL if every
+	ring has been claimed already.
+*/
+CaptainJack_TraceRing * CaptainJack_GetTraceRing(void);
+
+static inline uint64_t CaptainJack_TraceTicks(void) {
+#if defined(__x86_64__) || defined(__i386__)
+	return __builtin_ia32_rdtsc();
+#elif defined(__aarch64__)
+	uint64_t ticks;
+	__asm__ __volatile__ ("mrs %0, cntvct_el0" : "=r" (ticks));
+	return ticks;
+#else
+	return CaptainJack_Now();
+#endif
+}
+
+static inline void CaptainJack_TraceEvent_(char phase, const char *category, const char *name) {
+	CaptainJack_TraceRing *ring = CaptainJack_GetTraceRing();
+	if (ring == NULL) {
+		return;
+	}
+
+	uint64_t head = ring->head;
+	CaptainJack_TraceEvent *event = &ring->events[head % kTrace_Events];
+	event->time = CaptainJack_TraceTicks();
+	event->category = category;
+	event->name = name;
+	event->phase = phase;
+	__atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+}
+
+/*
+	writes every thread's recent events to `path`
+*/
+bool CaptainJack_DumpTrace(const char *path);
+
+#	define CaptainJack_TraceBegin(category, name) CaptainJack_TraceEvent_('B', (category), (name))
+#	define CaptainJack_TraceEnd(category, name)   CaptainJack_TraceEvent_('E', (category), (name))
+#else
+#	define CaptainJack_TraceBegin(category, name) ((void) 0)
+#	define CaptainJack_TraceEnd(category, name)   ((void) 0)
+
+static inline bool CaptainJack_DumpTrace(const char *path) {
+	return false;
+}
+#endif
+
+#endif
@@ -0,0 +1,174 @@
+/*
+	,---.         .              ,-_/
+	|  -' ,-. ,-. |- ,-. . ,-.   '  | ,-. ,-. . ,
+	|   . ,-| | | |  ,-| | | |      | ,-| |   |/
+	`---' `-^ |-' `' `-^ ' ' '      | `-^ `-' |\
+	          |                  /  |         ' `
+	          '                  `--'
+	          captain jack audio device
+	         github.com/qix-/captainjack
+
+	        copyright (c) 2016 josh junon
+	        released under the MIT license
+*/
+
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syslog.h>
+#include <unistd.h>
+
+#if defined(__linux__)
+#	include <sys/vfs.h>
+#	define kTransport_HugeTLBMagic 0x958458f6
+#elif defined(__APPLE__)
+#	include <mach/vm_statistics.h>
+#endif
+
+#include "transport.h"
+
+#define kTransport_PageBytes 4096u
+
+static size_t RoundUp(size_t bytes, size_t to) {
+	return (bytes + to - 1) & ~(to - 1);
+}
+
+static void * MapAnonymous(size_t length, unsigned int flags, bool *huge) {
+	void *region = MAP_FAILED;
+	int populate = 0;
+
+#if defined(MAP_POPULATE)
+	populate = (flags & kTransportFlag_Prefault) ? MAP_POPULATE : 0;
+#endif
+
+	if (flags & kTransportFlag_HugePages) {
+#if defined(MAP_HUGETLB)
+		// only works if the admin has set some huge pages aside
+		region = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANON | MAP_HUGETLB | populate, -1, 0);
+#elif defined(VM_FLAGS_SUPERPAGE_SIZE_2MB)
+		// OS/X takes the superpage size where the descriptor would go
+		region = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANON, VM_FLAGS_SUPERPAGE_SIZE_2MB, 0);
+#endif
+		*huge = region != MAP_FAILED;
+	}
+
+	if (region == MAP_FAILED) {
+		region = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANON | populate, -1, 0);
+	}
+
+	return region;
+}
+
+static void * MapFile(const char *path, size_t length, unsigned int flags, bool *huge) {
+	int fd = open(path, O_RDWR | O_CREAT, 0644);
+	if (fd < 0) {
+		syslog(LOG_ERR, "CaptainJack_MapTransport: could not open %s: %s", path, strerror(errno));
+		return MAP_FAILED;
+	}
+
+	// down to nothing first, so whatever was left in it from last time comes back as fresh zeroes
+	if (ftruncate(fd, 0) != 0 || ftruncate(fd, (off_t) length) != 0) {
+		syslog(LOG_ERR, "CaptainJack_MapTransport: could not size %s: %s", path, strerror(errno));
+		close(fd);
+		return MAP_FAILED;
+	}
+
+#if defined(__linux__)
+	// a file on hugetlbfs is huge pages whatever it's mapped with
+	struct statfs fs;
+	*huge = fstatfs(fd, &fs) == 0 && (unsigned long) fs.f_type == kTransport_HugeTLBMagic;
+#endif
+
+	int populate = 0;
+#if defined(MAP_POPULATE)
+	populate = (flags & kTransportFlag_Prefault) ? MAP_POPULATE : 0;
+#endif
+
+	void *region = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_SHARED | populate, fd, 0);
+	close(fd);
+
+	if (region == MAP_FAILED) {
+		syslog(LOG_ERR, "CaptainJack_MapTransport: could not map %s: %s", path, strerror(errno));
+	}
+
+	return region;
+}
+
+bool CaptainJack_MapTransport(CaptainJack_Transport *transport, const char *path, size_t ringBytes, unsigned int flags) {
+	memset(transport, 0, sizeof(*transport));
+
+	size_t headerBytes = RoundUp(sizeof(CaptainJack_TransportHeader), kTransport_PageBytes);
+	size_t length = RoundUp(headerBytes + ringBytes, (flags & kTransportFlag_HugePages) ? kTransport_HugePageBytes : kTransport_PageBytes);
+
+	bool huge = false;
+	void *region = path != NULL ? MapFile(path, length, flags, &huge) : MapAnonymous(length, flags, &huge);
+	if (region == MAP_FAILED) {
+		return false;
+	}
+
+#if defined(MADV_HUGEPAGE)
+	// otherwise ask for transparent huge pages; it's up to the kernel whether they happen
+	if ((flags & kTransportFlag_HugePages) && !huge) {
+		(void) madvise(region, length, MADV_HUGEPAGE);
+	}
+#endif
+
+	/*
+		writing every page faults it in (for writing, which
+		reading wouldn't) now, rather than the first time a
+		ring wraps around onto it. it's all zeroes already,
+		so that's what gets written.
+	*/
+	if (flags & kTransportFlag_Prefault) {
+		memset(region, 0, length);
+	}
+
+	if (flags & kTransportFlag_Lock) {
+		if (mlock(region, length) == 0) {
+			transport->locked = true;
+		} else {
+			syslog(LOG_WARNING, "CaptainJack_MapTransport: could not lock %zu bytes (%s); the rings can be paged out", length, strerror(errno));
+		}
+	}
+
+	transport->header = region;
+	transport->rings = (char *) region + headerBytes;
+	transport->ringBytes = length - headerBytes;
+	transport->length = length;
+	transport->huge = huge;
+
+	transport->header->rings = kTransport_MaxRings;
+	__atomic_store_n(&transport->header->magic, kTransport_Magic, __ATOMIC_RELEASE);
+
+	return true;
+}
+
+void CaptainJack_UnmapTransport(CaptainJack_Transport *transport) {
+	if (transport->header != NULL) {
+		munmap(transport->header, transport->length);
+	}
+
+	memset(transport, 0, sizeof(*transport));
+}
+
+void CaptainJack_PublishRing(CaptainJack_Transport *transport, unsigned int index, unsigned int cid, void *samples, size_t bytes) {
+	CaptainJack_RingEntry *entry = &transport->header->entries[index];
+	CaptainJack_RingIndices *indices = &transport->header->indices[index];
+
+	// out of use while it changes, so the device never sees half of it
+	__atomic_store_n(&entry->offset, 0, __ATOMIC_RELEASE);
+
+	__atomic_store_n(&indices->write, 0, __ATOMIC_RELAXED);
+	__atomic_store_n(&indices->read, 0, __ATOMIC_RELAXED);
+	entry->bytes = (uint32_t) bytes;
+	entry->cid = cid;
+
+	__atomic_store_n(&entry->offset, (uint64_t) ((char *) samples - (char *) transport->header), __ATOMIC_RELEASE);
+}
+
+void CaptainJack_RetractRing(CaptainJack_Transport *transport, unsigned int index) {
+	__atomic_store_n(&transport->header->entries[index].offset, 0, __ATOMIC_RELEASE);
+}
@@ -0,0 +1,123 @@
+#ifndef CAPTAIN_JACK_TRANSPORT_H__
+#define CAPTAIN_JACK_TRANSPORT_H__
+/*
+	,---.         .              ,-_/
+	|  -' ,-. ,-. |- ,-. . ,-.   '  | ,-. ,-. . ,
+	|   . ,-| | | |  ,-| | | |      | ,-| |   |/
+	`---' `-^ |-' `' `-^ ' ' '      | `-^ `-' |\
+	          |                  /  |         ' `
+	          '                  `--'
+	          captain jack audio device
+	         github.com/qix-/captainjack
+
+	        copyright (c) 2016 josh junon
+	        released under the MIT license
+*/
+
+/*
+	the shared region client rings live in, between the
+	daemon and the device. both touch it every cycle, so
+	it's set up once to never cost anything after that:
+	huge pages where the system has them (fewer TLB misses
+	across hundreds of rings), every page faulted in up
+	front and locked so none of them can be paged out
+	from under the process callback.
+
+	the region starts with a header the device finds the
+	rings by: one entry per ring (where its samples are)
+	and its indices, and the word it wakes the daemon
+	through once it's written to them (see wake.h). the
+	producer's index and the consumer's each get a cache
+	line of their own, away from the samples, so neither
+	side's stores bounce the other's lines (or the
+	samples) between cores. the rings themselves come
+	after the header, page aligned, for the daemon to
+	carve up however it likes.
+*/
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "wake.h"
+
+#define kTransport_Magic          0x434a5452
+#define kTransport_MaxRings       256
+#define kTransport_HugePageBytes  (2u << 20)
+
+typedef enum {
+	kTransportFlag_HugePages = 1 << 0,
+	kTransportFlag_Prefault  = 1 << 1,
+	kTransportFlag_Lock      = 1 << 2,
+	kTransportFlag_All       = kTransportFlag_HugePages | kTransportFlag_Prefault | kTransportFlag_Lock
+} CaptainJack_TransportFlags;
+
+// a ring's indices, in frames; `write` is the producer's, `read` the consumer's
+typedef struct {
+	uint32_t write;
+	uint8_t  pad0[60];
+	uint32_t read;
+	uint8_t  pad1[60];
+} CaptainJack_RingIndices;
+
+/*
+	where a ring's samples are, from the start of the
+	region. `offset` is 0 while the entry isn't in use
+	(the header is always there)
+*/
+typedef struct {
+	uint64_t offset;
+	uint32_t bytes;
+	uint32_t cid;
+} CaptainJack_RingEntry;
+
+typedef struct {
+	uint32_t                magic;
+	uint32_t                rings;
+	uint8_t                 pad[56];
+	CaptainJack_WakeWord    wake;
+	CaptainJack_RingEntry   entries[kTransport_MaxRings];
+	CaptainJack_RingIndices indices[kTransport_MaxRings];
+} CaptainJack_TransportHeader;
+
+/*
+	a mapped region. `rings` is everything after the
+	header, `ringBytes` long. `huge` and `locked` say what
+	the system actually went along with
+*/
+typedef struct {
+	CaptainJack_TransportHeader *header;
+	void                        *rings;
+	size_t                       ringBytes;
+	size_t                       length;
+	bool                         huge;
+	bool                         locked;
+} CaptainJack_Transport;
+
+/*
+	maps (and clears) a region at `path` with at least
+	`ringBytes` for rings, or an anonymous one if `path` is
+	NULL (which only this process and its children see).
+	`flags` is what to try; anything the system won't do
+	is logged and left out rather than failing. false if
+	there's no region at all
+*/
+bool CaptainJack_MapTransport(CaptainJack_Transport *transport, const char *path, size_t ringBytes, unsigned int flags);
+
+/*
+	unmaps a region
+*/
+void CaptainJack_UnmapTransport(CaptainJack_Transport *transport);
+
+/*
+	puts a ring (somewhere in `rings`) in entry `index`,
+	with both its indices back at zero
+*/
+void CaptainJack_PublishRing(CaptainJack_Transport *transport, unsigned int index, unsigned int cid, void *samples, size_t bytes);
+
+/*
+	takes entry `index` out of use
+*/
+void CaptainJack_RetractRing(CaptainJack_Transport *transport, unsigned int index);
+
+#endif
@@ -0,0 +1,87 @@
+#ifndef CAPTAIN_JACK_TRIPLE_H__
+#define CAPTAIN_JACK_TRIPLE_H__
+/*
+	,---.         .              ,-_/
+	|  -' ,-. ,-. |- ,-. . ,-.   '  | ,-. ,-. . ,
+	|   . ,-| | | |  ,-| | | |      | ,-| |   |/
+	`---' `-^ |-' `' `-^ ' ' '      | `-^ `-' |\
+	          |                  /  |         ' `
+	          '                  `--'
+	          captain jack audio device
+	         github.com/qix-/captainjack
+
+	        copyright (c) 2016 josh junon
+	        released under the MIT license
+*/
+
+/*
+	a wait-free triple buffer for handing whole blocks of
+	state from exactly one writer to exactly one reader.
+
+	the writer fills the back buffer and publishes it; the
+	reader picks up whatever was published last. neither
+	side ever waits on the other, and each publish or pick
+	up is a single atomic exchange, which makes this safe
+	to use from the JACK process thread in either role.
+
+	the reader only ever sees the most recent block, so
+	anything that mustn't be lost between reads (peaks,
+	counters...) has to be accumulated by the writer.
+*/
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define kTripleBuffer_Fresh 4
+
+typedef struct {
+	void    *buffers[3];
+	uint8_t  back;
+	uint8_t  pad0[63];
+	uint8_t  middle;
+	uint8_t  pad1[63];
+	uint8_t  front;
+} CaptainJack_TripleBuffer;
+
+static inline void CaptainJack_InitTripleBuffer(CaptainJack_TripleBuffer *tb, void *a, void *b, void *c) {
+	tb->buffers[0] = a;
+	tb->buffers[1] = b;
+	tb->buffers[2] = c;
+	tb->back = 0;
+	tb->middle = 1;
+	tb->front = 2;
+}
+
+/*
+	the buffer the writer should fill in next
+*/
+static inline void * CaptainJack_TripleBufferBack(CaptainJack_TripleBuffer *tb) {
+	return tb->buffers[tb->back];
+}
+
+/*
+	publishes the back buffer to the reader
+*/
+static inline void CaptainJack_PublishTripleBuffer(CaptainJack_TripleBuffer *tb) {
+	tb->back = __atomic_exchange_n(&tb->middle, (uint8_t) (tb->back | kTripleBuffer_Fresh), __ATOMIC_ACQ_REL) & 3;
+}
+
+/*
+	returns the most recently published buffer. `fresh` (if
+	given) says whether it was published since the last call.
+*/
+static inline const void * CaptainJack_ReadTripleBuffer(CaptainJack_TripleBuffer *tb, bool *fresh) {
+	bool updated = (__atomic_load_n(&tb->middle, __ATOMIC_RELAXED) & kTripleBuffer_Fresh) != 0;
+
+	if (updated) {
+		tb->front = __atomic_exchange_n(&tb->middle, tb->front, __ATOMIC_ACQ_REL) & 3;
+	}
+
+	if (fresh != NULL) {
+		*fresh = updated;
+	}
+
+	return tb->buffers[tb->front];
+}
+
+#endif
@@ -0,0 +1,324 @@
+/*
+	,---.         .              ,-_/
+	|  -' ,-. ,-. |- ,-. . ,-.   '  | ,-. ,-. . ,
+	|   . ,-| | | |  ,-| | | |      | ,-| |   |/
+	`---' `-^ |-' `' `-^ ' ' '      | `-^ `-' |\
+	          |                  /  |         ' `
+	          '                  `--'
+	          captain jack audio device
+	         github.com/qix-/captainjack
+
+	        copyright (c) 2016 josh junon
+	        released under the MIT license
+*/
+
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/syslog.h>
+#include <time.h>
+#include <unistd.h>
+
+#if defined(__linux__)
+#	include <linux/futex.h>
+#	include <sys/syscall.h>
+#	define CAPTAIN_JACK_FUTEX 1
+#elif defined(__APPLE__)
+#	if defined(__has_include)
+#		if __has_include(<os/os_sync_wait_on_address.h>)
+#			include <os/clock.h>
+#			include <os/os_sync_wait_on_address.h>
+#			define CAPTAIN_JACK_OS_SYNC 1
+#		endif
+#	endif
+/*
+	private, but it's what libc++ has waited with since
+	10.12. weak, so there's a NULL to check for on anything
+	older
+*/
+#	define kULock_CompareAndWaitShared 3
+#	define kULock_WakeAll              0x00000100
+extern int __ulock_wait(uint32_t operation, void *address, uint64_t value, uint32_t timeout) __attribute__((weak_import));
+extern int __ulock_wake(uint32_t operation, void *address, uint64_t value) __attribute__((weak_import));
+#endif
+
+#include "clock.h"
+#include "wake.h"
+
+// how many spins between looking at the clock
+#define kWake_SpinBatch 64
+
+static const char *kBackendNames[kWake_Count] = {
+	[kWake_Auto] = "auto",
+	[kWake_Futex] = "futex",
+	[kWake_OSSync] = "os_sync",
+	[kWake_ULock] = "ulock",
+	[kWake_Semaphore] = "semaphore"
+};
+
+bool CaptainJack_HasWakeBackend(CaptainJack_WakeBackend backend) {
+	switch (backend) {
+	case kWake_Auto:
+	case kWake_Semaphore:
+		return true;
+
+	case kWake_Futex:
+#if defined(CAPTAIN_JACK_FUTEX)
+		return true;
+#else
+		return false;
+#endif
+
+	case kWake_OSSync:
+#if defined(CAPTAIN_JACK_OS_SYNC)
+		if (__builtin_available(macOS 14.4, *)) {
+			return true;
+		}
+#endif
+		return false;
+
+	case kWake_ULock:
+#if defined(__APPLE__)
+		return __ulock_wait != NULL && __ulock_wake != NULL;
+#else
+		return false;
+#endif
+
+	default:
+		return false;
+	}
+}
+
+const char * CaptainJack_WakeBackendName(CaptainJack_WakeBackend backend) {
+	return backend < kWake_Count ? kBackendNames[backend] : "unknown";
+}
+
+static CaptainJack_WakeBackend BestBackend(void) {
+	for (int backend = kWake_Auto + 1; backend < kWake_Count; backend++) {
+		if (CaptainJack_HasWakeBackend((CaptainJack_WakeBackend) backend)) {
+			return (CaptainJack_WakeBackend) backend;
+		}
+	}
+
+	return kWake_Semaphore;
+}
+
+bool CaptainJack_CreateWaker(CaptainJack_Waker *waker, CaptainJack_WakeWord *word, CaptainJack_WakeBackend backend) {
+	static uint32_t created = 0;
+
+	memset(waker, 0, sizeof(*waker));
+	memset(word, 0, sizeof(*word));
+
+	if (backend == kWake_Auto) {
+		backend = BestBackend();
+	}
+
+	if (!CaptainJack_HasWakeBackend(backend)) {
+		syslog(LOG_ERR, "CaptainJack_CreateWaker: %s isn't available here", CaptainJack_WakeBackendName(backend));
+		return false;
+	}
+
+	if (backend == kWake_Semaphore) {
+		// short, since OS/X only allows 31 characters
+		snprintf(word->name, sizeof(word->name), "/cj-wake-%d-%u", (int) getpid(), __atomic_fetch_add(&created, 1, __ATOMIC_RELAXED));
+		waker->semaphore = sem_open(word->name, O_CREAT | O_EXCL, 0600, 0);
+		if (waker->semaphore == SEM_FAILED) {
+			syslog(LOG_ERR, "CaptainJack_CreateWaker: could not create semaphore %s: %s", word->name, strerror(errno));
+			waker->semaphore = NULL;
+			return false;
+		}
+	}
+
+	waker->word = word;
+	waker->backend = backend;
+	waker->owner = true;
+
+	__atomic_store_n(&word->backend, (uint32_t) backend, __ATOMIC_RELEASE);
+	return true;
+}
+
+bool CaptainJack_OpenWaker(CaptainJack_Waker *waker, CaptainJack_WakeWord *word) {
+	memset(waker, 0, sizeof(*waker));
+
+	CaptainJack_WakeBackend backend = (CaptainJack_WakeBackend) __atomic_load_n(&word->backend, __ATOMIC_ACQUIRE);
+	if (backend == kWake_Auto || backend >= kWake_Count || !CaptainJack_HasWakeBackend(backend)) {
+		return false;
+	}
+
+	if (backend == kWake_Semaphore) {
+		waker->semaphore = sem_open(word->name, 0);
+		if (waker->semaphore == SEM_FAILED) {
+			syslog(LOG_ERR, "CaptainJack_OpenWaker: could not open semaphore %s: %s", word->name, strerror(errno));
+			waker->semaphore = NULL;
+			return false;
+		}
+	}
+
+	waker->word = word;
+	waker->backend = backend;
+	return true;
+}
+
+void CaptainJack_CloseWaker(CaptainJack_Waker *waker) {
+	if (waker->semaphore != NULL) {
+		sem_close(waker->semaphore);
+		if (waker->owner) {
+			sem_unlink(waker->word->name);
+		}
+	}
+
+	memset(waker, 0, sizeof(*waker));
+}
+
+uint32_t CaptainJack_WakeSequence(const CaptainJack_Waker *waker) {
+	return __atomic_load_n(&waker->word->sequence, __ATOMIC_ACQUIRE);
+}
+
+static void WaitSemaphore(sem_t *semaphore, uint64_t nanos) {
+#if defined(__APPLE__)
+	// no sem_timedwait on OS/X; this is only for anything older than 10.12, so it can poll
+	uint64_t deadline = CaptainJack_Now() + nanos;
+	while (sem_trywait(semaphore) != 0 && CaptainJack_Now() < deadline) {
+		usleep(500);
+	}
+#else
+	struct timespec at;
+	clock_gettime(CLOCK_REALTIME, &at);
+	at.tv_sec += (time_t) (nanos / 1000000000ull);
+	at.tv_nsec += (long) (nanos % 1000000000ull);
+	if (at.tv_nsec >= 1000000000l) {
+		at.tv_sec++;
+		at.tv_nsec -= 1000000000l;
+	}
+
+	while (sem_timedwait(semaphore, &at) != 0 && errno == EINTR) {
+	}
+#endif
+}
+
+// sleeps until the sequence might not be `seen` any more, or `nanos` pass
+static void Block(CaptainJack_Waker *waker, uint32_t seen, uint64_t nanos) {
+	uint32_t *address = &waker->word->sequence;
+
+	switch (waker->backend) {
+#if defined(CAPTAIN_JACK_FUTEX)
+	case kWake_Futex: {
+		// not FUTEX_WAIT_PRIVATE; the other side is another process
+		struct timespec timeout = { (time_t) (nanos / 1000000000ull), (long) (nanos % 1000000000ull) };
+		syscall(SYS_futex, address, FUTEX_WAIT, seen, &timeout, NULL, 0);
+		break;
+	}
+#endif
+
+#if defined(CAPTAIN_JACK_OS_SYNC)
+	case kWake_OSSync:
+		if (__builtin_available(macOS 14.4, *)) {
+			os_sync_wait_on_address_with_timeout(address, seen, sizeof(*address), OS_SYNC_WAIT_ON_ADDRESS_SHARED, OS_CLOCK_MACH_ABSOLUTE_TIME, nanos);
+		}
+		break;
+#endif
+
+#if defined(__APPLE__)
+	case kWake_ULock: {
+		// in microseconds, where 0 is forever
+		uint64_t micros = nanos / 1000 + 1;
+		__ulock_wait(kULock_CompareAndWaitShared, address, seen, micros > UINT32_MAX ? UINT32_MAX : (uint32_t) micros);
+		break;
+	}
+#endif
+
+	case kWake_Semaphore:
+		WaitSemaphore(waker->semaphore, nanos);
+		break;
+
+	default:
+		break;
+	}
+}
+
+void CaptainJack_Wake(CaptainJack_Waker *waker) {
+	CaptainJack_WakeWord *word = waker->word;
+
+	/*
+		the other half of the waiters count in
+		CaptainJack_WaitForWake(): either this sees the
+		waiter, or the waiter sees the new sequence before it
+		blocks. the kernel backends check the sequence again
+		themselves, so they can't miss it in between either.
+	*/
+	__atomic_add_fetch(&word->sequence, 1, __ATOMIC_SEQ_CST);
+	uint32_t waiters = __atomic_load_n(&word->waiters, __ATOMIC_SEQ_CST);
+	if (waiters == 0) {
+		return;
+	}
+
+	uint32_t *address = &word->sequence;
+
+	switch (waker->backend) {
+#if defined(CAPTAIN_JACK_FUTEX)
+	case kWake_Futex:
+		syscall(SYS_futex, address, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+		break;
+#endif
+
+#if defined(CAPTAIN_JACK_OS_SYNC)
+	case kWake_OSSync:
+		if (__builtin_available(macOS 14.4, *)) {
+			os_sync_wake_by_address_all(address, sizeof(*address), OS_SYNC_WAKE_BY_ADDRESS_SHARED);
+		}
+		break;
+#endif
+
+#if defined(__APPLE__)
+	case kWake_ULock:
+		__ulock_wake(kULock_CompareAndWaitShared | kULock_WakeAll, address, 0);
+		break;
+#endif
+
+	case kWake_Semaphore:
+		// one each; a post nobody takes only costs somebody a loop around later
+		for (uint32_t i = 0; i < waiters; i++) {
+			sem_post(waker->semaphore);
+		}
+		break;
+
+	default:
+		break;
+	}
+}
+
+bool CaptainJack_WaitForWake(CaptainJack_Waker *waker, uint32_t seen, uint64_t spinNanos, uint64_t timeoutNanos) {
+	CaptainJack_WakeWord *word = waker->word;
+	uint64_t start = CaptainJack_Now();
+
+	do {
+		for (int spin = 0; spin < kWake_SpinBatch; spin++) {
+			if (__atomic_load_n(&word->sequence, __ATOMIC_ACQUIRE) != seen) {
+				return true;
+			}
+#if defined(__x86_64__) || defined(__i386__)
+			__builtin_ia32_pause();
+#endif
+		}
+	} while (CaptainJack_Now() - start < spinNanos);
+
+	__atomic_add_fetch(&word->waiters, 1, __ATOMIC_SEQ_CST);
+
+	bool woken = false;
+	for (;;) {
+		woken = __atomic_load_n(&word->sequence, __ATOMIC_SEQ_CST) != seen;
+
+		uint64_t waited = CaptainJack_Now() - start;
+		if (woken || waited >= timeoutNanos) {
+			break;
+		}
+
+		Block(waker, seen, timeoutNanos - waited);
+	}
+
+	__atomic_sub_fetch(&word->waiters, 1, __ATOMIC_SEQ_CST);
+	return woken;
+}
@@ -0,0 +1,118 @@
+#ifndef CAPTAIN_JACK_WAKE_H__
+#define CAPTAIN_JACK_WAKE_H__
+/*
+	,---.         .              ,-_/
+	|  -' ,-. ,-. |- ,-. . ,-.   '  | ,-. ,-. . ,
+	|   . ,-| | | |  ,-| | | |      | ,-| |   |/
+	`---' `-^ |-' `' `-^ ' ' '      | `-^ `-' |\
+	          |                  /  |         ' `
+	          '                  `--'
+	          captain jack audio device
+	         github.com/qix-/captainjack
+
+	        copyright (c) 2016 josh junon
+	        released under the MIT license
+*/
+
+/*
+	wakes whoever is waiting on a word in shared memory,
+	for a consumer (the daemon) that sleeps until its
+	producer (the device) has put something in a ring.
+	a message through a socket every cycle is a system call
+	each way plus a read; this is only a system call on
+	either side if somebody is actually asleep.
+
+	the word is a sequence the producer bumps on every
+	wake. a consumer spins on it for a bounded time first,
+	since the next period often turns up within it, then
+	blocks on the kernel's wait-on-address primitive: a
+	futex on Linux, os_sync_wait_on_address on OS/X 14.4 and
+	up, __ulock_wait back to 10.12. where there's none of
+	those, a named POSIX semaphore. whoever creates the word
+	picks; whoever opens it uses the same.
+*/
+
+#include <semaphore.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef enum {
+	kWake_Auto = 0,
+	kWake_Futex,
+	kWake_OSSync,
+	kWake_ULock,
+	kWake_Semaphore,
+	kWake_Count
+} CaptainJack_WakeBackend;
+
+/*
+	the part that lives in shared memory, a cache line of
+	its own. zeroed, it's a word nobody's created yet.
+	`name` is the semaphore's, if that's the backend
+*/
+typedef struct {
+	uint32_t sequence;
+	uint32_t waiters;
+	uint32_t backend;
+	char     name[52];
+} CaptainJack_WakeWord;
+
+// one process's handle on a word
+typedef struct {
+	CaptainJack_WakeWord   *word;
+	CaptainJack_WakeBackend backend;
+	sem_t                  *semaphore;
+	bool                    owner;
+} CaptainJack_Waker;
+
+/*
+	whether a backend works here. kWake_Auto is the best
+	one that does
+*/
+bool CaptainJack_HasWakeBackend(CaptainJack_WakeBackend backend);
+
+/*
+	the name of a backend, for logs and stats
+*/
+const char * CaptainJack_WakeBackendName(CaptainJack_WakeBackend backend);
+
+/*
+	sets `word` up with `backend` (or the best there is, for
+	kWake_Auto). false (and logs why) if that can't be done
+*/
+bool CaptainJack_CreateWaker(CaptainJack_Waker *waker, CaptainJack_WakeWord *word, CaptainJack_WakeBackend backend);
+
+/*
+	a handle on a word some other process created. false if
+	it hasn't been, or its backend doesn't work here
+*/
+bool CaptainJack_OpenWaker(CaptainJack_Waker *waker, CaptainJack_WakeWord *word);
+
+/*
+	lets go of a handle (and the semaphore, if this process
+	created it)
+*/
+void CaptainJack_CloseWaker(CaptainJack_Waker *waker);
+
+/*
+	the word's sequence, to check for whatever's to be
+	waited for and then wait with
+*/
+uint32_t CaptainJack_WakeSequence(const CaptainJack_Waker *waker);
+
+/*
+	bumps the sequence, and wakes anyone blocked on it.
+	real-time safe as long as nobody is; a system call if
+	they are
+*/
+void CaptainJack_Wake(CaptainJack_Waker *waker);
+
+/*
+	waits for the sequence to move on from `seen`: spinning
+	for up to `spinNanos`, then blocking for up to
+	`timeoutNanos` in total. true if it moved, false on
+	timing out
+*/
+bool CaptainJack_WaitForWake(CaptainJack_Waker *waker, uint32_t seen, uint64_t spinNanos, uint64_t timeoutNanos);
+
+#endif
@@ -16,16 +16,42 @@
 #include <errno.h>
 #include <fcntl.h>
 #include <netinet/in.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
 #include <sys/ioctl.h>
 #include <sys/socket.h>
-#include <sys/syslog.h>
 #include <sys/types.h>
+#include <time.h>
 #include <unistd.h>
 
+#include "clock.h"
+#include "log.h"
+#include "mpsc.h"
+#include "stats.h"
+#include "trace.h"
 #include "xmit.h"
 
+#define kXmit_BackoffMin 10000000ull
+#define kXmit_BackoffMax 2000000000ull
+#define kXmit_Window     512
+#define kXmit_AckEvery   16
+#define kXmit_LateAfter  50000000ull
+#define kXmit_PollMillis 1000
+#define kXmit_Events     1024
+#define kXmit_CoalesceMs 50
+
+// SIGPIPE would take coreaudiod down with us if the daemon goes away mid-send
+#ifdef MSG_NOSIGNAL
+#	define kXmit_SendFlags MSG_NOSIGNAL
+#else
+#	define kXmit_SendFlags 0
+#endif
+
 typedef enum {
 	XMPC_NONE = 0,
 	XMPC_READY,
@@ -33,8 +59,40 @@ typedef enum {
 	XMPC_CLIENT_DISCONNECT,
 	XMPC_CLIENT_ENABLE_IO,
 	XMPC_CLIENT_DISABLE_IO,
+	XMPC_CLIENT_SILENCE,
+	XMPC_SNAPSHOT,
 } Proto_MessageId;
 
+/*
+	what the daemon sends back. a hello opens every connection
+	and says where the daemon's copy of the stream left off; acks
+	are cumulative; a resync asks for a fresh snapshot.
+*/
+typedef enum {
+	XMPR_NONE = 0,
+	XMPR_HELLO,
+	XMPR_ACK,
+	XMPR_RESYNC,
+} Proto_ReplyId;
+
+/*
+	every message from the device starts with one of these. `seq`
+	counts up from 1 for as long as the device is loaded (0 is
+	never sent), and `sent` is CaptainJack_Now() at the time,
+	which means the same thing in the daemon.
+*/
+typedef struct {
+	uint32_t                                 id;
+	uint32_t                                 seq;
+	uint64_t                                 sent;
+} Proto_Header;
+
+typedef struct {
+	uint32_t                                 id;
+	uint32_t                                 seq;
+	uint64_t                                 session;
+} Proto_Reply;
+
 typedef struct {
 	unsigned int                             cid;
 	pid_t                                    pid;
@@ -44,192 +102,955 @@ typedef struct {
 	unsigned int                             cid;
 } Proto_CIDMessage;
 
-static int                  gSocket              = -1;
-static int                  gPeerSocket          = -1;
-static const uint16_t       gBindPort            = 50963;
-static CaptainJack_Xmitter *gXmitterClient       = NULL;
-static Proto_MessageId      gTickHeader          = XMPC_NONE;
+typedef struct {
+	unsigned int                             cid;
+	uint32_t                                 silent;
+} Proto_SilenceMessage;
+
+typedef struct {
+	uint32_t                                 cid;
+	int32_t                                  pid;
+	uint8_t                                  io;
+	uint8_t                                  silent;
+	uint8_t                                  reserved[2];
+} Proto_ClientState;
+
+// always sent whole; it's small, and the reader never has to guess at a length
+typedef struct {
+	uint64_t                                 session;
+	uint32_t                                 count;
+	Proto_ClientState                        clients[kXmit_MaxClients];
+} Proto_SnapshotMessage;
+
+// the window only has room for the small messages; see PostMessage() for snapshots
+typedef struct {
+	size_t                                   length;
+	char                                     bytes[sizeof(Proto_Header) + sizeof(Proto_PIDCIDMessage)];
+} Proto_Packet;
+
+typedef struct {
+	size_t                                   length;
+	char                                     bytes[sizeof(Proto_Header) + sizeof(Proto_SnapshotMessage)];
+} Proto_SnapshotPacket;
+
+// a HAL callback, on its way to the xmit thread
+typedef struct {
+	uint32_t                                 id;
+	uint32_t                                 cid;
+	int32_t                                  pid;
+	uint32_t                                 silent;
+} Xmit_Event;
+
+// a client's StopIO, held back in case it starts again straight away
+typedef struct {
+	unsigned int                             cid;
+	uint64_t                                 at;
+} Xmit_PendingStop;
+
+/*
+	the device's side. the HAL calls in on whatever threads
+	coreaudiod likes, so the callbacks only queue an event and
+	poke the xmit thread; it owns the client table, the window
+	and the peer socket, so the snapshot a new daemon gets and
+	the messages after it are always in order, and nothing on
+	a HAL thread takes a lock.
+
+	the window keeps the last kXmit_Window messages, by sequence
+	number. a daemon that reconnects gets whatever it missed from
+	there if it can, and a snapshot if it can't. messages only go
+	out from the window: a send that would block leaves the rest
+	there (half a message, even) for the control thread to finish
+	once the socket drains, so the stream is never left torn.
+
+	some apps start and stop IO around every sound they make, so
+	a StopIO waits coalesceWindow before it's sent: a StartIO for
+	the same client in the meantime cancels the pair, and the
+	daemon never hears about either. StartIO itself is never held.
+*/
+struct CaptainJack_XmitServer {
+	CaptainJack_MPSCQueue   events;
+	char                    eventCells[kMPSC_Bytes(kXmit_Events, sizeof(Xmit_Event))] __attribute__((aligned(64)));
+	bool                    wakePending;
+	int                     wakePipe[2];
+	bool                    stopping;
+	pthread_t               thread;
+	CaptainJack_XmitOptions options;
+	uint64_t                coalesceWindow;
+	int                     listener;
+	Xmit_PendingStop        pendingStops[kXmit_MaxClients];
+	unsigned int            pendingStopCount;
+	Proto_ClientState       table[kXmit_MaxClients];
+	unsigned int            tableCount;
+	int                     peer;
+	bool                    peerReady;
+	uint64_t                session;
+	Proto_Packet            window[kXmit_Window];
+	Proto_SnapshotPacket    snapshot;
+	uint32_t                snapshotSeq;
+	uint32_t                nextSeq;
+	uint32_t                acked;
+	uint32_t                flushSeq;
+	size_t                  flushOffset;
+	Proto_Reply             reply;
+	size_t                  replyHave;
+};
+
+/*
+	the daemon's side; only ever touched from whoever ticks
+*/
+struct CaptainJack_XmitConnection {
+	CaptainJack_XmitHandlers handlers;
+	void                    *context;
+	CaptainJack_XmitOptions  options;
+	int                      socket;
+	Proto_Header             header;
+	uint64_t                 backoff;
+	uint64_t                 retryAt;
+	uint64_t                 seenSession;
+	uint32_t                 expected;
+	uint32_t                 ackedUpTo;
+	bool                     resyncRequested;
+};
+
+static const char *kMessage_Names[] = {
+	"none",
+	"ready",
+	"new_client",
+	"client_disconnect",
+	"client_enable_io",
+	"client_disable_io",
+	"client_silence",
+	"snapshot",
+};
+
+const char * CaptainJack_XmitMessageName(unsigned int id) {
+	return id < sizeof(kMessage_Names) / sizeof(kMessage_Names[0]) ? kMessage_Names[id] : NULL;
+}
+
+void CaptainJack_InitXmitOptions(CaptainJack_XmitOptions *options) {
+	memset(options, 0, sizeof(*options));
+	options->port = kXmit_Port;
+	options->coalesceMillis = kXmit_CoalesceMs;
+
+	// CAPTAIN_JACK_IO_COALESCE_MS=0 sends every StopIO straight away
+	const char *window = getenv("CAPTAIN_JACK_IO_COALESCE_MS");
+	if (window != NULL && atoi(window) >= 0) {
+		options->coalesceMillis = (unsigned int) atoi(window);
+	}
+}
 
-static void InitializeBindAddr(struct sockaddr_in *addr) {
+static uint64_t Now(const CaptainJack_XmitOptions *options) {
+	return options->hooks.now != NULL ? options->hooks.now(options->hooks.context) : CaptainJack_Now();
+}
+
+static void InitializeBindAddr(struct sockaddr_in *addr, uint16_t port) {
 	memset(addr, 0, sizeof(*addr));
 	addr->sin_family = PF_INET;
 	addr->sin_addr.s_addr = INADDR_ANY;
-	addr->sin_port = htons(gBindPort);
+	addr->sin_port = htons(port);
 }
 
-static bool AssertAccepted(void) {
-	if (gSocket < 0) {
-		syslog(LOG_NOTICE, "AssertAccepted: noticed the socket was down; will attempt to bring it online");
+static uint64_t NextBackoff(uint64_t backoff) {
+	backoff = backoff == 0 ? kXmit_BackoffMin : backoff * 2;
+	return backoff > kXmit_BackoffMax ? kXmit_BackoffMax : backoff;
+}
 
-		gSocket = socket(PF_INET, SOCK_STREAM, 0);
-		if (gSocket < 0) {
-			syslog(LOG_ERR, "AssertAccepted: could not create a new socket: %s", strerror(errno));
-			gSocket = -1;
-			return false;
+static void SleepFor(uint64_t nanoseconds) {
+	struct timespec wait = { (time_t) (nanoseconds / 1000000000ull), (long) (nanoseconds % 1000000000ull) };
+	while (nanosleep(&wait, &wait) != 0 && errno == EINTR);
+}
+
+// the default listen hook
+static int ListenTCP(uint16_t port) {
+	int fd = socket(PF_INET, SOCK_STREAM, 0);
+	if (fd < 0) {
+		CaptainJack_Log(LOG_ERR, "Listen: could not create a new socket: %s", strerror(errno));
+		return -1;
+	}
+
+	// before bind(), or a restarted coreaudiod can't have the port back for a while
+	int value = 1;
+	setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &value, sizeof(value));
+
+	struct sockaddr_in addr;
+	InitializeBindAddr(&addr, port);
+	if (bind(fd, (const struct sockaddr *) &addr, sizeof(addr)) != 0) {
+		CaptainJack_Log(LOG_ERR, "Listen: could not bind to 0.0.0.0:%d: %s", port, strerror(errno));
+		close(fd);
+		return -1;
+	}
+
+	if (listen(fd, 2) != 0) {
+		CaptainJack_Log(LOG_ERR, "Listen: could not listen on 0.0.0.0:%d: %s", port, strerror(errno));
+		close(fd);
+		return -1;
+	}
+
+	return fd;
+}
+
+// the default connect hook
+static int ConnectTCP(uint16_t port) {
+	int fd = socket(PF_INET, SOCK_STREAM, 0);
+	if (fd < 0) {
+		return -1;
+	}
+
+	struct sockaddr_in addr;
+	InitializeBindAddr(&addr, port);
+	if (connect(fd, (const struct sockaddr *) &addr, sizeof(addr)) != 0) {
+		int error = errno;
+		close(fd);
+		errno = error;
+		return -1;
+	}
+
+	return fd;
+}
+
+static bool Listen(CaptainJack_XmitServer *server) {
+	const CaptainJack_XmitHooks *hooks = &server->options.hooks;
+	server->listener = hooks->listen != NULL ? hooks->listen(hooks->context) : ListenTCP(server->options.port);
+	return server->listener >= 0;
+}
+
+static void ClosePeer(CaptainJack_XmitServer *server) {
+	if (server->peer >= 0) {
+		close(server->peer);
+		server->peer = -1;
+	}
+	server->peerReady = false;
+	server->replyHave = 0;
+}
+
+static uint32_t PacketID(const CaptainJack_XmitServer *server, uint32_t seq) {
+	Proto_Header header;
+	memcpy(&header, server->window[seq % kXmit_Window].bytes, sizeof(header));
+	return header.id;
+}
+
+static const char * PacketBytes(const CaptainJack_XmitServer *server, uint32_t seq, size_t *length) {
+	if (PacketID(server, seq) == XMPC_SNAPSHOT) {
+		*length = server->snapshot.length;
+		return server->snapshot.bytes;
+	}
+
+	*length = server->window[seq % kXmit_Window].length;
+	return server->window[seq % kXmit_Window].bytes;
+}
+
+/*
+	writes out as much of the window as the socket will take;
+	xmit thread only
+*/
+static void Flush(CaptainJack_XmitServer *server) {
+	while (server->peerReady && server->flushSeq != server->nextSeq) {
+		size_t length;
+		const char *bytes = PacketBytes(server, server->flushSeq, &length);
+		ssize_t sent = send(server->peer, &bytes[server->flushOffset], length - server->flushOffset, kXmit_SendFlags);
+
+		if (sent == -1) {
+			if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+				CaptainJack_Log(LOG_ERR, "Flush: could not transmit message %u: %s", server->flushSeq, strerror(errno));
+				CaptainJack_CountStat(kStat_XmitErrors, 1);
+				ClosePeer(server);
+			}
+			return;
 		}
 
-		struct sockaddr_in addr;
-		InitializeBindAddr(&addr);
-		if (bind(gSocket, (const struct sockaddr *) &addr, sizeof(addr)) != 0) {
-			syslog(LOG_ERR, "AssertAccepted: could not bind to 0.0.0.0:%d: %s", gBindPort, strerror(errno));
-			close(gSocket);
-			gSocket = -1;
-			return false;
+		CaptainJack_CountStat(kStat_XmitBytesSent, (uint64_t) sent);
+		server->flushOffset += (size_t) sent;
+		if (server->flushOffset < length) {
+			// the socket's full; the control thread picks this up when it isn't
+			return;
+		}
+
+		Proto_Header header;
+		memcpy(&header, bytes, sizeof(header));
+		CaptainJack_CountStat(kStat_XmitMessagesSent + header.id, 1);
+
+		server->flushSeq++;
+		server->flushOffset = 0;
+	}
+}
+
+/*
+	numbers a message, puts it in the window and sends it if there's
+	anyone to send it to; xmit thread only.
+
+	a snapshot is too big for a window slot, so there's only ever
+	one, kept on the side; its slot just marks where it goes.
+*/
+static uint32_t PostMessage(CaptainJack_XmitServer *server, Proto_MessageId id, const void *message, size_t length) {
+	if (server->nextSeq - server->acked > kXmit_Window) {
+		/*
+			about to overwrite a message the daemon hasn't acked. if
+			one is connected, it's stopped listening; either way that
+			message is gone, and the snapshot will have to cover it.
+		*/
+		if (server->peer >= 0) {
+			CaptainJack_Log(LOG_ERR, "PostMessage: the daemon is %u messages behind; hanging up", server->nextSeq - server->acked - 1);
+			CaptainJack_CountStat(kStat_XmitStalls, 1);
+			ClosePeer(server);
 		}
 
-		if (listen(gSocket, 2) != 0) {
-			syslog(LOG_ERR, "AssertAccepted: could not listen on 0.0.0.0:%d: %s", gBindPort, strerror(errno));
-			close(gSocket);
-			gSocket = -1;
+		CaptainJack_CountStat(kStat_XmitDropped, 1);
+		server->acked = server->nextSeq - kXmit_Window;
+	}
+
+	uint32_t seq = server->nextSeq;
+	Proto_Header header = { id, seq, Now(&server->options) };
+	Proto_Packet *packet = &server->window[seq % kXmit_Window];
+	memcpy(packet->bytes, &header, sizeof(header));
+	packet->length = sizeof(header);
+
+	if (id == XMPC_SNAPSHOT) {
+		memcpy(server->snapshot.bytes, &header, sizeof(header));
+		memcpy(&server->snapshot.bytes[sizeof(header)], message, length);
+		server->snapshot.length = sizeof(header) + length;
+		server->snapshotSeq = seq;
+	} else if (length > 0) {
+		memcpy(&packet->bytes[sizeof(header)], message, length);
+		packet->length += length;
+	}
+
+	server->nextSeq = seq + 1;
+
+	return seq;
+}
+
+static void SendMessage(CaptainJack_XmitServer *server, Proto_MessageId id, const void *message, size_t length) {
+	CaptainJack_TraceBegin("xmit send", kMessage_Names[id]);
+	PostMessage(server, id, message, length);
+	Flush(server);
+	CaptainJack_TraceEnd("xmit send", kMessage_Names[id]);
+}
+
+static void SendSnapshot(CaptainJack_XmitServer *server) {
+	/*
+		one that hasn't gone out yet will do: it's older than the table,
+		but everything that's changed since is queued up behind it.
+		(and it might be half sent, so it can't be touched anyway.)
+	*/
+	if (server->snapshotSeq != 0 && server->snapshotSeq - server->flushSeq < kXmit_Window) {
+		return;
+	}
+
+	Proto_SnapshotMessage msg;
+	memset(&msg, 0, sizeof(msg));
+	msg.session = server->session;
+	msg.count = server->tableCount;
+	memcpy(msg.clients, server->table, server->tableCount * sizeof(server->table[0]));
+
+	/*
+		the table already has the held StopIOs in it, so the daemon
+		hears about them here; a StartIO in the window now has to
+		be sent rather than cancel one it's already been told about
+	*/
+	server->pendingStopCount = 0;
+
+	SendMessage(server, XMPC_SNAPSHOT, &msg, sizeof(msg));
+}
+
+/*
+	whether a daemon that's seen everything up to `seq` can be caught
+	up from the window. the last snapshot has to be the one still on
+	the side if it's part of what it missed.
+*/
+static bool CanResume(const CaptainJack_XmitServer *server, uint32_t seq) {
+	if (seq >= server->nextSeq || server->nextSeq - 1 - seq >= kXmit_Window || seq < server->acked) {
+		return false;
+	}
+
+	for (uint32_t missed = seq + 1; missed != server->nextSeq; missed++) {
+		if (PacketID(server, missed) == XMPC_SNAPSHOT && missed != server->snapshotSeq) {
 			return false;
 		}
+	}
+
+	return true;
+}
+
+/*
+	a daemon has said where it left off. if that was in this session
+	and everything since is still in the window, it gets just that;
+	otherwise it starts over from a snapshot.
+*/
+static void OnHello(CaptainJack_XmitServer *server, const Proto_Reply *reply) {
+	server->peerReady = true;
+	server->flushOffset = 0;
+
+	if (reply->session == server->session && CanResume(server, reply->seq)) {
+		uint32_t missed = server->nextSeq - 1 - reply->seq;
+		server->flushSeq = reply->seq + 1;
+		server->acked = reply->seq;
+		CaptainJack_CountStat(kStat_XmitRetransmits, missed);
+		CaptainJack_Log(LOG_NOTICE, "OnHello: daemon resumed from %u; resending %u messages", reply->seq, missed);
+		Flush(server);
+	} else {
+		// nothing from before the snapshot matters to this daemon
+		server->flushSeq = server->nextSeq;
+		server->acked = server->nextSeq - 1;
+		server->snapshotSeq = 0;
+		CaptainJack_CountStat(kStat_XmitResyncs, 1);
+		CaptainJack_Log(LOG_NOTICE, "OnHello: daemon is starting over; sending it %u clients", server->tableCount);
+		SendSnapshot(server);
+	}
+}
+
+static void OnReply(CaptainJack_XmitServer *server, const Proto_Reply *reply) {
+	switch (reply->id) {
+	case XMPR_HELLO:
+		OnHello(server, reply);
+		break;
+
+	case XMPR_ACK:
+		// acks are cumulative, so an old one can't take anything back
+		if (reply->seq < server->nextSeq && reply->seq - server->acked < kXmit_Window) {
+			server->acked = reply->seq;
+		}
+		break;
 
-		bool value = true;
-		setsockopt(gSocket, SOL_SOCKET, SO_KEEPALIVE, &value, sizeof(value));
-		setsockopt(gSocket, SOL_SOCKET, SO_REUSEADDR, &value, sizeof(value));
+	case XMPR_RESYNC:
+		CaptainJack_CountStat(kStat_XmitResyncs, 1);
+		CaptainJack_Log(LOG_NOTICE, "OnReply: daemon lost track at %u; sending a snapshot", reply->seq);
+		SendSnapshot(server);
+		break;
 
-		gPeerSocket = -1;
+	default:
+		CaptainJack_Log(LOG_ERR, "OnReply: unknown reply %u; hanging up", reply->id);
+		CaptainJack_CountStat(kStat_XmitErrors, 1);
+		ClosePeer(server);
 	}
+}
 
-	if (gPeerSocket < 0) {
-		syslog(LOG_NOTICE, "AssertAccepted: attempting to accept");
+/*
+	reads whatever the daemon has sent back. replies are fixed
+	size, but the stream can still split one, so a partial one
+	waits in the server for the rest.
+*/
+static void ReadReplies(CaptainJack_XmitServer *server) {
+	for (;;) {
+		ssize_t nread = recv(server->peer, &((char *) &server->reply)[server->replyHave], sizeof(server->reply) - server->replyHave, 0);
+		if (nread == 0 || (nread == -1 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+			CaptainJack_Log(LOG_NOTICE, "ReadReplies: the daemon hung up");
+			ClosePeer(server);
+			return;
+		}
+
+		if (nread == -1) {
+			return;
+		}
 
-		struct sockaddr_in peerAddr;
-		socklen_t peerAddrLen = 0;
-		if ((gPeerSocket = accept(gSocket, (struct sockaddr *) &peerAddr, &peerAddrLen)) == -1) {
-			if (errno != EAGAIN && errno != EWOULDBLOCK) {
-				syslog(LOG_ERR, "AssertAccepted: error when accepting: %s", strerror(errno));
+		CaptainJack_CountStat(kStat_XmitBytesReceived, (uint64_t) nread);
+		server->replyHave += (size_t) nread;
+		if (server->replyHave == sizeof(server->reply)) {
+			server->replyHave = 0;
+			OnReply(server, &server->reply);
+			if (server->peer < 0) {
+				return;
 			}
+		}
+	}
+}
 
-			close(gSocket);
+static void AcceptPeer(CaptainJack_XmitServer *server, int peer) {
+	fcntl(peer, F_SETFL, fcntl(peer, F_GETFL) | O_NONBLOCK);
+#ifdef SO_NOSIGPIPE
+	int value = 1;
+	setsockopt(peer, SOL_SOCKET, SO_NOSIGPIPE, &value, sizeof(value));
+#endif
 
-			gPeerSocket = -1;
-			gSocket = -1;
-			return false;
+	// a new daemon replaces the old one; it only connects again if it lost the first
+	ClosePeer(server);
+	server->peer = peer;
+	CaptainJack_CountStat(kStat_XmitReconnects, 1);
+
+	CaptainJack_Log(LOG_NOTICE, "AcceptPeer: daemon connected on %d", peer);
+}
+
+static Proto_ClientState * FindEntry(CaptainJack_XmitServer *server, unsigned int cid) {
+	for (unsigned int i = 0; i < server->tableCount; i++) {
+		if (server->table[i].cid == cid) {
+			return &server->table[i];
 		}
+	}
+
+	return NULL;
+}
+
+static void PostEventMessage(CaptainJack_XmitServer *server, const Xmit_Event *event) {
+	CaptainJack_TraceBegin("xmit send", kMessage_Names[event->id]);
+
+	switch (event->id) {
+	case XMPC_NEW_CLIENT:
+	case XMPC_CLIENT_DISCONNECT: {
+		Proto_PIDCIDMessage msg = { event->cid, event->pid };
+		PostMessage(server, event->id, &msg, sizeof(msg));
+		break;
+	}
 
-		syslog(LOG_NOTICE, "AssertAccepted: client connected from %s on %d", inet_ntoa(peerAddr.sin_addr), (int) gPeerSocket);
+	case XMPC_CLIENT_ENABLE_IO:
+	case XMPC_CLIENT_DISABLE_IO: {
+		Proto_CIDMessage msg = { event->cid };
+		PostMessage(server, event->id, &msg, sizeof(msg));
+		break;
 	}
 
-	return true;
+	case XMPC_CLIENT_SILENCE: {
+		Proto_SilenceMessage msg = { event->cid, event->silent };
+		PostMessage(server, event->id, &msg, sizeof(msg));
+		break;
+	}
+
+	default:
+		PostMessage(server, event->id, NULL, 0);
+	}
+
+	CaptainJack_TraceEnd("xmit send", kMessage_Names[event->id]);
 }
 
-static bool AssertConnected(void) {
-	if (gSocket < 0) {
-		// note, we take a different approach here; we're a launch daemon in this call,
-		// so if we can't connect we're going to crash and burn by returning false here.
-		// we'll gracefully shut down any JACKd registries and tell launchd that we're basically
-		// useless, and let it reschedule us as necessary.
-		syslog(LOG_NOTICE, "AssertConnected: noticed I wasn't connected anymore; I'll try to connect now.");
+static int FindPendingStop(const CaptainJack_XmitServer *server, unsigned int cid) {
+	for (unsigned int i = 0; i < server->pendingStopCount; i++) {
+		if (server->pendingStops[i].cid == cid) {
+			return (int) i;
+		}
+	}
 
-		gSocket = socket(PF_INET, SOCK_STREAM, 0);
-		if (gSocket < 0) {
-			syslog(LOG_ERR, "AssertConnected: could not create a new socket: %s", strerror(errno));
-			gSocket = -1;
-			return false;
+	return -1;
+}
+
+static void SendPendingStop(CaptainJack_XmitServer *server, int index) {
+	Xmit_Event stop = { XMPC_CLIENT_DISABLE_IO, server->pendingStops[index].cid, 0, 0 };
+	server->pendingStops[index] = server->pendingStops[--server->pendingStopCount];
+	PostEventMessage(server, &stop);
+}
+
+/*
+	sends the held StopIOs that nothing has cancelled in time, and
+	says how long until the next one is due (or 0 if there isn't one)
+*/
+static uint64_t SendDueStops(CaptainJack_XmitServer *server, uint64_t now) {
+	uint64_t next = 0;
+
+	for (unsigned int i = 0; i < server->pendingStopCount;) {
+		if (now >= server->pendingStops[i].at) {
+			SendPendingStop(server, (int) i);
+			continue;
 		}
 
-		struct sockaddr_in addr;
-		InitializeBindAddr(&addr);
-		if (connect(gSocket, (const struct sockaddr *) &addr, sizeof(addr)) != 0) {
-			syslog(LOG_ERR, "AssertConnected: connect failed: %s", strerror(errno));
-			gSocket = -1;
-			return false;
+		uint64_t wait = server->pendingStops[i].at - now;
+		next = next == 0 || wait < next ? wait : next;
+		i++;
+	}
+
+	return next;
+}
+
+/*
+	brings the client table up to date with an event and numbers
+	the message for it, unless it's a StopIO to hold back or a
+	StartIO that cancels one; Flush() sends it
+*/
+static void ApplyEvent(CaptainJack_XmitServer *server, const Xmit_Event *event) {
+	Proto_ClientState *entry = FindEntry(server, event->cid);
+	int pending = event->id != XMPC_READY ? FindPendingStop(server, event->cid) : -1;
+
+	switch (event->id) {
+	case XMPC_NEW_CLIENT:
+		if (entry == NULL && server->tableCount < kXmit_MaxClients) {
+			entry = &server->table[server->tableCount++];
 		}
 
-		// bool value = true;
-		// setsockopt(gSocket, SOL_SOCKET, SO_KEEPALIVE, &value, sizeof(value));
-		fcntl(gSocket, F_SETFL, O_NONBLOCK);
+		if (entry != NULL) {
+			memset(entry, 0, sizeof(*entry));
+			entry->cid = event->cid;
+			entry->pid = event->pid;
+		} else {
+			CaptainJack_Log(LOG_ERR, "ApplyEvent: client table is full; %u won't survive a daemon restart", event->cid);
+		}
+		break;
 
-		gTickHeader = true;
+	case XMPC_CLIENT_DISCONNECT:
+		if (entry != NULL) {
+			*entry = server->table[--server->tableCount];
+		}
+		break;
+
+	case XMPC_CLIENT_ENABLE_IO:
+		if (entry != NULL) {
+			entry->io = true;
+		}
 
-		syslog(LOG_NOTICE, "AssertConnected: connected to device. Yargh!");
+		// as far as the daemon knows, it never stopped
+		if (pending >= 0) {
+			server->pendingStops[pending] = server->pendingStops[--server->pendingStopCount];
+			CaptainJack_CountStat(kStat_XmitCoalesced, 2);
+			return;
+		}
+		break;
+
+	case XMPC_CLIENT_DISABLE_IO:
+		if (entry != NULL) {
+			entry->io = false;
+			entry->silent = false;
+		}
+
+		if (server->coalesceWindow > 0 && server->pendingStopCount < kXmit_MaxClients) {
+			if (pending >= 0) {
+				SendPendingStop(server, pending);
+			}
+
+			server->pendingStops[server->pendingStopCount++] = (Xmit_PendingStop) { event->cid, Now(&server->options) + server->coalesceWindow };
+			return;
+		}
+		break;
+
+	case XMPC_CLIENT_SILENCE:
+		if (entry != NULL) {
+			entry->silent = event->silent != 0;
+		}
+		break;
 	}
 
-	return true;
+	// anything else about a client goes after the stop it's queued behind
+	if (pending >= 0) {
+		SendPendingStop(server, pending);
+	}
+
+	PostEventMessage(server, event);
 }
 
-static void SendMessage(Proto_MessageId id, void *message, size_t length) {
-	if (!AssertAccepted()) {
-		return;
+/*
+	takes everything the HAL threads have queued up, in the
+	order they queued it, and sends it in one go
+*/
+static void DrainEvents(CaptainJack_XmitServer *server) {
+	// clears the flag before looking, so a push that finds it still set is one we'll see
+	(void) __atomic_exchange_n(&server->wakePending, false, __ATOMIC_SEQ_CST);
+
+	Xmit_Event event;
+	while (CaptainJack_PopMPSC(&server->events, &event)) {
+		ApplyEvent(server, &event);
 	}
 
-	ssize_t sent = send(gPeerSocket, &id, sizeof(id), 0);
-	if (sent == -1) {
-		syslog(LOG_ERR, "SendMessage: could not transmit message header (%d): %s", id, strerror(errno));
-		close(gPeerSocket);
-		gPeerSocket = -1;
-		return;
+	// Flush() only does anything if something was posted
+	Flush(server);
+}
+
+/*
+	a server's xmit thread: waits for daemons, sends what the
+	HAL threads queue up, reads what the daemon sends back and
+	finishes any send that didn't fit in the socket. nothing on a
+	HAL thread ever waits on the daemon.
+*/
+static void * ControlThread(void *arg) {
+	CaptainJack_XmitServer *server = arg;
+	uint64_t backoff = 0;
+	uint64_t listenAt = 0;
+
+	while (!__atomic_load_n(&server->stopping, __ATOMIC_ACQUIRE)) {
+		int timeout = kXmit_PollMillis;
+		if (server->listener < 0) {
+			uint64_t now = Now(&server->options);
+			if (now >= listenAt && !Listen(server)) {
+				backoff = NextBackoff(backoff);
+				listenAt = now + backoff;
+			}
+			if (server->listener < 0) {
+				// still sends (well, queues) what the HAL says while we wait
+				timeout = (int) ((listenAt - now) / 1000000ull) + 1;
+			}
+		}
+
+		uint64_t due = SendDueStops(server, Now(&server->options));
+		if (due > 0) {
+			Flush(server);
+			int dueMillis = (int) ((due + 999999ull) / 1000000ull);
+			timeout = dueMillis < timeout ? dueMillis : timeout;
+		}
+
+		struct pollfd fds[3] = {
+			{ server->listener, POLLIN, 0 },
+			{ server->peer, POLLIN | (server->peerReady && server->flushSeq != server->nextSeq ? POLLOUT : 0), 0 },
+			{ server->wakePipe[0], POLLIN, 0 }
+		};
+
+		if (poll(fds, 3, timeout) < 0) {
+			if (errno != EINTR) {
+				CaptainJack_Log(LOG_ERR, "ControlThread: poll failed: %s", strerror(errno));
+				SleepFor(kXmit_BackoffMin);
+			}
+			continue;
+		}
+
+		if (fds[2].revents & POLLIN) {
+			char bytes[64];
+			while (read(server->wakePipe[0], bytes, sizeof(bytes)) > 0);
+		}
+
+		// before any replies, so a daemon saying hello gets a snapshot with all of it in
+		DrainEvents(server);
+
+		// it might have been replaced or hung up on since poll() started
+		if (fds[1].revents != 0 && server->peer == fds[1].fd) {
+			if (fds[1].revents & (POLLIN | POLLHUP | POLLERR)) {
+				ReadReplies(server);
+			}
+			Flush(server);
+		}
+
+		if (server->listener >= 0 && (fds[0].revents & POLLIN)) {
+			int peer = accept(server->listener, NULL, NULL);
+			if (peer >= 0) {
+				backoff = 0;
+				AcceptPeer(server, peer);
+			} else if (errno != EINTR && errno != ECONNABORTED && errno != EAGAIN && errno != EWOULDBLOCK) {
+				CaptainJack_Log(LOG_ERR, "ControlThread: error when accepting: %s", strerror(errno));
+				close(server->listener);
+				server->listener = -1;
+				backoff = NextBackoff(backoff);
+				listenAt = Now(&server->options) + backoff;
+			}
+		}
 	}
 
-	if (length <= 0) {
-		return;
+	return NULL;
+}
+
+static void WakeControlThread(CaptainJack_XmitServer *server) {
+	if (!__atomic_exchange_n(&server->wakePending, true, __ATOMIC_SEQ_CST) && server->wakePipe[1] >= 0) {
+		// a full pipe already has a wakeup in it
+		char byte = 0;
+		if (write(server->wakePipe[1], &byte, 1) < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+			CaptainJack_Log(LOG_ERR, "WakeControlThread: could not wake the xmit thread: %s", strerror(errno));
+		}
+	}
+}
+
+CaptainJack_XmitServer * CaptainJack_StartXmitServer(const CaptainJack_XmitOptions *options) {
+	CaptainJack_XmitServer *server = NULL;
+	if (posix_memalign((void **) &server, 64, sizeof(*server)) != 0) {
+		CaptainJack_Log(LOG_ERR, "CaptainJack_StartXmitServer: out of memory");
+		return NULL;
 	}
 
-	char *cmessage = message;
-	size_t total = 0;
-	sent = 0;
-	do {
-		sent = send(gPeerSocket, &cmessage[total], length - total, 0);
-		total += sent;
-	} while (sent > 0 && total < length);
+	memset(server, 0, sizeof(*server));
+	if (options != NULL) {
+		server->options = *options;
+	} else {
+		CaptainJack_InitXmitOptions(&server->options);
+	}
 
-	if (sent == -1) {
-		syslog(LOG_NOTICE, "SendMessage: could not transmit message (%d): %s", id, strerror(errno));
-		close(gPeerSocket);
-		gPeerSocket = -1;
+	server->coalesceWindow = server->options.coalesceMillis * 1000000ull;
+	server->listener = -1;
+	server->peer = -1;
+	server->nextSeq = 1;
+	server->flushSeq = 1;
+
+	// tells this load of the device apart from the last, for daemons that come back
+	server->session = ((uint64_t) getpid() << 32) ^ Now(&server->options) ^ (uintptr_t) server;
+
+	CaptainJack_InitMPSCQueue(&server->events, server->eventCells, kXmit_Events, sizeof(Xmit_Event));
+
+	// without it events still go out, just on the next poll timeout instead of straight away
+	if (pipe(server->wakePipe) != 0) {
+		CaptainJack_Log(LOG_ERR, "CaptainJack_StartXmitServer: could not create the wakeup pipe: %s", strerror(errno));
+		server->wakePipe[0] = server->wakePipe[1] = -1;
+	} else {
+		for (int i = 0; i < 2; i++) {
+			fcntl(server->wakePipe[i], F_SETFL, fcntl(server->wakePipe[i], F_GETFL) | O_NONBLOCK);
+			fcntl(server->wakePipe[i], F_SETFD, FD_CLOEXEC);
+		}
+	}
+
+	int error = pthread_create(&server->thread, NULL, &ControlThread, server);
+	if (error != 0) {
+		CaptainJack_Log(LOG_ERR, "CaptainJack_StartXmitServer: could not start the xmit thread: %s", strerror(error));
+		for (int i = 0; i < 2; i++) {
+			if (server->wakePipe[i] >= 0) {
+				close(server->wakePipe[i]);
+			}
+		}
+		free(server);
+		return NULL;
+	}
+
+	return server;
+}
+
+void CaptainJack_StopXmitServer(CaptainJack_XmitServer *server) {
+	if (server == NULL) {
 		return;
 	}
 
-	if (sent == 0) {
-		// XXX DEBUG
-		syslog(LOG_NOTICE, "SendMessage: sent message %d of %zu size", *(Proto_MessageId*)message, length);
+	__atomic_store_n(&server->stopping, true, __ATOMIC_RELEASE);
+	server->wakePending = false;
+	WakeControlThread(server);
+	pthread_join(server->thread, NULL);
+
+	ClosePeer(server);
+	if (server->listener >= 0) {
+		close(server->listener);
+	}
+
+	for (int i = 0; i < 2; i++) {
+		if (server->wakePipe[i] >= 0) {
+			close(server->wakePipe[i]);
+		}
+	}
+
+	free(server);
+}
+
+/*
+	queues an event for the xmit thread and wakes it if nobody
+	else already has. callable from any thread at once; it only
+	waits if the queue is full, which means the xmit thread has
+	been stuck for a thousand events.
+*/
+static void PostEvent(CaptainJack_XmitServer *server, uint32_t id, unsigned int cid, pid_t pid, bool silent) {
+	if (server == NULL) {
 		return;
 	}
+
+	Xmit_Event event = { id, cid, (int32_t) pid, silent };
+
+	if (!CaptainJack_PushMPSC(&server->events, &event)) {
+		CaptainJack_CountStat(kStat_XmitQueueFull, 1);
+		do {
+			sched_yield();
+		} while (!CaptainJack_PushMPSC(&server->events, &event));
+	}
+
+	WakeControlThread(server);
 }
 
-static void Send_DeviceReady(void) {
-	SendMessage(XMPC_READY, 0, 0);
+void CaptainJack_XmitDeviceReady(CaptainJack_XmitServer *server) {
+	PostEvent(server, XMPC_READY, 0, 0, false);
 }
 
-static void Send_NewClient(unsigned int cid, pid_t pid) {
-	Proto_PIDCIDMessage msg = { cid, pid };
-	SendMessage(XMPC_NEW_CLIENT, &msg, sizeof(msg));
+void CaptainJack_XmitClientConnect(CaptainJack_XmitServer *server, unsigned int cid, pid_t pid) {
+	PostEvent(server, XMPC_NEW_CLIENT, cid, pid, false);
 }
 
-static void Send_DCClient(unsigned int cid, pid_t pid) {
-	Proto_PIDCIDMessage msg = { cid, pid };
-	SendMessage(XMPC_CLIENT_DISCONNECT, &msg, sizeof(msg));
+void CaptainJack_XmitClientDisconnect(CaptainJack_XmitServer *server, unsigned int cid, pid_t pid) {
+	PostEvent(server, XMPC_CLIENT_DISCONNECT, cid, pid, false);
 }
 
-static void Send_ClientEnableIO(unsigned int cid) {
-	Proto_CIDMessage msg = { cid };
-	SendMessage(XMPC_CLIENT_ENABLE_IO, &msg, sizeof(msg));
+void CaptainJack_XmitClientEnableIO(CaptainJack_XmitServer *server, unsigned int cid) {
+	PostEvent(server, XMPC_CLIENT_ENABLE_IO, cid, 0, false);
 }
 
-static void Send_ClientDisableIO(unsigned int cid) {
-	Proto_CIDMessage msg = { cid };
-	SendMessage(XMPC_CLIENT_DISABLE_IO, &msg, sizeof(msg));
+void CaptainJack_XmitClientDisableIO(CaptainJack_XmitServer *server, unsigned int cid) {
+	PostEvent(server, XMPC_CLIENT_DISABLE_IO, cid, 0, false);
 }
 
-static CaptainJack_Xmitter gXmitterServer = {
-	&Send_DeviceReady,
-	&Send_NewClient,
-	&Send_DCClient,
-	&Send_ClientEnableIO,
-	&Send_ClientDisableIO,
-};
+void CaptainJack_XmitClientSilence(CaptainJack_XmitServer *server, unsigned int cid, bool silent) {
+	PostEvent(server, XMPC_CLIENT_SILENCE, cid, 0, silent);
+}
 
-CaptainJack_Xmitter * CaptainJack_GetXmitterServer(void) {
-	return &gXmitterServer;
+static void Disconnect(CaptainJack_XmitConnection *connection) {
+	close(connection->socket);
+	connection->socket = -1;
+	connection->header.id = XMPC_NONE;
+	connection->retryAt = Now(&connection->options);
+	connection->resyncRequested = false;
 }
 
-void CaptainJack_RegisterXmitterClient(CaptainJack_Xmitter *xmitter) {
-	if (gXmitterClient != NULL) {
-		syslog(LOG_NOTICE, "CaptainJack:RegisterXmitterClient: warning, you're overwriting a previously specified xmitter client");
+static bool SendReply(CaptainJack_XmitConnection *connection, Proto_ReplyId id, uint32_t seq) {
+	Proto_Reply reply = { id, seq, connection->seenSession };
+	ssize_t sent = send(connection->socket, &reply, sizeof(reply), kXmit_SendFlags);
+
+	if (sent != (ssize_t) sizeof(reply)) {
+		// the device reads these as fast as they come, so this is a broken connection
+		CaptainJack_Log(LOG_ERR, "SendReply: could not send reply %d: %s", id, sent == -1 ? strerror(errno) : "short write");
+		CaptainJack_CountStat(kStat_XmitErrors, 1);
+		Disconnect(connection);
+		return false;
+	}
+
+	CaptainJack_CountStat(kStat_XmitBytesSent, sizeof(reply));
+	if (id == XMPR_ACK) {
+		connection->ackedUpTo = seq;
+	}
+	return true;
+}
+
+static bool AssertConnected(CaptainJack_XmitConnection *connection) {
+	if (connection->socket >= 0) {
+		return true;
+	}
+
+	// still waiting out the last failure
+	uint64_t now = Now(&connection->options);
+	if (now < connection->retryAt) {
+		return false;
+	}
+
+	const CaptainJack_XmitHooks *hooks = &connection->options.hooks;
+	connection->socket = hooks->connect != NULL ? hooks->connect(hooks->context) : ConnectTCP(connection->options.port);
+	if (connection->socket < 0) {
+		// the device isn't up (or is restarting); only worth a log line on the first try
+		if (connection->backoff == 0) {
+			CaptainJack_Log(LOG_NOTICE, "AssertConnected: connect failed: %s; will keep trying", strerror(errno));
+		}
+		connection->socket = -1;
+		connection->backoff = NextBackoff(connection->backoff);
+		connection->retryAt = now + connection->backoff;
+		return false;
+	}
+
+	fcntl(connection->socket, F_SETFL, O_NONBLOCK);
+
+	// tell the device where we left off, so it knows whether to fill us in or start over
+	uint32_t last = connection->expected != 0 ? connection->expected - 1 : 0;
+	if (!SendReply(connection, XMPR_HELLO, last)) {
+		return false;
+	}
+	connection->ackedUpTo = last;
+
+	// made up locally, so it skips the sequence checks
+	connection->header.id = XMPC_READY;
+	connection->header.seq = 0;
+	connection->backoff = 0;
+
+	CaptainJack_Log(LOG_NOTICE, "AssertConnected: connected to device. Yargh!");
+	CaptainJack_CountStat(kStat_XmitReconnects, 1);
+
+	return true;
+}
+
+CaptainJack_XmitConnection * CaptainJack_OpenXmitConnection(const CaptainJack_XmitHandlers *handlers, void *context, const CaptainJack_XmitOptions *options) {
+	CaptainJack_XmitConnection *connection = calloc(1, sizeof(*connection));
+	if (connection == NULL) {
+		CaptainJack_Log(LOG_ERR, "CaptainJack_OpenXmitConnection: out of memory");
+		return NULL;
+	}
+
+	connection->handlers = *handlers;
+	connection->context = context;
+	if (options != NULL) {
+		connection->options = *options;
+	} else {
+		CaptainJack_InitXmitOptions(&connection->options);
+	}
+
+	connection->socket = -1;
+	connection->header.id = XMPC_NONE;
+	return connection;
+}
+
+void CaptainJack_CloseXmitConnection(CaptainJack_XmitConnection *connection) {
+	if (connection == NULL) {
+		return;
+	}
+
+	if (connection->socket >= 0) {
+		close(connection->socket);
 	}
 
-	gXmitterClient = xmitter;
+	free(connection);
 }
 
 /*
@@ -248,115 +1069,326 @@ void CaptainJack_RegisterXmitterClient(CaptainJack_Xmitter *xmitter) {
 	us there.
 */
 
-size_t GetBytesAvailable(void) {
+static size_t GetBytesAvailable(const CaptainJack_XmitConnection *connection) {
 	size_t available = 0;
-	ioctl(gSocket, FIONREAD, &available);
+	ioctl(connection->socket, FIONREAD, &available);
 	return available;
 }
 
-bool ReadMessage(void *out, size_t length) {
-	ssize_t nread = read(gSocket, out, length);
+/*
+	FIONREAD can't tell a quiet device from one that went away;
+	a peek can, without taking anything out of the stream
+*/
+static bool PeerHungUp(const CaptainJack_XmitConnection *connection) {
+	char byte;
+	ssize_t peeked = recv(connection->socket, &byte, 1, MSG_PEEK);
+	return peeked == 0 || (peeked == -1 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR);
+}
+
+static bool ReadMessage(CaptainJack_XmitConnection *connection, void *out, size_t length) {
+	ssize_t nread = read(connection->socket, out, length);
 
 	if (nread == -1) {
-		syslog(LOG_ERR, "ReadMessage: error reading message: %s", strerror(errno));
+		CaptainJack_Log(LOG_ERR, "ReadMessage: error reading message: %s", strerror(errno));
+		CaptainJack_CountStat(kStat_XmitErrors, 1);
+		Disconnect(connection);
 		return false;
 	}
 
+	CaptainJack_CountStat(kStat_XmitBytesReceived, (uint64_t) nread);
 	return true;
 }
 
-bool CaptainJack_TickXmitter(void) {
-	if (gXmitterClient == NULL) {
-		syslog(LOG_ERR, "CaptainJack_TickXmitter: cannot tick; you haven't specified a client yet");
-		return false;
+static size_t MessageLength(uint32_t id) {
+	switch (id) {
+	case XMPC_READY:
+		return 0;
+	case XMPC_NEW_CLIENT:
+	case XMPC_CLIENT_DISCONNECT:
+		return sizeof(Proto_PIDCIDMessage);
+	case XMPC_CLIENT_ENABLE_IO:
+	case XMPC_CLIENT_DISABLE_IO:
+		return sizeof(Proto_CIDMessage);
+	case XMPC_CLIENT_SILENCE:
+		return sizeof(Proto_SilenceMessage);
+	case XMPC_SNAPSHOT:
+		return sizeof(Proto_SnapshotMessage);
+	default:
+		return SIZE_MAX;
 	}
+}
 
-	if (!AssertConnected()) {
-		return false;
+/*
+	checks a message's place in the stream, counting anything out of
+	the ordinary. returns false for a duplicate, which gets read and
+	thrown away; a gap is still delivered, but we ask for a snapshot
+	since whatever fell in it is gone.
+*/
+static bool CheckSequence(CaptainJack_XmitConnection *connection, const Proto_Header *header) {
+	if (header->seq == 0) {
+		return true;
 	}
 
-	size_t available = GetBytesAvailable();
+	if (Now(&connection->options) - header->sent > kXmit_LateAfter) {
+		CaptainJack_CountStat(kStat_XmitLate, 1);
+	}
 
-	if (gTickHeader == XMPC_NONE) {
-		if (available < sizeof(gTickHeader)) {
-			return true;
-		}
+	// a snapshot replaces everything before it, so it's always where we are
+	if (header->id == XMPC_SNAPSHOT) {
+		connection->expected = header->seq + 1;
+		connection->resyncRequested = false;
+		return true;
+	}
 
-		if (read(gSocket, &gTickHeader, sizeof(gTickHeader)) == -1) {
-			syslog(LOG_ERR, "CaptainJack_TickXmitter: problem when reading message header: %s", strerror(errno));
-			return false;
+	if (connection->expected != 0 && header->seq < connection->expected) {
+		CaptainJack_CountStat(kStat_XmitDuplicates, 1);
+		return false;
+	}
+
+	if (connection->expected != 0 && header->seq > connection->expected) {
+		CaptainJack_Log(LOG_ERR, "CheckSequence: expected message %u, got %u; asking for a snapshot", connection->expected, header->seq);
+		CaptainJack_CountStat(kStat_XmitLost, header->seq - connection->expected);
+		if (!connection->resyncRequested && SendReply(connection, XMPR_RESYNC, connection->expected - 1)) {
+			connection->resyncRequested = true;
 		}
+	}
+
+	connection->expected = header->seq + 1;
+	return true;
+}
 
-		available -= sizeof(gTickHeader);
+bool CaptainJack_TickXmitConnection(CaptainJack_XmitConnection *connection) {
+	if (!AssertConnected(connection)) {
+		return false;
 	}
 
-	bool result = true;
-	switch (gTickHeader) {
-	case XMPC_NONE:
-		// strange...
-		syslog(LOG_NOTICE, "CaptainJack_TickXmitter: came across XMPC_NONE... not sure why...");
-		break;
-	case XMPC_READY:
-		gXmitterClient->do_device_ready();
-		break;
-	case XMPC_NEW_CLIENT: {
-		if (available < sizeof(Proto_PIDCIDMessage)) {
+	size_t available = GetBytesAvailable(connection);
+	CaptainJack_SetGauge(kGauge_XmitPendingBytes, (double) available);
+
+	if (available == 0 && connection->header.id == XMPC_NONE && PeerHungUp(connection)) {
+		// coreaudiod restarted, most likely; the next connection starts with a snapshot
+		CaptainJack_Log(LOG_NOTICE, "CaptainJack_TickXmitConnection: the device hung up; reconnecting");
+		Disconnect(connection);
+		return false;
+	}
+
+	if (connection->header.id == XMPC_NONE) {
+		if (available < sizeof(connection->header)) {
 			return true;
 		}
 
-		Proto_PIDCIDMessage msg;
-		if (!ReadMessage(&msg, sizeof(msg))) {
+		if (read(connection->socket, &connection->header, sizeof(connection->header)) == -1) {
+			CaptainJack_Log(LOG_ERR, "CaptainJack_TickXmitConnection: problem when reading message header: %s", strerror(errno));
+			CaptainJack_CountStat(kStat_XmitErrors, 1);
+			Disconnect(connection);
 			return false;
 		}
 
-		gXmitterClient->do_client_connect(msg.cid, msg.pid);
-		break;
+		CaptainJack_CountStat(kStat_XmitBytesReceived, sizeof(connection->header));
+		available -= sizeof(connection->header);
 	}
-	case XMPC_CLIENT_DISCONNECT: {
-		if (available < sizeof(Proto_PIDCIDMessage)) {
-			return true;
-		}
 
-		Proto_PIDCIDMessage msg;
-		if (!ReadMessage(&msg, sizeof(msg))) {
-			return false;
-		}
+	size_t length = MessageLength(connection->header.id);
+	if (length == SIZE_MAX) {
+		// we've lost our place in the stream; start over, snapshot and all
+		CaptainJack_Log(LOG_NOTICE, "CaptainJack_TickXmitConnection: encountered unknown xmit message header: %u", connection->header.id);
+		CaptainJack_CountStat(kStat_XmitErrors, 1);
+		connection->expected = 0;
+		connection->seenSession = 0;
+		Disconnect(connection);
+		return false;
+	}
 
-		gXmitterClient->do_client_disconnect(msg.cid, msg.pid);
-		break;
+	if (available < length) {
+		return true;
 	}
-	case XMPC_CLIENT_ENABLE_IO: {
-		if (available < sizeof(Proto_CIDMessage)) {
-			return true;
-		}
 
-		Proto_CIDMessage msg;
-		if (!ReadMessage(&msg, sizeof(msg))) {
-			return false;
-		}
+	union {
+		Proto_PIDCIDMessage   pidcid;
+		Proto_CIDMessage      cid;
+		Proto_SilenceMessage  silence;
+		Proto_SnapshotMessage snapshot;
+	} msg;
 
-		gXmitterClient->do_client_enable_io(msg.cid);
-		break;
+	if (length > 0 && !ReadMessage(connection, &msg, length)) {
+		return false;
 	}
-	case XMPC_CLIENT_DISABLE_IO: {
-		if (available < sizeof(Proto_CIDMessage)) {
-			return true;
-		}
+	available -= length;
 
-		Proto_CIDMessage msg;
-		if (!ReadMessage(&msg, sizeof(msg))) {
-			return false;
+	Proto_MessageId id = (Proto_MessageId) connection->header.id;
+	bool deliver = CheckSequence(connection, &connection->header);
+	connection->header.id = XMPC_NONE;
+
+	if (!deliver || connection->socket < 0) {
+		return connection->socket >= 0;
+	}
+
+	const CaptainJack_XmitHandlers *handlers = &connection->handlers;
+	void *context = connection->context;
+
+	CaptainJack_TraceBegin("xmit receive", kMessage_Names[id]);
+	switch (id) {
+	case XMPC_READY:
+		handlers->device_ready(context);
+		break;
+	case XMPC_NEW_CLIENT:
+		handlers->client_connect(context, msg.pidcid.cid, msg.pidcid.pid);
+		break;
+	case XMPC_CLIENT_DISCONNECT:
+		handlers->client_disconnect(context, msg.pidcid.cid, msg.pidcid.pid);
+		break;
+	case XMPC_CLIENT_ENABLE_IO:
+		handlers->client_enable_io(context, msg.cid.cid);
+		break;
+	case XMPC_CLIENT_DISABLE_IO:
+		handlers->client_disable_io(context, msg.cid.cid);
+		break;
+	case XMPC_CLIENT_SILENCE:
+		handlers->client_silence(context, msg.silence.cid, msg.silence.silent != 0);
+		break;
+	case XMPC_SNAPSHOT: {
+		CaptainJack_XmitClient clients[kXmit_MaxClients];
+		unsigned int count = msg.snapshot.count < kXmit_MaxClients ? msg.snapshot.count : kXmit_MaxClients;
+		for (unsigned int i = 0; i < count; i++) {
+			clients[i].cid = msg.snapshot.clients[i].cid;
+			clients[i].pid = msg.snapshot.clients[i].pid;
+			clients[i].io = msg.snapshot.clients[i].io != 0;
+			clients[i].silent = msg.snapshot.clients[i].silent != 0;
 		}
 
-		gXmitterClient->do_client_disable_io(msg.cid);
+		connection->seenSession = msg.snapshot.session;
+		handlers->snapshot(context, clients, count);
 		break;
 	}
 	default:
-		syslog(LOG_NOTICE, "CaptainJack_TickXmitter: encountered unknown xmit message header: %d", gTickHeader);
-		result = false;
+		// strange...
+		CaptainJack_Log(LOG_NOTICE, "CaptainJack_TickXmitConnection: came across XMPC_NONE... not sure why...");
+		break;
+	}
+	CaptainJack_TraceEnd("xmit receive", kMessage_Names[id]);
+
+	if ((unsigned int) id < kStats_MessageTypes) {
+		CaptainJack_CountStat(kStat_XmitMessagesReceived + id, 1);
+	}
+
+	// acks go out in batches, or once we've caught up
+	uint32_t last = connection->expected - 1;
+	if (connection->expected != 0 && last != connection->ackedUpTo && (last - connection->ackedUpTo >= kXmit_AckEvery || available == 0)) {
+		SendReply(connection, XMPR_ACK, last);
+	}
+
+	return connection->socket >= 0;
+}
+
+/*
+	the device's and the daemon's own instances, behind the
+	CaptainJack_Xmitter tables they've always used
+*/
+static pthread_once_t              gServerOnce      = PTHREAD_ONCE_INIT;
+static CaptainJack_XmitServer     *gServer          = NULL;
+static CaptainJack_XmitConnection *gConnection      = NULL;
+
+static void StartServer(void) {
+	gServer = CaptainJack_StartXmitServer(NULL);
+}
+
+static void Send_DeviceReady(void) {
+	CaptainJack_XmitDeviceReady(gServer);
+}
+
+static void Send_NewClient(unsigned int cid, pid_t pid) {
+	CaptainJack_XmitClientConnect(gServer, cid, pid);
+}
+
+static void Send_DCClient(unsigned int cid, pid_t pid) {
+	CaptainJack_XmitClientDisconnect(gServer, cid, pid);
+}
+
+static void Send_ClientEnableIO(unsigned int cid) {
+	CaptainJack_XmitClientEnableIO(gServer, cid);
+}
+
+static void Send_ClientDisableIO(unsigned int cid) {
+	CaptainJack_XmitClientDisableIO(gServer, cid);
+}
+
+static void Send_ClientSilence(unsigned int cid, bool silent) {
+	CaptainJack_XmitClientSilence(gServer, cid, silent);
+}
+
+static void Send_Snapshot(const CaptainJack_XmitClient *clients, unsigned int count) {
+	// the device is the one that sends these, on its own
+	CaptainJack_Log(LOG_NOTICE, "Send_Snapshot: snapshots aren't sent on request");
+}
+
+static CaptainJack_Xmitter gXmitterServer = {
+	&Send_DeviceReady,
+	&Send_NewClient,
+	&Send_DCClient,
+	&Send_ClientEnableIO,
+	&Send_ClientDisableIO,
+	&Send_ClientSilence,
+	&Send_Snapshot,
+};
+
+CaptainJack_Xmitter * CaptainJack_GetXmitterServer(void) {
+	pthread_once(&gServerOnce, &StartServer);
+	return &gXmitterServer;
+}
+
+static void Receive_DeviceReady(void *context) {
+	((CaptainJack_Xmitter *) context)->do_device_ready();
+}
+
+static void Receive_NewClient(void *context, unsigned int cid, pid_t pid) {
+	((CaptainJack_Xmitter *) context)->do_client_connect(cid, pid);
+}
+
+static void Receive_DCClient(void *context, unsigned int cid, pid_t pid) {
+	((CaptainJack_Xmitter *) context)->do_client_disconnect(cid, pid);
+}
+
+static void Receive_ClientEnableIO(void *context, unsigned int cid) {
+	((CaptainJack_Xmitter *) context)->do_client_enable_io(cid);
+}
+
+static void Receive_ClientDisableIO(void *context, unsigned int cid) {
+	((CaptainJack_Xmitter *) context)->do_client_disable_io(cid);
+}
+
+static void Receive_ClientSilence(void *context, unsigned int cid, bool silent) {
+	((CaptainJack_Xmitter *) context)->do_client_silence(cid, silent);
+}
+
+static void Receive_Snapshot(void *context, const CaptainJack_XmitClient *clients, unsigned int count) {
+	((CaptainJack_Xmitter *) context)->do_snapshot(clients, count);
+}
+
+static const CaptainJack_XmitHandlers kXmitterHandlers = {
+	&Receive_DeviceReady,
+	&Receive_NewClient,
+	&Receive_DCClient,
+	&Receive_ClientEnableIO,
+	&Receive_ClientDisableIO,
+	&Receive_ClientSilence,
+	&Receive_Snapshot,
+};
+
+void CaptainJack_RegisterXmitterClient(CaptainJack_Xmitter *xmitter) {
+	if (gConnection != NULL) {
+		CaptainJack_Log(LOG_NOTICE, "CaptainJack:RegisterXmitterClient: warning, you're overwriting a previously specified xmitter client");
+		gConnection->context = xmitter;
+		return;
 	}
 
-	gTickHeader = XMPC_NONE;
+	gConnection = CaptainJack_OpenXmitConnection(&kXmitterHandlers, xmitter, NULL);
+}
+
+bool CaptainJack_TickXmitter(void) {
+	if (gConnection == NULL) {
+		CaptainJack_Log(LOG_ERR, "CaptainJack_TickXmitter: cannot tick; you haven't specified a client yet");
+		return false;
+	}
 
-	return result;
+	return CaptainJack_TickXmitConnection(gConnection);
 }
@@ -35,10 +35,39 @@
 	method, the message is transmitted and processed
 	automatically by the daemon which invokes a callback
 	in the daemon to process the message.
+
+	underneath, each side is an instance: a server (the
+	device's end) or a connection (the daemon's), as many
+	of either as you like in one process, each with its
+	own socket, thread and state. how they reach each
+	other and tell the time can be swapped out, so one
+	process can run several devices, or both ends, on
+	whatever sockets it likes. the global functions further
+	down are one of each, on the default port, for the
+	device and the daemon themselves. stats are counted
+	across every instance.
 */
 
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdlib.h>
+#include <sys/types.h>
+
+#define kXmit_MaxClients 64
+#define kXmit_Port       50963
+
+/*
+	one client as the device sees it; the device keeps a
+	table of these and hands the whole thing over every time
+	a daemon connects, so a daemon that restarted (or missed
+	messages while it was gone) can catch up
+*/
+typedef struct {
+	unsigned int cid;
+	pid_t        pid;
+	bool         io;
+	bool         silent;
+} CaptainJack_XmitClient;
 
 typedef struct {
 	/*
@@ -62,13 +91,33 @@ typedef struct {
 	void (*do_client_enable_io)(unsigned int);
 
 	/*
-		called when a client disables their I/O stream
+		called when a client disables their I/O stream.
+		the device holds these back for a moment, and drops
+		them along with the next enable if it comes first
 	*/
 	void (*do_client_disable_io)(unsigned int);
+
+	/*
+		called when a client's output goes silent (true)
+		or stops being silent (false)
+	*/
+	void (*do_client_silence)(unsigned int, bool);
+
+	/*
+		called with every client the device knows about
+		when the daemon (re)connects. this is the truth;
+		anything else the daemon thought it knew is stale
+	*/
+	void (*do_snapshot)(const CaptainJack_XmitClient *, unsigned int);
 } CaptainJack_Xmitter;
 
 /*
-	gets an xmitter server for the driver device
+	gets an xmitter server for the driver device. the
+	first call starts a thread that waits for the daemon
+	to connect, so none of the methods ever block on it;
+	whatever is sent while no daemon is connected is
+	dropped, and made up for by the snapshot the daemon
+	gets when it does connect.
 
 	NOTE: this is for the device driver!
 */
@@ -86,8 +135,119 @@ void CaptainJack_RegisterXmitterClient(CaptainJack_Xmitter *);
 	processes any and all pending messages.
 	call this ~f r e q u e n t l y~.
 
+	returns false while there's no connection to the
+	device. it reconnects on its own, backing off from
+	10ms up to 2s between attempts, so just keep calling.
+
 	NOTE: this is for the daemon!
 */
 bool CaptainJack_TickXmitter(void);
 
+/*
+	gets a short name for a message id (for logs and
+	stats), or NULL if there's no such message
+*/
+const char * CaptainJack_XmitMessageName(unsigned int id);
+
+typedef struct CaptainJack_XmitServer     CaptainJack_XmitServer;
+typedef struct CaptainJack_XmitConnection CaptainJack_XmitConnection;
+
+/*
+	what a connection calls as messages come in; the same
+	as CaptainJack_Xmitter's, with the `context` it was
+	opened with first
+*/
+typedef struct {
+	void (*device_ready)(void *context);
+	void (*client_connect)(void *context, unsigned int, pid_t);
+	void (*client_disconnect)(void *context, unsigned int, pid_t);
+	void (*client_enable_io)(void *context, unsigned int);
+	void (*client_disable_io)(void *context, unsigned int);
+	void (*client_silence)(void *context, unsigned int, bool);
+	void (*snapshot)(void *context, const CaptainJack_XmitClient *, unsigned int);
+} CaptainJack_XmitHandlers;
+
+/*
+	how an instance reaches the other side, and its clock.
+	any left NULL is the default: TCP on the options'
+	port, and CaptainJack_Now().
+
+	`listen` gives a server a socket to accept() daemons on,
+	and `connect` gives a connection a stream socket that's
+	connected to a server; -1 (with errno set) if they
+	can't, and they'll be asked again after a backoff. both
+	ends have to share the clock, since message timestamps
+	from one are compared against the other's.
+*/
+typedef struct {
+	int      (*listen)(void *context);
+	int      (*connect)(void *context);
+	uint64_t (*now)(void *context);
+	void      *context;
+} CaptainJack_XmitHooks;
+
+typedef struct {
+	/*
+		the default transport's port
+	*/
+	uint16_t              port;
+
+	/*
+		how long a server holds StopIOs back, in
+		milliseconds; 0 sends them straight away
+	*/
+	unsigned int          coalesceMillis;
+
+	CaptainJack_XmitHooks hooks;
+} CaptainJack_XmitOptions;
+
+/*
+	fills in the defaults: kXmit_Port, the default hooks,
+	and the coalesce window from CAPTAIN_JACK_IO_COALESCE_MS
+	(or 50ms)
+*/
+void CaptainJack_InitXmitOptions(CaptainJack_XmitOptions *options);
+
+/*
+	starts a server and its thread. `options` may be NULL for
+	the defaults. returns NULL (and logs why) if it can't
+*/
+CaptainJack_XmitServer * CaptainJack_StartXmitServer(const CaptainJack_XmitOptions *options);
+
+/*
+	stops a server's thread, hangs up on its daemon and frees
+	it. nothing else may be calling into it
+*/
+void CaptainJack_StopXmitServer(CaptainJack_XmitServer *server);
+
+/*
+	a server's side of CaptainJack_Xmitter: each queues a
+	message for the server's thread and returns straight away.
+	callable from any thread at once
+*/
+void CaptainJack_XmitDeviceReady(CaptainJack_XmitServer *server);
+void CaptainJack_XmitClientConnect(CaptainJack_XmitServer *server, unsigned int cid, pid_t pid);
+void CaptainJack_XmitClientDisconnect(CaptainJack_XmitServer *server, unsigned int cid, pid_t pid);
+void CaptainJack_XmitClientEnableIO(CaptainJack_XmitServer *server, unsigned int cid);
+void CaptainJack_XmitClientDisableIO(CaptainJack_XmitServer *server, unsigned int cid);
+void CaptainJack_XmitClientSilence(CaptainJack_XmitServer *server, unsigned int cid, bool silent);
+
+/*
+	a connection to a server, which calls `handlers` with
+	`context`. it doesn't connect until it's first ticked.
+	`options` may be NULL for the defaults
+*/
+CaptainJack_XmitConnection * CaptainJack_OpenXmitConnection(const CaptainJack_XmitHandlers *handlers, void *context, const CaptainJack_XmitOptions *options);
+
+/*
+	hangs up and frees a connection
+*/
+void CaptainJack_CloseXmitConnection(CaptainJack_XmitConnection *connection);
+
+/*
+	CaptainJack_TickXmitter(), for one connection. only one
+	thread may tick a connection at a time
+*/
+bool CaptainJack_TickXmitConnection(CaptainJack_XmitConnection *connection);
+
 #endif